@@ -0,0 +1,241 @@
+/**
+ * @file adc_benchmark.cpp
+ * @author Kalina Knight
+ * @brief Times & measures the spread of AnalogSensor readings: the old single sample after a 1 ms settle against
+ * bursts of samples, with & without the SAADC's oversampling, and sensors read one by one against one adcManager scan.
+ * Host (native) only, in simulated time.
+ *
+ * @details For each way of reading it prints the time of a reading, and the mean, standard deviation & worst error of
+ * BENCH_READINGS readings against the simulated pin voltage. Then the time of reading two sensors with different ADC
+ * parameters alternately, which sets the ADC up for each reading, against reading them with the same parameters.
+ * Finally the time of reading the battery & a sensor on WB_A1 each wake, one by one & with one scan of the ADC, and
+ * the standard deviation of each.
+ *
+ * Build & run: pio run -e native_adc_bench -t exec
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "ADCManager.h"   /**< ADC scans being timed. */
+#include "AnalogSensor.h" /**< ADC readings being timed. */
+#include "NativeSim.h"    /**< Simulated time & pin voltages. */
+
+#define BENCH_READINGS 1000 /**< Readings of each way of reading. */
+
+/**
+ * @brief Time & spread of the readings.
+ */
+struct readingStats {
+    double us;       /**< Time of a reading. */
+    double mean_mv;  /**< Mean of the readings. */
+    double stdev_mv; /**< Standard deviation of the readings. */
+    double worst_mv; /**< Largest error of a reading against the pin voltage. */
+};
+
+/**
+ * @brief Take BENCH_READINGS readings.
+ * @param truth_mv Voltage the readings should be.
+ * @param read Function that takes a reading, in mV.
+ * @return Time & spread of the readings.
+ */
+template <typename F> static readingStats measure(float truth_mv, F read) {
+    double sum = 0;
+    double sum_sq = 0;
+    double worst = 0;
+    uint64_t start_us = nativeSimMicros();
+    for (uint16_t i = 0; i < BENCH_READINGS; i++) {
+        double mv = read();
+        sum += mv;
+        sum_sq += mv * mv;
+        worst = (fabs(mv - truth_mv) > worst) ? fabs(mv - truth_mv) : worst;
+    }
+    double us = (double)(nativeSimMicros() - start_us) / BENCH_READINGS;
+    double mean = sum / BENCH_READINGS;
+    double variance = (sum_sq / BENCH_READINGS) - (mean * mean);
+    return { us, mean, sqrt((variance > 0) ? variance : 0), worst };
+}
+
+/**
+ * @brief Print a row of readingStats.
+ */
+static void printStats(const char *name, const readingStats &stats) {
+    Serial.printf("%-34s %10.1f %10.2f %10.2f %10.2f\n", name, stats.us, stats.mean_mv, stats.stdev_mv,
+                  stats.worst_mv);
+}
+
+/**
+ * @brief Read the battery voltage as AnalogSensor used to: set the ADC up, wait 1 ms for it to settle, take a single
+ * sample.
+ * @return Battery voltage in mV.
+ */
+static float legacyBatteryMV(void) {
+    analogReference(AR_INTERNAL_3_0);
+    analogReadResolution(12);
+    analogOversampling(DEFAULT_OVERSAMPLING);
+    delay(1);
+    return (float)analogRead(BATTERY_PIN) * BATTERY_COMPENSATION_FACTOR * (3000.0F / 4096);
+}
+
+/**
+ * @brief Compare the old battery reading against BatteryLevel's default burst.
+ */
+static void benchmarkBattery(void) {
+    Serial.printf("Battery voltage (%d readings each)\n", BENCH_READINGS);
+    Serial.printf("%-34s %10s %10s %10s %10s\n", "reading", "us", "mean mV", "stdev mV", "worst mV");
+
+    // the battery discharges by 1 mV/hour, so it's as good as constant here
+    float truth_mv = nativeSimPinMV(BATTERY_PIN) * BATTERY_COMPENSATION_FACTOR;
+
+    printStats("1 ms settle + 1 sample (old)", measure(truth_mv, legacyBatteryMV));
+    // the ADC was set up directly
+    AnalogSensor::resetADCConfig();
+
+    BatteryLevel battery;
+    battery.ADCInit();
+    printStats("BatteryLevel default burst", measure(truth_mv, [&] { return battery.getSensorMV(); }));
+}
+
+/**
+ * @brief Compare burst settings on a sensor pin.
+ */
+static void benchmarkBursts(void) {
+    Serial.printf("\nBurst settings on WB_A1, 3.0V reference, 12-bit (%d readings each)\n", BENCH_READINGS);
+    Serial.printf("%-34s %10s %10s %10s %10s\n", "oversampling x samples reduction", "us", "mean mV", "stdev mV",
+                  "worst mV");
+
+    const struct {
+        uint32_t oversampling;
+        uint8_t n_samples;
+        ADC_REDUCTION reduction;
+    } settings[] = {
+        { 0, 1, ADC_REDUCTION::MEAN },    { 0, 5, ADC_REDUCTION::MEDIAN }, { 0, 8, ADC_REDUCTION::MEAN },
+        { 8, 1, ADC_REDUCTION::MEAN },    { 8, 5, ADC_REDUCTION::MEDIAN }, { 8, 8, ADC_REDUCTION::MEAN },
+        { 32, 5, ADC_REDUCTION::MEDIAN }, { 32, 16, ADC_REDUCTION::MEAN },
+    };
+    float truth_mv = nativeSimPinMV(WB_A1);
+    char name[40] = {};
+    for (const auto &setting : settings) {
+        AnalogSensor sensor(WB_A1, AR_INTERNAL_3_0, 12, setting.oversampling);
+        sensor.setBurst(setting.n_samples, setting.reduction);
+        sensor.ADCInit();
+        uint32_t oversampling = (setting.oversampling == 0) ? 1 : setting.oversampling;
+        snprintf(name, sizeof(name), "%3lux %2u %s", (unsigned long)oversampling, setting.n_samples,
+                 (setting.reduction == ADC_REDUCTION::MEAN) ? "mean" : "median");
+        printStats(name, measure(truth_mv, [&] { return sensor.getSensorMV(); }));
+    }
+}
+
+/**
+ * @brief Time two sensors read alternately, with different & with the same ADC parameters.
+ */
+static void benchmarkReconfiguration(void) {
+    Serial.printf("\nTwo sensors read alternately (%d readings each)\n", BENCH_READINGS);
+    Serial.printf("%-34s %10s\n", "ADC parameters", "us");
+
+    BatteryLevel battery;
+    battery.ADCInit();
+    AnalogSensor same(WB_A1, AR_INTERNAL_3_0, 12, BATTERY_OVERSAMPLING);
+    AnalogSensor different(WB_A1, AR_INTERNAL, 12, BATTERY_OVERSAMPLING);
+
+    bool toggle = false;
+    readingStats stats = measure(0, [&] { return (toggle = !toggle) ? battery.getSensorMV() : same.getSensorMV(); });
+    Serial.printf("%-34s %10.1f\n", "same", stats.us);
+    stats = measure(0, [&] { return (toggle = !toggle) ? battery.getSensorMV() : different.getSensorMV(); });
+    Serial.printf("%-34s %10.1f\n", "different", stats.us);
+}
+
+/**
+ * @brief Time BENCH_READINGS wakes that read the battery & a sensor, and print the time & spread of each.
+ * @param name Row name.
+ * @param read Function that reads both: read(float *battery_mv, float *sensor_mv).
+ */
+template <typename F> static void measureWake(const char *name, F read) {
+    double sum[2] = {};
+    double sum_sq[2] = {};
+    float mv[2] = {};
+    uint64_t start_us = nativeSimMicros();
+    for (uint16_t i = 0; i < BENCH_READINGS; i++) {
+        read(&mv[0], &mv[1]);
+        for (uint8_t s = 0; s < 2; s++) {
+            sum[s] += mv[s];
+            sum_sq[s] += (double)mv[s] * mv[s];
+        }
+    }
+    double us = (double)(nativeSimMicros() - start_us) / BENCH_READINGS;
+    double stdev[2] = {};
+    for (uint8_t s = 0; s < 2; s++) {
+        double mean = sum[s] / BENCH_READINGS;
+        double variance = (sum_sq[s] / BENCH_READINGS) - (mean * mean);
+        stdev[s] = sqrt((variance > 0) ? variance : 0);
+    }
+    Serial.printf("%-34s %10.1f %10.2f %10.2f\n", name, us, stdev[0], stdev[1]);
+}
+
+/**
+ * @brief Compare reading the battery & a sensor one by one against one adcManager scan, with the sensor on the
+ * battery's reference (e.g. a RAK5811) & on another (e.g. a RAK5801).
+ */
+static void benchmarkScan(void) {
+    Serial.printf("\nBattery + WB_A1 each wake, 8x oversampling (%d wakes each)\n", BENCH_READINGS);
+    Serial.printf("%-34s %10s %10s %10s\n", "sensor reference, reading", "us", "bat stdev", "A1 stdev");
+
+    BatteryLevel battery;
+    battery.ADCInit();
+    const struct {
+        const char *name;
+        _eAnalogReference analog_ref;
+    } sensors[] = { { "3.0V", AR_INTERNAL_3_0 }, { "3.6V", AR_INTERNAL } };
+    char name[40] = {};
+    for (const auto &setting : sensors) {
+        AnalogSensor sensor(WB_A1, setting.analog_ref, 12, BATTERY_OVERSAMPLING);
+        sensor.ADCInit();
+        adcManager adc;
+        adc.addSensor(&battery);
+        adc.addSensor(&sensor);
+
+        snprintf(name, sizeof(name), "%s, one by one", setting.name);
+        measureWake(name, [&](float *battery_mv, float *sensor_mv) {
+            *battery_mv = battery.getSensorMV();
+            *sensor_mv = sensor.getSensorMV();
+        });
+        snprintf(name, sizeof(name), "%s, one scan", setting.name);
+        measureWake(name, [&](float *battery_mv, float *sensor_mv) {
+            adc.scan();
+            *battery_mv = adc.getMV(&battery);
+            *sensor_mv = adc.getMV(&sensor);
+        });
+    }
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    Serial.begin(115200);
+
+    // the sensor logs would be timed too
+    setLogLevel(LOG_MODULE::SENSORS, LOG_LEVEL::NONE);
+    // the sensor on WB_A1 (e.g. a RAK5811) stays powered throughout
+    pinMode(WB_IO1, OUTPUT);
+    digitalWrite(WB_IO1, HIGH);
+
+    benchmarkBattery();
+    benchmarkBursts();
+    benchmarkReconfiguration();
+    benchmarkScan();
+    Serial.flush();
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
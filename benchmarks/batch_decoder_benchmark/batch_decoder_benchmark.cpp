@@ -0,0 +1,300 @@
+/**
+ * @file batch_decoder_benchmark.cpp
+ * @author Kalina Knight
+ * @brief Benchmarks decodeUplinkBatch() against decoding frame by frame with portSchema::decodePayloadToSensorData(),
+ * after checking the two give bit-for-bit identical results. Host (native) only.
+ * The batch decoder is timed with 1, 2, 4, ... threads up to the number of hardware threads.
+ *
+ * @details The batch is random sensor data encoded with the firmware encoder on every defined port, in runs of 1-32
+ * frames on the same port (as uplinks from a group of nodes might arrive), plus some truncated frames & undefined ports.
+ * A second batch of multi-sample frames, span reports & a clock sync request checks the rest of the uplinks the
+ * firmware sends. The run fails (exit code 1) if either check finds a difference.
+ *
+ * Build & run: pio run -e native_batch_bench -t exec
+ *
+ * @version 0.1
+ * @date 2022-02-17
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+#include <string.h>
+#include <thread>
+
+#include "CycleCounter.h"        /**< Cycle counter used for timing. */
+#include "PayloadBatchDecoder.h" /**< Batch decoder. */
+#include "PortSchema.h"          /**< Go here to see existing and define new sensor/port schemas. */
+#include "SpanProfiler.h"        /**< Span reports. */
+
+#define BENCH_FRAMES        1000000 /**< Frames in the batch. */
+#define BENCH_REPEATS       5       /**< Each decoder is timed this many times and the fastest is reported. */
+#define BENCH_FRAME_SAMPLES 16      /**< Samples per multi-sample frame in the check of the other uplinks. */
+
+static uint32_t rng_state = 1; /**< State of the random number generator, fixed so every run uses the same batch. */
+
+/**
+ * @brief Simple LCG so the batch doesn't depend on the host's rand().
+ * @return Pseudo random number.
+ */
+static uint32_t nextRandom(void) {
+    rng_state = (rng_state * 1664525UL) + 1013904223UL;
+    return (rng_state >> 8);
+}
+
+/**
+ * @brief Fill the sensor data with random values, occasionally invalid.
+ * @param data Sensor data to fill.
+ */
+static void randomSensorData(sensorData *data) {
+    data->battery_mv = { 3000.0F + (float)(nextRandom() % 1200), (nextRandom() % 32) != 0 };
+    data->temperature = { -40.0F + ((float)(nextRandom() % 12500) * 0.01F), (nextRandom() % 32) != 0 };
+    data->humidity = { (float)(nextRandom() % 1000) * 0.1F, (nextRandom() % 32) != 0 };
+    data->pressure = { 90000 + (nextRandom() % 20000), (nextRandom() % 32) != 0 };
+    data->gas_resist = { nextRandom() % 500000, (nextRandom() % 32) != 0 };
+    data->location = { -90.0F + ((float)(nextRandom() % 1800000) * 1e-4F),
+                       -180.0F + ((float)(nextRandom() % 3600000) * 1e-4F), (nextRandom() % 32) != 0 };
+    data->analog_mv = { (float)(nextRandom() % 8000), (nextRandom() % 32) != 0 };
+    data->timestamp = { 1644969600 + (nextRandom() % 31536000), (nextRandom() % 32) != 0 };
+}
+
+/**
+ * @brief Build the batch of uplink records.
+ * @param records Record buffer to fill.
+ */
+static void buildBatch(std::vector<uint8_t> *records) {
+    const size_t n_ports = sizeof(DEFINED_PORTS) / sizeof(DEFINED_PORTS[0]);
+    uint8_t payload[PAYLOAD_BUFFER_SIZE] = {};
+    sensorData data = {};
+
+    size_t n = 0;
+    while (n < BENCH_FRAMES) {
+        const portSchema &port = DEFINED_PORTS[nextRandom() % n_ports];
+        uint8_t port_number = ((nextRandom() % 256) == 0) ? 100 : port.port_number; // occasionally undefined
+        size_t run = 1 + (nextRandom() % 32);
+        for (size_t r = 0; (r < run) && (n < BENCH_FRAMES); r++, n++) {
+            randomSensorData(&data);
+            uint8_t len = port.encodeSensorDataToPayload(&data, payload);
+            if ((nextRandom() % 128) == 0) {
+                len = nextRandom() % len; // occasionally truncated
+            }
+            appendUplinkRecord(records, port_number, payload, len);
+        }
+    }
+}
+
+/**
+ * @brief Check a row of the columns is bit-for-bit the same as the sensor data decoded by the firmware decoder.
+ * @param columns Batch decoded columns.
+ * @param i Row.
+ * @param port_number Port the row should be on.
+ * @param len Length of the row's payload.
+ * @param expected Sensor data decoded by the firmware decoder.
+ * @return True if it's the same.
+ */
+static bool sameAsFrameDecoder(const sensorDataColumns &columns, size_t i, uint8_t port_number, uint8_t len,
+                               const sensorData &expected) {
+    sensorData got = {};
+    got.battery_mv = { columns.battery_mv[i], columns.isValid(SENSOR_FIELD::BATTERY_VOLTAGE, i) };
+    got.temperature = { columns.temperature[i], columns.isValid(SENSOR_FIELD::TEMPERATURE, i) };
+    got.humidity = { columns.humidity[i], columns.isValid(SENSOR_FIELD::RELATIVE_HUMIDITY, i) };
+    got.pressure = { columns.pressure[i], columns.isValid(SENSOR_FIELD::AIR_PRESSURE, i) };
+    got.gas_resist = { columns.gas_resist[i], columns.isValid(SENSOR_FIELD::GAS_RESISTANCE, i) };
+    // decodePayloadToSensorData() has one location flag, which the longitude (decoded last) sets if it fits
+    bool location_valid = columns.isValid(SENSOR_FIELD::LONGITUDE, i);
+    const portSchema &port = getPort(port_number);
+    if (port.sendLocation() && (len < port.payloadLength())) {
+        location_valid = columns.isValid(SENSOR_FIELD::LATITUDE, i);
+    }
+    got.location = { columns.latitude[i], columns.longitude[i], location_valid };
+    got.analog_mv = { columns.analog_mv[i], columns.isValid(SENSOR_FIELD::ANALOG, i) };
+    got.timestamp = { columns.timestamp[i], columns.isValid(SENSOR_FIELD::TIMESTAMP, i) };
+
+    return (columns.port[i] == port_number) && (memcmp(&got.battery_mv, &expected.battery_mv, sizeof(float)) == 0) &&
+           (got.battery_mv.is_valid == expected.battery_mv.is_valid) &&
+           (memcmp(&got.temperature, &expected.temperature, sizeof(float)) == 0) &&
+           (got.temperature.is_valid == expected.temperature.is_valid) &&
+           (memcmp(&got.humidity, &expected.humidity, sizeof(float)) == 0) &&
+           (got.humidity.is_valid == expected.humidity.is_valid) && (got.pressure.value == expected.pressure.value) &&
+           (got.pressure.is_valid == expected.pressure.is_valid) &&
+           (got.gas_resist.value == expected.gas_resist.value) &&
+           (got.gas_resist.is_valid == expected.gas_resist.is_valid) &&
+           (memcmp(&got.location, &expected.location, 2 * sizeof(float)) == 0) &&
+           (got.location.is_valid == expected.location.is_valid) &&
+           (memcmp(&got.analog_mv, &expected.analog_mv, sizeof(float)) == 0) &&
+           (got.analog_mv.is_valid == expected.analog_mv.is_valid) &&
+           (got.timestamp.value == expected.timestamp.value) &&
+           (got.timestamp.is_valid == expected.timestamp.is_valid);
+}
+
+/**
+ * @brief Check every frame in the columns is bit-for-bit the same as portSchema::decodePayloadToSensorData().
+ * @param records Record buffer.
+ * @param columns Batch decoded columns.
+ * @return Number of frames that differ.
+ */
+static size_t checkAgainstFrameDecoder(const std::vector<uint8_t> &records, const sensorDataColumns &columns) {
+    size_t mismatches = 0;
+    size_t pos = 0;
+    for (size_t i = 0; i < columns.n_frames; i++) {
+        uint8_t port_number = records[pos];
+        uint8_t len = records[pos + 1];
+        sensorData expected = getPort(port_number).decodePayloadToSensorData(&records[pos + 2], len);
+        pos += UPLINK_RECORD_HEADER_SIZE + len;
+        if (!sameAsFrameDecoder(columns, i, port_number, len, expected)) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * @brief Check the other uplinks the firmware sends: a multi-sample frame of every defined port must decode to a row
+ * per sample, each the same as portSchema::decodePayloadToSamples() gives, span reports to the same times as
+ * decodeSpanReport() (with times too long for the report saturating), and a clock sync request & an empty
+ * multi-sample frame must be counted rather than decoded.
+ * @return Number of rows, reports & counts that differ.
+ */
+static size_t checkOtherUplinks(void) {
+    const size_t n_ports = sizeof(DEFINED_PORTS) / sizeof(DEFINED_PORTS[0]);
+    std::vector<uint8_t> records;
+    std::vector<sensorData> expected;
+    std::vector<uint8_t> expected_ports;
+    sensorData samples[BENCH_FRAME_SAMPLES] = {};
+    uint8_t payload[UINT8_MAX] = {};
+    size_t mismatches = 0;
+
+    // slowly changing samples, as they would be taken
+    for (const portSchema &port : DEFINED_PORTS) {
+        randomSensorData(&samples[0]);
+        for (uint8_t s = 1; s < BENCH_FRAME_SAMPLES; s++) {
+            samples[s] = samples[s - 1];
+            samples[s].temperature.value += (float)(nextRandom() % 100) * 0.01F;
+            samples[s].timestamp.value += 300;
+        }
+        uint8_t n_encoded = 0;
+        uint8_t len = port.encodeSamplesToPayload(samples, BENCH_FRAME_SAMPLES, payload, sizeof(payload), &n_encoded);
+        appendUplinkRecord(&records, port.multiSamplePortNumber(), payload, len);
+        sensorData decoded[BENCH_FRAME_SAMPLES] = {};
+        uint8_t n_decoded = port.decodePayloadToSamples(payload, len, decoded, BENCH_FRAME_SAMPLES);
+        mismatches += (n_decoded != BENCH_FRAME_SAMPLES);
+        expected.insert(expected.end(), decoded, decoded + n_decoded);
+        expected_ports.insert(expected_ports.end(), n_decoded, port.port_number);
+    }
+
+    // a span report, with a span timed a few times
+    initSpans();
+    for (uint8_t r = 0; r < 3; r++) {
+        spanBegin(SPAN::SENSOR_READ);
+        delayMicroseconds(12345 * (r + 1));
+        spanEnd(SPAN::SENSOR_READ);
+    }
+    uint8_t report_len = encodeSpanReport(payload, sizeof(payload));
+    appendUplinkRecord(&records, DIAGNOSTICS_PORT, payload, report_len);
+    spanStats expected_spans[2][(uint8_t)SPAN::N_SPANS] = {};
+    decodeSpanReport(payload, report_len, expected_spans[0], (uint8_t)SPAN::N_SPANS);
+    mismatches += (expected_spans[0][(uint8_t)SPAN::SENSOR_READ].count != 3);
+
+    // & one with times up to longer than a report holds, e.g. RX windows timed with the tick, which must saturate
+    spanStats long_spans[(uint8_t)SPAN::N_SPANS] = {};
+    long_spans[(uint8_t)SPAN::RX_WINDOWS] = { 300, 2000000, 100000000, 250000000 };
+    report_len = encodeSpanReport(long_spans, payload, sizeof(payload));
+    appendUplinkRecord(&records, DIAGNOSTICS_PORT, payload, report_len);
+    decodeSpanReport(payload, report_len, expected_spans[1], (uint8_t)SPAN::N_SPANS);
+    const spanStats &rx_windows = expected_spans[1][(uint8_t)SPAN::RX_WINDOWS];
+    mismatches += (rx_windows.count != UINT8_MAX) + (rx_windows.min_us > 2000000) +
+                  (rx_windows.min_us < (2000000 - (2000000 >> (SPAN_REPORT_MANTISSA_BITS - 1)))) +
+                  (rx_windows.avg_us > 100000000) +
+                  (rx_windows.avg_us < (100000000 - (100000000 >> (SPAN_REPORT_MANTISSA_BITS - 1)))) +
+                  (rx_windows.max_us != SPAN_REPORT_MAX_US);
+
+    // a clock sync request, which isn't sensor data, & a multi-sample frame without any samples
+    const uint8_t app_time_req[] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    appendUplinkRecord(&records, 202, app_time_req, sizeof(app_time_req));
+    appendUplinkRecord(&records, DEFINED_PORTS[0].multiSamplePortNumber(), payload, 0);
+
+    sensorDataColumns columns;
+    batchDecodeResult result = decodeUplinkBatch(records.data(), records.size(), &columns);
+    mismatches += (result.n_frames != expected.size()) + (result.n_multi_sample_frames != n_ports) +
+                  (result.n_span_reports != 2) + (result.n_skipped != 1) + (result.n_invalid != 1);
+    for (size_t i = 0; (i < result.n_frames) && (i < expected.size()); i++) {
+        const uint8_t port_number = expected_ports[i];
+        mismatches += !sameAsFrameDecoder(columns, i, port_number, getPort(port_number).payloadLength(), expected[i]);
+    }
+    for (size_t r = 0; (r < columns.span_reports.n_reports) && (r < 2); r++) {
+        mismatches += (columns.span_reports.row[r] != expected.size());
+        for (uint8_t s = 0; s < (uint8_t)SPAN::N_SPANS; s++) {
+            mismatches += (memcmp(&columns.span_reports.spans[s][r], &expected_spans[r][s], sizeof(spanStats)) != 0);
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * @brief Print a row of results.
+ * @param name Row name.
+ * @param n_frames Frames decoded.
+ * @param cycles Cycles taken.
+ */
+static void printResult(const char *name, size_t n_frames, uint32_t cycles) {
+    double ns = (double)cyclesToNs(cycles);
+    Serial.printf("%-32s %10.1f %12.2f %14.0f\n", name, ns / 1e6, ns / (double)n_frames, (1e9 * n_frames) / ns);
+}
+
+void setup() {
+    cycleCounterInit();
+
+    std::vector<uint8_t> records;
+    buildBatch(&records);
+    Serial.printf("Batch decoder benchmark: %d frames, %u bytes of records\n", BENCH_FRAMES, (unsigned)records.size());
+
+    sensorDataColumns columns;
+    batchDecodeResult result = decodeUplinkBatch(records.data(), records.size(), &columns);
+    size_t mismatches = checkAgainstFrameDecoder(records, columns);
+    Serial.printf("Check against decodePayloadToSensorData(): %u frames decoded, %u differ\n",
+                  (unsigned)result.n_frames, (unsigned)mismatches);
+    size_t other_mismatches = checkOtherUplinks();
+    Serial.printf("Check of multi-sample frames, span reports & clock sync requests: %u differ\n\n",
+                  (unsigned)other_mismatches);
+    if ((mismatches != 0) || (other_mismatches != 0)) {
+        Serial.flush();
+        exit(EXIT_FAILURE);
+    }
+
+    Serial.printf("%-32s %10s %12s %14s\n", "decoder", "ms", "ns/frame", "frames/s");
+
+    // Frame by frame, as the firmware decoder is used
+    std::vector<sensorData> decoded(BENCH_FRAMES);
+    uint32_t fastest = UINT32_MAX;
+    for (uint8_t r = 0; r < BENCH_REPEATS; r++) {
+        uint32_t start = cycleCounterRead();
+        size_t pos = 0;
+        for (size_t i = 0; i < result.n_frames; i++) {
+            uint8_t len = records[pos + 1];
+            decoded[i] = getPort(records[pos]).decodePayloadToSensorData(&records[pos + 2], len);
+            pos += UPLINK_RECORD_HEADER_SIZE + len;
+        }
+        uint32_t cycles = cycleCounterRead() - start;
+        fastest = (cycles < fastest) ? cycles : fastest;
+    }
+    printResult("decodePayloadToSensorData", result.n_frames, fastest);
+
+    char name[40] = {};
+    unsigned max_threads = std::thread::hardware_concurrency();
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        fastest = UINT32_MAX;
+        for (uint8_t r = 0; r < BENCH_REPEATS; r++) {
+            uint32_t start = cycleCounterRead();
+            decodeUplinkBatch(records.data(), records.size(), &columns, threads);
+            uint32_t cycles = cycleCounterRead() - start;
+            fastest = (cycles < fastest) ? cycles : fastest;
+        }
+        snprintf(name, sizeof(name), "decodeUplinkBatch %u thread(s)", threads);
+        printResult(name, result.n_frames, fastest);
+    }
+}
+
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
@@ -0,0 +1,91 @@
+#ifndef LEGACY_FIELD_CODEC_H
+#define LEGACY_FIELD_CODEC_H
+
+/**
+ * @file legacy_field_codec.h
+ * @author Kalina Knight
+ * @brief The original generic sensorPortSchema encode/decode loops, kept only as the baseline the fixed-width field
+ * codecs are benchmarked against. Don't use them: they go through double & long long, loop & branch per byte, and the
+ * decoder doesn't sign extend or recognise the invalid marker of fields narrower than 4 bytes.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include "SensorPortSchema.h"
+
+/**
+ * @brief Original sensorPortSchema encoder (minus the unsigned warning).
+ * @param sensor_data Sensor data to encode.
+ * @param valid Validity of given sensor data.
+ * @param payload_buffer Payload buffer for data to be written into.
+ * @param buf_pos Start encoding from this byte.
+ * @param sensor_schema Sensor port schema that determines how the data is encoded.
+ * @return New total length of data encoded to payload_buffer - includes buf_pos.
+ */
+template <typename T>
+uint8_t legacyEncodeDataWithSchema(T sensor_data, bool valid, uint8_t *payload_buffer, uint8_t buf_pos, const sensorPortSchema *sensor_schema) {
+    long long data_to_encode = 0;
+    if (valid) {
+        data_to_encode = (long long)((double)sensor_data * (double)sensor_schema->scale_factor);
+    } else {
+        if (sensor_schema->is_signed) {
+            data_to_encode = 0x7F7F7F7F;
+        } else {
+            data_to_encode = 0xFFFFFFFF;
+        }
+    }
+
+    int data_size = (sensor_schema->n_bytes / sensor_schema->n_values);
+
+    uint8_t i = 0;
+    uint8_t j = (data_size - 1);
+    for (; i < data_size; i++, j--) {
+        uint8_t bitshift = j * 8;
+        if (j > 0) {
+            payload_buffer[buf_pos + i] = (uint8_t)((data_to_encode & (0xFF << bitshift)) >> bitshift);
+        } else {
+            payload_buffer[buf_pos + i] = (uint8_t)(data_to_encode & 0xFF);
+        }
+    }
+    return (buf_pos + i);
+}
+
+/**
+ * @brief Original sensorPortSchema decoder.
+ * @param sensor_data Resulting decoded sensor data.
+ * @param valid Validity of the decoded sensor data.
+ * @param buffer Buffer that data will be decoded from.
+ * @param buf_pos Start decoding from this byte.
+ * @param sensor_schema Sensor port schema that determines how the data is decoded.
+ * @return New total length of data decoded from buffer - includes buf_pos.
+ */
+template <typename T>
+uint8_t legacyDecodeDataWithSchema(T *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buf_pos, const sensorPortSchema *sensor_schema) {
+    long long data_to_decode = 0;
+
+    int data_size = (sensor_schema->n_bytes / sensor_schema->n_values);
+
+    uint8_t i = 0;
+    uint8_t j = (data_size - 1);
+    for (; i < data_size; i++, j--) {
+        uint8_t bitshift = j * 8;
+        if (j > 0) {
+            data_to_decode += (long long)(buffer[buf_pos + i] << bitshift);
+        } else {
+            data_to_decode += (long long)(buffer[buf_pos + i]);
+        }
+    }
+
+    if ((sensor_schema->is_signed && (data_to_decode == 0x7F7F7F7F)) || (data_to_decode == 0xFFFFFFFF)) {
+        *valid = false;
+    } else {
+        *valid = true;
+        *sensor_data = (T)(((double)data_to_decode) / (double)sensor_schema->scale_factor);
+    }
+    return (buf_pos + i);
+}
+
+#endif // LEGACY_FIELD_CODEC_H
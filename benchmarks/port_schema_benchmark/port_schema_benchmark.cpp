@@ -0,0 +1,352 @@
+/**
+ * @file port_schema_benchmark.cpp
+ * @author Kalina Knight
+ * @brief Benchmarks portSchema::encodeSensorDataToPayload() & portSchema::decodePayloadToSensorData() for every
+ * defined port, each sensorPortSchema::encodeData()/decodeData() overload, each sensor's fieldCodec against the
+ * original generic encode/decode loops, and multi-sample frames against single sample frames.
+ *
+ * @details Runs once in setup() and prints the results to Serial. Timing uses the CycleCounter, so the same sketch
+ * gives CPU cycles on the RAK4631 and steady clock nanoseconds on the host.
+ * The flash & stack cost of the encode/decode functions is printed at the end of the build by tools/symbol_sizes.py.
+ *
+ * Build & run:
+ *  - Host:    pio run -e native_bench -t exec
+ *  - RAK4631: pio run -e wiscore_rak4631_bench -t upload && pio device monitor
+ *
+ * @version 0.1
+ * @date 2022-02-14
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "CycleCounter.h"       /**< Cycle counter used for timing. */
+#include "PortSchema.h"         /**< Go here to see existing and define new sensor/port schemas. */
+#include "legacy_field_codec.h" /**< Original encode/decode loops to compare the field codecs against. */
+
+#define BENCH_ITERATIONS 10000 /**< Frames encoded/decoded per port. */
+
+#define LORAWAN_OVERHEAD_BYTES 13 /**< MHDR + FHDR (no FOpts) + FPort + MIC sent with every uplink's payload. */
+#define MULTI_SAMPLE_WINDOW    255 /**< Consecutive samples available to pack into each multi-sample frame. */
+
+/** Max payloads to pack multi-sample frames into: small (e.g. US915 DR0) & typical (AU915 DR0). */
+static const uint8_t MULTI_SAMPLE_MAX_LENS[] = { 11, 51 };
+
+volatile uint32_t bench_sink = 0; /**< Results are folded into this so the compiler can't discard the work. */
+static bool bench_failed = false;  /**< Set if a frame didn't decode to what was encoded. */
+
+/**
+ * @brief Fill the sensor data with plausible values that change each iteration.
+ * @param data Sensor data to fill.
+ * @param i Iteration number.
+ */
+static void fillSensorData(sensorData *data, uint32_t i) {
+    data->battery_mv = { 3700.0F + (float)(i % 500), true };
+    data->temperature = { -10.0F + ((float)(i % 4000) * 0.01F), true };
+    data->humidity = { (float)(i % 100), true };
+    data->pressure = { 100000 + (i % 3000), true };
+    data->gas_resist = { 40000 + (i % 20000), true };
+    data->location = { -33.8688F + ((float)(i % 100) * 1e-4F), 151.2093F - ((float)(i % 100) * 1e-4F), true };
+    data->analog_mv = { 2000.0F + (float)(i % 1000), true };
+    data->timestamp = { 1644969600 + (i * 300), true }; // a sample every 5 minutes
+}
+
+/**
+ * @brief Print a row of results.
+ * @param name Row name.
+ * @param bytes Bytes per frame/call.
+ * @param cycles Total cycles for BENCH_ITERATIONS.
+ */
+static void printResult(const char *name, uint8_t bytes, uint32_t cycles) {
+    uint64_t ns = cyclesToNs(cycles);
+    double ns_per_op = (double)ns / BENCH_ITERATIONS;
+    double ops_per_s = (ns_per_op > 0) ? (1e9 / ns_per_op) : 0;
+    Serial.printf("%-28s %6u %12.1f %12.1f %14.0f\n", name, bytes, (double)cycles / BENCH_ITERATIONS, ns_per_op,
+                  ops_per_s);
+}
+
+/**
+ * @brief Benchmark encoding & decoding every port in DEFINED_PORTS.
+ */
+static void benchmarkPorts(void) {
+    Serial.printf("\nPorts (%d frames each)\n", BENCH_ITERATIONS);
+    Serial.printf("%-28s %6s %12s %12s %14s\n", "port", "bytes", "cycles/frame", "ns/frame", "frames/s");
+
+    sensorData data = {};
+    uint8_t payload[PAYLOAD_BUFFER_SIZE] = {};
+    char name[32] = {};
+
+    for (const portSchema &port : DEFINED_PORTS) {
+        uint8_t len = 0;
+
+        uint32_t start = cycleCounterRead();
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+            fillSensorData(&data, i);
+            len = port.encodeSensorDataToPayload(&data, payload);
+            bench_sink += payload[len - 1];
+        }
+        uint32_t encode_cycles = cycleCounterRead() - start;
+
+        // the cost of filling the data is measured separately and removed
+        start = cycleCounterRead();
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+            fillSensorData(&data, i);
+            bench_sink += payload[i % len];
+        }
+        uint32_t fill_cycles = cycleCounterRead() - start;
+        encode_cycles = (encode_cycles > fill_cycles) ? (encode_cycles - fill_cycles) : 0;
+
+        start = cycleCounterRead();
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+            payload[0] = (uint8_t)i;
+            sensorData decoded = port.decodePayloadToSensorData(payload, len);
+            bench_sink += decoded.battery_mv.is_valid + decoded.temperature.is_valid + decoded.location.is_valid;
+        }
+        uint32_t decode_cycles = cycleCounterRead() - start;
+
+        snprintf(name, sizeof(name), "PORT%d encode", port.port_number);
+        printResult(name, len, encode_cycles);
+        snprintf(name, sizeof(name), "PORT%d decode", port.port_number);
+        printResult(name, len, decode_cycles);
+    }
+}
+
+/**
+ * @brief Benchmark a single encodeData() overload.
+ * @tparam T Type of the sensor data, selects the overload.
+ * @param name Row name.
+ * @param schema Sensor schema to encode with.
+ * @param value Value to encode.
+ */
+template <typename T>
+static void benchmarkEncodeOverload(const char *name, const sensorPortSchema &schema, T value) {
+    uint8_t buffer[8] = {};
+    uint32_t start = cycleCounterRead();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        bench_sink += schema.encodeData((T)(value + (T)(i & 0x7)), true, buffer, 0);
+    }
+    uint32_t cycles = cycleCounterRead() - start;
+    bench_sink += buffer[0];
+    printResult(name, schema.bytesPerValue(), cycles);
+}
+
+/**
+ * @brief Benchmark a single decodeData() overload.
+ * @tparam T Type of the sensor data, selects the overload.
+ * @param name Row name.
+ * @param schema Sensor schema to decode with.
+ */
+template <typename T>
+static void benchmarkDecodeOverload(const char *name, const sensorPortSchema &schema) {
+    uint8_t buffer[8] = { 0x01, 0x23, 0x45, 0x67, 0x01, 0x23, 0x45, 0x67 };
+    T value = 0;
+    bool valid = false;
+    uint32_t start = cycleCounterRead();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        buffer[0] = (uint8_t)(i & 0x3F);
+        bench_sink += schema.decodeData(&value, &valid, buffer, 0);
+    }
+    uint32_t cycles = cycleCounterRead() - start;
+    bench_sink += (uint32_t)value + valid;
+    printResult(name, schema.bytesPerValue(), cycles);
+}
+
+/**
+ * @brief Benchmark each encodeData()/decodeData() overload with the schema it's used with.
+ */
+static void benchmarkOverloads(void) {
+    Serial.printf("\nsensorPortSchema overloads (%d calls each)\n", BENCH_ITERATIONS);
+    Serial.printf("%-28s %6s %12s %12s %14s\n", "overload", "bytes", "cycles/call", "ns/call", "calls/s");
+
+    benchmarkEncodeOverload<float>("encodeData(float)", temperatureSchema, 21.37F);
+    benchmarkEncodeOverload<int>("encodeData(int)", temperatureSchema, -12);
+    benchmarkEncodeOverload<uint8_t>("encodeData(uint8_t)", relativeHumiditySchema, 55);
+    benchmarkEncodeOverload<uint16_t>("encodeData(uint16_t)", batteryVoltageSchema, 3700);
+    benchmarkEncodeOverload<uint32_t>("encodeData(uint32_t)", airPressureSchema, 101325);
+
+    benchmarkDecodeOverload<float>("decodeData(float)", temperatureSchema);
+    benchmarkDecodeOverload<int>("decodeData(int)", temperatureSchema);
+    benchmarkDecodeOverload<uint8_t>("decodeData(uint8_t)", relativeHumiditySchema);
+    benchmarkDecodeOverload<uint16_t>("decodeData(uint16_t)", batteryVoltageSchema);
+    benchmarkDecodeOverload<uint32_t>("decodeData(uint32_t)", airPressureSchema);
+}
+
+/**
+ * @brief Print a row comparing the field codec to the legacy loop.
+ * @param name Row name.
+ * @param legacy_cycles Total legacy cycles for BENCH_ITERATIONS.
+ * @param codec_cycles Total field codec cycles for BENCH_ITERATIONS.
+ */
+static void printComparison(const char *name, uint32_t legacy_cycles, uint32_t codec_cycles) {
+    double legacy = (double)legacy_cycles / BENCH_ITERATIONS;
+    double codec = (double)codec_cycles / BENCH_ITERATIONS;
+    double reduction = (legacy > 0) ? (100.0 * (legacy - codec) / legacy) : 0;
+    Serial.printf("%-28s %12.1f %12.1f %10.1f%%\n", name, legacy, codec, reduction);
+}
+
+/**
+ * @brief Benchmark one sensor's fieldCodec against the legacy loop, encoding & decoding the type sensorData uses.
+ * @tparam SCHEMA Sensor schema.
+ * @tparam T Type of the sensor data.
+ * @param name Sensor name.
+ * @param value Value to encode, varied slightly each iteration.
+ */
+template <const sensorPortSchema &SCHEMA, typename T> static void compareFieldCodec(const char *name, T value) {
+    uint8_t buffer[8] = {};
+    char row[32] = {};
+    uint32_t start = 0;
+
+    start = cycleCounterRead();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        bench_sink += legacyEncodeDataWithSchema((T)(value + (T)(i & 0x7)), true, buffer, 0, &SCHEMA);
+    }
+    uint32_t legacy_cycles = cycleCounterRead() - start;
+
+    start = cycleCounterRead();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        bench_sink += fieldCodec<SCHEMA>::encode((T)(value + (T)(i & 0x7)), true, buffer, 0);
+    }
+    uint32_t codec_cycles = cycleCounterRead() - start;
+
+    snprintf(row, sizeof(row), "%s encode", name);
+    printComparison(row, legacy_cycles, codec_cycles);
+
+    T decoded = 0;
+    bool valid = false;
+    start = cycleCounterRead();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        buffer[SCHEMA.bytesPerValue() - 1] = (uint8_t)i;
+        bench_sink += legacyDecodeDataWithSchema(&decoded, &valid, buffer, 0, &SCHEMA);
+    }
+    legacy_cycles = cycleCounterRead() - start;
+
+    start = cycleCounterRead();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        buffer[SCHEMA.bytesPerValue() - 1] = (uint8_t)i;
+        bench_sink += fieldCodec<SCHEMA>::decode(&decoded, &valid, buffer, 0);
+    }
+    codec_cycles = cycleCounterRead() - start;
+    bench_sink += (uint32_t)decoded + valid;
+
+    snprintf(row, sizeof(row), "%s decode", name);
+    printComparison(row, legacy_cycles, codec_cycles);
+}
+
+/**
+ * @brief Regression benchmark of each sensor's fieldCodec against the original generic encode/decode loops.
+ */
+static void benchmarkFieldCodecs(void) {
+    Serial.printf("\nField codecs vs legacy loop (%d calls each)\n", BENCH_ITERATIONS);
+    Serial.printf("%-28s %12s %12s %11s\n", "field", "legacy/call", "codec/call", "reduction");
+
+    compareFieldCodec<batteryVoltageSchema, float>("battery_mv", 3700.0F);
+    compareFieldCodec<temperatureSchema, float>("temperature", -12.34F);
+    compareFieldCodec<relativeHumiditySchema, float>("humidity", 55.5F);
+    compareFieldCodec<airPressureSchema, uint32_t>("pressure", 101325);
+    compareFieldCodec<gasResistanceSchema, uint32_t>("gas_resist", 48000);
+    compareFieldCodec<locationSchema, float>("location", -33.8688F);
+    compareFieldCodec<timestampSchema, uint32_t>("timestamp", 1644969600);
+}
+
+/**
+ * @brief Benchmark packing samples into multi-sample frames vs sending a frame per sample, for every port in
+ * DEFINED_PORTS at each of the MULTI_SAMPLE_MAX_LENS.
+ * The samples drift slowly like real readings do. Airtime is near enough proportional to the bytes sent (incl. the
+ * LoRaWAN overhead), so the gain in samples per byte is the gain in samples per second of airtime.
+ */
+static void benchmarkMultiSampleFrames(void) {
+    Serial.printf("\nMulti-sample frames (%d samples each)\n", BENCH_ITERATIONS);
+    Serial.printf("%-16s %7s %8s %10s %10s %6s %12s %12s\n", "port", "max len", "samples", "B/sample", "single B",
+                  "gain", "enc ns/smp", "dec ns/smp");
+
+    static sensorData samples[BENCH_ITERATIONS + MULTI_SAMPLE_WINDOW] = {};
+    static sensorData decoded[MAX_FRAME_SAMPLES] = {};
+    for (uint32_t i = 0; i < (BENCH_ITERATIONS + MULTI_SAMPLE_WINDOW); i++) {
+        fillSensorData(&samples[i], i);
+    }
+    uint8_t payload[PAYLOAD_BUFFER_SIZE] = {};
+    char name[32] = {};
+
+    for (const portSchema &port : DEFINED_PORTS) {
+        for (uint8_t max_len : MULTI_SAMPLE_MAX_LENS) {
+            if ((port.payloadLength() + 1) > max_len) {
+                continue; // not even one sample fits
+            }
+            uint32_t n_frames = 0;
+            uint32_t n_samples = 0; // the last frame may go past BENCH_ITERATIONS
+            uint32_t n_bytes = 0;
+            uint32_t encode_cycles = 0;
+            uint32_t decode_cycles = 0;
+            for (uint32_t i = 0; i < BENCH_ITERATIONS;) {
+                uint8_t n_encoded = 0;
+                uint32_t start = cycleCounterRead();
+                uint8_t len =
+                    port.encodeSamplesToPayload(&samples[i], MULTI_SAMPLE_WINDOW, payload, max_len, &n_encoded);
+                encode_cycles += cycleCounterRead() - start;
+
+                start = cycleCounterRead();
+                uint8_t n_decoded = port.decodePayloadToSamples(payload, len, decoded, MAX_FRAME_SAMPLES);
+                decode_cycles += cycleCounterRead() - start;
+                if ((n_encoded == 0) || (n_decoded != n_encoded)) {
+                    Serial.printf("PORT%d: %u samples encoded into %u bytes, but %u decoded.\n", port.port_number,
+                                  n_encoded, len, n_decoded);
+                    bench_failed = true;
+                    return;
+                }
+                bench_sink += n_decoded + decoded[n_decoded - 1].battery_mv.is_valid;
+
+                i += n_encoded;
+                n_samples += n_encoded;
+                n_frames++;
+                n_bytes += len + LORAWAN_OVERHEAD_BYTES;
+            }
+            double bytes_per_sample = (double)n_bytes / n_samples;
+            uint8_t single_bytes = port.payloadLength() + LORAWAN_OVERHEAD_BYTES;
+            snprintf(name, sizeof(name), "PORT%d", port.port_number);
+            Serial.printf("%-16s %7u %8.1f %10.2f %10u %5.1fx %12.1f %12.1f\n", name, max_len,
+                          (double)n_samples / n_frames, bytes_per_sample, single_bytes,
+                          single_bytes / bytes_per_sample, (double)cyclesToNs(encode_cycles) / n_samples,
+                          (double)cyclesToNs(decode_cycles) / n_samples);
+        }
+    }
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    Serial.begin(115200);
+    // Wait for upto 5 seconds for serial to connect
+    unsigned long serial_timeout = millis();
+    while (!Serial && ((millis() - serial_timeout) < 5000)) {
+        delay(100);
+    }
+
+    cycleCounterInit();
+    Serial.printf("PortSchema benchmark: counter runs at %lu Hz\n", (unsigned long)CYCLE_COUNTER_HZ);
+
+    benchmarkPorts();
+    benchmarkOverloads();
+    benchmarkFieldCodecs();
+    benchmarkMultiSampleFrames();
+
+    Serial.printf("\n(sink %lu)\n", (unsigned long)bench_sink);
+    if (bench_failed) {
+        Serial.printf("Benchmark FAILED: see above.\n");
+    }
+    Serial.flush();
+#ifndef ARDUINO_ARCH_NRF52
+    if (bench_failed) {
+        exit(EXIT_FAILURE);
+    }
+#endif
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
@@ -0,0 +1,247 @@
+/**
+ * @file sensor_pipeline_benchmark.cpp
+ * @author Kalina Knight
+ * @brief Times reading several sensors with a sensorPipeline (all started up front, then collected once the slowest is
+ * ready) against reading them one after another, each waited for. Host (native) only, in simulated time.
+ *
+ * @details First with simulated sensors of known latencies, in several combinations: for each it prints the sum & max
+ * of the latencies, and the wake time (start of the read to the end) & awake time (wake time less the time slept) of
+ * both ways of reading them. Then with the real sensor code on the native stand-ins (SensorHelper.h): each sensor of
+ * PORT9 (RAK1906) & PORT5 (RAK1901) read on its own, and all of them together with getSensorData().
+ * Checks that the pipeline's wake time of each combination is within PIPELINE_MARGIN_MS plus the CPU time of its
+ * sensors of the slowest latency, so the program exits non-zero if the pipeline stops overlapping the sensors.
+ *
+ * Build & run: pio run -e native_sensor_bench -t exec
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "NativeSim.h"      /**< Simulated time, incl. the time slept. */
+#include "SensorHelper.h"   /**< Real sensors, on the native stand-ins. */
+#include "SensorPipeline.h" /**< Pipeline being timed. */
+
+#define BENCH_REPEATS 10 /**< Each read is timed this many times and averaged. */
+
+#define PIPELINE_MARGIN_MS 1 /**< The pipeline may sleep a tick longer than the slowest latency. */
+
+/**
+ * @brief A simulated sensor.
+ */
+struct simSensor {
+    const char *name;
+    uint32_t busy_us;    /**< CPU time to start & collect a measurement, e.g. the I2C transfers. */
+    uint32_t convert_ms; /**< Time until the measurement is ready. */
+    bool blocking;       /**< Read blocking, so the CPU waits out the conversion, e.g. clock stretching. */
+};
+
+/** Simulated sensors, the ones that convert by themselves first, as the pipeline's stages are. */
+static const simSensor SIM_SENSORS[] = {
+    { "GPS", 2000, 1000, false },      // hot start fix
+    { "BME680+gas", 600, 183, false }, // 8x/4x/2x oversampling & 150 ms gas heater
+    { "BME680", 600, 33, false },      // 8x/4x/2x oversampling
+    { "ADC", 50, 1, false },           // settling
+    { "SHTC3", 400, 12, true },        // normal power mode, clock stretching
+};
+#define N_SIM_SENSORS (sizeof(SIM_SENSORS) / sizeof(SIM_SENSORS[0]))
+
+#define SIM_GPS     (1U << 0)
+#define SIM_BME680G (1U << 1)
+#define SIM_BME680  (1U << 2)
+#define SIM_ADC     (1U << 3)
+#define SIM_SHTC3   (1U << 4)
+
+/** Combinations of simulated sensors to time. */
+static const uint8_t SIM_COMBINATIONS[] = {
+    SIM_ADC | SIM_SHTC3,
+    SIM_ADC | SIM_BME680,
+    SIM_ADC | SIM_BME680G,
+    SIM_ADC | SIM_SHTC3 | SIM_BME680G,
+    SIM_ADC | SIM_BME680 | SIM_GPS,
+    SIM_ADC | SIM_SHTC3 | SIM_BME680G | SIM_GPS,
+};
+
+static uint8_t sim_combination = 0; /**< Simulated sensors being read. */
+
+template <uint8_t I> static bool simNeeded(const portSchema *port_settings) {
+    (void)port_settings;
+    return (sim_combination & (1U << I));
+}
+
+template <uint8_t I> static bool simStart(const portSchema *port_settings, uint32_t *ready_ms) {
+    (void)port_settings;
+    const simSensor &sensor = SIM_SENSORS[I];
+    delayMicroseconds(sensor.busy_us / 2);
+    if (sensor.blocking) {
+        delay(sensor.convert_ms);
+        *ready_ms = millis();
+    } else {
+        *ready_ms = millis() + sensor.convert_ms;
+    }
+    return true;
+}
+
+template <uint8_t I> static bool simCollect(const portSchema *port_settings, sensorData *data) {
+    (void)port_settings;
+    (void)data;
+    delayMicroseconds(SIM_SENSORS[I].busy_us / 2);
+    return true;
+}
+
+#define SIM_STAGE(i) { SIM_SENSORS[i].name, simNeeded<i>, simStart<i>, simCollect<i> }
+
+static const sensorStage sim_stages[] = { SIM_STAGE(0), SIM_STAGE(1), SIM_STAGE(2), SIM_STAGE(3), SIM_STAGE(4) };
+static_assert(sizeof(sim_stages) / sizeof(sim_stages[0]) == N_SIM_SENSORS, "Add a SIM_STAGE for the new sensor.");
+
+static const sensorPipeline sim_pipeline(sim_stages, N_SIM_SENSORS);
+
+/**
+ * @brief Read the stages one after another, each waited for, as getSensorData() used to.
+ * @param stages Stages to read.
+ * @param n_stages Number of stages.
+ * @param port_settings Port being read.
+ * @param data Sensor data to fill.
+ */
+static void readOneByOne(const sensorStage *stages, uint8_t n_stages, const portSchema *port_settings,
+                         sensorData *data) {
+    for (uint8_t i = 0; i < n_stages; i++) {
+        uint32_t ready_ms = 0;
+        if (!stages[i].needed(port_settings) || !stages[i].start(port_settings, &ready_ms)) {
+            continue;
+        }
+        int32_t remaining_ms = (int32_t)(ready_ms - (uint32_t)millis());
+        if (remaining_ms > 0) {
+            delay((uint32_t)remaining_ms);
+        }
+        stages[i].collect(port_settings, data);
+    }
+}
+
+/**
+ * @brief Wake & awake time of a read, averaged over BENCH_REPEATS.
+ */
+struct readTimes {
+    double wake_ms;  /**< From the start of the read to the end. */
+    double awake_ms; /**< The wake time less the time slept. */
+};
+
+/**
+ * @brief Time a read.
+ * @param read Function that does the read.
+ * @return The wake & awake time.
+ */
+template <typename F> static readTimes timeRead(F read) {
+    uint64_t wake_us = 0;
+    uint64_t slept_us = 0;
+    for (uint8_t r = 0; r < BENCH_REPEATS; r++) {
+        // start each read at a different point in the millisecond, as wakes would
+        delayMicroseconds(r * 97);
+        uint64_t start_us = nativeSimMicros();
+        uint64_t start_slept_us = nativeSimSleptMicros();
+        read();
+        wake_us += nativeSimMicros() - start_us;
+        slept_us += nativeSimSleptMicros() - start_slept_us;
+    }
+    return { (double)wake_us / BENCH_REPEATS / 1000, (double)(wake_us - slept_us) / BENCH_REPEATS / 1000 };
+}
+
+/**
+ * @brief Time the combinations of simulated sensors, one by one & with the pipeline.
+ */
+static void benchmarkSimulatedSensors(void) {
+    Serial.printf("Simulated sensors (%d reads each)\n", BENCH_REPEATS);
+    Serial.printf("%-30s %8s %8s %16s %16s %16s %16s\n", "sensors", "sum ms", "max ms", "one-by-one wake",
+                  "one-by-one awake", "pipeline wake", "pipeline awake");
+
+    const portSchema port = PORT1; // the simulated sensors ignore it
+    sensorData data = {};
+    char names[64] = {};
+    for (uint8_t combination : SIM_COMBINATIONS) {
+        sim_combination = combination;
+        uint32_t sum_ms = 0;
+        uint32_t max_ms = 0;
+        uint32_t busy_us = 0;
+        names[0] = '\0';
+        for (uint8_t i = 0; i < N_SIM_SENSORS; i++) {
+            if (!(combination & (1U << i))) {
+                continue;
+            }
+            sum_ms += SIM_SENSORS[i].convert_ms;
+            max_ms = (SIM_SENSORS[i].convert_ms > max_ms) ? SIM_SENSORS[i].convert_ms : max_ms;
+            busy_us += SIM_SENSORS[i].busy_us;
+            snprintf(&names[strlen(names)], sizeof(names) - strlen(names), "%s%s", (names[0] == '\0') ? "" : " + ",
+                     SIM_SENSORS[i].name);
+        }
+        readTimes one_by_one = timeRead([&] { readOneByOne(sim_stages, N_SIM_SENSORS, &port, &data); });
+        readTimes pipelined = timeRead([&] { sim_pipeline.read(&port, &data); });
+        Serial.printf("%-30s %8lu %8lu %16.2f %16.2f %16.2f %16.2f\n", names, (unsigned long)sum_ms,
+                      (unsigned long)max_ms, one_by_one.wake_ms, one_by_one.awake_ms, pipelined.wake_ms,
+                      pipelined.awake_ms);
+        NATIVE_CHECK(pipelined.wake_ms <= (max_ms + PIPELINE_MARGIN_MS + (double)busy_us / 1000));
+    }
+}
+
+/**
+ * @brief Time the real sensors of a port on the native stand-ins, the battery & the RAK sensor on their own, then
+ * together.
+ * @param port Port to read, with the battery voltage.
+ * @param sensor_name Name of the RAK sensor.
+ * @param useRAK1901 Read the RAK sensor fields with the RAK1901.
+ * @param useRAK1906 Read the RAK sensor fields with the RAK1906.
+ */
+static void timeRealSensors(const portSchema &port, const char *sensor_name, bool useRAK1901, bool useRAK1906) {
+    if (!initSensors(&port, useRAK1901, useRAK1906)) {
+        Serial.printf("Unable to initialise the %s.\n", sensor_name);
+        return;
+    }
+    char port_name[32] = {};
+    snprintf(port_name, sizeof(port_name), "PORT%u with getSensorData()", port.port_number);
+    const struct {
+        const char *name;
+        portSchema port;
+    } reads[] = {
+        { "battery", portSchema(port.port_number, SEND_BATTERY_VOLTAGE) },
+        { sensor_name, portSchema(port.port_number, port.sensors & ~SEND_BATTERY_VOLTAGE) },
+        { port_name, port },
+    };
+    for (const auto &read : reads) {
+        readTimes times = timeRead([&] { getSensorData(&read.port); });
+        Serial.printf("%-30s %8.2f %8.2f\n", read.name, times.wake_ms, times.awake_ms);
+    }
+}
+
+/**
+ * @brief Time the real sensors on the native stand-ins: PORT9 on the RAK1906 & PORT5 on the RAK1901.
+ */
+static void benchmarkRealSensors(void) {
+    Serial.printf("\nReal sensors on the native stand-ins (%d reads each)\n", BENCH_REPEATS);
+    Serial.printf("%-30s %8s %8s\n", "sensors", "wake ms", "awake ms");
+    timeRealSensors(PORT9, "RAK1906", false, true);
+    timeRealSensors(PORT5, "RAK1901", true, false);
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    Serial.begin(115200);
+
+    // the sensor logs would be timed too
+    setLogLevel(LOG_MODULE::SENSORS, LOG_LEVEL::NONE);
+
+    benchmarkSimulatedSensors();
+    benchmarkRealSensors();
+    Serial.flush();
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
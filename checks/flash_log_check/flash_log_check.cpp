@@ -0,0 +1,223 @@
+/**
+ * @file flash_log_check.cpp
+ * @author Kalina Knight
+ * @brief Checks the flash log (FlashLog.h) once its region has wrapped: a record with a bad CRC and a record torn by a
+ * reset are skipped (with the rest of their page) by begin() & read(), every other record still in the region is read
+ * back in order, and a reader left behind by the wrap carries on from the oldest record. Host (native) only, exits
+ * with a non-zero status if a check fails.
+ *
+ * Build & run: pio run -e native_flash_log_check -t exec
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "FlashLog.h"        /**< Log being checked. */
+#include "Logging.h"         /**< To quieten the flash log's own logs. */
+#include "NativeSim.h"       /**< NATIVE_CHECK(). */
+#include "RAK15001_helper.h" /**< The simulated flash. */
+
+#define CHECK_MAGIC        0x4B484346 // "FCHK", so nothing else reads the region
+#define CHECK_FIRST_SECTOR 500
+#define CHECK_N_SECTORS    3
+#define CHECK_MAX_RECORDS  2000
+
+/**
+ * @brief Where a record was appended.
+ */
+struct checkRecord {
+    flashLogPosition position; /**< Start of the record. */
+    uint8_t len;               /**< Length of the record data. */
+    bool readable;             /**< Whether it should be read back, false once corrupted or torn. */
+};
+
+RAK15001 flash;
+static checkRecord records[CHECK_MAX_RECORDS];
+static uint32_t n_records = 0;
+
+/**
+ * @brief Fill a record's data: its number, then bytes that are never 0 so clearing one always breaks the CRC.
+ * @param n Number of the record.
+ * @param bytes Buffer for the data.
+ * @return Length of the record, varied so the records fill the pages differently.
+ */
+static uint8_t fillRecord(uint32_t n, uint8_t *bytes) {
+    uint8_t len = sizeof(n) + 10 + (n * 37) % 90;
+    memcpy(bytes, &n, sizeof(n));
+    for (uint8_t i = sizeof(n); i < len; i++) {
+        bytes[i] = (uint8_t)(n + i) | 0x01;
+    }
+    return len;
+}
+
+/**
+ * @brief Append the next record, and note where it went.
+ * @param log The log.
+ * @return Whether it was appended.
+ */
+static bool appendRecord(flashLog &log) {
+    if (n_records >= CHECK_MAX_RECORDS) {
+        return false;
+    }
+    uint8_t bytes[FLASH_LOG_MAX_RECORD_LENGTH];
+    uint8_t len = fillRecord(n_records, bytes);
+    if (!log.append(bytes, len)) {
+        return false;
+    }
+    // records never cross a page, so the record ends where the log does now
+    flashLogPosition end = log.end();
+    records[n_records++] = { { end.sequence, (uint16_t)(end.offset - FLASH_LOG_RECORD_HEADER_LENGTH - len) }, len,
+                             true };
+    return true;
+}
+
+/**
+ * @brief Flash address of a position in the log, as the sectors are used in order.
+ * @param log The log.
+ * @param position The position, in a sector still in use.
+ * @return The address.
+ */
+static uint32_t positionAddress(const flashLog &log, flashLogPosition position) {
+    flashLogStats stats = log.getStats();
+    uint16_t head_sector = (stats.sequence - 1) % CHECK_N_SECTORS; // the first sector written was #1
+    uint16_t sector = (head_sector + CHECK_N_SECTORS - (stats.sequence - position.sequence)) % CHECK_N_SECTORS;
+    return (uint32_t)(CHECK_FIRST_SECTOR + sector) * SFLASH_SECTOR_SIZE + position.offset;
+}
+
+/**
+ * @brief The records after a corrupted one in its page can't be trusted, so are skipped with it.
+ * @param bad Number of the corrupted record.
+ */
+static void skipRestOfPage(uint32_t bad) {
+    flashLogPosition position = records[bad].position;
+    for (uint32_t n = bad; n < n_records; n++) {
+        if ((records[n].position.sequence == position.sequence) &&
+            ((records[n].position.offset / SFLASH_PAGE_SIZE) == (position.offset / SFLASH_PAGE_SIZE))) {
+            records[n].readable = false;
+        }
+    }
+}
+
+/**
+ * @brief Read every record from the oldest & check they're the ones expected, in order.
+ * @param log The log.
+ */
+static void checkReadBack(flashLog &log) {
+    flashLogPosition oldest = log.oldest();
+    uint32_t expected = 0;
+    while ((expected < n_records) && (records[expected].position.sequence < oldest.sequence)) {
+        expected++;
+    }
+    NATIVE_CHECK(expected > 0); // the region has wrapped
+
+    flashLogPosition position = oldest;
+    uint8_t bytes[FLASH_LOG_MAX_RECORD_LENGTH];
+    uint8_t expected_bytes[FLASH_LOG_MAX_RECORD_LENGTH];
+    uint16_t len;
+    uint32_t n_read = 0;
+    while ((len = log.read(&position, bytes)) > 0) {
+        while ((expected < n_records) && !records[expected].readable) {
+            expected++;
+        }
+        if (!NATIVE_CHECK(expected < n_records)) {
+            return;
+        }
+        uint32_t n;
+        memcpy(&n, bytes, sizeof(n));
+        NATIVE_CHECK(n == expected);
+        NATIVE_CHECK(len == fillRecord(expected, expected_bytes));
+        NATIVE_CHECK(memcmp(bytes, expected_bytes, len) == 0);
+        expected++;
+        n_read++;
+    }
+    NATIVE_CHECK(expected == n_records);
+    NATIVE_CHECK(n_read > 0);
+    NATIVE_CHECK((position.sequence == log.end().sequence) && (position.offset == log.end().offset));
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    Serial.begin(115200);
+    setLogLevel(LOG_MODULE::STORAGE, LOG_LEVEL::NONE);
+    if (!NATIVE_CHECK(flash.init())) {
+        return;
+    }
+
+    // fill the region & wrap it, so the records are in a reused sector, stopping with room for a torn record
+    flashLog log(&flash, CHECK_MAGIC, CHECK_FIRST_SECTOR, CHECK_N_SECTORS);
+    NATIVE_CHECK(log.begin());
+    flashLogPosition stale = log.oldest();
+    while ((log.getStats().sequence < CHECK_N_SECTORS + 2) || (log.end().offset < 4 * SFLASH_PAGE_SIZE) ||
+           ((log.end().offset % SFLASH_PAGE_SIZE) > SFLASH_PAGE_SIZE / 2)) {
+        if (!NATIVE_CHECK(appendRecord(log))) {
+            return;
+        }
+    }
+    NATIVE_CHECK(log.flush());
+    NATIVE_CHECK(log.getStats().sectors_used == CHECK_N_SECTORS);
+    NATIVE_CHECK(log.getStats().sector_erases == CHECK_N_SECTORS + 2);
+
+    // clear a data byte of a record in the middle of the middle sector, so its CRC fails
+    flashLogPosition oldest = log.oldest();
+    uint32_t bad = 0;
+    while ((records[bad].position.sequence <= oldest.sequence) ||
+           (records[bad].position.offset < SFLASH_SECTOR_SIZE / 2)) {
+        bad++;
+    }
+    const uint8_t zero = 0;
+    flash.writeBuffer(positionAddress(log, records[bad].position) + FLASH_LOG_RECORD_HEADER_LENGTH +
+                          records[bad].len - 1,
+                      &zero, 1);
+    skipRestOfPage(bad);
+
+    // then a record cut short by a reset after its header & some of its data, in the same page
+    uint8_t torn[FLASH_LOG_RECORD_HEADER_LENGTH + FLASH_LOG_MAX_RECORD_LENGTH];
+    torn[0] = fillRecord(n_records, &torn[FLASH_LOG_RECORD_HEADER_LENGTH]);
+    uint16_t crc = flashLogCRC(torn, 1);
+    crc = flashLogCRC(&torn[FLASH_LOG_RECORD_HEADER_LENGTH], torn[0], crc);
+    torn[1] = (uint8_t)crc;
+    torn[2] = (uint8_t)(crc >> 8);
+    uint16_t torn_len = FLASH_LOG_RECORD_HEADER_LENGTH + torn[0] / 2;
+    uint16_t page_room = SFLASH_PAGE_SIZE - (log.end().offset % SFLASH_PAGE_SIZE);
+    flash.writeBuffer(positionAddress(log, log.end()), torn, (torn_len < page_room) ? torn_len : page_room);
+
+    // after the "reset" the log carries on in the next page, and the bad records are skipped when read
+    flashLog restarted(&flash, CHECK_MAGIC, CHECK_FIRST_SECTOR, CHECK_N_SECTORS);
+    NATIVE_CHECK(restarted.begin());
+    NATIVE_CHECK(restarted.getStats().bad_records == 1);
+    NATIVE_CHECK(restarted.end().offset % SFLASH_PAGE_SIZE == 0);
+    for (uint8_t i = 0; i < 20; i++) {
+        NATIVE_CHECK(appendRecord(restarted));
+    }
+    checkReadBack(restarted);
+    NATIVE_CHECK(restarted.getStats().bad_records == 3); // begin()'s & each of them again
+    NATIVE_CHECK(restarted.getStats().overwritten == 0);
+
+    // wrap again until the bad record is erased, a reader left in an erased sector carries on from the oldest
+    while (restarted.oldest().sequence <= records[bad].position.sequence) {
+        if (!NATIVE_CHECK(appendRecord(restarted))) {
+            return;
+        }
+    }
+    checkReadBack(restarted);
+    NATIVE_CHECK(restarted.getStats().bad_records == 4); // only the torn record is left
+    uint8_t bytes[FLASH_LOG_MAX_RECORD_LENGTH];
+    uint16_t len = restarted.read(&stale, bytes);
+    NATIVE_CHECK(restarted.getStats().overwritten == 1);
+    NATIVE_CHECK((len > 0) && (stale.sequence == restarted.oldest().sequence));
+    Serial.println("FlashLog checks done.");
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
@@ -0,0 +1,165 @@
+/**
+ * @file fragments_check.cpp
+ * @author Kalina Knight
+ * @brief Checks the payload fragments (PayloadFragments.h): the number of fragments for every frame & max fragment
+ * length, incl. frames that fill their last fragment exactly, and that the fragments reassemble into the frame, or are
+ * dropped if one is lost. Host (native) only, exits with a non-zero status if a check fails.
+ *
+ * Build & run: pio run -e native_fragments_check -t exec
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "NativeSim.h"        /**< NATIVE_CHECK(). */
+#include "PayloadFragments.h" /**< Fragments being checked. */
+
+#define CHECK_PORT 9 /**< Port of the frames split up. */
+
+/**
+ * @brief Bytes of frame that fit in a number of fragments: the first also carries the port, the rest just a header.
+ * @param n_fragments Number of fragments.
+ * @param max_len Max length of each fragment.
+ * @return The bytes of frame.
+ */
+static uint16_t fragmentsCapacity(uint8_t n_fragments, uint8_t max_len) {
+    if (n_fragments == 0) {
+        return 0;
+    }
+    return (max_len - FIRST_FRAGMENT_HEADER_LENGTH) + (n_fragments - 1) * (max_len - FRAGMENT_HEADER_LENGTH);
+}
+
+/**
+ * @brief Check the fragment count of a frame is the fewest fragments it fits in, then split it up & reassemble it.
+ * @param payload The frame.
+ * @param len Length of the frame.
+ * @param max_len Max length of each fragment.
+ * @param frame_id Id of the frame.
+ * @param reassembler Reassembler to add the fragments to.
+ */
+static void checkFrame(const uint8_t *payload, uint8_t len, uint8_t max_len, uint8_t frame_id,
+                       fragmentReassembler &reassembler) {
+    uint8_t n_fragments = fragmentCount(len, max_len);
+    if (len <= max_len) {
+        // sent as it is
+        NATIVE_CHECK(n_fragments == 1);
+        return;
+    }
+    if (n_fragments == 0) {
+        NATIVE_CHECK((len > PAYLOAD_BUFFER_SIZE) || (max_len <= FIRST_FRAGMENT_HEADER_LENGTH) ||
+                     (fragmentsCapacity(MAX_FRAGMENTS, max_len) < len));
+        return;
+    }
+    NATIVE_CHECK(n_fragments <= MAX_FRAGMENTS);
+    NATIVE_CHECK(fragmentsCapacity(n_fragments, max_len) >= len);
+    NATIVE_CHECK(fragmentsCapacity(n_fragments - 1, max_len) < len);
+
+    uint8_t fragment[PAYLOAD_BUFFER_SIZE];
+    uint16_t data_len = 0;
+    for (uint8_t index = 0; index < n_fragments; index++) {
+        uint8_t fragment_len = encodeFragment(payload, len, CHECK_PORT, frame_id, index, max_len, fragment);
+        uint8_t header_len = (index == 0) ? FIRST_FRAGMENT_HEADER_LENGTH : FRAGMENT_HEADER_LENGTH;
+        if (index + 1 < n_fragments) {
+            // every fragment but the last is full, so the reassembler only needs them in order
+            NATIVE_CHECK(fragment_len == max_len);
+            NATIVE_CHECK(!reassembler.addFragment(fragment, fragment_len));
+        } else {
+            NATIVE_CHECK(fragment_len > header_len);
+            NATIVE_CHECK(fragment_len <= max_len);
+            // a frame that fills its fragments exactly ends on a full fragment, not on an empty one after it
+            NATIVE_CHECK((fragment_len == max_len) == (fragmentsCapacity(n_fragments, max_len) == len));
+            NATIVE_CHECK(reassembler.addFragment(fragment, fragment_len));
+        }
+        data_len += fragment_len - header_len;
+    }
+    NATIVE_CHECK(data_len == len);
+    NATIVE_CHECK(encodeFragment(payload, len, CHECK_PORT, frame_id, n_fragments, max_len, fragment) == 0);
+    NATIVE_CHECK(reassembler.port() == CHECK_PORT);
+    NATIVE_CHECK(reassembler.length() == len);
+    NATIVE_CHECK(memcmp(reassembler.payload(), payload, len) == 0);
+}
+
+/**
+ * @brief Check every frame length with every max fragment length, and in particular the frames that fill 2 to
+ * MAX_FRAGMENTS fragments exactly & the ones 1 byte longer, which need 1 more fragment.
+ */
+static void checkCounts(void) {
+    uint8_t payload[PAYLOAD_BUFFER_SIZE + 1];
+    for (uint16_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    fragmentReassembler reassembler;
+    uint8_t frame_id = 0;
+    for (uint8_t max_len = 1; max_len <= PAYLOAD_BUFFER_SIZE; max_len++) {
+        for (uint8_t len = 1; len <= sizeof(payload); len++) {
+            checkFrame(payload, len, max_len, frame_id, reassembler);
+            frame_id = (frame_id + 1) & 0x0F;
+        }
+        if (max_len <= FIRST_FRAGMENT_HEADER_LENGTH) {
+            continue;
+        }
+        for (uint8_t n_fragments = 2; n_fragments <= MAX_FRAGMENTS; n_fragments++) {
+            uint16_t capacity = fragmentsCapacity(n_fragments, max_len);
+            if (capacity >= PAYLOAD_BUFFER_SIZE) {
+                break;
+            }
+            if (capacity <= max_len) {
+                continue; // fits as it is
+            }
+            NATIVE_CHECK(fragmentCount(capacity, max_len) == n_fragments);
+            NATIVE_CHECK(fragmentCount(capacity + 1, max_len) == ((n_fragments < MAX_FRAGMENTS) ? n_fragments + 1 : 0));
+        }
+    }
+    NATIVE_CHECK(reassembler.droppedFragments() == 0);
+}
+
+/**
+ * @brief Check a lost fragment drops the rest of its frame, and the next frame is reassembled as usual.
+ */
+static void checkLostFragment(void) {
+    uint8_t payload[PAYLOAD_BUFFER_SIZE];
+    for (uint8_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = i;
+    }
+    const uint8_t max_len = 11; // e.g. US915 DR0
+    uint8_t n_fragments = fragmentCount(sizeof(payload), max_len);
+    NATIVE_CHECK(n_fragments == 7);
+
+    fragmentReassembler reassembler;
+    uint8_t fragment[PAYLOAD_BUFFER_SIZE];
+    for (uint8_t index = 0; index < n_fragments; index++) {
+        if (index == 2) {
+            continue; // lost
+        }
+        uint8_t fragment_len = encodeFragment(payload, sizeof(payload), CHECK_PORT, 1, index, max_len, fragment);
+        NATIVE_CHECK(!reassembler.addFragment(fragment, fragment_len));
+    }
+    NATIVE_CHECK(reassembler.droppedFragments() == (uint32_t)(n_fragments - 1));
+
+    checkFrame(payload, sizeof(payload), max_len, 2, reassembler);
+    NATIVE_CHECK(reassembler.droppedFragments() == (uint32_t)(n_fragments - 1));
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    Serial.begin(115200);
+
+    checkCounts();
+    checkLostFragment();
+    Serial.println("PayloadFragments checks done.");
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
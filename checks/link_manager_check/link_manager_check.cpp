@@ -0,0 +1,220 @@
+/**
+ * @file link_manager_check.cpp
+ * @author Kalina Knight
+ * @brief Checks the linkManager (LinkManager.h): the level it moves to on a scripted run of acks, losses & downlink
+ * margins, when probes are due, and the cap on probes a day. Host (native) only, exits with a non-zero status if a
+ * check fails.
+ *
+ * Build & run: pio run -e native_link_manager_check -t exec
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+#include <LoRaWan-RAK4630.h> /**< DR_X & TX_POWER_X. */
+
+#include "LinkManager.h" /**< Manager being checked. */
+#include "NativeSim.h"   /**< NATIVE_CHECK(). */
+
+#define HOUR_MS 3600000ULL
+
+/**
+ * @brief Evidence given to the manager in a scripted step.
+ */
+enum class EVENT {
+    ACK,    /**< A confirmed uplink that was acked. */
+    LOSS,   /**< A confirmed uplink that wasn't. */
+    AMPLE,  /**< A downlink with more than LINK_MARGIN_HIGH_DB of margin. */
+    MID,    /**< A downlink with a margin between LINK_MARGIN_LOW_DB & LINK_MARGIN_HIGH_DB. */
+    THIN,   /**< A downlink with less than LINK_MARGIN_LOW_DB of margin. */
+    NO_JOIN /**< A failed join. */
+};
+
+/**
+ * @brief A scripted step: the evidence, then the settings the manager should be at after it.
+ */
+struct linkStep {
+    EVENT event;
+    uint8_t datarate;
+    uint8_t tx_power;
+};
+
+/**
+ * @brief SNR of a downlink answering an uplink at a datarate, for a margin over the demodulation floor of its RX1
+ * datarate: -20 dB at SF12, 2.5 dB higher for each step down, and 6 dB higher again at 500 kHz.
+ * @param datarate Datarate of the uplink.
+ * @param margin_db The margin.
+ * @return The SNR in dB.
+ */
+static int8_t downlinkSnr(uint8_t datarate, int8_t margin_db) {
+    loraDatarate settings = {};
+    NATIVE_CHECK(loraWANRx1Datarate(datarate, &settings));
+    float floor_db = -20 + 2.5f * (12 - settings.spreading_factor) + ((settings.bandwidth_khz == 500) ? 6 : 0);
+    return (int8_t)(floor_db + margin_db);
+}
+
+/**
+ * @brief Check the level after each step of a scripted run from DR_5, with the probes LINK_PROBE_INTERVAL_MS apart:
+ * LINK_STEP_UP_ACKS acks (or ample margins) in a row step up on trial, a lost trial probe steps straight back down &
+ * doubles the acks needed, LINK_STEP_DOWN_LOSSES losses or a thin margin step down, and a failed join goes back to the
+ * most robust level. Then the counters.
+ */
+static void checkScript(void) {
+    const linkStep script[] = {
+        { EVENT::ACK, DR_5, TX_POWER_0 },     { EVENT::ACK, DR_5, TX_POWER_0 },
+        { EVENT::ACK, DR_6, TX_POWER_0 },     // up, on trial
+        { EVENT::ACK, DR_6, TX_POWER_0 },     // the trial holds
+        { EVENT::ACK, DR_6, TX_POWER_0 },     { EVENT::ACK, DR_6, TX_POWER_1 }, // then the power comes down
+        { EVENT::LOSS, DR_6, TX_POWER_0 },    // the trial fails, so 6 acks are needed now
+        { EVENT::AMPLE, DR_6, TX_POWER_0 },   { EVENT::AMPLE, DR_6, TX_POWER_0 },
+        { EVENT::AMPLE, DR_6, TX_POWER_0 },   { EVENT::AMPLE, DR_6, TX_POWER_0 },
+        { EVENT::AMPLE, DR_6, TX_POWER_0 },   { EVENT::AMPLE, DR_6, TX_POWER_1 },
+        { EVENT::AMPLE, DR_6, TX_POWER_1 },   // on trial, so only its probe counts
+        { EVENT::ACK, DR_6, TX_POWER_1 },     // the trial holds, back to 3 acks
+        { EVENT::AMPLE, DR_6, TX_POWER_1 },   { EVENT::MID, DR_6, TX_POWER_1 }, // breaks the run
+        { EVENT::AMPLE, DR_6, TX_POWER_1 },   { EVENT::AMPLE, DR_6, TX_POWER_1 },
+        { EVENT::ACK, DR_6, TX_POWER_2 },     { EVENT::ACK, DR_6, TX_POWER_2 },
+        { EVENT::LOSS, DR_6, TX_POWER_2 },    { EVENT::LOSS, DR_6, TX_POWER_1 },
+        { EVENT::THIN, DR_6, TX_POWER_0 },    { EVENT::THIN, DR_5, TX_POWER_0 },
+        { EVENT::NO_JOIN, DR_0, TX_POWER_0 }, { EVENT::THIN, DR_0, TX_POWER_0 }, // already the most robust
+    };
+
+    linkManager link(loraWANMinDatarate(), loraWANMaxDatarate(), TX_POWER_10);
+    link.begin(DR_5, TX_POWER_3); // the power is only lowered at the max datarate
+    NATIVE_CHECK(link.datarate() == DR_5);
+    NATIVE_CHECK(link.txPower() == TX_POWER_0);
+
+    uint64_t now_ms = 0;
+    uint32_t n_probes = 0;
+    uint32_t n_acks = 0;
+    uint32_t n_downlinks = 0;
+    for (uint8_t s = 0; s < sizeof(script) / sizeof(script[0]); s++) {
+        const linkStep &step = script[s];
+        switch (step.event) {
+        case EVENT::ACK:
+        case EVENT::LOSS:
+            NATIVE_CHECK(link.probeDue(now_ms));
+            link.uplinkSent(true, now_ms);
+            link.uplinkResult(step.event == EVENT::ACK);
+            n_probes++;
+            n_acks += (step.event == EVENT::ACK) ? 1 : 0;
+            now_ms += LINK_PROBE_INTERVAL_MS;
+            break;
+        case EVENT::AMPLE:
+            link.downlinkReceived(-90, downlinkSnr(link.datarate(), LINK_MARGIN_HIGH_DB + 1));
+            n_downlinks++;
+            break;
+        case EVENT::MID:
+            link.downlinkReceived(-100, downlinkSnr(link.datarate(), (LINK_MARGIN_LOW_DB + LINK_MARGIN_HIGH_DB) / 2));
+            n_downlinks++;
+            break;
+        case EVENT::THIN:
+            link.downlinkReceived(-120, downlinkSnr(link.datarate(), LINK_MARGIN_LOW_DB - 1));
+            n_downlinks++;
+            break;
+        case EVENT::NO_JOIN:
+            link.joinResult(false);
+            break;
+        }
+        if (!NATIVE_CHECK((link.datarate() == step.datarate) && (link.txPower() == step.tx_power))) {
+            Serial.printf("Step %u: DR%u TX_POWER_%u, expected DR%u TX_POWER_%u\n", s, link.datarate(), link.txPower(),
+                          step.datarate, step.tx_power);
+        }
+    }
+
+    linkManagerStats stats = link.getStats();
+    NATIVE_CHECK(stats.probes == n_probes);
+    NATIVE_CHECK(stats.acked == n_acks);
+    NATIVE_CHECK(stats.lost == n_probes - n_acks);
+    NATIVE_CHECK(stats.downlinks == n_downlinks);
+    NATIVE_CHECK(stats.steps_up == 4);
+    NATIVE_CHECK(stats.steps_down == 4);
+    NATIVE_CHECK(stats.failed_trials == 1);
+    NATIVE_CHECK(stats.join_failures == 1);
+    NATIVE_CHECK(stats.last_snr == downlinkSnr(DR_0, LINK_MARGIN_LOW_DB - 1));
+}
+
+/**
+ * @brief Check when a probe is due: straight away after begin(), LINK_PROBE_INTERVAL_MS after the last confirmed
+ * uplink (unconfirmed ones don't count), and straight after a lost probe or a step up.
+ */
+static void checkProbeInterval(void) {
+    linkManager link(loraWANMinDatarate(), loraWANMaxDatarate(), TX_POWER_10);
+    link.begin(DR_2, TX_POWER_0);
+    uint64_t now_ms = 1000;
+    NATIVE_CHECK(link.probeDue(now_ms));
+    link.uplinkSent(true, now_ms);
+    link.uplinkResult(true);
+    NATIVE_CHECK(!link.probeDue(now_ms));
+
+    link.uplinkSent(false, now_ms + HOUR_MS);
+    NATIVE_CHECK(!link.probeDue(now_ms + LINK_PROBE_INTERVAL_MS - 1));
+    NATIVE_CHECK(link.probeDue(now_ms + LINK_PROBE_INTERVAL_MS));
+
+    // a lost probe is followed up straight away
+    now_ms += LINK_PROBE_INTERVAL_MS;
+    link.uplinkSent(true, now_ms);
+    link.uplinkResult(false);
+    NATIVE_CHECK(link.probeDue(now_ms + 1));
+    link.uplinkSent(true, now_ms + 1);
+    link.uplinkResult(true);
+    NATIVE_CHECK(!link.probeDue(now_ms + 1));
+    NATIVE_CHECK(link.datarate() == DR_2);
+
+    // and so is a step up, which is on trial
+    link.uplinkSent(true, now_ms + 2);
+    link.uplinkResult(true);
+    link.uplinkSent(true, now_ms + 3);
+    link.uplinkResult(true);
+    NATIVE_CHECK(link.datarate() == DR_3);
+    NATIVE_CHECK(link.probeDue(now_ms + 3));
+}
+
+/**
+ * @brief Check no more than LINK_MAX_PROBES_PER_DAY confirmed uplinks are probed in any LINK_PROBE_WINDOW_MS, even
+ * when every probe is lost: probing starts again as the oldest leaves the window.
+ */
+static void checkDailyCap(void) {
+    linkManager link(loraWANMinDatarate(), loraWANMaxDatarate(), TX_POWER_10);
+    link.begin(DR_0, TX_POWER_0);
+    uint64_t now_ms = 0;
+    for (uint8_t p = 0; p < LINK_MAX_PROBES_PER_DAY; p++, now_ms += HOUR_MS) {
+        NATIVE_CHECK(link.probeDue(now_ms));
+        link.uplinkSent(true, now_ms);
+        link.uplinkResult(false);
+    }
+    NATIVE_CHECK(link.datarate() == DR_0);
+    NATIVE_CHECK(!link.probeDue(now_ms));
+    NATIVE_CHECK(!link.probeDue(LINK_PROBE_WINDOW_MS - 1));
+    NATIVE_CHECK(link.probeDue(LINK_PROBE_WINDOW_MS));
+
+    // the window rolls: the next is due once the second oldest has left it
+    link.uplinkSent(true, LINK_PROBE_WINDOW_MS);
+    link.uplinkResult(false);
+    NATIVE_CHECK(!link.probeDue(LINK_PROBE_WINDOW_MS + HOUR_MS - 1));
+    NATIVE_CHECK(link.probeDue(LINK_PROBE_WINDOW_MS + HOUR_MS));
+    NATIVE_CHECK(link.getStats().probes == LINK_MAX_PROBES_PER_DAY + 1);
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    Serial.begin(115200);
+
+    checkScript();
+    checkProbeInterval();
+    checkDailyCap();
+    Serial.println("LinkManager checks done.");
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
@@ -0,0 +1,254 @@
+/**
+ * @file tx_queue_check.cpp
+ * @author Kalina Knight
+ * @brief Checks the txQueue (TxQueue.h): retries & their backoff, frames expiring after their max attempts, which
+ * frame makes room when the queue is full, and frames that never fit the airtime budget being dropped. Host (native)
+ * only, exits with a non-zero status if a check fails.
+ *
+ * Build & run: pio run -e native_tx_queue_check -t exec
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "Airtime.h"   /**< airtimeBudget, for frames that never fit it. */
+#include "NativeSim.h" /**< NATIVE_CHECK(). */
+#include "TxQueue.h"   /**< Queue being checked. */
+
+/**
+ * @brief Push a 1 byte frame holding its port, so the frames can be told apart.
+ * @param queue The queue.
+ * @param port Port of the frame.
+ * @param priority Priority of the frame.
+ * @param now_ms Uptime now.
+ * @return Whether it was queued.
+ */
+static bool pushFrame(txQueue &queue, uint8_t port, TX_PRIORITY priority, uint64_t now_ms = 0) {
+    return queue.push(port, &port, 1, priority, false, now_ms);
+}
+
+/**
+ * @brief Check the retries of a frame that's never delivered: each after a backoff that doubles from
+ * TX_QUEUE_BACKOFF_MS (jittered over its upper half, capped at TX_QUEUE_MAX_BACKOFF_MS), until it expires after its
+ * max attempts.
+ * @param priority Priority of the frame.
+ * @param max_attempts Attempts it should get.
+ */
+static void checkExpiry(TX_PRIORITY priority, uint8_t max_attempts) {
+    txQueue queue;
+    uint64_t now_ms = 1000;
+    NATIVE_CHECK(pushFrame(queue, 1, priority, now_ms));
+
+    uint32_t backoff_ms = TX_QUEUE_BACKOFF_MS;
+    for (uint8_t attempt = 1; attempt <= max_attempts; attempt++) {
+        const txFrame *frame = queue.next(now_ms);
+        if (!NATIVE_CHECK(frame != nullptr)) {
+            return;
+        }
+        NATIVE_CHECK(frame->attempts == attempt);
+        NATIVE_CHECK(frame->confirmed() == (priority != TX_PRIORITY::ROUTINE));
+        NATIVE_CHECK(queue.next(now_ms) == nullptr); // only one in flight at a time
+        NATIVE_CHECK(queue.nextSendMillis() == TX_QUEUE_NEVER);
+        queue.done(false, now_ms);
+        if (attempt == max_attempts) {
+            break;
+        }
+
+        uint64_t retry_ms = queue.nextSendMillis();
+        NATIVE_CHECK(retry_ms >= now_ms + backoff_ms / 2);
+        NATIVE_CHECK(retry_ms <= now_ms + backoff_ms);
+        NATIVE_CHECK(queue.peek(retry_ms - 1) == nullptr);
+        now_ms = retry_ms;
+        backoff_ms = (backoff_ms * 2 < TX_QUEUE_MAX_BACKOFF_MS) ? (backoff_ms * 2) : TX_QUEUE_MAX_BACKOFF_MS;
+    }
+
+    txQueueStats stats = queue.getStats();
+    NATIVE_CHECK(queue.size() == 0);
+    NATIVE_CHECK(queue.nextSendMillis() == TX_QUEUE_NEVER);
+    NATIVE_CHECK(stats.sent == max_attempts);
+    NATIVE_CHECK(stats.retries == (uint32_t)(max_attempts - 1));
+    NATIVE_CHECK(stats.expired == 1);
+    NATIVE_CHECK(stats.delivered == 0);
+}
+
+/**
+ * @brief Check a frame that's delivered on a retry isn't counted as expired, and one superseded in flight isn't
+ * retried.
+ */
+static void checkRetryDelivered(void) {
+    txQueue queue;
+    NATIVE_CHECK(pushFrame(queue, 1, TX_PRIORITY::CHECKPOINT));
+    queue.next(0);
+    queue.done(false, 0);
+    uint64_t retry_ms = queue.nextSendMillis();
+    NATIVE_CHECK(queue.next(retry_ms) != nullptr);
+    queue.done(true, retry_ms);
+
+    NATIVE_CHECK(pushFrame(queue, 2, TX_PRIORITY::ROUTINE, retry_ms));
+    NATIVE_CHECK(queue.next(retry_ms) != nullptr);
+    NATIVE_CHECK(queue.push(2, (const uint8_t *)"\x02", 1, TX_PRIORITY::ROUTINE, true, retry_ms));
+    queue.done(false, retry_ms);
+    NATIVE_CHECK(queue.size() == 1); // only the newer frame is left
+
+    txQueueStats stats = queue.getStats();
+    NATIVE_CHECK(stats.delivered == 1);
+    NATIVE_CHECK(stats.retries == 1);
+    NATIVE_CHECK(stats.superseded == 1);
+    NATIVE_CHECK(stats.expired == 0);
+}
+
+/**
+ * @brief Take every frame that's due & deliver it, checking they come out in the expected order.
+ * @param queue The queue.
+ * @param ports Expected ports, in order.
+ * @param n_ports Number of ports expected.
+ */
+static void checkSendOrder(txQueue &queue, const uint8_t *ports, uint8_t n_ports) {
+    for (uint8_t i = 0; i < n_ports; i++) {
+        const txFrame *frame = queue.next(0);
+        if (!NATIVE_CHECK(frame != nullptr)) {
+            return;
+        }
+        NATIVE_CHECK(frame->port == ports[i]);
+        NATIVE_CHECK(frame->buffer[0] == ports[i]);
+        queue.done(true, 0);
+    }
+    NATIVE_CHECK(queue.size() == 0);
+}
+
+/**
+ * @brief Check which frame makes room when the queue is full: the oldest of the lowest priority, never one in flight,
+ * and none if they're all more important than the new frame.
+ */
+static void checkEviction(void) {
+    txQueue queue;
+    const TX_PRIORITY R = TX_PRIORITY::ROUTINE;
+    const TX_PRIORITY C = TX_PRIORITY::CHECKPOINT;
+    const TX_PRIORITY A = TX_PRIORITY::ALARM;
+    const TX_PRIORITY priorities[TX_QUEUE_LENGTH] = { R, C, R, A, R, C, R, C };
+    for (uint8_t port = 1; port <= TX_QUEUE_LENGTH; port++) {
+        NATIVE_CHECK(pushFrame(queue, port, priorities[port - 1]));
+    }
+    NATIVE_CHECK(queue.size() == TX_QUEUE_LENGTH);
+
+    NATIVE_CHECK(pushFrame(queue, 9, C));  // evicts routine 1, the oldest routine frame
+    NATIVE_CHECK(pushFrame(queue, 10, R)); // evicts routine 3, as a frame can make room for one as important
+    NATIVE_CHECK(pushFrame(queue, 11, A)); // evicts routine 5
+    NATIVE_CHECK(pushFrame(queue, 12, A)); // evicts routine 7
+    NATIVE_CHECK(pushFrame(queue, 13, A)); // evicts routine 10, the last routine frame
+    NATIVE_CHECK(!pushFrame(queue, 14, R)); // rejected, every frame is more important
+    NATIVE_CHECK(pushFrame(queue, 15, C));  // evicts checkpoint 2, the oldest checkpoint
+
+    txQueueStats stats = queue.getStats();
+    NATIVE_CHECK(stats.evicted == 6);
+    NATIVE_CHECK(stats.rejected == 1);
+    NATIVE_CHECK(queue.size() == TX_QUEUE_LENGTH);
+
+    // alarms first, then checkpoints, oldest first within each
+    const uint8_t order[] = { 4, 11, 12, 13, 6, 8, 9, 15 };
+    checkSendOrder(queue, order, sizeof(order));
+
+    // a frame in flight is never evicted, even if it's the least important
+    NATIVE_CHECK(pushFrame(queue, 1, R));
+    NATIVE_CHECK(queue.next(0) != nullptr);
+    for (uint8_t port = 2; port <= TX_QUEUE_LENGTH; port++) {
+        NATIVE_CHECK(pushFrame(queue, port, A));
+    }
+    NATIVE_CHECK(!pushFrame(queue, 9, R));  // rejected, only the frame in flight is less important
+    NATIVE_CHECK(pushFrame(queue, 10, A)); // evicts alarm 2, the oldest not in flight
+    queue.done(true, 0);
+    const uint8_t order_in_flight[] = { 3, 4, 5, 6, 7, 8, 10 };
+    checkSendOrder(queue, order_in_flight, sizeof(order_in_flight));
+}
+
+/**
+ * @brief Take the next frame that fits an airtime budget, as sendQueuedLoRaWANFrame() does: a frame that doesn't fit
+ * yet is deferred, and one that never will is dropped.
+ * @param queue The queue.
+ * @param budget The budget. Each frame takes 100 ms of airtime per port number, to tell them apart.
+ * @param now_ms Uptime now.
+ * @return The frame, or nullptr if none fits.
+ */
+static const txFrame *nextFitting(txQueue &queue, airtimeBudget &budget, uint64_t now_ms) {
+    const txFrame *frame = nullptr;
+    while ((frame = queue.peek(now_ms)) != nullptr) {
+        uint64_t allowed_ms = budget.allowedAtMillis(frame->port * 100000UL, frame->confirmed(), now_ms);
+        if (allowed_ms <= now_ms) {
+            break;
+        }
+        if (allowed_ms == AIRTIME_NEVER) {
+            queue.drop(frame);
+        } else {
+            queue.defer(frame, allowed_ms);
+        }
+    }
+    return queue.next(now_ms);
+}
+
+/**
+ * @brief Check a frame longer than the whole airtime budget is dropped, counted as expired, rather than deferred
+ * forever ahead of the frames behind it. A confirmed frame may use the reserve, so it still fits.
+ */
+static void checkNeverFits(void) {
+    txQueue queue;
+    airtimeBudget budget(1000, AIRTIME_SLOTS * 1000, 10); // 900 ms, and 100 ms in reserve
+    NATIVE_CHECK(pushFrame(queue, 20, TX_PRIORITY::ALARM));   // 2 s, never fits
+    NATIVE_CHECK(pushFrame(queue, 10, TX_PRIORITY::ROUTINE)); // 1 s, only fits with the reserve
+    NATIVE_CHECK(pushFrame(queue, 10, TX_PRIORITY::CHECKPOINT));
+    NATIVE_CHECK(pushFrame(queue, 3, TX_PRIORITY::ROUTINE));
+
+    const txFrame *frame = nextFitting(queue, budget, 0);
+    if (NATIVE_CHECK(frame != nullptr)) {
+        NATIVE_CHECK(frame->port == 10);
+        NATIVE_CHECK(frame->confirmed());
+    }
+    queue.done(true, 0);
+    budget.spend(1000000, 0);
+    NATIVE_CHECK(queue.size() == 2);
+    NATIVE_CHECK(queue.getStats().expired == 1);
+
+    // the routine frame can't use the reserve so it's dropped too, and the next only waits for the window to roll
+    NATIVE_CHECK(nextFitting(queue, budget, 0) == nullptr);
+    NATIVE_CHECK(queue.size() == 1);
+    uint64_t retry_ms = queue.nextSendMillis();
+    NATIVE_CHECK((retry_ms > 0) && (retry_ms != TX_QUEUE_NEVER));
+    frame = nextFitting(queue, budget, retry_ms);
+    if (NATIVE_CHECK(frame != nullptr)) {
+        NATIVE_CHECK(frame->port == 3);
+        NATIVE_CHECK(frame->attempts == 1);
+    }
+    queue.done(true, retry_ms);
+
+    txQueueStats stats = queue.getStats();
+    NATIVE_CHECK(queue.size() == 0);
+    NATIVE_CHECK(stats.sent == 2);
+    NATIVE_CHECK(stats.delivered == 2);
+    NATIVE_CHECK(stats.expired == 2);
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    Serial.begin(115200);
+
+    checkExpiry(TX_PRIORITY::ROUTINE, TX_QUEUE_MAX_ATTEMPTS_ROUTINE);
+    checkExpiry(TX_PRIORITY::CHECKPOINT, TX_QUEUE_MAX_ATTEMPTS_CONFIRMED);
+    checkExpiry(TX_PRIORITY::ALARM, TX_QUEUE_MAX_ATTEMPTS_CONFIRMED);
+    checkRetryDelivered();
+    checkEviction();
+    checkNeverFits();
+    Serial.println("TxQueue checks done.");
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
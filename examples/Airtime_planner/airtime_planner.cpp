@@ -0,0 +1,148 @@
+/**
+ * @file airtime_planner.cpp
+ * @author Kalina Knight
+ * @brief Plans the sample rates of a fleet within the airtime budget, with the same airtime calculator (Airtime.h) &
+ * frame encoding (PortSchema.h) the devices use.
+ *
+ * @details Runs once in setup() and prints the plan to Serial. For each port in PLAN_PORTS at each datarate, slowly
+ * drifting samples are packed into multi-sample frames of the datarate's max payload, to find the airtime per sample.
+ * From that it works out the fastest a device can sample & still send every sample within the budget. Then at
+ * PLAN_SAMPLE_PERIOD_S it works out the airtime a device uses per day, and the load on the gateway's channels if the
+ * whole fleet samples at that period.
+ *
+ * Build & run:
+ *  - Host:    pio run -e native_airtime_planner -t exec
+ *  - RAK4631: copy into main.cpp, then pio run -e wiscore_rak4631 -t upload && pio device monitor
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "Airtime.h"    /**< Time on air & the airtime budget. */
+#include "PortSchema.h" /**< Go here to see existing and define new sensor/port schemas. */
+
+#ifndef PLAN_DEVICES
+#define PLAN_DEVICES 100 /**< Devices in the fleet, all in range of the same gateway. */
+#endif
+
+#ifndef PLAN_CHANNELS
+#define PLAN_CHANNELS 8 /**< Uplink channels the fleet shares, e.g. the 8 of an AU915 sub-band. */
+#endif
+
+#ifndef PLAN_SAMPLE_PERIOD_S
+#define PLAN_SAMPLE_PERIOD_S 300 /**< Sample period to check against the budget & the channel load. */
+#endif
+
+#define PLAN_SAMPLES       2000 /**< Samples packed into frames for each port & datarate. */
+#define PLAN_SAMPLE_WINDOW 255  /**< Consecutive samples available to pack into each frame. */
+
+/** Ports to plan for. */
+static const portSchema PLAN_PORTS[] = { PORT3, PORT5, PORT9, PORT59 };
+
+/**
+ * @brief Fill the sensor data with plausible values that drift slowly from sample to sample.
+ * @param data Sensor data to fill.
+ * @param i Sample number.
+ */
+static void fillSensorData(sensorData *data, uint32_t i) {
+    data->battery_mv = { 3700.0F + (float)(i % 500), true };
+    data->temperature = { -10.0F + ((float)(i % 4000) * 0.01F), true };
+    data->humidity = { (float)(i % 100), true };
+    data->pressure = { 100000 + (i % 3000), true };
+    data->gas_resist = { 40000 + (i % 20000), true };
+    data->location = { -33.8688F + ((float)(i % 100) * 1e-4F), 151.2093F - ((float)(i % 100) * 1e-4F), true };
+    data->analog_mv = { 2000.0F + (float)(i % 1000), true };
+    data->timestamp = { 1644969600 + (i * 300), true }; // a sample every 5 minutes
+}
+
+/**
+ * @brief Print the plan of every port in PLAN_PORTS at every uplink datarate of the region.
+ */
+static void planPorts(void) {
+    // routine uplinks can't use the reserve
+    const double budget_s = (AIRTIME_BUDGET_MS / 1000.0) * (100 - AIRTIME_RESERVE_PERCENT) / 100.0;
+    const double window_s = AIRTIME_WINDOW_MS / 1000.0;
+    Serial.printf("Airtime budget: %.1f s per %.1f h per device, %.1f s of it for routine uplinks\n",
+                  AIRTIME_BUDGET_MS / 1000.0, window_s / 3600, budget_s);
+    Serial.printf("Fleet: %d devices on %d channels, sampling every %d s\n\n", PLAN_DEVICES, PLAN_CHANNELS,
+                  PLAN_SAMPLE_PERIOD_S);
+    Serial.printf("%-8s %4s %7s %9s %8s %10s %12s %12s %9s %9s\n", "port", "DR", "max len", "smp/frame", "frame B",
+                  "airtime ms", "min period s", "airtime s/d", "ch. load", "ALOHA ok");
+
+    static sensorData samples[PLAN_SAMPLES + PLAN_SAMPLE_WINDOW] = {};
+    for (uint32_t i = 0; i < (PLAN_SAMPLES + PLAN_SAMPLE_WINDOW); i++) {
+        fillSensorData(&samples[i], i);
+    }
+    uint8_t payload[PAYLOAD_BUFFER_SIZE] = {};
+    char name[16] = {};
+
+    for (const portSchema &port : PLAN_PORTS) {
+        snprintf(name, sizeof(name), "PORT%d", port.port_number);
+        for (uint8_t datarate = loraWANMinDatarate(); datarate <= loraWANMaxDatarate(); datarate++) {
+            loraDatarate settings;
+            loraWANDatarate(datarate, &settings);
+            uint8_t max_len = settings.max_payload;
+            if (max_len > PAYLOAD_BUFFER_SIZE) {
+                max_len = PAYLOAD_BUFFER_SIZE;
+            }
+            if ((port.payloadLength() + 1) > max_len) {
+                Serial.printf("%-8s %4u %7u   (a sample doesn't fit)\n", name, datarate, max_len);
+                continue;
+            }
+            uint32_t n_frames = 0;
+            uint32_t n_samples = 0; // the last frame may go past PLAN_SAMPLES
+            uint32_t n_bytes = 0;
+            uint64_t airtime_us = 0;
+            for (uint32_t i = 0; i < PLAN_SAMPLES;) {
+                uint8_t n_encoded = 0;
+                uint8_t len =
+                    port.encodeSamplesToPayload(&samples[i], PLAN_SAMPLE_WINDOW, payload, max_len, &n_encoded);
+                i += n_encoded;
+                n_samples += n_encoded;
+                n_frames++;
+                n_bytes += len;
+                airtime_us += loraWANAirtimeMicros(datarate, len);
+            }
+            double frame_airtime_s = (double)airtime_us / n_frames / 1e6;
+            double samples_per_frame = (double)n_samples / n_frames;
+            // sending every sample, as fast as the budget allows
+            double min_period_s = window_s / ((budget_s / frame_airtime_s) * samples_per_frame);
+            // at the planned period: a device's airtime per day, the offered load on each channel, & the share of
+            // uplinks that don't collide (pure ALOHA)
+            double airtime_per_day_s = (86400.0 / PLAN_SAMPLE_PERIOD_S) / samples_per_frame * frame_airtime_s;
+            double load = (PLAN_DEVICES * airtime_per_day_s) / (86400.0 * PLAN_CHANNELS);
+            Serial.printf("%-8s %4u %7u %9.1f %8.1f %10.1f %12.1f %11.1f%s %8.3f%% %8.1f%%\n", name, datarate,
+                          max_len, samples_per_frame, (double)n_bytes / n_frames, frame_airtime_s * 1000, min_period_s,
+                          airtime_per_day_s, (PLAN_SAMPLE_PERIOD_S < min_period_s) ? "!" : " ", load * 100,
+                          exp(-2 * load) * 100);
+        }
+    }
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    Serial.begin(115200);
+    // Wait for upto 5 seconds for serial to connect
+    unsigned long serial_timeout = millis();
+    while (!Serial && ((millis() - serial_timeout) < 5000)) {
+        delay(100);
+    }
+
+    planPorts();
+    Serial.flush();
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // nothing left to do
+    delay(UINT32_MAX - 1);
+}
@@ -12,25 +12,31 @@
 #include <Arduino.h>
 #include <LoRaWan-RAK4630.h> // Click to get library: https://platformio.org/lib/show/6601/SX126x-Arduino
 
-#include "LoRaWAN_functs.h" /**< Go here to change the LoRaWAN settings. */
-#include "Logging.h"        /**< Go here to change the logging level for the entire application. */
-#include "OTAA_keys.h"      /**< Go here to set the OTAA keys (See LoRaWAN_functs README). */
-#include "PortSchema.h"     /**< Go here to see existing and define new sensor/port schemas. */
-#include "SensorHelper.h"   /**< Go here to add code for init-ing and reading new additional sensors. */
+#include "LoRaWAN_functs.h"  /**< Go here to change the LoRaWAN settings. */
+#include "Logging.h"         /**< Go here to change the logging level for the entire application. */
+#include "OTAA_keys.h"       /**< Go here to set the OTAA keys (See LoRaWAN_functs README). */
+#include "PortSchema.h"      /**< Go here to see existing and define new sensor/port schemas. */
+#include "RAK15001_helper.h" /**< Flash for the sample queue. */
+#include "SampleQueue.h"     /**< Go here to change the sample queue region. */
+#include "SampleScheduler.h" /**< Sensor reading & uplink schedule. */
+#include "SensorHelper.h"    /**< Go here to add code for init-ing and reading new additional sensors. */
+#include "SpanProfiler.h"    /**< Spans of the awake time, for the diagnostics report. */
+#include "WallClock.h"       /**< Wall clock for timestamping samples. */
 
 // APP TIMER
-const int lorawan_app_interval = 300000; /**< App payloadTimer interval value in [ms] = 5mins. */
-SoftwareTimer payloadTimer;              /**< payloadTimer to wakeup task and send payload. */
+SoftwareTimer appTimer; /**< One-shot appTimer to wakeup task at the next sensor reading or uplink. */
 // forward declarations
 static void appTimerInit(void);
 static void appTimerTimeoutHandler(TimerHandle_t unused);
+static void appTimerStartForNextEvent(void);
 
 // POWER SAVING - see README for further details on Semaphores & low power mode
 // TODO: not sure about pdFalse
 static SemaphoreHandle_t semaphore_handle = NULL; /**< Semaphore used by events to wake up loop task. */
 enum class EVENT_TASK {
     SLEEP,        /**< Use semaphore take to "sleep" in a low power state. */
-    SEND_PAYLOAD, /**< Send a sensor reading payload. */
+    SAMPLE,       /**< Read the sensors that are due, then send an uplink if one is due. */
+    SEND_QUEUED,  /**< The last frame is done with, send the next queued frame (or a clock sync request). */
 };
 static EVENT_TASK current_task = EVENT_TASK::SLEEP; /**< Current task of the device, similar to a finite
                                                        state machine
@@ -40,22 +46,95 @@ static EVENT_TASK current_task = EVENT_TASK::SLEEP; /**< Current task of the dev
 uint8_t payload_buffer[PAYLOAD_BUFFER_SIZE] = {};                /**< Buffer that payload data is placed in. */
 lmh_app_data_t lorawan_payload = { payload_buffer, 0, 0, 0, 0 }; /**< Struct that passes the payload buffer and
                                                                     relevant params for a LoRaWAN frame. */
+// forward declarations
+void logSensorData(const sensorData *sensor_data);
+void logPayload(void);
+
+// SAMPLE QUEUE - every sample is queued on the RAK15001 flash and sent oldest first, so none are lost while the link is
+// down. Without the RAK15001 frames go through the LoRaWAN transmit queue instead (see queueLoRaWANFrame()), & samples
+// are dropped while not joined.
+const uint8_t max_queued_frames_per_uplink = 4; /**< Cap on frames sent per uplink to catch up. */
+RAK15001 flash;
+sampleQueue sample_queue(&flash);
+bool use_sample_queue = false;
+uint8_t queued_frames_sent = 0;        /**< Frames sent since the last uplink was due. */
+volatile bool frame_in_flight = false; /**< A frame of queued samples has been sent & isn't done with yet. */
+volatile bool frame_done = false;      /**< Set by sendDoneHandler() once the frame in flight is done with. */
+volatile bool frame_delivered = false; /**< Whether the frame in flight got through, so its samples can be popped. */
+// forward declarations
+void sendUplink(void);
+void sendPendingSamples(void);
+void sendQueuedFrame(void);
+static void sendDoneHandler(bool delivered);
+
+// CHECKPOINTS - without the sample queue, an uplink is sent confirmed now & then & retried until acked, so the
+// latest samples get through even if the routine (unconfirmed) frames around it are lost
+const uint32_t checkpoint_interval_s = 6 * 60 * 60; /**< Send a confirmed checkpoint every 6 hours. */
+uint32_t checkpoint_uptime_s = 0;                   /**< Uptime of the last checkpoint. */
+
+// JOIN RETRIES - after a failed join, try again after 5, 10, 20... minutes so a long outage doesn't clog the network
+const uint32_t min_join_backoff_s = 5 * 60;   /**< First retry, at the next uplink after 5 minutes. */
+const uint32_t max_join_backoff_s = 60 * 60;  /**< Retry at least once an hour. */
+uint32_t join_backoff_s = min_join_backoff_s; /**< Time to wait before the next join retry. */
+uint32_t join_attempt_uptime_s = 0;           /**< Uptime of the last join attempt. */
+// forward declaration
+void retryJoin(void);
+
+// CLOCK SYNC - ports that send a timestamp (e.g. PORT21) need the wall clock set from the network, see WallClock.h
+const uint32_t clock_sync_interval_s = 24 * 60 * 60; /**< Correct the RTC drift (up to ~3.5 s) once a day. */
+const uint32_t clock_sync_retry_s = 60 * 60;         /**< Ask again after an hour if a request goes unanswered. */
+bool clock_sync_requested = false;                   /**< A clock sync request has been sent since startup. */
+uint32_t clock_sync_request_uptime_s = 0;            /**< Uptime of the last clock sync request. */
 // forward declaration
-void fillPayload(void);
+bool syncClockIfDue(void);
+
+// DIAGNOSTICS - the min/avg/max time of each span of the awake time (see SpanProfiler.h) is logged & sent on
+// DIAGNOSTICS_PORT now & then, then reset. Needs APP_PROFILE_SPANS, as set in platformio.ini.
+const uint32_t diagnostics_interval_s = 24 * 60 * 60; /**< Report the spans once a day. */
+uint32_t diagnostics_uptime_s = 0;                    /**< Uptime of the last report. */
+// forward declaration
+bool sendDiagnosticsIfDue(void);
+
+// AIRTIME - frames are only sent within the airtime budget of Airtime.h (e.g. TTN's 30 s a day). While the budget is
+// running low the sample_scheduler is slowed down, so the sensors are read less often & more samples go in each uplink
+const uint8_t low_airtime_rate_divider = 2;       /**< Half as often while the budget is running low. */
+const uint8_t exhausted_airtime_rate_divider = 4; /**< A quarter as often once only the reserve is left. */
+// forward declaration
+void adaptToAirtime(void);
 
 // PORT/SENSOR SELECTION
 // The chosen port determines the sensor data included in the payload - see
 // PortSchema.h
 static portSchema payload_port = PORT1; /**< Frame data port. E.g. port 3: battery voltage + temperature */
 
+// SAMPLING - each group of sensors is read at its own period, and their samples are sent together in multi-sample
+// frames, so the radio wakes less often than the sensors. Readings are only sent when they move by more than the
+// channel's deadband, or at least every max silence as a heartbeat. Sensors not in payload_port are skipped.
+const samplingChannel sampling_channels[] = {
+    // sensors, period [s], deadband, max silence [s]
+    { SEND_BATTERY_VOLTAGE, 5 * 60, 20, 60 * 60 },   /**< Battery every 5 minutes, if it moved by 20 mV. */
+    { SEND_TEMPERATURE, 60, 0.2, 60 * 60 },          /**< Temperature every minute, if it moved by 0.2 C. */
+    { SEND_RELATIVE_HUMIDITY, 60, 1, 60 * 60 },      /**< Humidity every minute, if it moved by 1 %. */
+    { SEND_AIR_PRESSURE, 5 * 60, 50, 60 * 60 },      /**< Air pressure every 5 minutes, if it moved by 50 Pa. */
+    { SEND_GAS_RESISTANCE, 60 * 60, 0, 0 },          /**< Gas resistance hourly, as the heater is power hungry. */
+    { SEND_LOCATION, 60 * 60, 0.001, 24 * 60 * 60 }, /**< Location hourly, if it moved by ~100 m. */
+    { SEND_ANALOG, 60, 10, 60 * 60 },                /**< Analog sensor every minute, if it moved by 10 mV. */
+};
+const uint32_t max_uplink_interval_s = 15 * 60; /**< Send at least every 15 minutes, sooner if a frame fills up. */
+sampleScheduler sample_scheduler(payload_port, sampling_channels,
+                                 sizeof(sampling_channels) / sizeof(sampling_channels[0]), max_uplink_interval_s);
+
 /**
  * @brief Setup code runs once on reset/startup.
  */
 void setup() {
+    // start timing the spans first, so the startup is included
+    initSpans();
+
     // initialise the logging module - function does nothing if APP_LOG_LEVEL in
     // Logging.h = NONE
     initLogging();
-    log(LOG_LEVEL::INFO,
+    LOG(LOG_LEVEL::INFO,
         "\n============================================"
         "\nWelcome to Combined Library WisBlock Example"
         "\n============================================");
@@ -71,14 +150,25 @@ void setup() {
         return;
     }
 
-    // Init payloadTimer
+    // Init the sample queue
+    use_sample_queue = flash.init() && sample_queue.begin();
+    if (!use_sample_queue) {
+        LOG(LOG_LEVEL::WARN, "No sample queue, samples taken while the network isn't joined will be lost.");
+    }
+
+    // Init appTimer, sampling starts straight away whether the network is joined or not
     appTimerInit();
+    sample_scheduler.begin(uptimeSeconds());
+    appTimerStartForNextEvent();
 
     // Init LoRaWAN
-    if (!initLoRaWAN(&payloadTimer, OTAA_KEY_APP_EUI, OTAA_KEY_DEV_EUI, OTAA_KEY_APP_KEY)) {
+    if (!initLoRaWAN(OTAA_KEY_APP_EUI, OTAA_KEY_DEV_EUI, OTAA_KEY_APP_KEY)) {
         delay(1000);
         return;
     }
+    setLoRaWANSendDoneCallback(sendDoneHandler);
+    // pick the fastest datarate & lowest TX power that gets through, starting from those given to initLoRaWAN()
+    setLoRaWANLinkAdaptation(true);
 
     // Attempt to join the network
     startLoRaWANJoinProcedure();
@@ -94,12 +184,14 @@ void loop() {
     switch (current_task) {
         case EVENT_TASK::SLEEP:
             // Sleep until we are woken up by an event
-            log(LOG_LEVEL::DEBUG, "Semaphore sleep");
+            LOG(LOG_LEVEL::DEBUG, "Semaphore sleep");
+            SPAN_END(SPAN::WAKE);
             // This function call puts the device to 'sleep' in low power mode.
             // The semaphore can only be taken once given in appTimerTimeoutHandler()
             // (or another function). It will wait (up to portMAX_DELAY ticks) for the
             // semaphore_handle semaphore to be given.
             xSemaphoreTake(semaphore_handle, portMAX_DELAY);
+            SPAN_BEGIN(SPAN::WAKE);
             // This point is only reached if the semaphore was able to be taken or the
             // function timed out. If the semaphore was able to be taken, then the
             // current_task should have been set before giving the semaphore. If
@@ -107,17 +199,40 @@ void loop() {
             // switch-case will come back to EVENT_TASK::SLEEP and sleep again.
             break;
 
-        case EVENT_TASK::SEND_PAYLOAD:
-            // do nothing if not connected
-            if (isLoRaWANConnected()) {
-                log(LOG_LEVEL::DEBUG, "Send payload");
-                // fill lora data buffer
-                fillPayload();
-                // send data
-                sendLoRaWANFrame(&lorawan_payload);
-            } else {
-                log(LOG_LEVEL::DEBUG, "LoRaWAN not connected. Try again later.");
+        case EVENT_TASK::SAMPLE: {
+            uint32_t uptime_s = uptimeSeconds();
+            if (sample_scheduler.sampleIfDue(uptime_s)) {
+                logSensorData(&sample_scheduler.latestSample());
+                if (use_sample_queue) {
+                    // queued straight away, so it's kept even if the device resets before the uplink
+                    sample_queue.push(payload_port, &sample_scheduler.latestSample(), uptime_s);
+                }
+            }
+            // with the sample queue, uplinks also send the backlog & retry the join
+            bool send_empty = use_sample_queue && !sample_queue.empty();
+            if (sample_scheduler.uplinkDue(uptime_s, getLoRaWANMaxPayload(), send_empty)) {
+                sendUplink();
+            } else if (!use_sample_queue && isLoRaWANConnected()) {
+                // a queued frame may be due a retry
+                sendQueuedLoRaWANFrame();
+            }
+            appTimerStartForNextEvent();
+            // go back to 'sleep'
+            current_task = EVENT_TASK::SLEEP;
+            break;
+        }
+
+        case EVENT_TASK::SEND_QUEUED:
+            if (use_sample_queue) {
+                sendQueuedFrame();
+            } else if (isLoRaWANConnected() && !sendQueuedLoRaWANFrame()) {
+                // the radio is free again
+                if (!syncClockIfDue()) {
+                    sendDiagnosticsIfDue();
+                }
             }
+            // a frame that failed may be due a retry before the next sensor reading
+            appTimerStartForNextEvent();
             // go back to 'sleep'
             current_task = EVENT_TASK::SLEEP;
             break;
@@ -130,55 +245,285 @@ void loop() {
 }
 
 /**
- * @brief Function for the payloadTimer initialization.
- * Initializes the payloadTimer as repeating with lorawan_app_interval timeout.
+ * @brief Function for the appTimer initialization.
+ * Initializes the appTimer as one-shot, it's started for each event by appTimerStartForNextEvent().
  */
 void appTimerInit(void) {
-    log(LOG_LEVEL::DEBUG, "Initialising timer...");
-    payloadTimer.begin(lorawan_app_interval, appTimerTimeoutHandler);
+    LOG(LOG_LEVEL::DEBUG, "Initialising timer...");
+    appTimer.begin(max_uplink_interval_s * 1000, appTimerTimeoutHandler, NULL, false);
+}
+
+/**
+ * @brief Starts the appTimer to wake the loop task at the next sensor reading or uplink of the sample_scheduler, or
+ * the next retry of a queued frame.
+ */
+void appTimerStartForNextEvent(void) {
+    uint64_t event_ms = (uint64_t)sample_scheduler.nextEventUptime() * 1000;
+    uint64_t retry_ms = getLoRaWANTxQueueNextSend();
+    if (retry_ms < event_ms) {
+        event_ms = retry_ms;
+    }
+    uint64_t now_ms = uptimeMillis();
+    uint32_t wait_ms = (event_ms > now_ms) ? (uint32_t)(event_ms - now_ms) : 0;
+    // + 2 ms to wake just after the event, as the uptime is counted in ~1 ms ticks
+    appTimer.setPeriod(wait_ms + 2);
+    appTimer.start();
 }
 
 /**
- * @brief Function for handling payloadTimer timeout event.
- * Sets the current_task to SEND_PAYLOAD and then 'wakes' the device by giving
+ * @brief Function for handling appTimer timeout event.
+ * Sets the current_task to SAMPLE and then 'wakes' the device by giving
  * the semaphore so then it can be taken in loop(), and the switch case will
  * move to the new current_task.
  */
 void appTimerTimeoutHandler(TimerHandle_t unused) {
-    current_task = EVENT_TASK::SEND_PAYLOAD;
+    current_task = EVENT_TASK::SAMPLE;
     // Give the semaphore, so the loop task can take it and wake up
     xSemaphoreGiveFromISR(semaphore_handle, pdFALSE);
 }
 
 /**
- * @brief Gets the sensor data, then fills payload_buffer with the encoded data
- * ready for sending via LoRaWAN. Follows the portSchema specified in
- * PortSchema.h.
+ * @brief Function for handling the end of a sent frame, after its RX windows.
+ * Sets the current_task to SEND_QUEUED and wakes the loop task to send the next frame of queued samples, or a clock
+ * sync request.
+ * @param delivered Whether the frame got through.
  */
-void fillPayload(void) {
-    // get the sensor data
-    sensorData sensor_data = {};
-    sensor_data = getSensorData(&payload_port);
+void sendDoneHandler(bool delivered) {
+    frame_delivered = delivered;
+    frame_done = true;
+    current_task = EVENT_TASK::SEND_QUEUED;
+    // Give the semaphore, so the loop task can take it and wake up
+    xSemaphoreGiveFromISR(semaphore_handle, pdFALSE);
+}
 
-    // log sensor data
-    log(LOG_LEVEL::INFO,
-        "Sensor Data: {b: %.2f mV | t: %.2f C | h: %.2f %% | p: %lu Pa | g: %lu "
-        "| l: %.5f, %.5f}",
-        sensor_data.battery_mv.value, sensor_data.temperature.value, sensor_data.humidity.value, sensor_data.pressure.value,
-        sensor_data.gas_resist.value, sensor_data.location.latitude, sensor_data.location.longitude);
+/**
+ * @brief Sends the samples taken since the last uplink: from the sample queue, or straight from the sample_scheduler
+ * without it.
+ */
+void sendUplink(void) {
+    sampleSchedulerStats stats = sample_scheduler.getStats();
+    LOG(LOG_LEVEL::DEBUG, "Samples: %lu taken, %lu suppressed, %lu heartbeats. Uplinks: %lu due, %lu suppressed.",
+        (unsigned long)stats.samples, (unsigned long)stats.suppressed, (unsigned long)stats.heartbeats,
+        (unsigned long)stats.uplinks, (unsigned long)stats.suppressed_uplinks);
+    linkManagerStats link_stats = getLoRaWANLinkStats();
+    LOG(LOG_LEVEL::DEBUG, "Link: DR%u TX_POWER_%u. Probes: %lu acked, %lu lost. Steps: %lu up, %lu down.",
+        getLoRaWANDatarate(), getLoRaWANTxPower(), (unsigned long)link_stats.acked, (unsigned long)link_stats.lost,
+        (unsigned long)link_stats.steps_up, (unsigned long)link_stats.steps_down);
+    adaptToAirtime();
+    if (use_sample_queue) {
+        // the samples are already queued
+        sample_scheduler.clear();
+        queued_frames_sent = 0;
+        sendQueuedFrame();
+    } else {
+        sendPendingSamples();
+    }
+}
+
+/**
+ * @brief Queues the oldest pending samples of the sample_scheduler in one frame, if joined, then sends the next queued
+ * frame. Routine frames are sent unconfirmed, so they're only retried if they couldn't be sent, while a checkpoint
+ * (every checkpoint_interval_s) is retried until acked.
+ */
+void sendPendingSamples(void) {
+    if (!isLoRaWANConnected()) {
+        LOG(LOG_LEVEL::DEBUG, "LoRaWAN not connected. Try again later.");
+        retryJoin();
+        return;
+    }
+    join_backoff_s = min_join_backoff_s;
+    uint8_t n_samples = sample_scheduler.fillFrame(payload_buffer, getLoRaWANMaxPayload(), &lorawan_payload.port,
+                                                   &lorawan_payload.buffsize);
+    if (n_samples == 0) {
+        return;
+    }
+    TX_PRIORITY priority = TX_PRIORITY::ROUTINE;
+    if ((uptimeSeconds() - checkpoint_uptime_s) >= checkpoint_interval_s) {
+        priority = TX_PRIORITY::CHECKPOINT;
+        checkpoint_uptime_s = uptimeSeconds();
+    }
+    LOG(LOG_LEVEL::DEBUG, "Send payload of %u samples%s", n_samples,
+        (priority == TX_PRIORITY::CHECKPOINT) ? " as a checkpoint" : "");
+    logPayload();
+    if (queueLoRaWANFrame(&lorawan_payload, priority)) {
+        sample_scheduler.pop();
+    }
+    txQueueStats tx_stats = getLoRaWANTxQueueStats();
+    LOG(LOG_LEVEL::DEBUG, "Transmit queue: %lu delivered, %lu retries, %lu expired, %lu evicted.",
+        (unsigned long)tx_stats.delivered, (unsigned long)tx_stats.retries, (unsigned long)tx_stats.expired,
+        (unsigned long)tx_stats.evicted);
+    sendQueuedLoRaWANFrame();
+}
+
+/**
+ * @brief Sends the oldest queued samples in one frame, once the last frame is done with.
+ * Pops the samples of the last frame if it got through, else they're sent again. Sends up to
+ * max_queued_frames_per_uplink frames per uplink, one after the other, so a backlog catches up over a few uplinks.
+ */
+void sendQueuedFrame(void) {
+    if (frame_in_flight) {
+        if (!frame_done) {
+            // still in its RX windows, sendDoneHandler() will wake the loop task again
+            return;
+        }
+        if (frame_delivered && hasLoRaWANFragmentsLeft()) {
+            // the frame was too long for the datarate, send its next fragment
+            frame_done = false;
+            if (sendNextLoRaWANFragment()) {
+                return;
+            }
+            // the rest of the fragments were dropped, so the frame is sent again
+            frame_delivered = false;
+        }
+        frame_in_flight = false;
+        if (frame_delivered) {
+            sample_queue.pop();
+        }
+    }
 
-    // reset the payload
-    memset(payload_buffer, 0, sizeof(payload_buffer));
-    lorawan_payload.buffsize = 0;
-    lorawan_payload.port = payload_port.port_number;
+    if (!isLoRaWANConnected()) {
+        retryJoin();
+        if (!isLoRaWANConnected()) {
+            LOG(LOG_LEVEL::DEBUG, "LoRaWAN not connected. Sample queued.");
+            return;
+        }
+    }
+    join_backoff_s = min_join_backoff_s;
+    if (syncClockIfDue()) {
+        // first, so the queued samples can be timestamped. The next frame is sent once the request is done with
+        return;
+    }
+    if (sendDiagnosticsIfDue()) {
+        return;
+    }
+    if (queued_frames_sent >= max_queued_frames_per_uplink) {
+        LOG(LOG_LEVEL::DEBUG, "Sent %u queued frames this uplink, the rest wait for the next.", queued_frames_sent);
+        return;
+    }
+
+    uint8_t n_samples = sample_queue.fillFrame(payload_buffer, getLoRaWANMaxPayload(), &lorawan_payload.port,
+                                               &lorawan_payload.buffsize);
+    if (n_samples == 0) {
+        return;
+    }
+    if (n_samples > 1) {
+        LOG(LOG_LEVEL::INFO, "Sending %u queued samples.", n_samples);
+    }
+    logPayload();
+    frame_done = false;
+    if (sendLoRaWANFrame(&lorawan_payload)) {
+        frame_in_flight = true;
+        queued_frames_sent++;
+    }
+}
+
+/**
+ * @brief Requests the time from the network, if the port sends a timestamp and the wall clock isn't set or is due to
+ * be corrected. Must only be called while joined and the radio is free.
+ * @return True if a clock sync request was sent, so the radio is busy until sendDoneHandler().
+ */
+bool syncClockIfDue(void) {
+    if (!payload_port.sendTimestamp()) {
+        return false;
+    }
+    uint32_t since_request_s = uptimeSeconds() - clock_sync_request_uptime_s;
+    if (clock_sync_requested &&
+        (since_request_s < (wallClockIsSet() ? clock_sync_interval_s : clock_sync_retry_s))) {
+        return false;
+    }
+    if (!requestLoRaWANClockSync()) {
+        return false;
+    }
+    clock_sync_requested = true;
+    clock_sync_request_uptime_s = uptimeSeconds();
+    return true;
+}
+
+/**
+ * @brief Logs the spans of the awake time & sends them on DIAGNOSTICS_PORT, if the report is due. Waits for a datarate
+ * it fits in whole. Must only be called while joined and the radio is free.
+ * @return True if the report was sent, so the radio is busy until sendDoneHandler().
+ */
+bool sendDiagnosticsIfDue(void) {
+    if (!APP_PROFILE_SPANS || ((uptimeSeconds() - diagnostics_uptime_s) < diagnostics_interval_s)) {
+        return false;
+    }
+    static uint8_t report[PAYLOAD_BUFFER_SIZE];
+    lmh_app_data_t report_frame = { report, encodeSpanReport(report, getLoRaWANMaxPayload()), DIAGNOSTICS_PORT, 0, 0 };
+    if ((report_frame.buffsize == 0) || !sendLoRaWANFrame(&report_frame)) {
+        return false;
+    }
+    for (uint8_t s = 0; s < (uint8_t)SPAN::N_SPANS; s++) {
+        spanStats stats = getSpanStats((SPAN)s);
+        LOG(LOG_LEVEL::INFO, "Span %s: %lu times, min %lu us, avg %lu us, max %lu us.", spanName((SPAN)s),
+            (unsigned long)stats.count, (unsigned long)stats.min_us, (unsigned long)stats.avg_us,
+            (unsigned long)stats.max_us);
+    }
+    resetSpans();
+    diagnostics_uptime_s = uptimeSeconds();
+    return true;
+}
 
-    // encode the sensor data to lorawan_payload
-    lorawan_payload.buffsize = payload_port.encodeSensorDataToPayload(&sensor_data, payload_buffer);
+/**
+ * @brief Slows the sample_scheduler down while the airtime budget is running low, and back up once it recovers.
+ */
+void adaptToAirtime(void) {
+    airtimeStats airtime = getLoRaWANAirtimeStats();
+    LOG(LOG_LEVEL::DEBUG, "Airtime: %lu ms used, %lu ms left. %lu frames deferred.", (unsigned long)airtime.used_ms,
+        (unsigned long)airtime.left_ms, (unsigned long)airtime.deferred);
+    uint8_t divider = 1;
+    switch (getLoRaWANAirtimeState()) {
+        case AIRTIME_STATE::RUNNING_LOW:
+            divider = low_airtime_rate_divider;
+            break;
+        case AIRTIME_STATE::EXHAUSTED:
+            divider = exhausted_airtime_rate_divider;
+            break;
+        default:
+            break;
+    }
+    if (divider != sample_scheduler.rateDivider()) {
+        LOG(LOG_LEVEL::INFO, "Airtime budget has %lu ms left, sampling & sending 1/%u as often.",
+            (unsigned long)airtime.left_ms, divider);
+        sample_scheduler.setRateDivider(divider);
+    }
+}
 
-    // log the encoded bytes
+/**
+ * @brief Called at each uplink while not joined. Joins again if the last join failed and the backoff has passed.
+ */
+void retryJoin(void) {
+    uint32_t uptime_s = uptimeSeconds();
+    if (!hasLoRaWANJoinFailed() || ((uptime_s - join_attempt_uptime_s) < join_backoff_s)) {
+        return;
+    }
+    join_attempt_uptime_s = uptime_s;
+    join_backoff_s = (2 * join_backoff_s < max_join_backoff_s) ? (2 * join_backoff_s) : max_join_backoff_s;
+    LOG(LOG_LEVEL::INFO, "Retrying the join.");
+    startLoRaWANJoinProcedure();
+}
+
+/**
+ * @brief Logs a sample.
+ * @param sensor_data The sensor data.
+ */
+void logSensorData(const sensorData *sensor_data) {
+    LOG(LOG_LEVEL::INFO,
+        "Sensor Data: {b: %.2f mV | t: %.2f C | h: %.2f %% | p: %lu Pa | g: %lu "
+        "| l: %.5f, %.5f | a: %.0f mV}",
+        sensor_data->battery_mv.value, sensor_data->temperature.value, sensor_data->humidity.value,
+        sensor_data->pressure.value, sensor_data->gas_resist.value, sensor_data->location.latitude,
+        sensor_data->location.longitude, sensor_data->analog_mv.value);
+}
+
+/**
+ * @brief Logs the port & encoded bytes of lorawan_payload.
+ */
+void logPayload(void) {
     char encoded_payload_bytes[3 * PAYLOAD_BUFFER_SIZE] = {};
     for (int b = 0; b < lorawan_payload.buffsize; b++) {
-        snprintf(encoded_payload_bytes, sizeof(encoded_payload_bytes), "%s%02X ", encoded_payload_bytes, payload_buffer[b]);
+        // write each byte after the previous one - passing the buffer as both the source & destination is undefined
+        snprintf(&encoded_payload_bytes[3 * b], sizeof(encoded_payload_bytes) - (3 * b), "%02X ", payload_buffer[b]);
     }
-    log(LOG_LEVEL::INFO, "Port: %2.d | Payload: %s", lorawan_payload.port, encoded_payload_bytes);
+    LOG(LOG_LEVEL::INFO, "Port: %2.d | Payload: %s", lorawan_payload.port, encoded_payload_bytes);
 }
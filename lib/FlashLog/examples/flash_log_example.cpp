@@ -0,0 +1,96 @@
+/**
+ * @file flash_log_example.cpp
+ * @author Kalina Knight
+ * @brief A low power example that keeps the logs on the RAK15001 flash, for unattended units.
+ *
+ * @details Every minute the device wakes up, logs the battery voltage and goes back to 'sleep'. The logs go to the
+ * flash log (& Serial, unless built with -DLOG_TO_SERIAL=0). Once an hour the flash log counters are logged.
+ * Read the logs back with dumpLogs() & tools/flash_log_extractor.py, see the FlashLog README.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "AnalogSensor.h"    /**< BatteryLevel class. */
+#include "FlashLog.h"        /**< Go here to change the flash log region. */
+#include "Logging.h"         /**< Go here to change the logging level for the entire application. */
+#include "RAK15001_helper.h" /**< Wrapper for the Adafruit SPIFlash library. */
+
+// APP TIMER
+const int log_interval = 60000; /**< logTimer interval value in [ms] = 1 minute. */
+SoftwareTimer logTimer;         /**< logTimer to wakeup task and log. */
+// forward declaration
+static void logTimerTimeoutHandler(TimerHandle_t unused);
+
+// POWER SAVING - see the combined example README for further details on Semaphores & low power mode
+static SemaphoreHandle_t semaphore_handle = NULL; /**< Semaphore used by events to wake up loop task. */
+
+// FLASH LOG
+RAK15001 flash;
+flashLog flash_log(&flash, FLASH_LOG_MAGIC_LOGS, FLASH_LOG_FIRST_SECTOR, FLASH_LOG_N_SECTORS);
+flashLogSink flash_log_sink(flash_log);
+
+BatteryLevel battery;
+ulong minutes = 0;
+
+/**
+ * @brief Write the flash log out over Serial for tools/flash_log_extractor.py, e.g. when a button is pressed.
+ */
+void dumpLogs(void) {
+    flash_log_sink.flush();
+    Serial.begin(115200);
+    flash_log.dump(Serial);
+}
+
+/**
+ * @brief Setup code runs once on reset/startup.
+ */
+void setup() {
+    // start the flash log first so it gets the startup logs too
+    if (flash.init() && flash_log.begin()) {
+        addLogSink(&flash_log_sink);
+    }
+    initLogging();
+    LOG(LOG_LEVEL::INFO,
+        "\n========================"
+        "\nWelcome to Flash Logging"
+        "\n========================");
+
+    battery.ADCInit();
+
+    // Create the semaphore that will enable low power 'sleep'
+    semaphore_handle = xSemaphoreCreateBinary();
+
+    logTimer.begin(log_interval, logTimerTimeoutHandler);
+    logTimer.start();
+}
+
+/**
+ * @brief Loop code runs repeated after setup().
+ */
+void loop() {
+    // Sleep until woken up by the logTimer, the log drain task writes to the flash meanwhile
+    xSemaphoreTake(semaphore_handle, portMAX_DELAY);
+
+    minutes++;
+    LOG(LOG_LEVEL::INFO, "Minute %lu: battery %.0f mV", minutes, battery.getSensorMV());
+    if ((minutes % 60) == 0) {
+        flashLogStats stats = flash_log.getStats();
+        LOG(LOG_LEVEL::INFO, "Flash log: %u sectors, %lu records, %lu page writes, %lu erases, max erase count %lu",
+            stats.sectors_used, (unsigned long)stats.records, (unsigned long)stats.page_writes,
+            (unsigned long)stats.sector_erases, (unsigned long)stats.max_erase_count);
+    }
+}
+
+/**
+ * @brief Function for handling logTimer timeout event.
+ * Wakes the loop task by giving the semaphore.
+ */
+void logTimerTimeoutHandler(TimerHandle_t unused) {
+    // Give the semaphore, so the loop task can take it and wake up
+    xSemaphoreGiveFromISR(semaphore_handle, pdFALSE);
+}
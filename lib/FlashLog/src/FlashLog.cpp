@@ -0,0 +1,344 @@
+#define LOG_MODULE_ID LOG_MODULE::STORAGE // see setLogLevel() in Logging.h
+
+#include "FlashLog.h"
+
+#include <stddef.h>
+
+#include "Logging.h"
+
+// flashLogSink doesn't bother filling the last few bytes of a page, a record header is 3 bytes of it anyway
+#define FLASH_LOG_SINK_MIN_RECORD_LENGTH 16
+
+uint16_t flashLogCRC(const void *bytes, size_t len, uint16_t crc) {
+    const uint8_t *data = (const uint8_t *)bytes;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+bool flashLog::begin(void) {
+    has_head = false;
+    stats = {};
+    if ((n_sectors < 2) || (sectorAddress(n_sectors) > flash->size())) {
+        LOG(LOG_LEVEL::ERROR, "Flash log region of %u sectors from %u doesn't fit on the flash.", n_sectors,
+            first_sector);
+        return false;
+    }
+
+    // find the newest & oldest sectors from the headers alone
+    uint32_t oldest_sequence = UINT32_MAX;
+    for (uint16_t sector = 0; sector < n_sectors; sector++) {
+        flashLogSectorHeader header;
+        if (!readSectorHeader(sector, &header)) {
+            continue;
+        }
+        stats.sectors_used++;
+        if (header.erase_count > stats.max_erase_count) {
+            stats.max_erase_count = header.erase_count;
+        }
+        if (!has_head || (header.sequence > stats.sequence)) {
+            has_head = true;
+            head_sector = sector;
+            head_erase_count = header.erase_count;
+            stats.sequence = header.sequence;
+        }
+        if (header.sequence < oldest_sequence) {
+            oldest_sequence = header.sequence;
+            oldest_sector = sector;
+        }
+    }
+    if (!has_head) {
+        LOG(LOG_LEVEL::INFO, "Flash log from sector %u is empty.", first_sector);
+        return true;
+    }
+
+    // then find the end of the records in the newest sector, a page at a time
+    uint32_t address = sectorAddress(head_sector);
+    for (uint16_t page_index = 0; page_index < FLASH_LOG_PAGES_PER_SECTOR; page_index++) {
+        page_offset = page_index * SFLASH_PAGE_SIZE;
+        flash->readBuffer(address + page_offset, page, SFLASH_PAGE_SIZE);
+        bool bad = false;
+        page_fill = findPageEnd((page_index == 0) ? FLASH_LOG_SECTOR_HEADER_LENGTH : 0, &bad);
+        if (bad) {
+            // probably a write cut short by a reset, the rest of the page can't be trusted so carry on in the next
+            stats.bad_records++;
+            page_fill = SFLASH_PAGE_SIZE;
+        } else if (page_index + 1 < FLASH_LOG_PAGES_PER_SECTOR) {
+            // the records carry on in the next page if the last one didn't fit in this one
+            uint8_t next_length = 0xFF;
+            flash->readBuffer(address + page_offset + SFLASH_PAGE_SIZE, &next_length, sizeof(next_length));
+            if (next_length == 0xFF) {
+                break;
+            }
+        }
+    }
+    page_written = page_fill;
+
+    LOG(LOG_LEVEL::INFO, "Flash log: %u sectors used, newest sector %u (#%lu) at %u bytes, max erase count %lu.",
+        stats.sectors_used, first_sector + head_sector, (unsigned long)stats.sequence, page_offset + page_fill,
+        (unsigned long)stats.max_erase_count);
+    if (stats.bad_records > 0) {
+        LOG(LOG_LEVEL::WARN, "Flash log from sector %u: skipped %lu bad records.", first_sector,
+            (unsigned long)stats.bad_records);
+    }
+    return true;
+}
+
+bool flashLog::append(const void *bytes, uint16_t len) {
+    if ((len == 0) || (len > FLASH_LOG_MAX_RECORD_LENGTH)) {
+        return false;
+    }
+    if (!has_head && !startSector()) {
+        return false;
+    }
+    while (pageRoom() < len) {
+        if (!nextPage()) {
+            return false;
+        }
+    }
+
+    uint8_t *record = &page[page_fill];
+    record[0] = (uint8_t)len;
+    memcpy(&record[FLASH_LOG_RECORD_HEADER_LENGTH], bytes, len);
+    uint16_t crc = flashLogCRC(record, 1);
+    crc = flashLogCRC(&record[FLASH_LOG_RECORD_HEADER_LENGTH], len, crc);
+    record[1] = (uint8_t)crc;
+    record[2] = (uint8_t)(crc >> 8);
+    page_fill += FLASH_LOG_RECORD_HEADER_LENGTH + len;
+    stats.records++;
+
+    if (pageRoom() == 0) {
+        // the page is full, no point waiting
+        return flush();
+    }
+    return true;
+}
+
+bool flashLog::flush(void) {
+    if (!has_head || (page_written >= page_fill)) {
+        return true;
+    }
+    uint16_t len = page_fill - page_written;
+    if (flash->writeBuffer(sectorAddress(head_sector) + page_offset + page_written, &page[page_written], len) != len) {
+        return false;
+    }
+    page_written = page_fill;
+    stats.page_writes++;
+    return true;
+}
+
+uint16_t flashLog::pageRoom(void) const {
+    if (!has_head || ((page_fill + FLASH_LOG_RECORD_HEADER_LENGTH) >= SFLASH_PAGE_SIZE)) {
+        return 0;
+    }
+    return SFLASH_PAGE_SIZE - page_fill - FLASH_LOG_RECORD_HEADER_LENGTH;
+}
+
+flashLogPosition flashLog::oldest(void) const {
+    if (!has_head) {
+        return { stats.sequence + 1, FLASH_LOG_SECTOR_HEADER_LENGTH }; // where the first sector will start
+    }
+    return { stats.sequence - (stats.sectors_used - 1), FLASH_LOG_SECTOR_HEADER_LENGTH };
+}
+
+flashLogPosition flashLog::end(void) const {
+    if (!has_head) {
+        return oldest();
+    }
+    return { stats.sequence, (uint16_t)(page_offset + page_fill) };
+}
+
+uint16_t flashLog::read(flashLogPosition *position, uint8_t *bytes) {
+    if (!has_head || !flush()) {
+        return 0;
+    }
+    flashLogPosition oldest_position = oldest();
+    if ((position->sequence < oldest_position.sequence) || (position->sequence > stats.sequence)) {
+        // erased since (or from before the log was started again), so carry on from the oldest there is
+        stats.overwritten++;
+        *position = oldest_position;
+    }
+    if (position->offset < FLASH_LOG_SECTOR_HEADER_LENGTH) {
+        position->offset = FLASH_LOG_SECTOR_HEADER_LENGTH;
+    }
+
+    flashLogPosition end_position = end();
+    while ((position->sequence < end_position.sequence) || (position->offset < end_position.offset)) {
+        uint16_t page_end = (position->offset / SFLASH_PAGE_SIZE + 1) * SFLASH_PAGE_SIZE;
+        if (position->offset >= SFLASH_SECTOR_SIZE) {
+            *position = { position->sequence + 1, FLASH_LOG_SECTOR_HEADER_LENGTH };
+            continue;
+        }
+        if ((position->offset + FLASH_LOG_RECORD_HEADER_LENGTH) >= page_end) {
+            position->offset = page_end;
+            continue;
+        }
+
+        // the sectors are used in order, so the sector is as far behind the head as its sequence number
+        uint16_t sector = nextSector(head_sector, n_sectors - (stats.sequence - position->sequence));
+        uint32_t address = sectorAddress(sector) + position->offset;
+        uint8_t header[FLASH_LOG_RECORD_HEADER_LENGTH];
+        flash->readBuffer(address, header, sizeof(header));
+        uint8_t len = header[0];
+        if (len == 0xFF) {
+            // the rest of the page is empty, the next record didn't fit
+            position->offset = page_end;
+            continue;
+        }
+        if ((len == 0) || ((position->offset + FLASH_LOG_RECORD_HEADER_LENGTH + len) > page_end)) {
+            stats.bad_records++;
+            position->offset = page_end;
+            continue;
+        }
+        flash->readBuffer(address + FLASH_LOG_RECORD_HEADER_LENGTH, bytes, len);
+        uint16_t crc = flashLogCRC(bytes, len, flashLogCRC(header, 1));
+        if (crc != (uint16_t)(header[1] | (header[2] << 8))) {
+            stats.bad_records++;
+            position->offset = page_end;
+            continue;
+        }
+        position->offset += FLASH_LOG_RECORD_HEADER_LENGTH + len;
+        return len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read a sector's header.
+ * @param sector Sector, relative to first_sector.
+ * @param header Returns the header.
+ * @return True if the header is valid & belongs to this log.
+ */
+bool flashLog::readSectorHeader(uint16_t sector, flashLogSectorHeader *header) {
+    if (flash->readBuffer(sectorAddress(sector), (uint8_t *)header, sizeof(*header)) != sizeof(*header)) {
+        return false;
+    }
+    return (header->magic == magic) && (header->crc == flashLogCRC(header, offsetof(flashLogSectorHeader, crc)));
+}
+
+/**
+ * @brief Erase the sector after the head (the oldest once the region is full) and start appending to it.
+ * @return False if the flash failed.
+ */
+bool flashLog::startSector(void) {
+    uint16_t sector = has_head ? nextSector(head_sector) : 0;
+
+    // carry the erase count on. If the sector's header is gone (never used, or cut short by a reset) it's assumed to be
+    // on the same lap as the head sector.
+    flashLogSectorHeader header;
+    bool in_use = readSectorHeader(sector, &header);
+    header.erase_count = in_use ? (header.erase_count + 1) : (has_head ? head_erase_count : 1);
+    header.magic = magic;
+    header.sequence = stats.sequence + 1;
+    header.reserved = 0xFFFF;
+    header.crc = flashLogCRC(&header, offsetof(flashLogSectorHeader, crc));
+
+    if (!flash->eraseSector(first_sector + sector)) {
+        return false;
+    }
+    stats.sector_erases++;
+    if (flash->writeBuffer(sectorAddress(sector), (const uint8_t *)&header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    stats.page_writes++;
+
+    if (in_use) {
+        // the oldest sector is gone
+        stats.sectors_used--;
+        if (sector == oldest_sector) {
+            oldest_sector = nextSector(sector);
+        }
+    }
+    if (stats.sectors_used == 0) {
+        oldest_sector = sector;
+    }
+    stats.sectors_used++;
+    stats.sequence = header.sequence;
+    head_erase_count = header.erase_count;
+    if (header.erase_count > stats.max_erase_count) {
+        stats.max_erase_count = header.erase_count;
+    }
+
+    has_head = true;
+    head_sector = sector;
+    page_offset = 0;
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, &header, sizeof(header));
+    page_fill = sizeof(header);
+    page_written = sizeof(header);
+    return true;
+}
+
+/**
+ * @brief Program the current page and move onto the next, or the next sector.
+ * @return False if the flash failed.
+ */
+bool flashLog::nextPage(void) {
+    if (!flush()) {
+        return false;
+    }
+    page_offset += SFLASH_PAGE_SIZE;
+    if (page_offset >= SFLASH_SECTOR_SIZE) {
+        return startSector();
+    }
+    memset(page, 0xFF, sizeof(page));
+    page_fill = 0;
+    page_written = 0;
+    return true;
+}
+
+/**
+ * @brief Walk the records in the page buffer to find where they end.
+ * @param start Offset of the first record.
+ * @param bad Returns true if the walk stopped at a bad record rather than erased flash.
+ * @return Offset of the end of the last good record.
+ */
+uint16_t flashLog::findPageEnd(uint16_t start, bool *bad) {
+    uint16_t offset = start;
+    *bad = false;
+    while ((offset + FLASH_LOG_RECORD_HEADER_LENGTH) < SFLASH_PAGE_SIZE) {
+        uint8_t len = page[offset];
+        if (len == 0xFF) {
+            break;
+        }
+        if ((len == 0) || ((offset + FLASH_LOG_RECORD_HEADER_LENGTH + len) > SFLASH_PAGE_SIZE)) {
+            *bad = true;
+            break;
+        }
+        uint16_t crc = flashLogCRC(&page[offset], 1);
+        crc = flashLogCRC(&page[offset + FLASH_LOG_RECORD_HEADER_LENGTH], len, crc);
+        if (crc != (uint16_t)(page[offset + 1] | (page[offset + 2] << 8))) {
+            *bad = true;
+            break;
+        }
+        offset += FLASH_LOG_RECORD_HEADER_LENGTH + len;
+    }
+    return offset;
+}
+
+void flashLogSink::write(const uint8_t *bytes, size_t len) {
+    while (len > 0) {
+        // the log bytes are one stream, so records can be cut anywhere to fill the pages
+        uint16_t record_len = log.pageRoom();
+        if (record_len < FLASH_LOG_SINK_MIN_RECORD_LENGTH) {
+            record_len = FLASH_LOG_MAX_RECORD_LENGTH;
+        }
+        if (record_len > len) {
+            record_len = len;
+        }
+        if (!log.append(bytes, record_len)) {
+            // can't log about it as it'd just end up back here
+            return;
+        }
+        bytes += record_len;
+        len -= record_len;
+    }
+}
+
+bool flashLogSink::flush(void) {
+    return flushLogs() && log.flush();
+}
@@ -0,0 +1,219 @@
+#pragma once
+/**
+ * @file FlashLog.h
+ * @author Kalina Knight
+ * @brief Append-only, wear levelled record store on SPI NOR flash, e.g. the RAK15001's GD25Q16C (RAK15001_helper.h).
+ *
+ * A flashLog uses a region of whole sectors as a circular log. Each sector starts with a header (magic, sequence number
+ * & erase count) and then holds records, each framed by a length byte & CRC so torn writes are found & skipped.
+ * Records are collected in a RAM page buffer and programmed a page at a time. When the region is full the oldest sector
+ * is erased & reused, so every sector is erased the same number of times. At startup only the sector headers are read
+ * to find the newest sector, plus the pages of that one sector to find where to carry on.
+ *
+ * Sector layout:
+ *     | header (16 bytes) | record | record | ... | 0xFF (erased) |
+ * Record layout, records never cross a page boundary:
+ *     | length (1 byte) | CRC-16 of length & data (2 bytes, little endian) | data (1 - 253 bytes) |
+ *
+ * tools/flash_log_extractor.py reads the records back out of a flash image or dump().
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Adafruit_SPIFlash.h>
+#include <Arduino.h>
+
+#include "LogSink.h"
+
+#define FLASH_LOG_SECTOR_HEADER_LENGTH 16
+#define FLASH_LOG_RECORD_HEADER_LENGTH 3
+#define FLASH_LOG_MAX_RECORD_LENGTH    (SFLASH_PAGE_SIZE - FLASH_LOG_RECORD_HEADER_LENGTH)
+#define FLASH_LOG_PAGES_PER_SECTOR     (SFLASH_SECTOR_SIZE / SFLASH_PAGE_SIZE)
+
+// Magic numbers at the start of each sector, which also tell the extractor what the records are
+#define FLASH_LOG_MAGIC_LOGS 0x474F4C46 // "FLOG": the log byte stream, see flashLogSink
+
+// Region of the 2 MB RAK15001 used for the logs, the first 1 MB unless set with build flags
+#ifndef FLASH_LOG_FIRST_SECTOR
+#define FLASH_LOG_FIRST_SECTOR 0
+#endif
+#ifndef FLASH_LOG_N_SECTORS
+#define FLASH_LOG_N_SECTORS 256
+#endif
+
+/**
+ * @brief Header at the start of every sector in use.
+ */
+struct flashLogSectorHeader {
+    uint32_t magic;       /**< Which store the sector belongs to, erased (0xFFFFFFFF) if unused. */
+    uint32_t sequence;    /**< Counts up by 1 for every new sector, so the newest has the highest. */
+    uint32_t erase_count; /**< Times this sector has been erased. */
+    uint16_t reserved;    /**< 0xFFFF. */
+    uint16_t crc;         /**< CRC-16 of the header before this field. */
+};
+static_assert(sizeof(flashLogSectorHeader) == FLASH_LOG_SECTOR_HEADER_LENGTH, "flashLogSectorHeader must be packed.");
+
+/**
+ * @brief Position of a record in a flashLog, for reading the records back with flashLog::read().
+ */
+struct flashLogPosition {
+    uint32_t sequence; /**< Sequence number of the sector. */
+    uint16_t offset;   /**< Offset in the sector. */
+};
+
+/**
+ * @brief Counters for a flashLog, see flashLog::getStats().
+ */
+struct flashLogStats {
+    uint16_t sectors_used;    /**< Sectors holding records. */
+    uint32_t sequence;        /**< Sequence number of the newest sector. */
+    uint32_t max_erase_count; /**< Most erases of any sector. The others have been erased the same or 1 less. */
+    uint32_t records;         /**< Records appended since begin(). */
+    uint32_t page_writes;     /**< Page programs since begin(). */
+    uint32_t sector_erases;   /**< Sector erases since begin(). */
+    uint32_t bad_records;     /**< Records that failed their CRC in begin() or read(). */
+    uint32_t overwritten;     /**< Times read() was behind the oldest sector, so skipped the records erased since. */
+};
+
+/**
+ * @brief CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF), used for the sector headers & records.
+ * @param bytes Bytes to check.
+ * @param len Number of bytes.
+ * @param crc CRC so far, to continue over several buffers.
+ * @return The CRC.
+ */
+uint16_t flashLogCRC(const void *bytes, size_t len, uint16_t crc = 0xFFFF);
+
+class flashLog {
+  public:
+    /**
+     * @brief A log on the given sectors of the flash. Nothing is read until begin().
+     * @param flash The flash, already started.
+     * @param magic Magic number for the sector headers, different for every store on the same flash.
+     * @param first_sector First sector of the region.
+     * @param n_sectors Number of sectors in the region, at least 2.
+     */
+    flashLog(Adafruit_SPIFlash *flash, uint32_t magic, uint16_t first_sector, uint16_t n_sectors)
+        : flash(flash), magic(magic), first_sector(first_sector), n_sectors(n_sectors){};
+
+    /**
+     * @brief Find the end of the log from the sector headers, and the pages of the newest sector.
+     * @return False if the region doesn't fit on the flash.
+     */
+    bool begin(void);
+
+    /**
+     * @brief Append a record. It's kept in RAM until its page is full or flush() is called.
+     * May erase the oldest sector, which takes ~50 ms.
+     * @param bytes Record data.
+     * @param len Record length, 1 - FLASH_LOG_MAX_RECORD_LENGTH bytes.
+     * @return False if the length is invalid or the flash failed.
+     */
+    bool append(const void *bytes, uint16_t len);
+
+    /**
+     * @brief Program the appended records still in RAM to the flash. Later records carry on in the same page.
+     * @return False if the flash failed.
+     */
+    bool flush(void);
+
+    /**
+     * @brief Get the longest record that still fits in the current page, so a byte stream can fill pages exactly.
+     * @return Max record length without moving onto the next page, 0 if none fit.
+     */
+    uint16_t pageRoom(void) const;
+
+    /**
+     * @brief Position of the oldest record.
+     * @return The position, to start reading from.
+     */
+    flashLogPosition oldest(void) const;
+
+    /**
+     * @brief Position after the newest record, which read() will return to once every record has been read.
+     * @return The position.
+     */
+    flashLogPosition end(void) const;
+
+    /**
+     * @brief Read the next good record, oldest first. Flushes first, so every appended record can be read.
+     * Bad records are skipped. If the position's sector has been erased since, it skips to the oldest record.
+     * @param position Position to read from, moved to after the record read.
+     * @param bytes Returns the record data, must fit FLASH_LOG_MAX_RECORD_LENGTH bytes.
+     * @return Record length, 0 if there are no more records.
+     */
+    uint16_t read(flashLogPosition *position, uint8_t *bytes);
+
+    /**
+     * @brief Flush, then write every sector in use to the stream, oldest first, for tools/flash_log_extractor.py.
+     * @tparam STREAM Anything with a write(const uint8_t *, size_t) method, e.g. Serial.
+     * @param stream Stream to write to.
+     */
+    template <typename STREAM> void dump(STREAM &stream) {
+        flush();
+        uint8_t buffer[SFLASH_PAGE_SIZE];
+        for (uint16_t i = 0; i < stats.sectors_used; i++) {
+            uint32_t address = sectorAddress(nextSector(oldest_sector, i));
+            for (uint32_t offset = 0; offset < SFLASH_SECTOR_SIZE; offset += sizeof(buffer)) {
+                flash->readBuffer(address + offset, buffer, sizeof(buffer));
+                stream.write(buffer, sizeof(buffer));
+            }
+        }
+    };
+
+    /**
+     * @brief Get the counters.
+     * @return The counters.
+     */
+    flashLogStats getStats(void) const { return stats; };
+
+  private:
+    bool readSectorHeader(uint16_t sector, flashLogSectorHeader *header);
+    bool startSector(void);
+    bool nextPage(void);
+    uint16_t findPageEnd(uint16_t start, bool *bad);
+
+    inline uint16_t nextSector(uint16_t sector, uint16_t n = 1) const { return (sector + n) % n_sectors; };
+    inline uint32_t sectorAddress(uint16_t sector) const {
+        return (uint32_t)(first_sector + sector) * SFLASH_SECTOR_SIZE;
+    };
+
+    Adafruit_SPIFlash *flash;
+    const uint32_t magic;
+    const uint16_t first_sector;
+    const uint16_t n_sectors;
+
+    bool has_head = false;         /**< Whether a sector has been started. */
+    uint16_t head_sector = 0;      /**< Sector being appended to, relative to first_sector. */
+    uint32_t head_erase_count = 0; /**< Erase count of the head sector. */
+    uint16_t oldest_sector = 0;    /**< Oldest sector in use, relative to first_sector. */
+    uint16_t page_offset = 0;      /**< Offset of the page buffer in the head sector. */
+    uint16_t page_fill = 0;        /**< Bytes used in the page buffer. */
+    uint16_t page_written = 0;     /**< Bytes of the page buffer already programmed. */
+    uint8_t page[SFLASH_PAGE_SIZE];
+    flashLogStats stats = {};
+};
+
+/**
+ * @brief Log sink (see LogSink.h) that appends the log bytes to a flashLog, filling its pages.
+ * The last part page of logs is only in RAM until it fills or flashLogSink::flush() is called, e.g. before a reset.
+ */
+class flashLogSink : public logSink {
+  public:
+    explicit flashLogSink(flashLog &log) : log(log){};
+
+    void write(const uint8_t *bytes, size_t len) override;
+
+    /**
+     * @brief Write out the log buffer with flushLogs(), then program the logs still in RAM to the flash.
+     * @return False if the log drain task was interrupted in the middle of writing (try again later) or the flash
+     * failed.
+     */
+    bool flush(void);
+
+  private:
+    flashLog &log;
+};
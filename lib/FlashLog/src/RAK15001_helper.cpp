@@ -0,0 +1,36 @@
+#define LOG_MODULE_ID LOG_MODULE::STORAGE // see setLogLevel() in Logging.h
+
+#include "RAK15001_helper.h"
+
+#include "Logging.h"
+
+// Flash definition for the GD25Q16C, from the RAK15001 example
+static const SPIFlash_Device_t rak15001_device = {
+    .total_size = (1UL << 21),
+    .start_up_time_us = 5000,
+    .manufacturer_id = 0xc8,
+    .memory_type = 0x40,
+    .capacity = 0x15,
+    .max_clock_speed_mhz = 15,
+    .quad_enable_bit_mask = 0x00,
+    .has_sector_protection = false,
+    .supports_fast_read = true,
+    .supports_qspi = false,
+    .supports_qspi_writes = false,
+    .write_status_register_split = false,
+    .single_status_byte = true,
+    .is_fram = false,
+};
+
+bool RAK15001::init(void) {
+    if (!begin(&rak15001_device)) {
+        LOG(LOG_LEVEL::ERROR, "RAK15001 flash access failed.");
+        return false;
+    }
+    waitUntilReady();
+    if (getJEDECID() != RAK15001_JEDEC_ID) {
+        LOG(LOG_LEVEL::ERROR, "RAK15001 flash JEDEC ID %06lX isn't a GD25Q16C.", (unsigned long)getJEDECID());
+        return false;
+    }
+    return true;
+}
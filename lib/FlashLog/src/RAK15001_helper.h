@@ -0,0 +1,31 @@
+#pragma once
+/**
+ * @file RAK15001_helper.h
+ * @author Kalina Knight
+ * @brief RAK15001 class inherits the Adafruit_SPIFlash class and adds the GD25Q16C's settings to simplify
+ * initialisation, like the RAK15001_Flash_GD25Q16C WisBlock example.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Adafruit_SPIFlash.h> // Click to get library: http://librarymanager/All#Adafruit_SPIFlash
+#include <Arduino.h>
+
+#define RAK15001_JEDEC_ID 0xC84015 // GigaDevice GD25Q16C
+
+class RAK15001 : public Adafruit_SPIFlash {
+  public:
+    RAK15001(void) : Adafruit_SPIFlash(&transport), transport(SS, SPI){};
+
+    /**
+     * @brief Initialises the 2 MB flash on the SPI bus.
+     * @return True if successful. False if not.
+     */
+    bool init(void);
+
+  private:
+    Adafruit_FlashTransport_SPI transport;
+};
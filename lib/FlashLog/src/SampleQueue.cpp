@@ -0,0 +1,167 @@
+#define LOG_MODULE_ID LOG_MODULE::STORAGE // see setLogLevel() in Logging.h
+
+#include "SampleQueue.h"
+
+#include "Logging.h"
+#include "SpanProfiler.h"
+#include "WallClock.h"
+
+// a saved read position: sequence (4 bytes) & offset (2 bytes), little endian
+#define SAMPLE_QUEUE_CURSOR_RECORD_LENGTH 6
+
+/**
+ * @brief Check if a position in the log is after another.
+ * @param position Position to check.
+ * @param other Position to compare with.
+ * @return True if position is after other.
+ */
+static bool isAfter(const flashLogPosition &position, const flashLogPosition &other) {
+    return ((position.sequence > other.sequence) ||
+            ((position.sequence == other.sequence) && (position.offset > other.offset)));
+}
+
+bool sampleQueue::begin(void) {
+    frame_samples = 0;
+    stats = {};
+    if (!samples.begin() || !cursor.begin()) {
+        return false;
+    }
+    boot_start = samples.end();
+
+    // the newest saved position is where the queue starts, the oldest sample if nothing has been sent yet
+    read_position = samples.oldest();
+    flashLogPosition position = cursor.oldest();
+    uint8_t record[FLASH_LOG_MAX_RECORD_LENGTH];
+    uint16_t len;
+    while ((len = cursor.read(&position, record)) != 0) {
+        if (len == SAMPLE_QUEUE_CURSOR_RECORD_LENGTH) {
+            read_position.sequence = record[0] | (record[1] << 8) | (record[2] << 16) | ((uint32_t)record[3] << 24);
+            read_position.offset = record[4] | (record[5] << 8);
+        }
+    }
+    LOG(LOG_LEVEL::DEBUG, "Sample queue starts at sector %lu offset %u.", (unsigned long)read_position.sequence,
+        read_position.offset);
+    return true;
+}
+
+bool sampleQueue::push(const portSchema &port, const sensorData *sample, uint32_t uptime_s) {
+    if (port == PORTERROR) {
+        return false;
+    }
+    uint8_t record[SAMPLE_QUEUE_RECORD_HEADER_LENGTH + PAYLOAD_BUFFER_SIZE] = {};
+    record[0] = port.port_number;
+    for (uint8_t i = 0; i < 4; i++) {
+        record[1 + i] = (uint8_t)(uptime_s >> (8 * i));
+    }
+    SPAN_BEGIN(SPAN::ENCODE);
+    uint8_t len = port.encodeSensorDataToPayload(sample, record, SAMPLE_QUEUE_RECORD_HEADER_LENGTH);
+    SPAN_END(SPAN::ENCODE);
+    // programmed straight away, so a reset doesn't lose it
+    if (!samples.append(record, len) || !samples.flush()) {
+        LOG(LOG_LEVEL::ERROR, "Failed to queue the sample.");
+        return false;
+    }
+    stats.pushed++;
+    return true;
+}
+
+uint8_t sampleQueue::fillFrame(uint8_t *buffer, uint8_t max_len, uint8_t *port_number, uint8_t *len) {
+    frame_samples = 0;
+    *len = 0;
+
+    // read the oldest samples of the same port, as they were encoded
+    uint8_t record[FLASH_LOG_MAX_RECORD_LENGTH];
+    portSchema port = PORTERROR;
+    uint8_t n_samples = 0;
+    flashLogPosition position = read_position;
+    while (n_samples < SAMPLE_QUEUE_MAX_FRAME_SAMPLES) {
+        uint16_t record_len = samples.read(&position, record);
+        if (record_len == 0) {
+            break;
+        }
+        if (n_samples == 0) {
+            port = getPort(record[0]);
+            if ((port == PORTERROR) || (record_len != (SAMPLE_QUEUE_RECORD_HEADER_LENGTH + port.payloadLength()))) {
+                // can't be sent, e.g. from firmware with different ports, so skip it
+                LOG(LOG_LEVEL::WARN, "Skipped a queued sample for unknown port %u.", record[0]);
+                read_position = position;
+                continue;
+            }
+        } else if ((record[0] != port.port_number) ||
+                   (record_len != (SAMPLE_QUEUE_RECORD_HEADER_LENGTH + port.payloadLength()))) {
+            break;
+        }
+        uint8_t *payload = &payloads[n_samples * port.payloadLength()];
+        memcpy(payload, &record[SAMPLE_QUEUE_RECORD_HEADER_LENGTH], port.payloadLength());
+        if (port.sendTimestamp() && isAfter(position, boot_start)) {
+            timestampPayload(port, record, payload);
+        }
+        payload_ends[n_samples] = position;
+        n_samples++;
+    }
+    if (samples.getStats().overwritten != stats.overwritten) {
+        stats.overwritten = samples.getStats().overwritten;
+        LOG(LOG_LEVEL::WARN, "Sample queue was full, the oldest samples were dropped.");
+    }
+    if (n_samples == 0) {
+        return 0;
+    }
+    if (max_len > PAYLOAD_BUFFER_SIZE) {
+        max_len = PAYLOAD_BUFFER_SIZE;
+    }
+
+    if (n_samples > 1) {
+        SPAN_SCOPE(SPAN::ENCODE);
+        *len = port.encodePayloadsToPayload(payloads, n_samples, buffer, max_len, &frame_samples);
+        *port_number = port.multiSamplePortNumber();
+    }
+    if ((frame_samples == 0) || (frame_samples == 1)) {
+        // the usual single sample frame, sent in fragments if it's longer than max_len
+        *port_number = port.port_number;
+        *len = port.payloadLength();
+        memcpy(buffer, payloads, *len);
+        frame_samples = 1;
+    }
+    frame_end = payload_ends[frame_samples - 1];
+    return frame_samples;
+}
+
+void sampleQueue::timestampPayload(const portSchema &port, const uint8_t *record, uint8_t *payload) {
+    if (port.decodePayloadToSensorData(payload, port.payloadLength()).timestamp.is_valid) {
+        return;
+    }
+    uint32_t uptime_s = record[1] | (record[2] << 8) | (record[3] << 16) | ((uint32_t)record[4] << 24);
+    uint32_t unix_time;
+    if (wallClockAt(uptime_s, &unix_time)) {
+        port.setPayloadTimestamp(payload, unix_time);
+        stats.timestamped++;
+    }
+}
+
+bool sampleQueue::pop(void) {
+    if (frame_samples == 0) {
+        return false;
+    }
+    uint8_t record[SAMPLE_QUEUE_CURSOR_RECORD_LENGTH];
+    for (uint8_t i = 0; i < 4; i++) {
+        record[i] = (uint8_t)(frame_end.sequence >> (8 * i));
+    }
+    record[4] = (uint8_t)frame_end.offset;
+    record[5] = (uint8_t)(frame_end.offset >> 8);
+    // the position is only saved once the frame is sent, so a reset in between sends the samples again
+    if (!cursor.append(record, sizeof(record)) || !cursor.flush()) {
+        LOG(LOG_LEVEL::ERROR, "Failed to save the sample queue position.");
+        return false;
+    }
+    read_position = frame_end;
+    stats.sent += frame_samples;
+    stats.frames++;
+    frame_samples = 0;
+    return true;
+}
+
+bool sampleQueue::empty(void) {
+    uint8_t record[FLASH_LOG_MAX_RECORD_LENGTH];
+    flashLogPosition position = read_position;
+    return (samples.read(&position, record) == 0);
+}
@@ -0,0 +1,142 @@
+#pragma once
+/**
+ * @file SampleQueue.h
+ * @author Kalina Knight
+ * @brief Store & forward queue of sensor samples on the RAK15001 flash, so no reading is lost while the link is down.
+ *
+ * Every sample is appended to a flashLog as soon as it's taken, encoded as it would be sent on its port. The queue is
+ * sent oldest first: fillFrame() packs as many queued samples of the same port as fit into one frame (a multi-sample
+ * frame on the port's multiSamplePortNumber(), or the usual single sample frame if there's only one), then pop()
+ * removes them once the frame has been sent. The read position is kept in its own small flashLog, so the queue
+ * survives resets. When the queue's region fills up the oldest sector of samples is erased, so the newest are kept.
+ *
+ * The samples are sent exactly as they were encoded, except for the timestamp of ports that send one (SEND_TIMESTAMP):
+ * samples taken since startup but before the wall clock was set (WallClock.h) are timestamped from their uptime when
+ * they're sent, if the wall clock has been set by then.
+ *
+ * Record layout:
+ *     | port number (1 byte) | uptime in s (4 bytes, little endian) | encodeSensorDataToPayload() of the sample |
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "FlashLog.h"
+#include "PortSchema.h"
+
+#define SAMPLE_QUEUE_RECORD_HEADER_LENGTH 5
+
+// Magic numbers of the queue's sectors
+#define FLASH_LOG_MAGIC_SAMPLES 0x504D5346 // "FSMP": the queued samples
+#define FLASH_LOG_MAGIC_CURSOR  0x52554346 // "FCUR": the queue's read position
+
+// Region of the 2 MB RAK15001 used for the queue: the second 1 MB, after the logs (see FLASH_LOG_FIRST_SECTOR)
+#ifndef SAMPLE_QUEUE_FIRST_SECTOR
+#define SAMPLE_QUEUE_FIRST_SECTOR 256
+#endif
+#ifndef SAMPLE_QUEUE_N_SECTORS
+#define SAMPLE_QUEUE_N_SECTORS 254 /**< ~1 MB, e.g. ~100 days of PORT3 samples at 1 every 5 minutes. */
+#endif
+#ifndef SAMPLE_QUEUE_CURSOR_FIRST_SECTOR
+#define SAMPLE_QUEUE_CURSOR_FIRST_SECTOR (SAMPLE_QUEUE_FIRST_SECTOR + SAMPLE_QUEUE_N_SECTORS)
+#endif
+#define SAMPLE_QUEUE_CURSOR_N_SECTORS 2
+
+#ifndef SAMPLE_QUEUE_MAX_FRAME_SAMPLES
+#define SAMPLE_QUEUE_MAX_FRAME_SAMPLES 64 /**< Max samples read into one frame by fillFrame(). Costs ~70 bytes RAM each. */
+#endif
+
+/**
+ * @brief Counters for a sampleQueue, see sampleQueue::getStats().
+ */
+struct sampleQueueStats {
+    uint32_t pushed;      /**< Samples queued since begin(). */
+    uint32_t sent;        /**< Samples popped since begin(). */
+    uint32_t frames;      /**< Frames popped since begin(). */
+    uint32_t overwritten; /**< Times the unsent samples were so old their sector had been erased for new ones. */
+    uint32_t timestamped; /**< Samples timestamped when sent, as they were taken before the wall clock was set. */
+};
+
+class sampleQueue {
+  public:
+    /**
+     * @brief A queue on the given sectors of the flash. Nothing is read until begin().
+     * @param flash The flash, already started.
+     * @param first_sector First sector of the samples.
+     * @param n_sectors Number of sectors for the samples, at least 2.
+     * @param cursor_first_sector First of the SAMPLE_QUEUE_CURSOR_N_SECTORS sectors for the read position.
+     */
+    sampleQueue(Adafruit_SPIFlash *flash, uint16_t first_sector = SAMPLE_QUEUE_FIRST_SECTOR,
+                uint16_t n_sectors = SAMPLE_QUEUE_N_SECTORS,
+                uint16_t cursor_first_sector = SAMPLE_QUEUE_CURSOR_FIRST_SECTOR)
+        : samples(flash, FLASH_LOG_MAGIC_SAMPLES, first_sector, n_sectors),
+          cursor(flash, FLASH_LOG_MAGIC_CURSOR, cursor_first_sector, SAMPLE_QUEUE_CURSOR_N_SECTORS){};
+
+    /**
+     * @brief Find the end of the queue and the read position saved by the last pop().
+     * @return False if the regions don't fit on the flash.
+     */
+    bool begin(void);
+
+    /**
+     * @brief Append a sample to the queue and program it to the flash straight away.
+     * @param port Port the sample is sent on, which also decides the fields kept.
+     * @param sample The sample.
+     * @param uptime_s When the sample was taken: seconds since startup, from uptimeSeconds().
+     * @return False if the port is invalid or the flash failed.
+     */
+    bool push(const portSchema &port, const sensorData *sample, uint32_t uptime_s);
+
+    /**
+     * @brief Fill a frame with the oldest queued samples, as many of the same port as fit.
+     * The samples stay queued until pop(), so the frame can be filled again if sending fails. A sample that's longer
+     * than max_len on its own is filled as the usual single sample frame, for sendLoRaWANFrame() to send in fragments.
+     * @param buffer Frame buffer, PAYLOAD_BUFFER_SIZE long.
+     * @param max_len Max length of the frame e.g. the max payload of the current datarate, up to PAYLOAD_BUFFER_SIZE.
+     * @param port_number Returns the port to send the frame on.
+     * @param len Returns the frame length.
+     * @return Number of samples in the frame, 0 if the queue is empty.
+     */
+    uint8_t fillFrame(uint8_t *buffer, uint8_t max_len, uint8_t *port_number, uint8_t *len);
+
+    /**
+     * @brief Remove the samples of the last fillFrame() from the queue, once the frame has been sent.
+     * @return False if there's no frame to pop or the flash failed.
+     */
+    bool pop(void);
+
+    /**
+     * @brief Whether there are samples waiting to be sent.
+     * @return True if the queue is empty.
+     */
+    bool empty(void);
+
+    /**
+     * @brief Get the counters.
+     * @return The counters.
+     */
+    sampleQueueStats getStats(void) const { return stats; };
+
+  private:
+    /**
+     * @brief Timestamp a sample taken since startup from its uptime, if it has no timestamp & the wall clock is set.
+     * @param port Port of the sample, which sends a timestamp.
+     * @param record The sample's record.
+     * @param payload The sample's payload, to write the timestamp into.
+     */
+    void timestampPayload(const portSchema &port, const uint8_t *record, uint8_t *payload);
+
+    flashLog samples;                /**< The queued samples. */
+    flashLog cursor;                 /**< Read positions, the newest one is where the queue starts. */
+    flashLogPosition read_position;  /**< Oldest sample not sent yet. */
+    flashLogPosition frame_end;      /**< Position after the samples of the last fillFrame(). */
+    flashLogPosition boot_start;     /**< End of the queue at begin(), the samples after it were taken since startup. */
+    uint8_t frame_samples = 0;       /**< Samples in the last fillFrame(), 0 if there's nothing to pop. */
+    sampleQueueStats stats = {};
+    uint8_t payloads[SAMPLE_QUEUE_MAX_FRAME_SAMPLES * PAYLOAD_BUFFER_SIZE]; /**< Payloads of the frame's samples. */
+    flashLogPosition payload_ends[SAMPLE_QUEUE_MAX_FRAME_SAMPLES];
+};
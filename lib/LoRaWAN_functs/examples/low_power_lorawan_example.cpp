@@ -45,7 +45,7 @@ lmh_app_data_t lorawan_payload = { payload_buffer, strlen("Hello!"), 1, 0, 0 };
 void setup() {
     // initialise the logging module - function does nothing if APP_LOG_LEVEL in Logging.h = NONE
     initLogging();
-    log(LOG_LEVEL::INFO,
+    LOG(LOG_LEVEL::INFO,
         "\n===================================="
         "\nWelcome to Low Power LoRaWAN Example"
         "\n====================================");
@@ -76,7 +76,7 @@ void loop() {
     switch (current_task) {
         case EVENT_TASK::SLEEP:
             // Sleep until we are woken up by an event
-            log(LOG_LEVEL::DEBUG, "Semaphore sleep");
+            LOG(LOG_LEVEL::DEBUG, "Semaphore sleep");
             // This function call puts the device to 'sleep' in low power mode.
             // The semaphore can only be taken once given in appTimerTimeoutHandler() (or another function).
             // It will wait (up to portMAX_DELAY ticks) for the semaphore_handle semaphore to be given.
@@ -89,7 +89,7 @@ void loop() {
 
         case EVENT_TASK::SEND_PAYLOAD:
             // send sendLoRaWANFrame will do nothing if not connected
-            log(LOG_LEVEL::DEBUG, "Send payload");
+            LOG(LOG_LEVEL::DEBUG, "Send payload");
             sendLoRaWANFrame(&lorawan_payload);
             // go back to 'sleep'
             current_task = EVENT_TASK::SLEEP;
@@ -107,7 +107,7 @@ void loop() {
  * Initializes the payloadTimer as repeating with lorawan_app_interval timeout.
  */
 void appTimerInit(void) {
-    log(LOG_LEVEL::DEBUG, "Initialising timer...");
+    LOG(LOG_LEVEL::DEBUG, "Initialising timer...");
     payloadTimer.begin(lorawan_app_interval, appTimerTimeoutHandler);
 }
 
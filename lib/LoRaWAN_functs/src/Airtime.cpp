@@ -0,0 +1,157 @@
+#include "Airtime.h"
+
+#include <mac/region/RegionAU915.h>
+
+// the uplink datarates of the region the firmware is built for (loraRegion in LoRaWAN_functs.h), from the LoRaWAN
+// stack's regional parameters
+#define REGION_TX_MIN_DATARATE AU915_TX_MIN_DATARATE
+#define REGION_TX_MAX_DATARATE AU915_TX_MAX_DATARATE
+#define REGION_DATARATES       DataratesAU915
+#define REGION_BANDWIDTHS      BandwidthsAU915
+#define REGION_MAX_PAYLOADS    MaxPayloadOfDatarateAU915
+#define REGION_RX1_DATARATES   DatarateOffsetsAU915
+
+#define LORA_LOW_DATARATE_SYMBOL_US 16000 /**< Low datarate optimisation is on for symbols this long & over. */
+
+uint32_t loraAirtimeMicros(uint8_t spreading_factor, uint16_t bandwidth_khz, uint8_t length, uint8_t coding_rate,
+                           uint8_t preamble_symbols) {
+    // exact for 125, 250 & 500 kHz
+    uint32_t symbol_us = (1000UL << spreading_factor) / bandwidth_khz;
+    int32_t low_datarate = (symbol_us >= LORA_LOW_DATARATE_SYMBOL_US) ? 1 : 0;
+    // explicit header & CRC on, as LoRaWAN uplinks are sent
+    int32_t bits = 8 * (int32_t)length - 4 * spreading_factor + 28 + 16;
+    int32_t bits_per_block = 4 * (spreading_factor - 2 * low_datarate);
+    uint32_t payload_symbols = 8;
+    if (bits > 0) {
+        payload_symbols += ((bits + bits_per_block - 1) / bits_per_block) * (coding_rate + 4);
+    }
+    // the preamble is followed by 4.25 symbols of sync word & start frame delimiter
+    uint32_t preamble_us = ((4 * (uint32_t)preamble_symbols + 17) * symbol_us) / 4;
+    return preamble_us + payload_symbols * symbol_us;
+}
+
+bool loraWANDatarate(uint8_t datarate, loraDatarate *settings) {
+    // RFU datarates have no spreading factor
+    if ((datarate < loraWANMinDatarate()) || (datarate > REGION_TX_MAX_DATARATE) || (REGION_DATARATES[datarate] == 0)) {
+        return false;
+    }
+    settings->spreading_factor = REGION_DATARATES[datarate];
+    settings->bandwidth_khz = (uint16_t)(REGION_BANDWIDTHS[datarate] / 1000);
+    settings->max_payload = REGION_MAX_PAYLOADS[datarate];
+    return true;
+}
+
+bool loraWANRx1Datarate(uint8_t uplink_datarate, loraDatarate *settings) {
+    loraDatarate uplink_settings;
+    if (!loraWANDatarate(uplink_datarate, &uplink_settings)) {
+        return false;
+    }
+    // RX1 datarate offset 0, the default, which initLoRaWAN() leaves as is
+    uint8_t datarate = (uint8_t)REGION_RX1_DATARATES[uplink_datarate][0];
+    settings->spreading_factor = REGION_DATARATES[datarate];
+    settings->bandwidth_khz = (uint16_t)(REGION_BANDWIDTHS[datarate] / 1000);
+    settings->max_payload = REGION_MAX_PAYLOADS[datarate];
+    return true;
+}
+
+uint8_t loraWANMinDatarate(void) {
+    return REGION_TX_MIN_DATARATE;
+}
+
+uint8_t loraWANMaxDatarate(void) {
+    uint8_t datarate = REGION_TX_MIN_DATARATE;
+    while ((datarate < REGION_TX_MAX_DATARATE) && (REGION_DATARATES[datarate + 1] != 0)) {
+        datarate++;
+    }
+    return datarate;
+}
+
+uint32_t loraWANAirtimeMicros(uint8_t datarate, uint8_t payload_length) {
+    loraDatarate settings;
+    if (!loraWANDatarate(datarate, &settings)) {
+        return 0;
+    }
+    return loraAirtimeMicros(settings.spreading_factor, settings.bandwidth_khz,
+                             payload_length + LORAWAN_OVERHEAD_LENGTH);
+}
+
+uint64_t airtimeBudget::allowedAtMillis(uint32_t airtime_us, bool use_reserve, uint64_t now_ms) {
+    uint32_t allowed_us = use_reserve ? budget_us : (budget_us - reserve_us);
+    if (airtime_us > allowed_us) {
+        return AIRTIME_NEVER;
+    }
+    roll(now_ms);
+    uint32_t used_us = usedMicros();
+    if ((used_us + airtime_us) <= allowed_us) {
+        return now_ms;
+    }
+    // wait for the oldest slots to roll out of the window until it fits, the current slot last
+    for (uint8_t i = 1; i <= AIRTIME_SLOTS; i++) {
+        used_us -= slots_us[(slot + i) % AIRTIME_SLOTS];
+        if ((used_us + airtime_us) <= allowed_us) {
+            return slot_end_ms + (uint64_t)(i - 1) * slot_ms;
+        }
+    }
+    return AIRTIME_NEVER; // not reached, as it fits an empty window
+}
+
+void airtimeBudget::spend(uint32_t airtime_us, uint64_t now_ms) {
+    roll(now_ms);
+    slots_us[slot] += airtime_us;
+    stats.uplinks++;
+    stats.total_us += airtime_us;
+}
+
+AIRTIME_STATE airtimeBudget::state(uint64_t now_ms) {
+    roll(now_ms);
+    uint32_t used_us = usedMicros();
+    uint32_t left_us = (used_us < budget_us) ? (budget_us - used_us) : 0;
+    uint32_t low_us = (budget_us / 100) * AIRTIME_LOW_PERCENT;
+    // each state is left at a higher level than it's entered at
+    if (left_us < reserve_us + (budget_us / 100) * AIRTIME_EXHAUSTED_PERCENT) {
+        last_state = AIRTIME_STATE::EXHAUSTED;
+    } else if (left_us < low_us) {
+        if (last_state == AIRTIME_STATE::OK) {
+            last_state = AIRTIME_STATE::RUNNING_LOW;
+        }
+    } else if (left_us < (budget_us / 100) * AIRTIME_RECOVERED_PERCENT) {
+        if (last_state == AIRTIME_STATE::EXHAUSTED) {
+            last_state = AIRTIME_STATE::RUNNING_LOW;
+        }
+    } else {
+        last_state = AIRTIME_STATE::OK;
+    }
+    return last_state;
+}
+
+airtimeStats airtimeBudget::getStats(uint64_t now_ms) {
+    roll(now_ms);
+    uint32_t used_us = usedMicros();
+    stats.used_ms = used_us / 1000;
+    stats.left_ms = (used_us < budget_us) ? ((budget_us - used_us) / 1000) : 0;
+    return stats;
+}
+
+void airtimeBudget::roll(uint64_t now_ms) {
+    if (slot_end_ms == 0) {
+        slot_end_ms = now_ms + slot_ms;
+        return;
+    }
+    for (uint8_t i = 0; (now_ms >= slot_end_ms) && (i < AIRTIME_SLOTS); i++) {
+        slot = (slot + 1) % AIRTIME_SLOTS;
+        slots_us[slot] = 0;
+        slot_end_ms += slot_ms;
+    }
+    if (now_ms >= slot_end_ms) {
+        // the whole window has rolled out, start the current slot afresh
+        slot_end_ms = now_ms + slot_ms;
+    }
+}
+
+uint32_t airtimeBudget::usedMicros(void) const {
+    uint32_t used_us = 0;
+    for (uint32_t slot_us : slots_us) {
+        used_us += slot_us;
+    }
+    return used_us;
+}
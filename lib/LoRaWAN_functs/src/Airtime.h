@@ -0,0 +1,214 @@
+#pragma once
+/**
+ * @file Airtime.h
+ * @author Kalina Knight
+ * @brief Time on air of LoRaWAN uplinks, and a rolling airtime budget to keep them within.
+ *
+ * loraAirtimeMicros() is the time on air of a LoRa packet from the Semtech SX126x/SX127x datasheet formula, for any
+ * spreading factor, bandwidth & coding rate. loraWANAirtimeMicros() adds the LoRaWAN overhead to an application
+ * payload and looks the spreading factor & bandwidth up with loraWANDatarate(), from the LoRaWAN stack's regional
+ * parameters for the region the firmware is built for (loraRegion in LoRaWAN_functs.h, AU915), which
+ * getLoRaWANMaxPayload() & the linkManager use too.
+ *
+ * An airtimeBudget keeps the airtime used over a rolling window, e.g. The Things Network's fair use policy of 30 s per
+ * day per device, or a regulatory 1% duty cycle as 36 s per hour. The window is kept in AIRTIME_SLOTS slots, so the
+ * airtime of an uplink rolls out of the window a slot at a time, up to one slot late. Part of the budget can be held in
+ * reserve for the uplinks that matter most, e.g. confirmed checkpoints & alarms, see allowedAtMillis().
+ *
+ * Only uses stdint.h & the stack's regional parameters (which the native environment has a stand-in for), so it can be
+ * run on the host, e.g. to plan the sample rates of a fleet (see the Airtime_planner example).
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+#define LORA_PREAMBLE_SYMBOLS    8  /**< LoRaWAN preamble length. */
+#define LORA_CODING_RATE_4_5     1  /**< Coding rate 4/5, the one LoRaWAN uses. 4 is 4/8. */
+#define LORAWAN_OVERHEAD_LENGTH  13 /**< MHDR + FHDR (no FOpts) + FPort + MIC sent with every application payload. */
+
+#ifndef AIRTIME_BUDGET_MS
+#define AIRTIME_BUDGET_MS 30000 /**< Airtime allowed per window, e.g. 30 s a day for TTN's fair use policy. */
+#endif
+
+#ifndef AIRTIME_WINDOW_MS
+#define AIRTIME_WINDOW_MS (24UL * 60 * 60 * 1000) /**< Length of the rolling window, e.g. a day. */
+#endif
+
+#ifndef AIRTIME_RESERVE_PERCENT
+#define AIRTIME_RESERVE_PERCENT 10 /**< Share of the budget only uplinks allowed the reserve can use. */
+#endif
+
+#ifndef AIRTIME_LOW_PERCENT
+#define AIRTIME_LOW_PERCENT 25 /**< The budget is low once less than this share of it is left. */
+#endif
+
+#define AIRTIME_RECOVERED_PERCENT (AIRTIME_LOW_PERCENT + 10) /**< No longer low once this share is left again. */
+#define AIRTIME_EXHAUSTED_PERCENT 5 /**< Exhausted once less than this share is left on top of the reserve. */
+
+#define AIRTIME_SLOTS 24         /**< Slots the window is kept in, e.g. an hour each for a day. */
+#define AIRTIME_NEVER UINT64_MAX /**< Returned by allowedAtMillis() for an uplink that never fits the budget. */
+
+/**
+ * @brief Settings of a datarate.
+ */
+struct loraDatarate {
+    uint8_t spreading_factor; /**< 7 - 12. */
+    uint16_t bandwidth_khz;   /**< 125, 250 or 500. */
+    uint8_t max_payload;      /**< Longest application payload. */
+};
+
+/**
+ * @brief How much of an airtimeBudget is left, see airtimeBudget::state().
+ */
+enum class AIRTIME_STATE : uint8_t {
+    OK,          /**< Plenty left. */
+    RUNNING_LOW, /**< Less than AIRTIME_LOW_PERCENT left, time to send less. */
+    EXHAUSTED,   /**< Little more than the reserve is left, so routine uplinks are about to be held back. */
+};
+
+/**
+ * @brief Counters for an airtimeBudget, see airtimeBudget::getStats().
+ */
+struct airtimeStats {
+    uint32_t uplinks;  /**< Uplinks whose airtime was spent. */
+    uint64_t total_us; /**< Airtime of all of them. */
+    uint32_t used_ms;  /**< Airtime used in the window. */
+    uint32_t left_ms;  /**< Airtime left in the window, incl. the reserve. */
+    uint32_t deferred; /**< Uplinks held back as they didn't fit the budget. */
+};
+
+/**
+ * @brief Time on air of a LoRa packet.
+ * @param spreading_factor Spreading factor, 7 - 12.
+ * @param bandwidth_khz Bandwidth, 125, 250 or 500 kHz.
+ * @param length Length of the PHY payload, i.e. the whole LoRaWAN frame.
+ * @param coding_rate Coding rate, 1 (4/5) - 4 (4/8).
+ * @param preamble_symbols Preamble length.
+ * @return Time on air in microseconds. Low datarate optimisation is on for symbols of 16 ms & over, as LoRaWAN has it.
+ */
+uint32_t loraAirtimeMicros(uint8_t spreading_factor, uint16_t bandwidth_khz, uint8_t length,
+                           uint8_t coding_rate = LORA_CODING_RATE_4_5,
+                           uint8_t preamble_symbols = LORA_PREAMBLE_SYMBOLS);
+
+/**
+ * @brief Settings of an uplink datarate of the region, from the LoRaWAN stack's regional parameters.
+ * @param datarate Datarate, e.g. DR_0 - DR_6 for AU915.
+ * @param settings Returns the spreading factor, bandwidth & max payload.
+ * @return False if the region doesn't define the datarate for uplinks (e.g. DR_7 is RFU in AU915).
+ */
+bool loraWANDatarate(uint8_t datarate, loraDatarate *settings);
+
+/**
+ * @brief Settings of the datarate a downlink in RX1 is sent at, from the LoRaWAN stack's regional parameters, e.g.
+ * DR_8 (SF12 at 500 kHz) for an uplink at DR_0 in AU915. With the default RX1 datarate offset of 0.
+ * @param uplink_datarate Datarate of the uplink the downlink answers, see loraWANDatarate().
+ * @param settings Returns the spreading factor, bandwidth & max payload of the downlink.
+ * @return False if the region doesn't define the uplink datarate.
+ */
+bool loraWANRx1Datarate(uint8_t uplink_datarate, loraDatarate *settings);
+
+/**
+ * @brief Slowest uplink datarate of the region.
+ * @return The datarate, e.g. DR_0 for AU915.
+ */
+uint8_t loraWANMinDatarate(void);
+
+/**
+ * @brief Fastest uplink datarate of the region. Every datarate from loraWANMinDatarate() up to it is defined.
+ * @return The datarate, e.g. DR_6 for AU915.
+ */
+uint8_t loraWANMaxDatarate(void);
+
+/**
+ * @brief Time on air of a LoRaWAN uplink.
+ * @param datarate Datarate, see loraWANDatarate().
+ * @param payload_length Length of the application payload. The LoRaWAN overhead is added, without any MAC commands.
+ * @return Time on air in microseconds, 0 if the region doesn't define the datarate.
+ */
+uint32_t loraWANAirtimeMicros(uint8_t datarate, uint8_t payload_length);
+
+class airtimeBudget {
+  public:
+    /**
+     * @brief A budget of airtime over a rolling window, with none used yet.
+     * @param budget_ms Airtime allowed per window, up to ~4000 s.
+     * @param window_ms Length of the window, at least AIRTIME_SLOTS ms.
+     * @param reserve_percent Share of the budget held in reserve, see allowedAtMillis().
+     */
+    airtimeBudget(uint32_t budget_ms = AIRTIME_BUDGET_MS, uint32_t window_ms = AIRTIME_WINDOW_MS,
+                  uint8_t reserve_percent = AIRTIME_RESERVE_PERCENT)
+        : budget_us(budget_ms * 1000), reserve_us((budget_ms / 100) * reserve_percent * 1000),
+          slot_ms(window_ms / AIRTIME_SLOTS){};
+
+    /**
+     * @brief When an uplink fits the budget: now, or once enough airtime has rolled out of the window.
+     * @param airtime_us Time on air of the uplink.
+     * @param use_reserve True if it may use the reserve too, e.g. a confirmed checkpoint or alarm.
+     * @param now_ms Uptime now.
+     * @return The uptime it fits at, now_ms if it fits now, or AIRTIME_NEVER if it's longer than the budget.
+     */
+    uint64_t allowedAtMillis(uint32_t airtime_us, bool use_reserve, uint64_t now_ms);
+
+    /**
+     * @brief Check if an uplink fits the budget now.
+     * @param airtime_us Time on air of the uplink.
+     * @param use_reserve True if it may use the reserve too.
+     * @param now_ms Uptime now.
+     * @return True if it fits.
+     */
+    bool allows(uint32_t airtime_us, bool use_reserve, uint64_t now_ms) {
+        return (allowedAtMillis(airtime_us, use_reserve, now_ms) <= now_ms);
+    };
+
+    /**
+     * @brief Spend the airtime of an uplink that was sent, fitting or not.
+     * @param airtime_us Time on air of the uplink.
+     * @param now_ms Uptime now.
+     */
+    void spend(uint32_t airtime_us, uint64_t now_ms);
+
+    /**
+     * @brief Count an uplink that was held back as it didn't fit, see getStats().
+     */
+    void deferred(void) { stats.deferred++; };
+
+    /**
+     * @brief How much of the budget is left. It's only back to OK once AIRTIME_RECOVERED_PERCENT is left, and back from
+     * EXHAUSTED to RUNNING_LOW once AIRTIME_LOW_PERCENT is, so it doesn't flip back & forth with each uplink.
+     * @param now_ms Uptime now.
+     * @return OK, RUNNING_LOW or EXHAUSTED.
+     */
+    AIRTIME_STATE state(uint64_t now_ms);
+
+    /**
+     * @brief Get the counters, with the airtime used & left in the window now.
+     * @param now_ms Uptime now.
+     * @return The counters.
+     */
+    airtimeStats getStats(uint64_t now_ms);
+
+  private:
+    /**
+     * @brief Move the window up to now, emptying the slots that have rolled out of it.
+     * @param now_ms Uptime now.
+     */
+    void roll(uint64_t now_ms);
+
+    /**
+     * @brief Airtime used in the window, after roll().
+     */
+    uint32_t usedMicros(void) const;
+
+    const uint32_t budget_us;
+    const uint32_t reserve_us;
+    const uint32_t slot_ms;
+    uint32_t slots_us[AIRTIME_SLOTS] = {};        /**< Airtime spent in each slot. */
+    uint8_t slot = 0;                             /**< The current slot, the oldest is the one after it. */
+    uint64_t slot_end_ms = 0;                     /**< Uptime the current slot ends at, 0 before the first roll(). */
+    AIRTIME_STATE last_state = AIRTIME_STATE::OK; /**< State at the last state(). */
+    airtimeStats stats = {};
+};
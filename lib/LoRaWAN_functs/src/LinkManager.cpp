@@ -0,0 +1,167 @@
+#include "LinkManager.h"
+
+// Demodulation floor of a datarate in dB, as the SNR of a 125 kHz signal: SF12's, and 2.5 dB higher for each step down
+// in spreading factor. A 500 kHz datarate needs 6 dB more, as it takes in 4x the noise.
+#define LINK_SF12_SNR_DB    -20
+#define LINK_SF_STEP_SNR_DB 2.5f
+#define LINK_500_KHZ_SNR_DB 6
+
+/**
+ * @brief Demodulation floor of a datarate.
+ * @param settings The datarate's spreading factor & bandwidth, see loraWANDatarate().
+ * @return The SNR it needs in dB.
+ */
+static float requiredSnrDb(const loraDatarate &settings) {
+    float snr_db = LINK_SF12_SNR_DB + LINK_SF_STEP_SNR_DB * (12 - settings.spreading_factor);
+    return snr_db + ((settings.bandwidth_khz == 500) ? LINK_500_KHZ_SNR_DB : 0);
+}
+
+void linkManager::begin(uint8_t datarate, uint8_t tx_power) {
+    if (datarate < min_datarate) {
+        datarate = min_datarate;
+    } else if (datarate > max_datarate) {
+        datarate = max_datarate;
+    }
+    if (tx_power > min_tx_power) {
+        tx_power = min_tx_power;
+    }
+    stats = {};
+    step_up_acks = LINK_STEP_UP_ACKS;
+    next_probe = 0;
+    n_probes = 0;
+    on_trial = false;
+    probe_now = true;
+    setLevel((datarate - min_datarate) + ((datarate == max_datarate) ? tx_power : 0));
+}
+
+void linkManager::joinResult(bool joined) {
+    if (joined) {
+        stats.joins++;
+        probe_now = true;
+        return;
+    }
+    // try again from the most robust level
+    stats.join_failures++;
+    on_trial = false;
+    setLevel(0);
+}
+
+void linkManager::uplinkSent(bool confirmed, uint64_t now_ms) {
+    if (!confirmed) {
+        return;
+    }
+    // each will be acked by a downlink, so count it against the day's
+    stats.probes++;
+    probe_ms[next_probe] = now_ms;
+    next_probe = (next_probe + 1) % LINK_MAX_PROBES_PER_DAY;
+    if (n_probes < LINK_MAX_PROBES_PER_DAY) {
+        n_probes++;
+    }
+    probe_now = false;
+}
+
+void linkManager::uplinkResult(bool delivered) {
+    if (delivered) {
+        stats.acked++;
+        losses = 0;
+        if (on_trial) {
+            // the step up held, so the next can be tried a little sooner
+            on_trial = false;
+            step_up_acks = (step_up_acks / 2 > LINK_STEP_UP_ACKS) ? (step_up_acks / 2) : LINK_STEP_UP_ACKS;
+        }
+        if (++acks >= step_up_acks) {
+            stepUp();
+        }
+        return;
+    }
+
+    stats.lost++;
+    acks = 0;
+    probe_now = true;
+    if (on_trial) {
+        // the level below was fine, go back and wait longer before trying again
+        stats.failed_trials++;
+        step_up_acks = (2 * step_up_acks < LINK_MAX_STEP_UP_ACKS) ? (2 * step_up_acks) : LINK_MAX_STEP_UP_ACKS;
+        stepDown();
+    } else if (++losses >= LINK_STEP_DOWN_LOSSES) {
+        stepDown();
+    }
+}
+
+void linkManager::downlinkReceived(int16_t rssi, int8_t snr) {
+    stats.downlinks++;
+    stats.last_rssi = rssi;
+    stats.last_snr = snr;
+    // the downlink is sent in RX1 at a datarate of its own, e.g. SF10 at 500 kHz for an uplink at DR_2 in AU915
+    loraDatarate settings;
+    if (!loraWANRx1Datarate(datarate(), &settings)) {
+        // not a datarate of the region, so there's no floor to judge the margin by
+        return;
+    }
+    float margin = snr - requiredSnrDb(settings);
+    if (margin < LINK_MARGIN_LOW_DB) {
+        stepDown();
+    } else if (on_trial) {
+        // the trial's probe decides
+    } else if (margin > LINK_MARGIN_HIGH_DB) {
+        // counted like an ack, so it takes a run of ample margins to step up
+        if (++acks >= step_up_acks) {
+            stepUp();
+        }
+    } else {
+        acks = 0;
+    }
+}
+
+bool linkManager::probeDue(uint64_t now_ms) const {
+    if (n_probes == 0) {
+        return true;
+    }
+    // the oldest of the last LINK_MAX_PROBES_PER_DAY must have left the day
+    if ((n_probes == LINK_MAX_PROBES_PER_DAY) && (now_ms < probe_ms[next_probe] + LINK_PROBE_WINDOW_MS)) {
+        return false;
+    }
+    uint64_t last_ms = probe_ms[(next_probe + LINK_MAX_PROBES_PER_DAY - 1) % LINK_MAX_PROBES_PER_DAY];
+    return (probe_now || (now_ms >= last_ms + LINK_PROBE_INTERVAL_MS));
+}
+
+uint8_t linkManager::datarate(void) const {
+    uint8_t n_datarates = max_datarate - min_datarate + 1;
+    return (level < n_datarates) ? (min_datarate + level) : max_datarate;
+}
+
+uint8_t linkManager::txPower(void) const {
+    uint8_t n_datarates = max_datarate - min_datarate + 1;
+    return (level < n_datarates) ? 0 : (level - (n_datarates - 1));
+}
+
+void linkManager::setLevel(uint8_t new_level) {
+    level = new_level;
+    acks = 0;
+    losses = 0;
+}
+
+void linkManager::stepUp(void) {
+    if ((level + 1) >= levels()) {
+        // already the cheapest level
+        acks = 0;
+        return;
+    }
+    setLevel(level + 1);
+    stats.steps_up++;
+    on_trial = true;
+    probe_now = true;
+}
+
+void linkManager::stepDown(void) {
+    on_trial = false;
+    probe_now = true;
+    if (level == 0) {
+        // already the most robust level
+        acks = 0;
+        losses = 0;
+        return;
+    }
+    setLevel(level - 1);
+    stats.steps_down++;
+}
@@ -0,0 +1,174 @@
+#pragma once
+/**
+ * @file LinkManager.h
+ * @author Kalina Knight
+ * @brief Link adaptation: picks the fastest datarate & lowest TX power that still gets the uplinks through.
+ *
+ * The settings are a ladder of levels, from the most robust (slowest datarate at max power) to the cheapest (fastest
+ * datarate at the lowest power): the datarate goes up first, as it saves both airtime and energy, then the power comes
+ * down. The manager moves one level at a time on the evidence it's given:
+ *
+ * - Confirmed uplinks (e.g. the probes of probeDue()): a run of acks steps up, two lost in a row step down.
+ * - Downlinks: their SNR above the demodulation floor of their RX1 datarate's spreading factor & bandwidth (the
+ *   margin) steps down straight away if it's thin. An ample margin counts as an ack, so a run of them steps up, and one
+ *   in between breaks the run.
+ * - Joins: a failed join drops back to the most robust level.
+ *
+ * Every ack is a downlink, and networks limit those: e.g. The Things Network's fair use policy allows 10 a day. So the
+ * probes are spaced in time (LINK_PROBE_INTERVAL_MS) rather than every few uplinks, and no more than
+ * LINK_MAX_PROBES_PER_DAY confirmed uplinks (probes or not) are counted over any 24 hours before probing stops.
+ *
+ * A step up is on trial until its first ack: if that probe is lost the manager steps straight back down and waits twice
+ * as long before trying again, so it doesn't flap around the edge of the link budget.
+ *
+ * Only uses stdint.h & Airtime.h (for the datarates of the region), so it can be run against a simulated link on the
+ * host.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+#include "Airtime.h" /**< Datarates of the region. */
+
+#ifndef LINK_PROBE_INTERVAL_MS
+#define LINK_PROBE_INTERVAL_MS 21600000 /**< Uptime between routine probes, 6 hours. See probeDue(). */
+#endif
+#ifndef LINK_MAX_PROBES_PER_DAY
+#define LINK_MAX_PROBES_PER_DAY 8 /**< Confirmed uplinks per 24 hours before probing stops, under TTN's 10 downlinks. */
+#endif
+#define LINK_PROBE_WINDOW_MS 86400000 /**< The day of LINK_MAX_PROBES_PER_DAY, rolling. */
+
+#define LINK_STEP_UP_ACKS        3  /**< Acks in a row needed to step up. */
+#define LINK_MAX_STEP_UP_ACKS    48 /**< Cap on the acks needed after failed trials. */
+#define LINK_STEP_DOWN_LOSSES    2  /**< Lost probes in a row that step down. */
+#define LINK_MARGIN_LOW_DB       5  /**< Downlink margin below which to step down. */
+#define LINK_MARGIN_HIGH_DB      15 /**< Downlink margin above which it counts as an ack towards a step up. */
+
+/**
+ * @brief Counters for a linkManager, see linkManager::getStats().
+ */
+struct linkManagerStats {
+    uint32_t probes;        /**< Uplinks sent confirmed, e.g. as probes. */
+    uint32_t acked;         /**< Confirmed uplinks acked. */
+    uint32_t lost;          /**< Confirmed uplinks not acked. */
+    uint32_t downlinks;     /**< Downlinks whose margin was checked. */
+    uint32_t steps_up;      /**< Steps to a faster datarate or lower power. */
+    uint32_t steps_down;    /**< Steps to a slower datarate or higher power. */
+    uint32_t failed_trials; /**< Steps up taken back as their first probe was lost. */
+    uint32_t joins;         /**< Joins that succeeded. */
+    uint32_t join_failures; /**< Joins that failed, each drops back to the most robust level. */
+    int16_t last_rssi;      /**< RSSI of the last downlink in dBm. */
+    int8_t last_snr;        /**< SNR of the last downlink in dB. */
+};
+
+class linkManager {
+  public:
+    /**
+     * @brief A link manager over a range of datarates & TX powers. Starts at the most robust level until begin().
+     * @param min_datarate Slowest (most robust) datarate e.g. loraWANMinDatarate().
+     * @param max_datarate Fastest datarate e.g. loraWANMaxDatarate(). Every datarate in between must be defined by the
+     * region, see loraWANDatarate().
+     * @param min_tx_power Lowest TX power setting, i.e. the highest TX_POWER_X e.g. TX_POWER_10. TX_POWER_0 is the max.
+     */
+    linkManager(uint8_t min_datarate, uint8_t max_datarate, uint8_t min_tx_power)
+        : min_datarate(min_datarate), max_datarate(max_datarate), min_tx_power(min_tx_power){};
+
+    /**
+     * @brief Start from the level nearest the given settings, e.g. those passed to initLoRaWAN(). The TX power is only
+     * lowered at the max datarate, so below it the level is at max power. The first uplink is a probe.
+     * @param datarate Datarate, clamped to the manager's range.
+     * @param tx_power TX power setting, clamped to the manager's range.
+     */
+    void begin(uint8_t datarate, uint8_t tx_power);
+
+    /**
+     * @brief Tell the manager how a join went.
+     * @param joined True if joined, false if the join failed.
+     */
+    void joinResult(bool joined);
+
+    /**
+     * @brief Tell the manager an uplink was sent, so it knows when the next probe is due.
+     * @param confirmed True if it was sent confirmed, whether as a probe or not.
+     * @param now_ms Uptime now.
+     */
+    void uplinkSent(bool confirmed, uint64_t now_ms);
+
+    /**
+     * @brief Tell the manager whether a confirmed uplink was acked.
+     * @param delivered True if acked.
+     */
+    void uplinkResult(bool delivered);
+
+    /**
+     * @brief Tell the manager the quality of a received downlink, sent in RX1 of an uplink at datarate().
+     * @param rssi RSSI in dBm.
+     * @param snr SNR in dB.
+     */
+    void downlinkReceived(int16_t rssi, int8_t snr);
+
+    /**
+     * @brief Check if the next uplink should be sent confirmed, to find out if it gets through: LINK_PROBE_INTERVAL_MS
+     * after the last confirmed uplink, and straight after a step up or a lost probe. Never while
+     * LINK_MAX_PROBES_PER_DAY confirmed uplinks have been sent in the last 24 hours.
+     * @param now_ms Uptime now.
+     * @return True if a probe is due.
+     */
+    bool probeDue(uint64_t now_ms) const;
+
+    /**
+     * @brief The datarate to send the next uplink at.
+     */
+    uint8_t datarate(void) const;
+
+    /**
+     * @brief The TX power setting to send the next uplink at.
+     */
+    uint8_t txPower(void) const;
+
+    /**
+     * @brief Get the counters.
+     * @return The counters.
+     */
+    linkManagerStats getStats(void) const { return stats; };
+
+  private:
+    /**
+     * @brief Move to a level and start counting the evidence for it afresh.
+     * @param new_level The level, 0 is the most robust.
+     */
+    void setLevel(uint8_t new_level);
+
+    /**
+     * @brief Number of levels: each datarate at max power, then each lower power at the max datarate.
+     */
+    uint8_t levels(void) const { return (max_datarate - min_datarate + 1) + min_tx_power; };
+
+    /**
+     * @brief Move one level up, to a faster datarate or lower power, on trial until its first ack.
+     */
+    void stepUp(void);
+
+    /**
+     * @brief Move one level down, to a higher power or slower datarate.
+     */
+    void stepDown(void);
+
+    const uint8_t min_datarate;
+    const uint8_t max_datarate;
+    const uint8_t min_tx_power;
+    uint8_t level = 0;                               /**< Current level, 0 is the most robust. */
+    uint8_t acks = 0;                                /**< Acks in a row at this level. */
+    uint8_t losses = 0;                              /**< Lost probes in a row at this level. */
+    uint8_t step_up_acks = LINK_STEP_UP_ACKS;        /**< Acks in a row needed to step up, doubled by failed trials. */
+    uint64_t probe_ms[LINK_MAX_PROBES_PER_DAY] = {}; /**< Uptimes of the last confirmed uplinks. */
+    uint8_t next_probe = 0;                          /**< Slot of probe_ms for the next, the oldest once full. */
+    uint8_t n_probes = 0;                            /**< Slots of probe_ms used, up to LINK_MAX_PROBES_PER_DAY. */
+    bool on_trial = false;                           /**< Stepped up, and no ack yet at this level. */
+    bool probe_now = false;                          /**< Probe the next uplink, e.g. straight after a step up. */
+    linkManagerStats stats = {};
+};
@@ -1,8 +1,46 @@
+#define LOG_MODULE_ID LOG_MODULE::LORAWAN // see setLogLevel() in Logging.h
+
 #include "LoRaWAN_functs.h"
 
+#include "PayloadFragments.h"
+#include "SpanProfiler.h"
+
 // pointer set by initLoRaWAN() to be used by lorawanJoinedHandler() to start timer that sends payloads
 SoftwareTimer *timer_to_start_on_join = nullptr;
 
+// function set by setLoRaWANSendDoneCallback() to be told when each frame is finished with
+static void (*send_done_callback)(bool delivered) = nullptr;
+
+// token of the last AppTimeReq, so a late answer to an older request is ignored
+static uint8_t clock_sync_token = 0;
+
+// the frame being sent in fragments by sendLoRaWANFrame() & sendNextLoRaWANFragment()
+static uint8_t fragment_frame[PAYLOAD_BUFFER_SIZE];
+static uint8_t fragment_frame_len = 0;
+static uint8_t fragment_frame_port = 0;
+static uint8_t fragment_frame_id = 0;
+static uint8_t fragment_max_len = 0;
+static uint8_t n_fragments = 0;
+static uint8_t next_fragment = 0;
+static lmh_confirm fragment_confirm = LMH_UNCONFIRMED_MSG;
+
+// the last uplink, set by sendLoRaWANUplink() & the handlers
+static volatile bool uplink_in_flight = false; // sent & not done with yet
+static volatile bool uplink_delivered = false; // sent (unconfirmed) or acked (confirmed), once done with
+
+// frames queued by queueLoRaWANFrame(), see sendQueuedLoRaWANFrame()
+static txQueue tx_queue;
+static uint8_t queued_frame[PAYLOAD_BUFFER_SIZE];
+static bool queued_frame_in_flight = false; // the last uplink was (a fragment of) a queued frame
+
+// link adaptation, see setLoRaWANLinkAdaptation()
+// over every uplink datarate of the region, e.g. DR_0 - DR_6 for AU915
+static linkManager link_manager(loraWANMinDatarate(), loraWANMaxDatarate(), TX_POWER_10);
+static bool link_adaptation = false;
+
+// airtime of the uplinks over the rolling window, see getLoRaWANAirtimeState()
+static airtimeBudget airtime_budget;
+
 // LoRaWan parameters & callbacks used in initLoRaWAN()
 lmh_param_t lora_init_params;
 lmh_callback_t lora_init_callbacks;
@@ -11,14 +49,31 @@ lmh_callback_t lora_init_callbacks;
 static void lorawanJoinedHandler(void);
 static void lorawanJoinedFailedHandler(void);
 static void lorawanRXHandler(lmh_app_data_t *app_data);
+static void lorawanUnconfirmedFinishedHandler(void);
+static void lorawanConfirmedResultHandler(bool result);
+static void lorawanClockSyncHandler(const lmh_app_data_t *app_data);
+static bool sendLoRaWANFrameAs(lmh_app_data_t *lora_app_data, lmh_confirm confirm, bool use_reserve);
+static bool sendLoRaWANUplink(lmh_app_data_t *lora_app_data, lmh_confirm confirm, bool may_probe);
+static bool sendFirstLoRaWANFragment(const lmh_app_data_t *lora_app_data, uint8_t max_len, lmh_confirm confirm);
+static bool sendLoRaWANFragment(void);
+static void applyLinkSettings(void);
+static uint32_t frameAirtimeMicros(uint8_t len);
+
+// the datarate table in Airtime.cpp is from the stack's AU915 regional parameters
+static_assert(loraRegion == LORAMAC_REGION_AU915, "Airtime.cpp must look the datarates up for loraRegion.");
 
 bool initLoRaWAN(uint8_t *appEUI, uint8_t *deviceEUI, uint8_t *appKey, uint8_t tx_power, uint8_t datarate) {
-    log(LOG_LEVEL::DEBUG, "Initialising LoRaWAN...");
+    LOG(LOG_LEVEL::DEBUG, "Initialising LoRaWAN...");
+    loraDatarate settings;
+    if (!loraWANDatarate(datarate, &settings)) {
+        LOG(LOG_LEVEL::ERROR, "DR%u isn't an uplink datarate of the region.", datarate);
+        return false;
+    }
 
     // Initialize LoRa chip.
     uint32_t ret = lora_rak4630_init(); // function return code
     if (ret != 0) {
-        log(LOG_LEVEL::ERROR, "lora_rak4630_init failed with return code: %d.", ret);
+        LOG(LOG_LEVEL::ERROR, "lora_rak4630_init failed with return code: %d.", ret);
         return false;
     }
 
@@ -40,13 +95,17 @@ bool initLoRaWAN(uint8_t *appEUI, uint8_t *deviceEUI, uint8_t *appKey, uint8_t t
     lora_init_callbacks.lmh_RxData = lorawanRXHandler;
     lora_init_callbacks.lmh_has_joined = lorawanJoinedHandler;
     lora_init_callbacks.lmh_has_joined_failed = lorawanJoinedFailedHandler;
+    lora_init_callbacks.lmh_unconf_finished = lorawanUnconfirmedFinishedHandler;
+    lora_init_callbacks.lmh_conf_result = lorawanConfirmedResultHandler;
 
     // Initialize LoRaWan
     ret = lmh_init(&lora_init_callbacks, lora_init_params, true, loraClass, loraRegion);
     if (ret != 0) {
-        log(LOG_LEVEL::ERROR, "lmh_init failed with return code: %d.", ret);
+        LOG(LOG_LEVEL::ERROR, "lmh_init failed with return code: %d.", ret);
         return false;
     }
+    // so devices that fail together don't retry together
+    tx_queue.seed(BoardGetRandomSeed());
 
     return true;
 }
@@ -62,21 +121,325 @@ bool initLoRaWAN(SoftwareTimer *timer, uint8_t *appEUI, uint8_t *deviceEUI, uint
 uint32_t count = 0;
 uint32_t count_fail = 0;
 
-void sendLoRaWANFrame(lmh_app_data_t *lora_app_data) {
+bool sendLoRaWANFrame(lmh_app_data_t *lora_app_data) {
+    return sendLoRaWANFrameAs(lora_app_data, loraConfirm, false);
+}
+
+/**
+ * @brief Sends a frame, in fragments if it's too long for the datarate, if it fits the airtime budget.
+ * @param lora_app_data Data to be sent.
+ * @param confirm Whether to send it (& each of its fragments) confirmed.
+ * @param use_reserve Whether it may use the reserve of the airtime budget.
+ * @return True if the frame (or its first fragment) was handed to the LoRaWAN stack, false if not.
+ */
+bool sendLoRaWANFrameAs(lmh_app_data_t *lora_app_data, lmh_confirm confirm, bool use_reserve) {
     if (!isLoRaWANConnected()) {
-        log(LOG_LEVEL::ERROR, "Device has not joined the network. Try again later.");
-        return;
+        LOG(LOG_LEVEL::ERROR, "Device has not joined the network. Try again later.");
+        return false;
     }
+    if (hasLoRaWANFragmentsLeft()) {
+        if (uplink_in_flight) {
+            LOG(LOG_LEVEL::WARN, "Still sending the fragments of the last frame. Try again later.");
+            return false;
+        }
+        LOG(LOG_LEVEL::WARN, "Dropped the last %u fragments of the last frame.", n_fragments - next_fragment);
+        next_fragment = n_fragments;
+    }
+
+    if (link_adaptation) {
+        // only between frames, so each fragment of a frame is sent at the same datarate
+        applyLinkSettings();
+    }
+    // the whole frame, so its fragments aren't cut off part way
+    if (!airtime_budget.allows(frameAirtimeMicros(lora_app_data->buffsize), use_reserve, uptimeMillis())) {
+        airtime_budget.deferred();
+        LOG(LOG_LEVEL::WARN, "Airtime budget used up, the frame on port %u wasn't sent. Try again later.",
+            lora_app_data->port);
+        return false;
+    }
+    uint8_t max_len = getLoRaWANMaxPayload();
+    if (lora_app_data->buffsize > max_len) {
+        return sendFirstLoRaWANFragment(lora_app_data, max_len, confirm);
+    }
+    return sendLoRaWANUplink(lora_app_data, confirm, true);
+}
+
+bool sendNextLoRaWANFragment(void) {
+    if (!hasLoRaWANFragmentsLeft()) {
+        return false;
+    }
+    return sendLoRaWANFragment();
+}
+
+bool hasLoRaWANFragmentsLeft(void) {
+    return (next_fragment < n_fragments);
+}
+
+bool queueLoRaWANFrame(const lmh_app_data_t *lora_app_data, TX_PRIORITY priority, bool supersede) {
+    if (!tx_queue.push(lora_app_data->port, lora_app_data->buffer, lora_app_data->buffsize, priority, supersede,
+                       uptimeMillis())) {
+        LOG(LOG_LEVEL::WARN, "Transmit queue is full, the frame on port %u was dropped.", lora_app_data->port);
+        return false;
+    }
+    return true;
+}
 
-    log(LOG_LEVEL::DEBUG, "Sending payload frame now...");
-    lmh_error_status ret = lmh_send(lora_app_data, loraConfirm);
+bool sendQueuedLoRaWANFrame(void) {
+    if (uplink_in_flight) {
+        // the send done callback is called once it's done with
+        return false;
+    }
+    uint64_t now_ms = uptimeMillis();
+    if (queued_frame_in_flight) {
+        if (uplink_delivered && hasLoRaWANFragmentsLeft()) {
+            if (sendNextLoRaWANFragment()) {
+                return true;
+            }
+            // the rest of the fragments were dropped, so the frame is sent again whole
+            uplink_delivered = false;
+        }
+        queued_frame_in_flight = false;
+        tx_queue.done(uplink_delivered, now_ms);
+    }
+    if (!isLoRaWANConnected()) {
+        return false;
+    }
+
+    // a frame that doesn't fit the airtime budget waits until it does, so others may go first, or is dropped if it
+    // never will
+    const txFrame *frame = nullptr;
+    while ((frame = tx_queue.peek(now_ms)) != nullptr) {
+        uint32_t airtime_us = frameAirtimeMicros(frame->len);
+        uint64_t allowed_ms = airtime_budget.allowedAtMillis(airtime_us, frame->confirmed(), now_ms);
+        if (allowed_ms <= now_ms) {
+            break;
+        }
+        if (allowed_ms == AIRTIME_NEVER) {
+            // longer than the budget allows it, so it would wait forever & hold up the frames behind it
+            LOG(LOG_LEVEL::WARN, "The frame on port %u needs more airtime than the budget holds, dropped it.",
+                frame->port);
+            tx_queue.drop(frame);
+            continue;
+        }
+        airtime_budget.deferred();
+        LOG(LOG_LEVEL::INFO, "Airtime budget used up, deferred the frame on port %u by %lu s.", frame->port,
+            (unsigned long)((allowed_ms - now_ms) / 1000));
+        tx_queue.defer(frame, allowed_ms);
+    }
+    frame = tx_queue.next(now_ms);
+    if (frame == nullptr) {
+        return false;
+    }
+    if (frame->attempts > 1) {
+        LOG(LOG_LEVEL::INFO, "Retrying the frame on port %u, attempt %u.", frame->port, frame->attempts);
+    }
+    // copied, as the queue moves its frames around
+    memcpy(queued_frame, frame->buffer, frame->len);
+    lmh_app_data_t frame_data = { queued_frame, frame->len, frame->port, 0, 0 };
+    lmh_confirm confirm = frame->confirmed() ? LMH_CONFIRMED_MSG : LMH_UNCONFIRMED_MSG;
+    if (!sendLoRaWANFrameAs(&frame_data, confirm, frame->confirmed())) {
+        tx_queue.done(false, now_ms);
+        return false;
+    }
+    queued_frame_in_flight = true;
+    return true;
+}
+
+uint64_t getLoRaWANTxQueueNextSend(void) {
+    return tx_queue.nextSendMillis();
+}
+
+txQueueStats getLoRaWANTxQueueStats(void) {
+    return tx_queue.getStats();
+}
+
+/**
+ * @brief Hands an uplink to the LoRaWAN stack.
+ * @param lora_app_data Data to be sent, no longer than the max payload of the datarate.
+ * @param confirm Whether to send it confirmed.
+ * @param may_probe Whether an unconfirmed uplink is sent confirmed if a link probe is due: only the first uplink of a
+ * frame, as a lost ack on a later fragment would drop the rest of the frame.
+ * @return True if successful, false if not.
+ */
+bool sendLoRaWANUplink(lmh_app_data_t *lora_app_data, lmh_confirm confirm, bool may_probe) {
+    LOG(LOG_LEVEL::DEBUG, "Sending payload frame now...");
+    if (link_adaptation && may_probe && link_manager.probeDue(uptimeMillis())) {
+        // confirmed, to find out if it gets through
+        confirm = LMH_CONFIRMED_MSG;
+    }
+    uplink_in_flight = true;
+    SPAN_BEGIN(SPAN::LORAWAN_SEND);
+    lmh_error_status ret = lmh_send(lora_app_data, confirm);
+    SPAN_END(SPAN::LORAWAN_SEND);
     if (ret == LMH_SUCCESS) {
+        // until its send done handler
+        SPAN_BEGIN(SPAN::RX_WINDOWS);
+        airtime_budget.spend(loraWANAirtimeMicros(getLoRaWANDatarate(), lora_app_data->buffsize), uptimeMillis());
+        if (link_adaptation) {
+            link_manager.uplinkSent(confirm == LMH_CONFIRMED_MSG, uptimeMillis());
+        }
         count++;
-        log(LOG_LEVEL::DEBUG, "lmh_send ok count %d.", count);
-    } else {
-        count_fail++;
-        log(LOG_LEVEL::ERROR, "lmh_send fail count %d.", count_fail);
+        LOG(LOG_LEVEL::DEBUG, "lmh_send ok count %d.", count);
+        return true;
+    }
+    uplink_in_flight = false;
+    count_fail++;
+    LOG(LOG_LEVEL::ERROR, "lmh_send fail count %d.", count_fail);
+    return false;
+}
+
+/**
+ * @brief Splits a frame that's too long for the datarate into fragments, and sends the first.
+ * @param lora_app_data The frame.
+ * @param max_len Max payload of the datarate, the length of each fragment.
+ * @param confirm Whether to send each fragment confirmed.
+ * @return True if the first fragment was handed to the LoRaWAN stack, false if not.
+ */
+bool sendFirstLoRaWANFragment(const lmh_app_data_t *lora_app_data, uint8_t max_len, lmh_confirm confirm) {
+    uint8_t n = fragmentCount(lora_app_data->buffsize, max_len);
+    if (n == 0) {
+        LOG(LOG_LEVEL::ERROR, "Frame of %u bytes is too long to send at DR%u, even in fragments.",
+            lora_app_data->buffsize, getLoRaWANDatarate());
+        return false;
+    }
+    memcpy(fragment_frame, lora_app_data->buffer, lora_app_data->buffsize);
+    fragment_frame_len = lora_app_data->buffsize;
+    fragment_frame_port = lora_app_data->port;
+    fragment_frame_id = (fragment_frame_id + 1) & 0x0F;
+    fragment_max_len = max_len;
+    fragment_confirm = confirm;
+    n_fragments = n;
+    next_fragment = 0;
+    LOG(LOG_LEVEL::DEBUG, "Frame of %u bytes is too long for DR%u, sending it in %u fragments.", fragment_frame_len,
+        getLoRaWANDatarate(), n_fragments);
+    return sendLoRaWANFragment();
+}
+
+/**
+ * @brief Sends the next fragment of the frame being sent in fragments. Drops the rest of them if it fails.
+ * @return True if the fragment was handed to the LoRaWAN stack, false if not.
+ */
+bool sendLoRaWANFragment(void) {
+    static uint8_t fragment[PAYLOAD_BUFFER_SIZE];
+    uint8_t len = encodeFragment(fragment_frame, fragment_frame_len, fragment_frame_port, fragment_frame_id,
+                                 next_fragment, fragment_max_len, fragment);
+    lmh_app_data_t fragment_data = { fragment, len, FRAGMENT_PORT, 0, 0 };
+    LOG(LOG_LEVEL::DEBUG, "Sending fragment %u of %u.", next_fragment + 1, n_fragments);
+    if (!isLoRaWANConnected() || !sendLoRaWANUplink(&fragment_data, fragment_confirm, next_fragment == 0)) {
+        LOG(LOG_LEVEL::WARN, "Dropped the rest of the frame's fragments.");
+        next_fragment = n_fragments;
+        return false;
+    }
+    next_fragment++;
+    return true;
+}
+
+bool requestLoRaWANClockSync(void) {
+    // the device's time in GPS seconds, which wraps around like GPS time does if the clock isn't set yet
+    uint32_t device_time = wallClockNow() - LORAWAN_GPS_UNIX_OFFSET_S + LORAWAN_GPS_LEAP_SECONDS;
+    clock_sync_token = (clock_sync_token + 1) & 0x0F;
+    static uint8_t request[6];
+    request[0] = LORAWAN_APP_TIME_CID;
+    for (uint8_t i = 0; i < 4; i++) {
+        request[1 + i] = (uint8_t)(device_time >> (8 * i)); // little endian
     }
+    request[5] = (uint8_t)((1 << 4) | clock_sync_token); // AnsRequired | TokenReq
+    lmh_app_data_t request_frame = { request, sizeof(request), LORAWAN_CLOCK_SYNC_PORT, 0, 0 };
+    LOG(LOG_LEVEL::DEBUG, "Requesting the time.");
+    // from the reserve of the airtime budget, as the timestamps of the samples depend on it
+    return sendLoRaWANFrameAs(&request_frame, loraConfirm, true);
+}
+
+void setLoRaWANSendDoneCallback(void (*callback)(bool delivered)) {
+    send_done_callback = callback;
+}
+
+bool setLoRaWANDatarate(uint8_t datarate) {
+    loraDatarate settings;
+    if (!loraWANDatarate(datarate, &settings)) {
+        LOG(LOG_LEVEL::ERROR, "DR%u isn't an uplink datarate of the region, staying at DR%u.", datarate,
+            getLoRaWANDatarate());
+        return false;
+    }
+    lora_init_params.tx_data_rate = datarate;
+    lmh_datarate_set(datarate, false);
+    return true;
+}
+
+uint8_t getLoRaWANDatarate(void) {
+    return (uint8_t)lora_init_params.tx_data_rate;
+}
+
+void setLoRaWANTxPower(uint8_t tx_power) {
+    lora_init_params.tx_power = tx_power;
+    lmh_tx_power_set(tx_power);
+}
+
+uint8_t getLoRaWANTxPower(void) {
+    return (uint8_t)lora_init_params.tx_power;
+}
+
+void setLoRaWANLinkAdaptation(bool enable) {
+    if (enable && !link_adaptation) {
+        link_manager.begin(getLoRaWANDatarate(), getLoRaWANTxPower());
+    }
+    link_adaptation = enable;
+}
+
+linkManagerStats getLoRaWANLinkStats(void) {
+    return link_manager.getStats();
+}
+
+/**
+ * @brief Sets the datarate & TX power picked by the link manager, if they've changed.
+ */
+void applyLinkSettings(void) {
+    uint8_t datarate = link_manager.datarate();
+    uint8_t tx_power = link_manager.txPower();
+    if ((datarate == getLoRaWANDatarate()) && (tx_power == getLoRaWANTxPower())) {
+        return;
+    }
+    LOG(LOG_LEVEL::INFO, "Link adapted from DR%u TX_POWER_%u to DR%u TX_POWER_%u.", getLoRaWANDatarate(),
+        getLoRaWANTxPower(), datarate, tx_power);
+    setLoRaWANDatarate(datarate);
+    setLoRaWANTxPower(tx_power);
+}
+
+uint8_t getLoRaWANMaxPayload(void) {
+    loraDatarate settings;
+    if (!loraWANDatarate(getLoRaWANDatarate(), &settings)) {
+        return 0; // not reached, only defined datarates are set
+    }
+    return settings.max_payload;
+}
+
+uint32_t getLoRaWANAirtime(uint8_t len) {
+    return frameAirtimeMicros(len);
+}
+
+AIRTIME_STATE getLoRaWANAirtimeState(void) {
+    return airtime_budget.state(uptimeMillis());
+}
+
+airtimeStats getLoRaWANAirtimeStats(void) {
+    return airtime_budget.getStats(uptimeMillis());
+}
+
+/**
+ * @brief Time on air of a frame at the current datarate: of each of its fragments if it's too long for the datarate.
+ * @param len Length of the frame.
+ * @return Time on air in microseconds.
+ */
+uint32_t frameAirtimeMicros(uint8_t len) {
+    uint8_t datarate = getLoRaWANDatarate();
+    uint8_t max_len = getLoRaWANMaxPayload();
+    uint8_t n = (len > max_len) ? fragmentCount(len, max_len) : 1;
+    if (n <= 1) {
+        return loraWANAirtimeMicros(datarate, len);
+    }
+    // every fragment is max_len long but the last, which has what's left of the frame & the fragment headers
+    uint16_t last_len = len + FIRST_FRAGMENT_HEADER_LENGTH + (n - 1) * FRAGMENT_HEADER_LENGTH - (n - 1) * max_len;
+    return (n - 1) * loraWANAirtimeMicros(datarate, max_len) + loraWANAirtimeMicros(datarate, (uint8_t)last_len);
 }
 
 /**
@@ -84,33 +447,105 @@ void sendLoRaWANFrame(lmh_app_data_t *lora_app_data) {
  * Sends LoRa class change and starts app timer to send the payload periodically.
  */
 void lorawanJoinedHandler(void) {
-    log(LOG_LEVEL::INFO, "Network Joined!");
+    LOG(LOG_LEVEL::INFO, "Network Joined!");
+    if (link_adaptation) {
+        link_manager.joinResult(true);
+    }
     if (setLoRaWANClass()) {
         // if given a SoftwareTimer in initLoRaWAN
         if (timer_to_start_on_join != NULL) {
             timer_to_start_on_join->start();
         }
     }
-    delay(1000); // This ensures the log message is printed
 }
 
 /**
  * @brief LoRa function for handling OTAA join failed.
  */
 void lorawanJoinedFailedHandler(void) {
-    log(LOG_LEVEL::ERROR, "OTAA join failed!");
-    log(LOG_LEVEL::ERROR, "Check your EUI's and Keys's!");
-    log(LOG_LEVEL::ERROR, "Check if a Gateway is in range!");
-    delay(1000); // This ensures the log messages are printed
+    LOG(LOG_LEVEL::ERROR, "OTAA join failed!");
+    LOG(LOG_LEVEL::ERROR, "Check your EUI's and Keys's!");
+    LOG(LOG_LEVEL::ERROR, "Check if a Gateway is in range!");
+    if (link_adaptation) {
+        // start again from the most robust settings
+        link_manager.joinResult(false);
+        applyLinkSettings();
+    }
 }
 
 /**
  * @brief Function for handling LoRaWan received data from Gateway.
- * As we're not expecting any RX the app_data is just logged for now.
+ * The RSSI & SNR of every downlink go to the link manager. Clock sync answers are applied to the wall clock, anything
+ * else is just logged for now.
  * @param app_data  Pointer to rx data
  */
 void lorawanRXHandler(lmh_app_data_t *app_data) {
-    log(LOG_LEVEL::INFO, "LoRa Packet received on port %d, size:%d, rssi:%d, snr:%d, data:%s\n", app_data->port,
+    if (link_adaptation) {
+        link_manager.downlinkReceived(app_data->rssi, app_data->snr);
+    }
+    if (app_data->port == LORAWAN_CLOCK_SYNC_PORT) {
+        lorawanClockSyncHandler(app_data);
+        return;
+    }
+    LOG(LOG_LEVEL::INFO, "LoRa Packet received on port %d, size:%d, rssi:%d, snr:%d, data:%s\n", app_data->port,
         app_data->buffsize, app_data->rssi, app_data->snr, app_data->buffer);
-    delay(1000); // This ensures the log message is printed
+}
+
+/**
+ * @brief LoRa function for handling the end of an unconfirmed frame, after its RX windows.
+ */
+void lorawanUnconfirmedFinishedHandler(void) {
+    SPAN_END(SPAN::RX_WINDOWS);
+    uplink_delivered = true;
+    uplink_in_flight = false;
+    if (send_done_callback != nullptr) {
+        send_done_callback(true);
+    }
+}
+
+/**
+ * @brief LoRa function for handling the result of a confirmed frame.
+ * @param result True if the frame was acked.
+ */
+void lorawanConfirmedResultHandler(bool result) {
+    SPAN_END(SPAN::RX_WINDOWS);
+    uplink_delivered = result;
+    uplink_in_flight = false;
+    if (link_adaptation) {
+        link_manager.uplinkResult(result);
+    }
+    if (!result) {
+        LOG(LOG_LEVEL::WARN, "Confirmed frame wasn't acked.");
+        // the frame is sent again whole, so the rest of its fragments are no use
+        next_fragment = n_fragments;
+    }
+    if (send_done_callback != nullptr) {
+        send_done_callback(result);
+    }
+}
+
+/**
+ * @brief Function for handling a clock sync downlink: applies the TimeCorrection of an AppTimeAns to the wall clock.
+ * The correction is the network's time when it received the AppTimeReq minus the time the device sent in it, so it
+ * still holds whenever the answer arrives.
+ * @param app_data Pointer to rx data
+ */
+void lorawanClockSyncHandler(const lmh_app_data_t *app_data) {
+    const uint8_t *answer = app_data->buffer;
+    if ((app_data->buffsize < 6) || (answer[0] != LORAWAN_APP_TIME_CID)) {
+        LOG(LOG_LEVEL::WARN, "Unknown clock sync downlink.");
+        return;
+    }
+    if ((answer[5] & 0x0F) != clock_sync_token) {
+        LOG(LOG_LEVEL::DEBUG, "Ignored the answer to an old time request.");
+        return;
+    }
+    int32_t correction = (int32_t)(answer[1] | (answer[2] << 8) | (answer[3] << 16) | ((uint32_t)answer[4] << 24));
+    bool was_set = wallClockIsSet();
+    adjustWallClock(correction);
+    if (was_set) {
+        LOG(LOG_LEVEL::INFO, "Wall clock corrected by %ld s.", (long)correction);
+    } else {
+        LOG(LOG_LEVEL::INFO, "Wall clock set to %lu.", (unsigned long)wallClockNow());
+    }
 }
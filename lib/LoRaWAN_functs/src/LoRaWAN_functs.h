@@ -6,15 +6,19 @@
  * The OTAA keys are defined locally (not remotely on GitHub) in a separate header file; see the README for further
  * explanantion.
  *
- * @version 0.2
- * @date 2022-01-26
+ * @version 0.8
+ * @date 2022-02-16
  *
  * @copyright (c) 2021 Kalina Knight - MIT License
  */
 
 #include <LoRaWan-RAK4630.h>
 
+#include "Airtime.h"
+#include "LinkManager.h"
 #include "Logging.h"
+#include "TxQueue.h"
+#include "WallClock.h"
 
 // LoRaWAN Config/Default Parameters - feel free to change these defaults to whatever suits the project
 static const DeviceClass_t loraClass = CLASS_A;                 /**< Class definition. */
@@ -23,14 +27,20 @@ static const lmh_confirm loraConfirm = LMH_UNCONFIRMED_MSG;     /**< Confirm/unc
 #define LORAWAN_JOIN_TRIALS 3                                   /**< Join request reattempts. */
 #define PAYLOAD_BUFFER_SIZE 64                                  /**< Data payload buffer size. */
 
+// Application Layer Clock Synchronization (LoRaWAN TS003), see requestLoRaWANClockSync()
+#define LORAWAN_CLOCK_SYNC_PORT    202        /**< FPort of the clock sync messages. */
+#define LORAWAN_APP_TIME_CID       0x01       /**< AppTimeReq/AppTimeAns command ID. */
+#define LORAWAN_GPS_UNIX_OFFSET_S  315964800  /**< GPS epoch (1980-01-06) in Unix time. */
+#define LORAWAN_GPS_LEAP_SECONDS   18         /**< Leap seconds GPS time is ahead of UTC, since 2017. */
+
 /**
  * @brief Initialise LoRaWAN.
  * @param appEUI    OTAA key app EUI.
  * @param deviceEUI OTAA key device EUI.
  * @param appKey    OTAA key app key.
  * @param tx_power  TX power setting. (Defaults to LORAWAN_DEFAULT_TX_POWER). TX_POWER_0 - TX_POWER_10 valid for AU915.
- * @param datarate  Datarate setting. (Defaults to LORAWAN_DEFAULT_DATARATE). DR_0 to DR_5 valid for AU915.
- * @return True if successful, false if not.
+ * @param datarate  Datarate setting. (Defaults to LORAWAN_DEFAULT_DATARATE). DR_0 to DR_6 valid for AU915.
+ * @return True if successful, false if not, e.g. the region doesn't define the datarate.
  */
 bool initLoRaWAN(uint8_t *appEUI, uint8_t *deviceEUI, uint8_t *appKey, uint8_t tx_power = LORAWAN_DEFAULT_TX_POWER,
                  uint8_t datarate = LORAWAN_DEFAULT_DATARATE);
@@ -42,8 +52,8 @@ bool initLoRaWAN(uint8_t *appEUI, uint8_t *deviceEUI, uint8_t *appKey, uint8_t t
  * @param deviceEUI OTAA key device EUI.
  * @param appKey    OTAA key app key.
  * @param tx_power  TX power setting. (Defaults to LORAWAN_DEFAULT_TX_POWER). TX_POWER_0 - TX_POWER_10 valid for AU915.
- * @param datarate  Datarate setting. (Defaults to LORAWAN_DEFAULT_DATARATE). DR_0 to DR_5 valid for AU915.
- * @return True if successful, false if not.
+ * @param datarate  Datarate setting. (Defaults to LORAWAN_DEFAULT_DATARATE). DR_0 to DR_6 valid for AU915.
+ * @return True if successful, false if not, e.g. the region doesn't define the datarate.
  */
 bool initLoRaWAN(SoftwareTimer *timer, uint8_t *appEUI, uint8_t *deviceEUI, uint8_t *appKey,
                  uint8_t tx_power = LORAWAN_DEFAULT_TX_POWER, uint8_t datarate = LORAWAN_DEFAULT_DATARATE);
@@ -58,9 +68,147 @@ inline void startLoRaWANJoinProcedure(void) {
 
 /**
  * @brief Sends a frame with the data provided.
+ * A frame longer than getLoRaWANMaxPayload() is split into fragments on FRAGMENT_PORT (see PayloadFragments.h): the
+ * first is sent now, and each of the rest by sendNextLoRaWANFragment() once the one before is done with.
  * @param lora_app_data Data to be sent.
+ * @return True if the frame (or its first fragment) was handed to the LoRaWAN stack, false if not joined, the stack is
+ * busy/failed, the frame is too long to send even in fragments, or it doesn't fit the airtime budget.
+ */
+bool sendLoRaWANFrame(lmh_app_data_t *lora_app_data);
+
+/**
+ * @brief Sends the next fragment of a frame that sendLoRaWANFrame() split into fragments. Call once the last fragment
+ * is done with (see setLoRaWANSendDoneCallback()). If it can't be sent the rest of the frame's fragments are dropped.
+ * @return True if a fragment was handed to the LoRaWAN stack, false if there are none left or it failed.
+ */
+bool sendNextLoRaWANFragment(void);
+
+/**
+ * @brief Gets whether the frame sent last still has fragments to send with sendNextLoRaWANFragment().
+ * The rest of the fragments are dropped if one isn't acked (confirmed frames), so the frame must be sent again whole.
+ * @return True if there are fragments left.
+ */
+bool hasLoRaWANFragmentsLeft(void);
+
+/**
+ * @brief Queues a frame to be sent by sendQueuedLoRaWANFrame(), see TxQueue.h. Routine frames are sent unconfirmed,
+ * checkpoints & alarms confirmed, and a frame that fails is retried after a jittered exponential backoff. Don't mix
+ * with sendLoRaWANFrame() while queued frames are waiting, as the two would take turns at the radio unannounced.
+ * @param lora_app_data The frame, copied into the queue.
+ * @param priority Priority of the frame, ALARM first & ROUTINE last. (Defaults to ROUTINE).
+ * @param supersede True if the frame replaces the queued frames on its port of the same or a lower priority, e.g. as
+ * it holds the latest state. (Defaults to false, so it's sent after them).
+ * @return True if queued, false if the queue is full of more important frames.
  */
-void sendLoRaWANFrame(lmh_app_data_t *lora_app_data);
+bool queueLoRaWANFrame(const lmh_app_data_t *lora_app_data, TX_PRIORITY priority = TX_PRIORITY::ROUTINE,
+                       bool supersede = false);
+
+/**
+ * @brief Sends the next queued frame that's due, or the next fragment of the one being sent. Finishes with the last
+ * queued frame first, so call it once each frame is done with (see setLoRaWANSendDoneCallback()) and at
+ * getLoRaWANTxQueueNextSend().
+ * @return True if a frame or fragment was handed to the LoRaWAN stack, false if not joined, the radio is busy or
+ * nothing is due. A frame that doesn't fit the airtime budget is deferred until it does.
+ */
+bool sendQueuedLoRaWANFrame(void);
+
+/**
+ * @brief Gets the uptime (see uptimeMillis()) the next queued frame can be sent at, once its backoff is over.
+ * @return The uptime in ms, TX_QUEUE_NEVER if the queue is empty or a frame is in flight.
+ */
+uint64_t getLoRaWANTxQueueNextSend(void);
+
+/**
+ * @brief Gets the counters of the transmit queue, e.g. to log them.
+ * @return The counters.
+ */
+txQueueStats getLoRaWANTxQueueStats(void);
+
+/**
+ * @brief Sets the datarate of the uplinks, ADR stays off.
+ * @param datarate DR_0 to DR_6 valid for AU915, see loraWANDatarate() in Airtime.h.
+ * @return False if the region doesn't define the datarate for uplinks, which is left as it was.
+ */
+bool setLoRaWANDatarate(uint8_t datarate);
+
+/**
+ * @brief Gets the datarate of the uplinks.
+ * @return The datarate, e.g. DR_3.
+ */
+uint8_t getLoRaWANDatarate(void);
+
+/**
+ * @brief Sets the TX power of the uplinks.
+ * @param tx_power TX_POWER_0 (max) - TX_POWER_10 valid for AU915.
+ */
+void setLoRaWANTxPower(uint8_t tx_power);
+
+/**
+ * @brief Gets the TX power setting of the uplinks.
+ * @return The TX power setting, e.g. TX_POWER_0.
+ */
+uint8_t getLoRaWANTxPower(void);
+
+/**
+ * @brief Turns link adaptation on or off. While on, a linkManager (LinkManager.h) picks the datarate & TX power of each
+ * frame from the acks, downlinks & joins, starting from the current settings, and an uplink every few hours (at most
+ * LINK_MAX_PROBES_PER_DAY a day) is sent confirmed as a probe. Only the first uplink of a frame is probed, never a
+ * later fragment. The send done callback is called with false for a probe that isn't acked. While off, the datarate &
+ * TX power stay as they're set.
+ * @param enable True to turn it on.
+ */
+void setLoRaWANLinkAdaptation(bool enable);
+
+/**
+ * @brief Gets the counters of the link adaptation, e.g. to log them.
+ * @return The counters, all 0 if link adaptation has never been on.
+ */
+linkManagerStats getLoRaWANLinkStats(void);
+
+/**
+ * @brief Gets the max payload of an uplink at the current datarate, e.g. 51 bytes at AU915 DR0.
+ * Fill frames up to this length to send them whole, sendLoRaWANFrame() splits longer frames into fragments.
+ * @return Max payload length in bytes.
+ */
+uint8_t getLoRaWANMaxPayload(void);
+
+/**
+ * @brief Gets the time on air of a frame at the current datarate, of all its fragments if it's too long for it.
+ * @param len Length of the frame.
+ * @return Time on air in microseconds.
+ */
+uint32_t getLoRaWANAirtime(uint8_t len);
+
+/**
+ * @brief Gets how much of the airtime budget (Airtime.h) is left, e.g. to send less often while it's running low.
+ * Frames that don't fit what's left aren't sent: sendLoRaWANFrame() returns false & queued frames are deferred until
+ * they fit. Routine frames can't use the reserve, which is kept for confirmed queued frames & clock sync requests.
+ * @return OK, RUNNING_LOW or EXHAUSTED (routine frames are about to be deferred).
+ */
+AIRTIME_STATE getLoRaWANAirtimeState(void);
+
+/**
+ * @brief Gets the counters of the airtime budget, with the airtime used & left in the rolling window, e.g. to log them.
+ * @return The counters.
+ */
+airtimeStats getLoRaWANAirtimeStats(void);
+
+/**
+ * @brief Ask the network for the time, to set or correct the wall clock (WallClock.h).
+ * Sends a TS003 AppTimeReq with the device's time on LORAWAN_CLOCK_SYNC_PORT. The network server's clock sync package
+ * answers with the correction in a downlink, which is applied when it arrives. The uplink is finished with like any
+ * other, see setLoRaWANSendDoneCallback().
+ * @return True if the request was handed to the LoRaWAN stack, false if not joined or the stack is busy/failed.
+ */
+bool requestLoRaWANClockSync(void);
+
+/**
+ * @brief Set a function to be called once each frame sent by sendLoRaWANFrame() is finished with, i.e. after its RX
+ * windows. Called for each fragment of a frame sent in fragments, see sendNextLoRaWANFragment().
+ * Called from the LoRaWAN event handler, so keep it short e.g. wake the loop task.
+ * @param callback Called with true if the frame was sent (unconfirmed) or acked (confirmed), false if it wasn't acked.
+ */
+void setLoRaWANSendDoneCallback(void (*callback)(bool delivered));
 
 /**
  * @brief Gets the status of the current LoRaWAN connection.
@@ -70,6 +218,14 @@ inline bool isLoRaWANConnected(void) {
     return (lmh_join_status_get() == LMH_SET);
 };
 
+/**
+ * @brief Gets whether the last attempt to join the network failed, so it can be tried again.
+ * @return True if the join failed, false if joined, joining or not tried yet.
+ */
+inline bool hasLoRaWANJoinFailed(void) {
+    return (lmh_join_status_get() == LMH_FAILED);
+};
+
 /**
  * @brief Sets the class to loraClass.
  * @return True if successful, false if not.
@@ -0,0 +1,172 @@
+#include "TxQueue.h"
+
+#include <string.h>
+
+/**
+ * @brief Max attempts at a frame of a priority.
+ * @param priority The priority.
+ * @return The max attempts.
+ */
+static uint8_t maxAttempts(TX_PRIORITY priority) {
+    return (priority == TX_PRIORITY::ROUTINE) ? TX_QUEUE_MAX_ATTEMPTS_ROUTINE : TX_QUEUE_MAX_ATTEMPTS_CONFIRMED;
+}
+
+bool txQueue::push(uint8_t port, const uint8_t *payload, uint8_t len, TX_PRIORITY priority, bool supersede,
+                   uint64_t now_ms) {
+    if (len > PAYLOAD_BUFFER_SIZE) {
+        return false;
+    }
+    if (supersede) {
+        for (uint8_t i = n_frames; i-- > 0;) {
+            txFrame &frame = frames[i];
+            if ((frame.port != port) || (frame.priority > priority) || frame.superseded) {
+                continue;
+            }
+            stats.superseded++;
+            if (frame.in_flight) {
+                // can't be taken back, but it won't be retried
+                frame.superseded = true;
+            } else {
+                remove(i);
+            }
+        }
+    }
+    if (n_frames == TX_QUEUE_LENGTH) {
+        // make room by dropping the oldest of the least important frames
+        uint8_t victim = TX_QUEUE_LENGTH;
+        for (uint8_t i = 0; i < n_frames; i++) {
+            if (frames[i].in_flight) {
+                continue;
+            }
+            if ((victim == TX_QUEUE_LENGTH) || (frames[i].priority < frames[victim].priority)) {
+                victim = i;
+            }
+        }
+        if ((victim == TX_QUEUE_LENGTH) || (frames[victim].priority > priority)) {
+            stats.rejected++;
+            return false;
+        }
+        stats.evicted++;
+        remove(victim);
+    }
+
+    txFrame &frame = frames[n_frames++];
+    memcpy(frame.buffer, payload, len);
+    frame.len = len;
+    frame.port = port;
+    frame.priority = priority;
+    frame.attempts = 0;
+    frame.in_flight = false;
+    frame.superseded = false;
+    frame.not_before_ms = now_ms;
+    stats.queued++;
+    return true;
+}
+
+const txFrame *txQueue::next(uint64_t now_ms) {
+    txFrame *best = const_cast<txFrame *>(peek(now_ms));
+    if (best != nullptr) {
+        best->in_flight = true;
+        best->attempts++;
+        stats.sent++;
+    }
+    return best;
+}
+
+const txFrame *txQueue::peek(uint64_t now_ms) const {
+    if (inFlight()) {
+        return nullptr;
+    }
+    const txFrame *best = nullptr;
+    for (uint8_t i = 0; i < n_frames; i++) {
+        // oldest first, so only a higher priority frame takes over
+        if ((frames[i].not_before_ms <= now_ms) && ((best == nullptr) || (frames[i].priority > best->priority))) {
+            best = &frames[i];
+        }
+    }
+    return best;
+}
+
+void txQueue::defer(const txFrame *frame, uint64_t until_ms) {
+    for (uint8_t i = 0; i < n_frames; i++) {
+        if ((&frames[i] == frame) && !frames[i].in_flight) {
+            frames[i].not_before_ms = until_ms;
+            return;
+        }
+    }
+}
+
+void txQueue::drop(const txFrame *frame) {
+    for (uint8_t i = 0; i < n_frames; i++) {
+        if ((&frames[i] == frame) && !frames[i].in_flight) {
+            stats.expired++;
+            remove(i);
+            return;
+        }
+    }
+}
+
+void txQueue::done(bool delivered, uint64_t now_ms) {
+    for (uint8_t i = 0; i < n_frames; i++) {
+        txFrame &frame = frames[i];
+        if (!frame.in_flight) {
+            continue;
+        }
+        frame.in_flight = false;
+        if (delivered) {
+            stats.delivered++;
+            remove(i);
+        } else if (frame.superseded) {
+            remove(i);
+        } else if (frame.attempts >= maxAttempts(frame.priority)) {
+            stats.expired++;
+            remove(i);
+        } else {
+            stats.retries++;
+            frame.not_before_ms = now_ms + backoffMillis(frame.attempts);
+        }
+        return;
+    }
+}
+
+uint64_t txQueue::nextSendMillis(void) const {
+    if (inFlight()) {
+        return TX_QUEUE_NEVER;
+    }
+    uint64_t next_ms = TX_QUEUE_NEVER;
+    for (uint8_t i = 0; i < n_frames; i++) {
+        if (frames[i].not_before_ms < next_ms) {
+            next_ms = frames[i].not_before_ms;
+        }
+    }
+    return next_ms;
+}
+
+bool txQueue::inFlight(void) const {
+    for (uint8_t i = 0; i < n_frames; i++) {
+        if (frames[i].in_flight) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void txQueue::remove(uint8_t index) {
+    n_frames--;
+    memmove(&frames[index], &frames[index + 1], (n_frames - index) * sizeof(txFrame));
+}
+
+uint32_t txQueue::backoffMillis(uint8_t attempts) {
+    uint32_t backoff_ms = TX_QUEUE_BACKOFF_MS;
+    for (uint8_t i = 1; (i < attempts) && (backoff_ms < TX_QUEUE_MAX_BACKOFF_MS); i++) {
+        backoff_ms *= 2;
+    }
+    if (backoff_ms > TX_QUEUE_MAX_BACKOFF_MS) {
+        backoff_ms = TX_QUEUE_MAX_BACKOFF_MS;
+    }
+    // xorshift32, plenty for spreading retries out
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (backoff_ms / 2) + (rng_state % (backoff_ms / 2 + 1));
+}
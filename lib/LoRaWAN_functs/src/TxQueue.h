@@ -0,0 +1,177 @@
+#pragma once
+/**
+ * @file TxQueue.h
+ * @author Kalina Knight
+ * @brief Bounded transmit queue: holds frames until they're sent (or acked), retrying failed ones with a jittered
+ * exponential backoff.
+ *
+ * Each frame has a priority and a delivery class: routine frames are sent unconfirmed, so they're only retried if they
+ * couldn't be sent (or were sent as a link probe and lost), while checkpoints & alarms are sent confirmed and retried
+ * until acked. The highest priority frame that's due goes first, oldest first within a priority. A frame can supersede
+ * the queued frames on its port, e.g. a newer reading of the same state, so stale frames aren't retried. When the
+ * queue is full the oldest frame of the lowest priority makes room, if it's no more important than the new frame.
+ * A frame can also be deferred, e.g. until it fits the airtime budget (Airtime.h).
+ *
+ * Only uses stdint.h & string.h, so it can be run on the host.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+#include "PortSchema.h"
+
+#define TX_QUEUE_LENGTH                 8          /**< Max frames queued. */
+#define TX_QUEUE_BACKOFF_MS             10000      /**< Backoff before the first retry, doubled for each retry after. */
+#define TX_QUEUE_MAX_BACKOFF_MS         1200000    /**< Cap on the backoff, 20 minutes. */
+#define TX_QUEUE_MAX_ATTEMPTS_ROUTINE   2          /**< Attempts at a routine frame before it's dropped. */
+#define TX_QUEUE_MAX_ATTEMPTS_CONFIRMED 8          /**< Attempts at a checkpoint or alarm before it's dropped. */
+#define TX_QUEUE_NEVER                  UINT64_MAX /**< Returned by nextSendMillis() if there's nothing to wait for. */
+
+/**
+ * @brief Priority of a queued frame, which also sets its delivery class.
+ */
+enum class TX_PRIORITY : uint8_t {
+    ROUTINE,    /**< Routine data, sent unconfirmed. */
+    CHECKPOINT, /**< Periodic checkpoint, sent confirmed. */
+    ALARM,      /**< Alarm, sent confirmed ahead of everything else. */
+};
+
+/**
+ * @brief A queued frame.
+ */
+struct txFrame {
+    uint8_t buffer[PAYLOAD_BUFFER_SIZE]; /**< The frame. */
+    uint8_t len;                         /**< Length of the frame. */
+    uint8_t port;                        /**< Port of the frame. */
+    TX_PRIORITY priority;                /**< Priority of the frame. */
+    uint8_t attempts;                    /**< Attempts made so far. */
+    bool in_flight;                      /**< Handed to the LoRaWAN stack & not done with yet. */
+    bool superseded;                     /**< A newer frame replaced it while in flight, so it isn't retried. */
+    uint64_t not_before_ms;              /**< Uptime it can next be sent at, after the backoff. */
+
+    /**
+     * @brief Whether the frame is sent confirmed.
+     */
+    bool confirmed(void) const { return (priority != TX_PRIORITY::ROUTINE); };
+};
+
+/**
+ * @brief Counters for a txQueue, see txQueue::getStats().
+ */
+struct txQueueStats {
+    uint32_t queued;     /**< Frames pushed. */
+    uint32_t superseded; /**< Frames replaced by a newer frame on their port. */
+    uint32_t sent;       /**< Attempts handed to the LoRaWAN stack. */
+    uint32_t delivered;  /**< Frames sent (unconfirmed) or acked (confirmed). */
+    uint32_t retries;    /**< Attempts that failed & were retried after a backoff. */
+    uint32_t expired;    /**< Frames dropped after their max attempts, or that could never be sent. */
+    uint32_t evicted;    /**< Frames dropped to make room for a more important frame. */
+    uint32_t rejected;   /**< Frames not pushed as the queue was full of more important frames. */
+};
+
+class txQueue {
+  public:
+    /**
+     * @brief Queue a frame.
+     * @param port Port of the frame.
+     * @param payload The frame.
+     * @param len Length of the frame, up to PAYLOAD_BUFFER_SIZE.
+     * @param priority Priority of the frame, which also sets whether it's sent confirmed.
+     * @param supersede True if the frame holds everything the queued frames on its port do (e.g. the latest state),
+     * so it replaces those of the same or a lower priority. False to queue it after them (e.g. different samples).
+     * @param now_ms Uptime now.
+     * @return True if queued, false if it's too long or the queue is full of more important frames.
+     */
+    bool push(uint8_t port, const uint8_t *payload, uint8_t len, TX_PRIORITY priority, bool supersede,
+              uint64_t now_ms);
+
+    /**
+     * @brief Take the next frame to send: the highest priority frame whose backoff is over, oldest first. It's marked
+     * in flight until done() is called.
+     * @param now_ms Uptime now.
+     * @return The frame, or nullptr if there isn't one due or a frame is already in flight.
+     */
+    const txFrame *next(uint64_t now_ms);
+
+    /**
+     * @brief Look at the frame next() would take, without taking it.
+     * @param now_ms Uptime now.
+     * @return The frame, or nullptr if there isn't one due or a frame is already in flight.
+     */
+    const txFrame *peek(uint64_t now_ms) const;
+
+    /**
+     * @brief Hold a queued frame back until later without counting an attempt, e.g. until it fits the airtime budget.
+     * Frames that are due carry on being sent in the meantime.
+     * @param frame The frame, from peek().
+     * @param until_ms Uptime it can be sent at.
+     */
+    void defer(const txFrame *frame, uint64_t until_ms);
+
+    /**
+     * @brief Drop a queued frame that can never be sent, e.g. one longer than the whole airtime budget, so the frames
+     * after it aren't held up. It's counted as expired.
+     * @param frame The frame, from peek().
+     */
+    void drop(const txFrame *frame);
+
+    /**
+     * @brief The frame in flight is done with. If it failed it's retried after a backoff, unless it has used its
+     * attempts or was superseded.
+     * @param delivered True if it was sent (unconfirmed) or acked (confirmed), false if it couldn't be sent or wasn't
+     * acked.
+     * @param now_ms Uptime now.
+     */
+    void done(bool delivered, uint64_t now_ms);
+
+    /**
+     * @brief Uptime the next frame can be sent at, e.g. to wake up for it.
+     * @return The uptime, TX_QUEUE_NEVER if the queue is empty or a frame is in flight.
+     */
+    uint64_t nextSendMillis(void) const;
+
+    /**
+     * @brief Seed the jitter of the backoff, so devices that fail together don't retry together.
+     * @param seed Any non-zero value, e.g. from the radio.
+     */
+    void seed(uint32_t seed) { rng_state = (seed != 0) ? seed : 1; };
+
+    /**
+     * @brief Number of frames queued, including one in flight.
+     */
+    uint8_t size(void) const { return n_frames; };
+
+    /**
+     * @brief Whether a frame is in flight.
+     */
+    bool inFlight(void) const;
+
+    /**
+     * @brief Get the counters.
+     * @return The counters.
+     */
+    txQueueStats getStats(void) const { return stats; };
+
+  private:
+    /**
+     * @brief Remove a frame, keeping the rest in order.
+     * @param index Index of the frame.
+     */
+    void remove(uint8_t index);
+
+    /**
+     * @brief Backoff before the next attempt at a frame: doubled for each attempt, and jittered over its upper half.
+     * @param attempts Attempts made so far.
+     * @return The backoff in ms.
+     */
+    uint32_t backoffMillis(uint8_t attempts);
+
+    txFrame frames[TX_QUEUE_LENGTH] = {}; /**< Queued frames, oldest first. */
+    uint8_t n_frames = 0;                 /**< Number of frames queued. */
+    uint32_t rng_state = 0x2545F491;      /**< xorshift32 state for the jitter. */
+    txQueueStats stats = {};
+};
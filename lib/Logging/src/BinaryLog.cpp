@@ -0,0 +1,32 @@
+#include "BinaryLog.h"
+
+logRecord::logRecord(LOG_LEVEL level, uint32_t id, uint8_t n_args, const uint8_t *arg_types, uint16_t args_length) {
+    uint8_t n_type_bytes = (n_args + 3) / 4;
+    uint16_t length = LOG_RECORD_HEADER_LENGTH + n_type_bytes + args_length;
+    // a record that's too long for its length byte asks for more than the buffer could ever have, so is dropped
+    is_valid = logBufferReserve((length <= LOG_RECORD_MAX_LENGTH) ? length : UINT16_MAX, &position);
+    if (!is_valid) {
+        return;
+    }
+
+    // header: sync, length, level | number of args << 4, ID, timestamp
+    uint8_t header[3] = { LOG_RECORD_SYNC, (uint8_t)length, (uint8_t)((uint8_t)level | (n_args << 4)) };
+    uint32_t timestamp = millis();
+    putBytes(header, sizeof(header));
+    putBytes(&id, sizeof(id));
+    putBytes(&timestamp, sizeof(timestamp));
+    putBytes(arg_types, n_type_bytes);
+}
+
+void logRecord::put(const char *value) {
+    uint8_t len = (uint8_t)(logArgLength(value) - 1);
+    putBytes(&len, sizeof(len));
+    putBytes(value, len);
+}
+
+void logRecord::putBytes(const void *bytes, uint16_t len) {
+    if (is_valid && (len > 0)) {
+        logBufferWrite(position, bytes, len);
+        position += len;
+    }
+}
@@ -0,0 +1,205 @@
+#pragma once
+/**
+ * @file BinaryLog.h
+ * @author Kalina Knight
+ * @brief Deferred binary logging.
+ * Instead of formatting the message on the device, a log call writes a small record into the log buffer:
+ * the ID of its format string (a hash computed at compile time), the timestamp and the raw arguments.
+ * The log drain task then writes the records to the sinks, and tools/log_decoder.py turns them back into text on the
+ * host using the format strings found in the source code.
+ * Enabled with APP_LOG_FORMAT = LOG_FORMAT_BINARY, see Logging.h.
+ *
+ * @version 0.1
+ * @date 2022-02-14
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include "LogBuffer.h"
+#include "Logging.h"
+
+#include <string.h>
+#include <type_traits>
+
+// Every record starts with this byte so the decoder can find the start of a record in the middle of a capture
+#define LOG_RECORD_SYNC 0xA5
+
+// sync + length + level/number of args + ID + timestamp
+#define LOG_RECORD_HEADER_LENGTH 11
+
+// The length is one byte so that is the max size of a record
+#define LOG_RECORD_MAX_LENGTH 255
+
+// Max number of arguments for one binary log, the number is stored in 4 bits.
+#define LOG_MAX_ARGS 15
+
+// String (%s) arguments longer than this are cut short
+#define LOG_MAX_STRING_ARG_LENGTH 64
+
+/**
+ * @brief How an argument is stored in a record. The type of each argument is stored in 2 bits after the header, so the
+ * decoder knows how many bytes to read. The format string tells it how to print them.
+ */
+enum class LOG_ARG_TYPE : uint8_t {
+    WORD = 0,   /**< 4 bytes: integers up to 32 bits, pointers & floats. */
+    DWORD = 1,  /**< 8 bytes: 64 bit integers & doubles. */
+    STRING = 2, /**< 1 length byte + that many chars, no null terminator. */
+};
+
+/**
+ * @brief ID of a format string: its 32 bit FNV-1a hash.
+ * Used at compile time by LOG() so only the ID, not the string, ends up in the firmware.
+ * tools/log_decoder.py calculates the same hash to match the ID back up to the format string.
+ * @param format Format string.
+ * @return ID of the format string.
+ */
+constexpr uint32_t logStringId(const char *format) {
+    uint32_t hash = 2166136261u;
+    while (*format != '\0') {
+        hash = (hash ^ (uint8_t)*format) * 16777619u;
+        format++;
+    }
+    return hash;
+}
+
+/**
+ * @brief Storage type of a log argument.
+ * @tparam T Argument type.
+ */
+template <typename T> constexpr LOG_ARG_TYPE logArgType(void) {
+    using arg_t = typename std::decay<T>::type;
+    if (std::is_same<arg_t, char *>::value || std::is_same<arg_t, const char *>::value) {
+        return LOG_ARG_TYPE::STRING;
+    }
+    static_assert(std::is_arithmetic<arg_t>::value || std::is_enum<arg_t>::value || std::is_pointer<arg_t>::value,
+                  "Binary logs only support numbers, pointers & strings as arguments.");
+    return (sizeof(arg_t) > 4) ? LOG_ARG_TYPE::DWORD : LOG_ARG_TYPE::WORD;
+}
+
+/**
+ * @brief The argument types packed 2 bits each, first argument in the low bits of the first byte.
+ * @tparam ARGS Argument types.
+ */
+template <typename... ARGS> struct logArgTypes {
+    static constexpr uint8_t N_ARGS = sizeof...(ARGS);
+    static constexpr uint8_t N_BYTES = (N_ARGS + 3) / 4;
+    static_assert(N_ARGS <= LOG_MAX_ARGS, "Too many arguments for a binary log.");
+
+    /** N_BYTES of packed types, at least 1 byte so the array is never empty. */
+    struct packed_t {
+        uint8_t bytes[(N_BYTES == 0) ? 1 : N_BYTES];
+    };
+
+    static constexpr packed_t pack(void) {
+        packed_t packed = {};
+        const LOG_ARG_TYPE types[N_ARGS + 1] = { logArgType<ARGS>()..., LOG_ARG_TYPE::WORD };
+        for (uint8_t i = 0; i < N_ARGS; i++) {
+            packed.bytes[i / 4] |= (uint8_t)((uint8_t)types[i] << (2 * (i % 4)));
+        }
+        return packed;
+    }
+
+    static constexpr packed_t PACKED = pack();
+};
+
+/**
+ * @brief Writes a record straight into the log buffer.
+ * The record is reserved up front with its full length, then the arguments are added with put() and finally it's
+ * committed by the destructor. If there isn't room for the whole record it's dropped: valid() is false and put() does
+ * nothing.
+ */
+class logRecord {
+  public:
+    /**
+     * @brief Reserve room for a record and write its header & argument types.
+     * @param level The level of the log message.
+     * @param id ID of the format string.
+     * @param n_args Number of arguments.
+     * @param arg_types Argument types, packed 2 bits each.
+     * @param args_length Total length of the arguments in bytes.
+     */
+    logRecord(LOG_LEVEL level, uint32_t id, uint8_t n_args, const uint8_t *arg_types, uint16_t args_length);
+
+    /**
+     * @brief Commit the record to the log buffer.
+     */
+    ~logRecord(void) { logBufferCommit(); };
+
+    bool valid(void) const { return is_valid; };
+
+    void put(uint32_t value) { putBytes(&value, sizeof(value)); };
+    void put(uint64_t value) { putBytes(&value, sizeof(value)); };
+    void put(const char *value);
+
+  private:
+    void putBytes(const void *bytes, uint16_t len);
+
+    uint16_t position; /**< Where the next byte goes in the log buffer. */
+    bool is_valid;
+};
+
+/**
+ * @brief Length of an argument in a record.
+ */
+template <typename T> inline uint16_t logArgLength(T value) {
+    (void)value;
+    return (logArgType<T>() == LOG_ARG_TYPE::DWORD) ? 8 : 4;
+}
+inline uint16_t logArgLength(const char *value) {
+    uint16_t len = 0;
+    while ((value != nullptr) && (len < LOG_MAX_STRING_ARG_LENGTH) && (value[len] != '\0')) {
+        len++;
+    }
+    return (uint16_t)(1 + len);
+}
+inline uint16_t logArgLength(char *value) {
+    return logArgLength((const char *)value);
+}
+
+/**
+ * @brief Add an argument to a record, as the 4 or 8 bytes given by logArgType().
+ */
+template <typename T> inline void logArgPut(logRecord *record, T value) {
+    using arg_t = typename std::decay<T>::type;
+    if constexpr (std::is_pointer<arg_t>::value) {
+        logArgPut(record, (uintptr_t)value);
+    } else if constexpr (std::is_floating_point<arg_t>::value) {
+        if constexpr (sizeof(arg_t) > 4) {
+            double as_double = value;
+            uint64_t bits;
+            memcpy(&bits, &as_double, sizeof(bits));
+            record->put(bits);
+        } else {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            record->put(bits);
+        }
+    } else if constexpr (sizeof(arg_t) > 4) {
+        record->put((uint64_t)value);
+    } else if constexpr (std::is_signed<arg_t>::value) {
+        record->put((uint32_t)(int32_t)value); // sign extended so the decoder only needs the format
+    } else {
+        record->put((uint32_t)value);
+    }
+}
+inline void logArgPut(logRecord *record, const char *value) {
+    record->put(value);
+}
+inline void logArgPut(logRecord *record, char *value) {
+    record->put(value);
+}
+
+/**
+ * @brief Write a binary log record. Use LOG() rather than calling this, it checks the level first.
+ * @tparam ID ID of the format string.
+ * @param level The level of the log message. See enum LOG_LEVEL.
+ * @param args (Optional) Any additional arguments for the format.
+ */
+template <uint32_t ID, typename... ARGS> inline void logBinary(LOG_LEVEL level, ARGS... args) {
+    SPAN_SCOPE(SPAN::LOGGING);
+    uint16_t args_length = (uint16_t)(0 + ... + logArgLength(args));
+    logRecord record(level, ID, sizeof...(ARGS), logArgTypes<ARGS...>::PACKED.bytes, args_length);
+    if (record.valid()) {
+        (logArgPut(&record, args), ...);
+    }
+}
@@ -0,0 +1,91 @@
+#include "LogBuffer.h"
+
+#include <atomic>
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of 2.");
+static_assert(LOG_BUFFER_SIZE <= 32768, "LOG_BUFFER_SIZE must fit the uint16_t ring positions.");
+static_assert(std::atomic<uint16_t>::is_always_lock_free, "The log buffer must be lock-free to be used from ISRs.");
+
+// forward declaration - in LogSink.cpp
+void wakeLogDrainTask(void);
+
+// Positions are unmasked & wrap around at 65536, which is a multiple of LOG_BUFFER_SIZE
+static uint8_t log_buffer[LOG_BUFFER_SIZE] = {};
+static std::atomic<uint16_t> log_reserved(0);  /**< End of the reserved bytes. */
+static std::atomic<uint16_t> log_committed(0); /**< End of the bytes the reader can see. */
+static std::atomic<uint16_t> log_tail(0);      /**< Start of the bytes not yet read. */
+static std::atomic<uint8_t> log_writers(0);    /**< Writes in progress: between reserve & commit. */
+
+static std::atomic<uint32_t> log_written(0);
+static std::atomic<uint32_t> log_dropped(0);
+static std::atomic<uint16_t> log_max_used(0);
+
+bool logBufferReserve(uint16_t len, uint16_t *position) {
+    // count the write first so the reserved room can't be committed by someone else before it's written
+    log_writers.fetch_add(1, std::memory_order_acq_rel);
+
+    uint16_t reserved = log_reserved.load(std::memory_order_relaxed);
+    uint16_t used;
+    do {
+        used = reserved - log_tail.load(std::memory_order_acquire);
+        if (len > (LOG_BUFFER_SIZE - used)) {
+            log_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!log_reserved.compare_exchange_weak(reserved, reserved + len, std::memory_order_acq_rel));
+
+    *position = reserved;
+    log_written.fetch_add(1, std::memory_order_relaxed);
+    if ((uint16_t)(used + len) > log_max_used.load(std::memory_order_relaxed)) {
+        log_max_used.store(used + len, std::memory_order_relaxed); // just a statistic, a lost race doesn't matter
+    }
+    return true;
+}
+
+void logBufferWrite(uint16_t position, const void *bytes, uint16_t len) {
+    // copy in up to 2 parts if the bytes wrap around the end of the buffer
+    uint16_t index = position & (LOG_BUFFER_SIZE - 1);
+    uint16_t first_len = (len < (LOG_BUFFER_SIZE - index)) ? len : (LOG_BUFFER_SIZE - index);
+    memcpy(&log_buffer[index], bytes, first_len);
+    memcpy(log_buffer, (const uint8_t *)bytes + first_len, len - first_len);
+}
+
+void logBufferCommit(void) {
+    if (log_writers.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        // a write that this one interrupted is still in progress, it will commit this one too when it's finished
+        return;
+    }
+    uint16_t reserved = log_reserved.load(std::memory_order_acquire);
+    if (log_writers.load(std::memory_order_acquire) != 0) {
+        // another write has started since, it will commit everything up to its end
+        return;
+    }
+    // only ever move the committed position forwards, in case a later commit has already got in first
+    uint16_t committed = log_committed.load(std::memory_order_relaxed);
+    while ((committed != reserved) && ((uint16_t)(reserved - committed) <= LOG_BUFFER_SIZE)) {
+        if (log_committed.compare_exchange_weak(committed, reserved, std::memory_order_release)) {
+            wakeLogDrainTask();
+            break;
+        }
+    }
+}
+
+uint16_t logBufferPeek(const uint8_t **bytes) {
+    uint16_t tail = log_tail.load(std::memory_order_relaxed);
+    uint16_t len = log_committed.load(std::memory_order_acquire) - tail;
+    uint16_t index = tail & (LOG_BUFFER_SIZE - 1);
+    if (len > (LOG_BUFFER_SIZE - index)) {
+        len = LOG_BUFFER_SIZE - index; // up to the end of the buffer, the rest is read next time
+    }
+    *bytes = &log_buffer[index];
+    return len;
+}
+
+void logBufferConsume(uint16_t len) {
+    log_tail.store(log_tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+}
+
+logStats getLogStats(void) {
+    return { log_written.load(std::memory_order_relaxed), log_dropped.load(std::memory_order_relaxed),
+             log_max_used.load(std::memory_order_relaxed) };
+}
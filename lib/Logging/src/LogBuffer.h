@@ -0,0 +1,70 @@
+#pragma once
+/**
+ * @file LogBuffer.h
+ * @author Kalina Knight
+ * @brief Lock-free ring buffer the logs wait in until the log drain task writes them to the sinks (see LogSink.h).
+ * Writing never blocks and is safe from interrupts: a writer reserves room with a compare & swap, copies its bytes in,
+ * then commits. The reserved bytes are only made visible to the reader once every writer that was in progress (e.g. the
+ * task an interrupt logged over) has committed, so the reader never sees half written logs. There is only one reader.
+ * If there isn't room for a log it is dropped and counted rather than waiting.
+ *
+ * @version 0.1
+ * @date 2022-02-15
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+// Size of the ring buffer in bytes, must be a power of 2 and <= 32768
+#define LOG_BUFFER_SIZE 2048
+
+/**
+ * @brief Counters for the log buffer, see getLogStats().
+ */
+struct logStats {
+    uint32_t written;  /**< Logs written into the buffer since startup. */
+    uint32_t dropped;  /**< Logs dropped since startup because the buffer was full. */
+    uint16_t max_used; /**< Most bytes that have been waiting in the buffer at once. */
+};
+
+/**
+ * @brief Reserve room for a log in the buffer. Must be followed by logBufferCommit() whether it succeeds or not.
+ * @param len Length of the log in bytes.
+ * @param position Returns the position of the reserved room to pass to logBufferWrite().
+ * @return True if reserved, false if the log was dropped because there isn't room.
+ */
+bool logBufferReserve(uint16_t len, uint16_t *position);
+
+/**
+ * @brief Copy part of a log into its reserved room.
+ * @param position Where to write, from logBufferReserve() + the length already written.
+ * @param bytes Bytes to write.
+ * @param len Number of bytes.
+ */
+void logBufferWrite(uint16_t position, const void *bytes, uint16_t len);
+
+/**
+ * @brief Finish writing a log, making it (and any logs reserved while it was being written) visible to the reader once
+ * no other writes are in progress. Wakes the log drain task.
+ */
+void logBufferCommit(void);
+
+/**
+ * @brief Reader: get the oldest committed bytes, up to the end of the buffer.
+ * @param bytes Returns a pointer to the bytes.
+ * @return Number of bytes, 0 if the buffer is empty.
+ */
+uint16_t logBufferPeek(const uint8_t **bytes);
+
+/**
+ * @brief Reader: free the given number of bytes from logBufferPeek().
+ * @param len Number of bytes.
+ */
+void logBufferConsume(uint16_t len);
+
+/**
+ * @brief Get the log buffer counters.
+ * @return The counters.
+ */
+logStats getLogStats(void);
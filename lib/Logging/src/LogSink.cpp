@@ -0,0 +1,102 @@
+#include "LogSink.h"
+
+#include <atomic>
+
+#include "LogBuffer.h"
+#include "Logging.h"
+
+static logSink *log_sinks[LOG_MAX_SINKS] = {};
+static SemaphoreHandle_t log_drain_semaphore = NULL; /**< Given to wake the drain task when there are logs. */
+static std::atomic_flag log_draining = ATOMIC_FLAG_INIT; /**< Only one task can read the log buffer at a time. */
+static uint32_t log_dropped_reported = 0;                /**< Dropped logs already warned about. */
+
+bool addLogSink(logSink *sink) {
+    for (logSink *&slot : log_sinks) {
+        if ((slot == sink) || (slot == nullptr)) {
+            slot = sink;
+            return true;
+        }
+    }
+    return false;
+}
+
+void removeLogSink(logSink *sink) {
+    for (logSink *&slot : log_sinks) {
+        if (slot == sink) {
+            slot = nullptr;
+        }
+    }
+}
+
+/**
+ * @brief Wake the drain task, called by logBufferCommit().
+ * Uses the FromISR give as it's safe from both interrupts & tasks. There's no need to yield to the drain task as it's
+ * lower priority than anything logging anyway.
+ */
+void wakeLogDrainTask(void) {
+    if (log_drain_semaphore != NULL) {
+        xSemaphoreGiveFromISR(log_drain_semaphore, NULL);
+    }
+}
+
+/**
+ * @brief The log drain task: writes the logs to the sinks whenever it's woken.
+ */
+static void logDrainTask(void *parameters) {
+    (void)parameters;
+    for (;;) {
+        if (xSemaphoreTake(log_drain_semaphore, portMAX_DELAY) == pdTRUE) {
+            flushLogs();
+        }
+    }
+}
+
+bool startLogDrainTask(void) {
+    if (log_drain_semaphore != NULL) {
+        // already running
+        return true;
+    }
+    SemaphoreHandle_t semaphore = xSemaphoreCreateBinary();
+    if (semaphore == NULL) {
+        return false;
+    }
+    if (xTaskCreate(logDrainTask, "log", LOG_DRAIN_TASK_STACK_SIZE, NULL, LOG_DRAIN_TASK_PRIORITY, NULL) != pdPASS) {
+        vSemaphoreDelete(semaphore);
+        return false;
+    }
+    log_drain_semaphore = semaphore;
+    // drain anything logged before the task started
+    wakeLogDrainTask();
+    return true;
+}
+
+bool flushLogs(void) {
+    if (log_draining.test_and_set(std::memory_order_acquire)) {
+        return false;
+    }
+    bool warned = false;
+    do {
+        const uint8_t *bytes;
+        uint16_t len;
+        while ((len = logBufferPeek(&bytes)) > 0) {
+            for (logSink *sink : log_sinks) {
+                if (sink != nullptr) {
+                    sink->write(bytes, len);
+                }
+            }
+            logBufferConsume(len);
+        }
+
+        // let the reader know if logs are missing, once per flush so a full buffer can't keep it going forever
+        uint32_t dropped = getLogStats().dropped;
+        if (warned || (dropped == log_dropped_reported)) {
+            break;
+        }
+        LOG(LOG_LEVEL::WARN, "%lu logs dropped, the log buffer was full.",
+            (unsigned long)(dropped - log_dropped_reported));
+        log_dropped_reported = dropped;
+        warned = true;
+    } while (true);
+    log_draining.clear(std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+/**
+ * @file LogSink.h
+ * @author Kalina Knight
+ * @brief Where the logs end up. The log drain task writes the logs from the log buffer to every added sink, at low
+ * priority so it only runs once the application task is asleep or waiting. Logging itself never waits on a sink.
+ * initLogging() adds the Serial sink, e.g. to also send logs over BLE UART:
+ *     streamLogSink<BLEUart> ble_log_sink(bleuart);
+ *     addLogSink(&ble_log_sink);
+ *
+ * @version 0.1
+ * @date 2022-02-15
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+// Max number of sinks that can be added at once
+#define LOG_MAX_SINKS 4
+
+// Log drain task settings
+#define LOG_DRAIN_TASK_STACK_SIZE (2 * configMINIMAL_STACK_SIZE)
+#define LOG_DRAIN_TASK_PRIORITY   TASK_PRIO_LOWEST // below the loop task, so it runs while the application sleeps
+
+/**
+ * @brief A destination for the logs.
+ */
+class logSink {
+  public:
+    /**
+     * @brief Write log bytes: whole text lines or binary records, though either can be split over two writes.
+     * Called from the log drain task, so it's fine to wait on slow hardware here.
+     * @param bytes Log bytes.
+     * @param len Number of bytes.
+     */
+    virtual void write(const uint8_t *bytes, size_t len) = 0;
+};
+
+/**
+ * @brief A sink for anything with a write(const uint8_t *, size_t) method, e.g. Serial, a BLEUart or an open file on
+ * the internal flash (InternalFS).
+ * @tparam STREAM Type of the stream.
+ */
+template <typename STREAM> class streamLogSink : public logSink {
+  public:
+    explicit streamLogSink(STREAM &stream) : stream(stream){};
+
+    void write(const uint8_t *bytes, size_t len) override { stream.write(bytes, len); };
+
+  private:
+    STREAM &stream;
+};
+
+/**
+ * @brief Add a sink for the logs. Call from setup(), not while logging from other tasks.
+ * @param sink The sink, which must stay in scope while it's added.
+ * @return False if LOG_MAX_SINKS have already been added.
+ */
+bool addLogSink(logSink *sink);
+
+/**
+ * @brief Remove a sink added by addLogSink().
+ * @param sink The sink.
+ */
+void removeLogSink(logSink *sink);
+
+/**
+ * @brief Start the log drain task, if it hasn't already. Called by initLogging().
+ * @return True if the task is running.
+ */
+bool startLogDrainTask(void);
+
+/**
+ * @brief Write all the logs in the buffer to the sinks now, in this task.
+ * The drain task normally does this, but this can be used to make sure the logs are written before e.g. a reset. Also
+ * logs a warning if logs have been dropped since the last time.
+ * @return False if the drain task is in the middle of writing, in which case it will finish the job.
+ */
+bool flushLogs(void);
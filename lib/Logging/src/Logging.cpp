@@ -1,17 +1,25 @@
-#include "logging.h"
+#include "Logging.h"
 
 // forward declarations
-void formatTimestamp(unsigned long timestamp, char *buffer, int buffer_len);
-void printLog(char *log);
+int formatTimestamp(unsigned long timestamp, char *buffer, int buffer_len);
 void initSerial(void);
 
+static streamLogSink<decltype(Serial)> serial_log_sink(Serial);
+
+static_assert((int)LOG_MODULE::N_MODULES == 4, "Give the new LOG_MODULE a starting level in log_module_levels.");
+LOG_LEVEL log_module_levels[(int)LOG_MODULE::N_MODULES] = { APP_LOG_LEVEL, APP_LOG_LEVEL, APP_LOG_LEVEL,
+                                                            APP_LOG_LEVEL };
+
 void initLogging(void) {
     if (APP_LOG_LEVEL == LOG_LEVEL::NONE) {
         // do nothing
         return;
     }
-    // change which function is called here if logging to a different location e.g. EEPROM, SD card, etc.
-    initSerial();
+    if (LOG_TO_SERIAL) {
+        initSerial();
+        addLogSink(&serial_log_sink);
+    }
+    startLogDrainTask();
 }
 
 void log(LOG_LEVEL level, const char *format, ...) {
@@ -19,42 +27,63 @@ void log(LOG_LEVEL level, const char *format, ...) {
         // do nothing
         return;
     }
+    SPAN_SCOPE(SPAN::LOGGING);
 
-    char log_message[MAX_LOG_LENGTH] = {};
-
-    // using stdarg.h to grab the additional arguments (the ...) and use them in the vsnprintf to insert into format
-    va_list args;
-    va_start(args, format);
-    vsnprintf(log_message, sizeof(log_message), format, args);
-    va_end(args);
-
-    char log_level_prefix[6] = {};
+    const char *log_level_prefix;
     switch (level) {
         case LOG_LEVEL::DEBUG:
-            strcpy(log_level_prefix, "DEBUG");
+            log_level_prefix = "DEBUG";
             break;
         case LOG_LEVEL::INFO:
-            strcpy(log_level_prefix, " INFO"); // extra space is to pad the string to the same length
+            log_level_prefix = " INFO"; // extra space is to pad the string to the same length
             break;
         case LOG_LEVEL::WARN:
-            strcpy(log_level_prefix, " WARN"); // extra space is to pad the string to the same length
+            log_level_prefix = " WARN"; // extra space is to pad the string to the same length
             break;
         case LOG_LEVEL::ERROR:
-            strcpy(log_level_prefix, "ERROR");
+            log_level_prefix = "ERROR";
             break;
         default:
             // no level?
+            log_level_prefix = "";
             break;
     }
 
-    char timestamp[40] = {};
-    formatTimestamp(millis(), timestamp, sizeof(timestamp));
+    // assemble formatted log: "{timestamp} LOG_LEVEL: message\n"
+    // 1 byte is kept back for the \n, which then replaces the null terminator
+    char printable_log[MAX_LOG_LENGTH];
+    const int max_len = sizeof(printable_log) - 1;
+    int len = 0;
+    printable_log[len++] = '{';
+    len += formatTimestamp(millis(), &printable_log[len], max_len - len);
+    len += snprintf(&printable_log[len], max_len - len, "} %s: ", log_level_prefix);
+
+    // using stdarg.h to grab the additional arguments (the ...) and use them in the vsnprintf to insert into format
+    va_list args;
+    va_start(args, format);
+    int message_len = vsnprintf(&printable_log[len], max_len - len, format, args);
+    va_end(args);
+    len += (message_len < 0) ? 0 : message_len;
+    if (len > (max_len - 1)) {
+        len = max_len - 1; // cut short
+    }
+    printable_log[len++] = '\n';
+
+    uint16_t position;
+    if (logBufferReserve(len, &position)) {
+        logBufferWrite(position, printable_log, len);
+    }
+    logBufferCommit();
+}
 
-    // assemble formatted log: "{timestamp} LOG_LEVEL: message"
-    char printable_log[MAX_LOG_LENGTH] = {};
-    snprintf(printable_log, sizeof(printable_log), "{%s} %s: %s", timestamp, log_level_prefix, log_message);
+void setLogLevel(LOG_MODULE module, LOG_LEVEL level) {
+    if (module < LOG_MODULE::N_MODULES) {
+        log_module_levels[(int)module] = level;
+    }
+}
 
-    printLog(printable_log);
+LOG_LEVEL getLogLevel(LOG_MODULE module) {
+    return (module < LOG_MODULE::N_MODULES) ? log_module_levels[(int)module] : LOG_LEVEL::NONE;
 }
 
 /**
@@ -91,23 +120,14 @@ void initSerial(void) {
  * @param timestamp Timestamp to format.
  * @param buffer Buffer to place formatted timestamp into.
  * @param buffer_len Length of the buffer.
+ * @return Length of the formatted timestamp.
  */
-void formatTimestamp(unsigned long timestamp, char *buffer, int buffer_len) {
+int formatTimestamp(unsigned long timestamp, char *buffer, int buffer_len) {
     unsigned long HH, MM, SS, ms;
     HH = timestamp / MS_IN_HOUR;
     MM = (timestamp % MS_IN_HOUR) / MS_IN_MINUTE;
     SS = (timestamp % MS_IN_MINUTE) / MS_IN_SECOND;
     ms = timestamp % MS_IN_SECOND;
     // place formatted timestamp into given buffer
-    snprintf(buffer, buffer_len, "%lu:%02lu:%02lu.%03lu", HH, MM, SS, ms);
-}
-
-/**
- * @brief Prints the formatted log.
- * Change this function to alter the end location of the logs:
- * e.g. EEPROM, SD card, etc.
- * @param log The formatted log message to print.
- */
-void printLog(char *log) {
-    Serial.println(log);
+    return snprintf(buffer, buffer_len, "%lu:%02lu:%02lu.%03lu", HH, MM, SS, ms);
 }
@@ -4,8 +4,10 @@
  * @author Kalina Knight
  * @brief Some basic functions for logging.
  * Change the APP_LOG_LEVEL to turn log messages on and off.
- * Currently the logs are directed to Serial. If you'd like to direct them to a different location (e.g. EEPROM, SD
- * card, etc.), then you will need to edit/replace two functions in logging.cpp: initSerial() & printLog().
+ * Log with the LOG() macro. Logs are written into the log buffer (LogBuffer.h) without waiting, then a low priority
+ * task writes them to Serial & any other sinks (LogSink.h) while the application sleeps.
+ * Set APP_LOG_FORMAT to LOG_FORMAT_BINARY to write compact binary records instead of formatting the messages on the
+ * device, see BinaryLog.h.
  * @version 0.1
  * @date 2021-08-17
  *
@@ -15,6 +17,10 @@
 #include <Arduino.h>
 #include <stdarg.h>
 
+#include "LogBuffer.h"
+#include "LogSink.h"
+#include "SpanProfiler.h"
+
 enum class LOG_LEVEL {
     NONE = 0,  /**< Disable logging. No messages are logged. */
     ERROR = 1, /**< Only ERROR level messages are logged. */
@@ -23,8 +29,43 @@ enum class LOG_LEVEL {
     DEBUG = 4  /**< ERROR, WARN, INFO & DEBUG level messages are logged. */
 };
 
-// Set the logging level for the entire application here:
+// Set the logging level for the entire application here, or with a build flag: -DAPP_LOG_LEVEL=LOG_LEVEL::INFO
+// This is the compile time floor: LOG() calls of a lower level compile to nothing, arguments & format string included.
+#ifndef APP_LOG_LEVEL
 #define APP_LOG_LEVEL LOG_LEVEL::DEBUG
+#endif
+
+/**
+ * @brief Modules that can have their own log level at runtime, see setLogLevel().
+ * A source file picks its module by defining LOG_MODULE_ID before its includes, otherwise it is LOG_MODULE::APP.
+ * To add a module add it here before N_MODULES.
+ */
+enum class LOG_MODULE {
+    APP = 0,     /**< The application/sketch & anything that doesn't define LOG_MODULE_ID. */
+    LORAWAN = 1, /**< LoRaWAN_functs. */
+    SENSORS = 2, /**< SensorHelper. */
+    STORAGE = 3, /**< FlashLog. */
+    N_MODULES    /**< Number of modules, not a module. */
+};
+
+#ifndef LOG_MODULE_ID
+#define LOG_MODULE_ID LOG_MODULE::APP
+#endif
+
+// Set to 0 to leave Serial off, e.g. for unattended units that only log to flash (see FlashLog.h)
+#ifndef LOG_TO_SERIAL
+#define LOG_TO_SERIAL 1
+#endif
+
+// Log formats: TEXT formats each message on the device. BINARY only stores the format string ID, timestamp & raw
+// arguments, and tools/log_decoder.py formats them on the host.
+#define LOG_FORMAT_TEXT   0
+#define LOG_FORMAT_BINARY 1
+
+// Set the log format for the entire application here, or with a build flag: -DAPP_LOG_FORMAT=LOG_FORMAT_BINARY
+#ifndef APP_LOG_FORMAT
+#define APP_LOG_FORMAT LOG_FORMAT_TEXT
+#endif
 
 // I'm unsure what the max is for Serial, but 200 characters seems like plenty
 #define MAX_LOG_LENGTH 200
@@ -35,12 +76,12 @@ enum class LOG_LEVEL {
 #define MS_IN_SECOND 1000
 
 /**
- * @brief Initialises location where logs are sent.
+ * @brief Initialises Serial & adds it as a log sink (unless LOG_TO_SERIAL is 0), then starts the log drain task.
  */
 void initLogging(void);
 
 /**
- * @brief Formats and logs the message if it is of level >= APP_LOG_LEVEL.
+ * @brief Formats the message and writes it to the log buffer if it is of level >= APP_LOG_LEVEL.
  * Logs are formatted with a timestamp and the level: "{timestamp} LOG_LEVEL: message".
  * The arguments format and ... work just like printf() statements.
  * @param level The level of the log message. See enum LOG_LEVEL.
@@ -48,3 +89,60 @@ void initLogging(void);
  * @param ... (Optional) Any additional arguments for the format.
  */
 void log(LOG_LEVEL level, const char *format, ...);
+
+/**
+ * @brief Set the runtime log level of a module. Only logs of level >= both this level & APP_LOG_LEVEL are logged, so it
+ * can make a module quieter than APP_LOG_LEVEL but not louder.
+ * @param module The module to set the level of.
+ * @param level The new level. All modules start at APP_LOG_LEVEL.
+ */
+void setLogLevel(LOG_MODULE module, LOG_LEVEL level);
+
+/**
+ * @brief Get the runtime log level of a module.
+ * @param module The module.
+ * @return Its level, see setLogLevel().
+ */
+LOG_LEVEL getLogLevel(LOG_MODULE module);
+
+// Runtime log level of each module, use setLogLevel() & getLogLevel()
+extern LOG_LEVEL log_module_levels[(int)LOG_MODULE::N_MODULES];
+
+/**
+ * @brief Whether a log level is above the compile time floor APP_LOG_LEVEL.
+ * @param level The level of the log message.
+ * @return True if logs of this level are compiled in.
+ */
+constexpr bool logLevelCompiled(LOG_LEVEL level) {
+    return (level != LOG_LEVEL::NONE) && (level <= APP_LOG_LEVEL);
+}
+
+#include "BinaryLog.h"
+
+/**
+ * @brief Log a message if it is of level >= APP_LOG_LEVEL & the runtime level of this file's module (LOG_MODULE_ID), in
+ * the format set by APP_LOG_FORMAT.
+ * Works just like log(), except:
+ * - the level must be a constant (e.g. LOG_LEVEL::DEBUG), so that logs below APP_LOG_LEVEL compile to nothing: their
+ *   arguments are never evaluated and their format strings aren't in the firmware.
+ * - the format must be a string literal so the binary format can replace it with its ID at compile time.
+ *   tools/log_decoder.py finds the format strings by searching the source for LOG(LOG_LEVEL::...
+ * @param level The level of the log message. See enum LOG_LEVEL.
+ * @param format Print format for the message, a string literal.
+ * @param ... (Optional) Any additional arguments for the format.
+ */
+#define LOG(level, format, ...)                                                                                        \
+    do {                                                                                                               \
+        if constexpr (logLevelCompiled(level)) {                                                                       \
+            if ((level) <= log_module_levels[(int)(LOG_MODULE_ID)]) {                                                  \
+                LOG_WRITE(level, format, ##__VA_ARGS__);                                                               \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (0)
+
+// Writes a log that has passed the level checks in LOG()
+#if APP_LOG_FORMAT == LOG_FORMAT_BINARY
+#define LOG_WRITE(level, format, ...) logBinary<logStringId(format)>(level, ##__VA_ARGS__)
+#else
+#define LOG_WRITE(level, format, ...) log(level, format, ##__VA_ARGS__)
+#endif
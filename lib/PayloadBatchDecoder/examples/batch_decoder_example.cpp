@@ -0,0 +1,84 @@
+/**
+ * @file batch_decoder_example.cpp
+ * @author Kalina Knight
+ * @brief An example of decoding a batch of uplinks into columns with the PayloadBatchDecoder library.
+ * Encodes a few frames with the firmware encoder, as a stand-in for uplinks received by the server, then decodes them
+ * all at once and prints them as CSV. Host only, a plain C++17 program (see the README to build it).
+ *
+ * @version 0.1
+ * @date 2022-02-17
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdio.h>
+
+#include "PayloadBatchDecoder.h" /**< Batch decoder. */
+#include "PortSchema.h"          /**< Go here to see existing and define new sensor/port schemas. */
+
+int main() {
+    // "Receive" some uplinks: each is appended to the batch as a (port, length, payload) record
+    sensorData sensor_data = { 3712, true, 21.37, true, 55.5, true, 101325, true, 48000, true, -33.8688, 151.2093, true,
+                               2500, true, 0, false };
+    const portSchema ports[] = { PORT1, PORT3, PORT3, PORT9, PORT59, PORT43 };
+    std::vector<uint8_t> records;
+    for (const portSchema &port : ports) {
+        uint8_t payload[PAYLOAD_BUFFER_SIZE] = {};
+        uint8_t len = port.encodeSensorDataToPayload(&sensor_data, payload);
+        appendUplinkRecord(&records, port.port_number, payload, len);
+        sensor_data.temperature.value -= 1.5;
+    }
+
+    // Decode them all at once
+    sensorDataColumns columns;
+    batchDecodeResult result = decodeUplinkBatch(records.data(), records.size(), &columns);
+    printf("Decoded %u frames from %u bytes\n", (unsigned)result.n_frames, (unsigned)result.bytes_used);
+
+    // Invalid fields or fields not sent on the port are left empty
+    printf("port,battery_mv,temperature,humidity,pressure,gas_resist,latitude,longitude,analog_mv\n");
+    for (size_t i = 0; i < columns.n_frames; i++) {
+        printf("%u", columns.port[i]);
+        if (columns.isValid(SENSOR_FIELD::BATTERY_VOLTAGE, i)) {
+            printf(",%.0f", columns.battery_mv[i]);
+        } else {
+            printf(",");
+        }
+        if (columns.isValid(SENSOR_FIELD::TEMPERATURE, i)) {
+            printf(",%.2f", columns.temperature[i]);
+        } else {
+            printf(",");
+        }
+        if (columns.isValid(SENSOR_FIELD::RELATIVE_HUMIDITY, i)) {
+            printf(",%.1f", columns.humidity[i]);
+        } else {
+            printf(",");
+        }
+        if (columns.isValid(SENSOR_FIELD::AIR_PRESSURE, i)) {
+            printf(",%u", (unsigned)columns.pressure[i]);
+        } else {
+            printf(",");
+        }
+        if (columns.isValid(SENSOR_FIELD::GAS_RESISTANCE, i)) {
+            printf(",%u", (unsigned)columns.gas_resist[i]);
+        } else {
+            printf(",");
+        }
+        if (columns.isValid(SENSOR_FIELD::LATITUDE, i)) {
+            printf(",%.4f", columns.latitude[i]);
+        } else {
+            printf(",");
+        }
+        if (columns.isValid(SENSOR_FIELD::LONGITUDE, i)) {
+            printf(",%.4f", columns.longitude[i]);
+        } else {
+            printf(",");
+        }
+        if (columns.isValid(SENSOR_FIELD::ANALOG, i)) {
+            printf(",%.0f", columns.analog_mv[i]);
+        } else {
+            printf(",");
+        }
+        printf("\n");
+    }
+    return 0;
+}
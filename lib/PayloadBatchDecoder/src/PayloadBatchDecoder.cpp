@@ -0,0 +1,544 @@
+#include "PayloadBatchDecoder.h"
+
+#include <algorithm>
+#include <string.h>
+#include <thread>
+#include <utility>
+
+#define FRAMES_PER_WORD      64 /**< Frames per validity bitmap word. */
+#define MIN_WORDS_PER_THREAD 64 /**< Batches smaller than this many bitmap words per thread use fewer threads. */
+
+void sensorDataColumns::reset(size_t n) {
+    // Every entry is overwritten when decoding, so reused columns are only resized rather than cleared
+    n_frames = n;
+    port.resize(n);
+    battery_mv.resize(n);
+    temperature.resize(n);
+    humidity.resize(n);
+    pressure.resize(n);
+    gas_resist.resize(n);
+    latitude.resize(n);
+    longitude.resize(n);
+    analog_mv.resize(n);
+    timestamp.resize(n);
+    for (std::vector<uint64_t> &bitmap : validity) {
+        bitmap.assign((n + FRAMES_PER_WORD - 1) / FRAMES_PER_WORD, 0);
+    }
+}
+
+void spanReportColumns::clear(void) {
+    n_reports = 0;
+    row.clear();
+    for (std::vector<spanStats> &column : spans) {
+        column.clear();
+    }
+}
+
+void appendUplinkRecord(std::vector<uint8_t> *records, uint8_t port, const uint8_t *payload, uint8_t len) {
+    records->push_back(port);
+    records->push_back(len);
+    records->insert(records->end(), payload, payload + len);
+}
+
+/**
+ * @brief Decode one field of every frame in a run of frames on the same port.
+ * A frame too short to hold the field is left invalid, as portSchema::decodePayloadToSensorData() does. Invalid
+ * fields are set to 0.
+ * @param frames Start of each frame's record.
+ * @param first First frame of the run.
+ * @param last One past the last frame of the run.
+ * @param bit_offset Offset of the field in the payload in bits.
+ * @param column Column to decode the field into.
+ * @param bitmap Validity bitmap of the field.
+ */
+template <const sensorPortSchema &SCHEMA, typename T>
+static void decodeFieldRun(const uint8_t *const *frames, size_t first, size_t last, uint16_t bit_offset, T *column,
+                           uint64_t *bitmap) {
+    const uint16_t field_end = bit_offset + fieldCodec<SCHEMA>::BITS;
+    const bool byte_aligned = SCHEMA.isByteAligned() && ((bit_offset % 8) == 0);
+    for (size_t i = first; i < last; i++) {
+        const uint8_t *record = frames[i];
+        T value = 0;
+        bool valid = false;
+        if ((record[1] * 8) >= field_end) {
+            if constexpr (SCHEMA.isByteAligned()) {
+                if (byte_aligned) {
+                    fieldCodec<SCHEMA>::decode(&value, &valid, &record[UPLINK_RECORD_HEADER_SIZE], bit_offset / 8);
+                }
+            }
+            if (!byte_aligned) {
+                bitReader reader(&record[UPLINK_RECORD_HEADER_SIZE], record[1], bit_offset);
+                fieldCodec<SCHEMA>::decode(&value, &valid, &reader);
+            }
+        }
+        column[i] = value;
+        bitmap[i / FRAMES_PER_WORD] |= ((uint64_t)valid << (i % FRAMES_PER_WORD));
+    }
+}
+
+/**
+ * @brief Decode one field of every frame in a run with either its normal or compact schema, see decodeFieldRun().
+ * @param compact Use COMPACT_SCHEMA, as the port has the COMPACT_FIELDS flag.
+ */
+template <const sensorPortSchema &SCHEMA, const sensorPortSchema &COMPACT_SCHEMA, typename T>
+static void decodePlanFieldRun(bool compact, const uint8_t *const *frames, size_t first, size_t last,
+                               uint16_t bit_offset, T *column, uint64_t *bitmap) {
+    if (compact) {
+        decodeFieldRun<COMPACT_SCHEMA>(frames, first, last, bit_offset, column, bitmap);
+    } else {
+        decodeFieldRun<SCHEMA>(frames, first, last, bit_offset, column, bitmap);
+    }
+}
+
+/**
+ * @brief Set a field the port doesn't send to 0 for every frame in a run. Its validity bits are already clear.
+ * @param field Sensor field.
+ * @param first First frame of the run.
+ * @param last One past the last frame of the run.
+ * @param columns Columns to clear the field in.
+ */
+static void clearFieldRun(SENSOR_FIELD field, size_t first, size_t last, sensorDataColumns *columns) {
+    switch (field) {
+        case SENSOR_FIELD::BATTERY_VOLTAGE:
+            std::fill(&columns->battery_mv[first], &columns->battery_mv[0] + last, 0);
+            break;
+        case SENSOR_FIELD::TEMPERATURE:
+            std::fill(&columns->temperature[first], &columns->temperature[0] + last, 0);
+            break;
+        case SENSOR_FIELD::RELATIVE_HUMIDITY:
+            std::fill(&columns->humidity[first], &columns->humidity[0] + last, 0);
+            break;
+        case SENSOR_FIELD::AIR_PRESSURE:
+            std::fill(&columns->pressure[first], &columns->pressure[0] + last, 0);
+            break;
+        case SENSOR_FIELD::GAS_RESISTANCE:
+            std::fill(&columns->gas_resist[first], &columns->gas_resist[0] + last, 0);
+            break;
+        case SENSOR_FIELD::LATITUDE:
+            std::fill(&columns->latitude[first], &columns->latitude[0] + last, 0);
+            break;
+        case SENSOR_FIELD::LONGITUDE:
+            std::fill(&columns->longitude[first], &columns->longitude[0] + last, 0);
+            break;
+        case SENSOR_FIELD::ANALOG:
+            std::fill(&columns->analog_mv[first], &columns->analog_mv[0] + last, 0);
+            break;
+        case SENSOR_FIELD::TIMESTAMP:
+            std::fill(&columns->timestamp[first], &columns->timestamp[0] + last, 0);
+            break;
+    }
+}
+
+/**
+ * @brief Decode a run of frames on any port, a field at a time by walking the port's plan.
+ * @param port Port of every frame in the run.
+ * @param frames Start of each frame's record.
+ * @param first First frame of the run.
+ * @param last One past the last frame of the run.
+ * @param columns Columns to decode into.
+ */
+static void decodePortRun(const portSchema &port, const uint8_t *const *frames, size_t first, size_t last,
+                          sensorDataColumns *columns) {
+    for (size_t i = first; i < last; i++) {
+        columns->port[i] = frames[i][0];
+    }
+
+    bool sent[MAX_PORT_FIELDS] = {};
+    const bool compact = port.plan.compact;
+    for (uint8_t f = 0; f < port.plan.n_fields; f++) {
+        sent[(uint8_t)port.plan.fields[f].field] = true;
+        uint16_t offset = port.plan.fields[f].bit_offset;
+        uint64_t *bitmap = columns->validity[(uint8_t)port.plan.fields[f].field].data();
+        switch (port.plan.fields[f].field) {
+            case SENSOR_FIELD::BATTERY_VOLTAGE:
+                decodePlanFieldRun<batteryVoltageSchema, compactBatteryVoltageSchema>(
+                    compact, frames, first, last, offset, columns->battery_mv.data(), bitmap);
+                break;
+            case SENSOR_FIELD::TEMPERATURE:
+                decodePlanFieldRun<temperatureSchema, compactTemperatureSchema>(
+                    compact, frames, first, last, offset, columns->temperature.data(), bitmap);
+                break;
+            case SENSOR_FIELD::RELATIVE_HUMIDITY:
+                decodePlanFieldRun<relativeHumiditySchema, compactRelativeHumiditySchema>(
+                    compact, frames, first, last, offset, columns->humidity.data(), bitmap);
+                break;
+            case SENSOR_FIELD::AIR_PRESSURE:
+                decodePlanFieldRun<airPressureSchema, compactAirPressureSchema>(
+                    compact, frames, first, last, offset, columns->pressure.data(), bitmap);
+                break;
+            case SENSOR_FIELD::GAS_RESISTANCE:
+                decodePlanFieldRun<gasResistanceSchema, compactGasResistanceSchema>(
+                    compact, frames, first, last, offset, columns->gas_resist.data(), bitmap);
+                break;
+            case SENSOR_FIELD::LATITUDE:
+                decodePlanFieldRun<locationSchema, compactLocationSchema>(compact, frames, first, last, offset,
+                                                                          columns->latitude.data(), bitmap);
+                break;
+            case SENSOR_FIELD::LONGITUDE:
+                decodePlanFieldRun<locationSchema, compactLocationSchema>(compact, frames, first, last, offset,
+                                                                          columns->longitude.data(), bitmap);
+                break;
+            case SENSOR_FIELD::ANALOG:
+                decodePlanFieldRun<analogSchema, compactAnalogSchema>(compact, frames, first, last, offset,
+                                                                      columns->analog_mv.data(), bitmap);
+                break;
+            case SENSOR_FIELD::TIMESTAMP:
+                // compact ports send the timestamp with the same schema
+                decodePlanFieldRun<timestampSchema, timestampSchema>(compact, frames, first, last, offset,
+                                                                     columns->timestamp.data(), bitmap);
+                break;
+        }
+    }
+
+    for (uint8_t field = 0; field < MAX_PORT_FIELDS; field++) {
+        if (!sent[field]) {
+            clearFieldRun((SENSOR_FIELD)field, first, last, columns);
+        }
+    }
+}
+
+/**
+ * @brief Decode one value of one frame into its column, with the schema & offset known at compile time.
+ * @param payload Frame payload.
+ * @param len Length of the payload.
+ * @param column Column to decode the value into. Set to 0 if the value is invalid or missing from the payload.
+ * @param i Frame index.
+ * @return True if the value is valid.
+ */
+template <const sensorPortSchema &SCHEMA, uint16_t BIT_OFFSET, typename T>
+static inline bool decodeFrameValue(const uint8_t *payload, uint8_t len, T *column, size_t i) {
+    T value = 0;
+    bool valid = false;
+    if ((len * 8) >= (BIT_OFFSET + fieldCodec<SCHEMA>::BITS)) {
+        if constexpr (SCHEMA.isByteAligned() && ((BIT_OFFSET % 8) == 0)) {
+            fieldCodec<SCHEMA>::decode(&value, &valid, payload, BIT_OFFSET / 8);
+        } else {
+            bitReader reader(payload, len, BIT_OFFSET);
+            fieldCodec<SCHEMA>::decode(&value, &valid, &reader);
+        }
+    }
+    column[i] = value;
+    return valid;
+}
+
+/**
+ * @brief Decode one field of one frame into its column, with the field known at compile time.
+ * @tparam COMPACT Use the field's compact schema, as the port has the COMPACT_FIELDS flag.
+ * @param payload Frame payload.
+ * @param len Length of the payload.
+ * @param i Frame index.
+ * @param columns Columns to decode into.
+ */
+template <SENSOR_FIELD FIELD, uint16_t BIT_OFFSET, bool COMPACT>
+static inline void decodeFrameField(const uint8_t *payload, uint8_t len, size_t i, sensorDataColumns *columns) {
+    bool valid = false;
+    if constexpr (FIELD == SENSOR_FIELD::BATTERY_VOLTAGE) {
+        valid = decodeFrameValue<COMPACT ? compactBatteryVoltageSchema : batteryVoltageSchema, BIT_OFFSET>(
+            payload, len, columns->battery_mv.data(), i);
+    } else if constexpr (FIELD == SENSOR_FIELD::TEMPERATURE) {
+        valid = decodeFrameValue<COMPACT ? compactTemperatureSchema : temperatureSchema, BIT_OFFSET>(
+            payload, len, columns->temperature.data(), i);
+    } else if constexpr (FIELD == SENSOR_FIELD::RELATIVE_HUMIDITY) {
+        valid = decodeFrameValue<COMPACT ? compactRelativeHumiditySchema : relativeHumiditySchema, BIT_OFFSET>(
+            payload, len, columns->humidity.data(), i);
+    } else if constexpr (FIELD == SENSOR_FIELD::AIR_PRESSURE) {
+        valid = decodeFrameValue<COMPACT ? compactAirPressureSchema : airPressureSchema, BIT_OFFSET>(
+            payload, len, columns->pressure.data(), i);
+    } else if constexpr (FIELD == SENSOR_FIELD::GAS_RESISTANCE) {
+        valid = decodeFrameValue<COMPACT ? compactGasResistanceSchema : gasResistanceSchema, BIT_OFFSET>(
+            payload, len, columns->gas_resist.data(), i);
+    } else if constexpr (FIELD == SENSOR_FIELD::LATITUDE) {
+        valid = decodeFrameValue<COMPACT ? compactLocationSchema : locationSchema, BIT_OFFSET>(
+            payload, len, columns->latitude.data(), i);
+    } else if constexpr (FIELD == SENSOR_FIELD::LONGITUDE) {
+        valid = decodeFrameValue<COMPACT ? compactLocationSchema : locationSchema, BIT_OFFSET>(
+            payload, len, columns->longitude.data(), i);
+    } else if constexpr (FIELD == SENSOR_FIELD::ANALOG) {
+        valid = decodeFrameValue<COMPACT ? compactAnalogSchema : analogSchema, BIT_OFFSET>(
+            payload, len, columns->analog_mv.data(), i);
+    } else {
+        valid = decodeFrameValue<timestampSchema, BIT_OFFSET>(payload, len, columns->timestamp.data(), i);
+    }
+    columns->validity[(uint8_t)FIELD][i / FRAMES_PER_WORD] |= ((uint64_t)valid << (i % FRAMES_PER_WORD));
+}
+
+/**
+ * @brief Decode fields F onwards of a port's plan for one frame. The plan is unrolled at compile time.
+ * @tparam PORT_NUMBER Port number, a defined port in PORT_TABLE.
+ * @param payload Frame payload.
+ * @param len Length of the payload.
+ * @param i Frame index.
+ * @param columns Columns to decode into.
+ */
+template <uint8_t PORT_NUMBER, uint8_t F = 0>
+static inline void decodeFrameFields(const uint8_t *payload, uint8_t len, size_t i, sensorDataColumns *columns) {
+    constexpr const portEncodePlan &plan = PORT_TABLE.ports[PORT_NUMBER].plan;
+    if constexpr (F < plan.n_fields) {
+        decodeFrameField<plan.fields[F].field, plan.fields[F].bit_offset, plan.compact>(payload, len, i, columns);
+        decodeFrameFields<PORT_NUMBER, F + 1>(payload, len, i, columns);
+    }
+}
+
+/**
+ * @brief Check if a port's plan includes the field.
+ * @param port Port.
+ * @param field Sensor field.
+ * @return True if the port sends the field.
+ */
+static constexpr bool portSendsField(const portSchema &port, SENSOR_FIELD field) {
+    for (uint8_t f = 0; f < port.plan.n_fields; f++) {
+        if (port.plan.fields[f].field == field) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Decode a run of frames on a port, frame by frame with the port's plan unrolled at compile time.
+ * @tparam PORT_NUMBER Port number, a defined port in PORT_TABLE.
+ * @param frames Start of each frame's record.
+ * @param first First frame of the run.
+ * @param last One past the last frame of the run.
+ * @param columns Columns to decode into.
+ */
+template <uint8_t PORT_NUMBER>
+static void decodeDefinedPortRun(const uint8_t *const *frames, size_t first, size_t last, sensorDataColumns *columns) {
+    constexpr const portSchema &port = PORT_TABLE.ports[PORT_NUMBER];
+    for (size_t i = first; i < last; i++) {
+        const uint8_t *record = frames[i];
+        columns->port[i] = PORT_NUMBER;
+        decodeFrameFields<PORT_NUMBER>(&record[UPLINK_RECORD_HEADER_SIZE], record[1], i, columns);
+    }
+
+    for (uint8_t field = 0; field < MAX_PORT_FIELDS; field++) {
+        if (!portSendsField(port, (SENSOR_FIELD)field)) {
+            clearFieldRun((SENSOR_FIELD)field, first, last, columns);
+        }
+    }
+}
+
+/** @brief Decodes a run of frames on a single port. */
+typedef void (*portRunDecoder)(const uint8_t *const *frames, size_t first, size_t last, sensorDataColumns *columns);
+
+/** @brief Run decoders specialised for each defined port, indexed by port number like PORT_TABLE. */
+struct portRunDecoderTable {
+    portRunDecoder decoders[PORT_TABLE_SIZE];
+};
+
+/**
+ * @brief Get the run decoder specialised for a port number, if it's a defined port.
+ * @return The port's run decoder, or nullptr if the port number isn't defined.
+ */
+template <uint8_t PORT_NUMBER> static constexpr portRunDecoder definedPortRunDecoder(void) {
+    if constexpr ((PORT_NUMBER == 0) || (PORT_TABLE.ports[PORT_NUMBER].port_number != PORT_NUMBER)) {
+        // PORTERROR, port 0 is reserved by LoRaWAN
+        return nullptr;
+    } else {
+        return decodeDefinedPortRun<PORT_NUMBER>;
+    }
+}
+
+/**
+ * @brief Generate the run decoder table from PORT_TABLE, so every defined port gets a specialised run decoder.
+ * @return Run decoder table.
+ */
+template <size_t... PORT_NUMBERS>
+static constexpr portRunDecoderTable makePortRunDecoderTable(std::index_sequence<PORT_NUMBERS...>) {
+    return { { definedPortRunDecoder<PORT_NUMBERS>()... } };
+}
+
+static constexpr portRunDecoderTable PORT_RUN_DECODERS =
+    makePortRunDecoderTable(std::make_index_sequence<PORT_TABLE_SIZE>());
+
+/**
+ * @brief Checks every defined port has a specialised run decoder.
+ * @return True if they all do.
+ */
+static constexpr bool definedPortsHaveRunDecoders(void) {
+    for (const portSchema &port : DEFINED_PORTS) {
+        if (PORT_RUN_DECODERS.decoders[port.port_number] == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(definedPortsHaveRunDecoders(), "Every defined port must have a specialised run decoder.");
+
+/**
+ * @brief Get the run decoder specialised for a port.
+ * @param port_number Port number.
+ * @return The port's run decoder, or nullptr if the port isn't defined.
+ */
+static portRunDecoder getDefinedPortRunDecoder(uint8_t port_number) {
+    return (port_number < PORT_TABLE_SIZE) ? PORT_RUN_DECODERS.decoders[port_number] : nullptr;
+}
+
+/**
+ * @brief Decode a chunk of frames, splitting it into runs of frames on the same port.
+ * @param frames Start of each frame's record.
+ * @param first First frame of the chunk - a multiple of FRAMES_PER_WORD so no other chunk shares its bitmap words.
+ * @param last One past the last frame of the chunk.
+ * @param columns Columns to decode into.
+ */
+static void decodeChunk(const uint8_t *const *frames, size_t first, size_t last, sensorDataColumns *columns) {
+    size_t run_start = first;
+    while (run_start < last) {
+        uint8_t port_number = frames[run_start][0];
+        size_t run_end = run_start + 1;
+        while ((run_end < last) && (frames[run_end][0] == port_number)) {
+            run_end++;
+        }
+        portRunDecoder decode_run = getDefinedPortRunDecoder(port_number);
+        if (decode_run != nullptr) {
+            decode_run(frames, run_start, run_end, columns);
+        } else {
+            decodePortRun(getPort(port_number), frames, run_start, run_end, columns);
+        }
+        run_start = run_end;
+    }
+}
+
+/**
+ * @brief Frames of a batch being indexed, see decodeUplinkBatch().
+ */
+struct batchIndex {
+    std::vector<const uint8_t *> frames; /**< Start of each row's record. */
+    /** Records of rows that aren't in the record buffer: frames reassembled from fragments & the samples of
+     * multi-sample frames. Their rows only point into it once it's done growing. */
+    std::vector<uint8_t> rebuilt;
+    std::vector<std::pair<size_t, size_t>> rebuilt_rows; /**< Row & offset in rebuilt of each rebuilt record. */
+    std::vector<uint8_t> sample_payloads;                /**< Samples of a multi-sample frame. */
+
+    /**
+     * @brief Add a row that isn't in the record buffer.
+     * @param port Port number of the row.
+     * @param payload Payload of the row.
+     * @param len Length of the payload.
+     */
+    void addRebuilt(uint8_t port, const uint8_t *payload, uint8_t len) {
+        rebuilt_rows.emplace_back(frames.size(), rebuilt.size());
+        frames.push_back(nullptr);
+        appendUplinkRecord(&rebuilt, port, payload, len);
+    }
+};
+
+/**
+ * @brief Index a frame of a batch: add it as a row, add its samples as rows, or decode it as a span report.
+ * @param record The frame's record.
+ * @param in_records True if the record is in the record buffer, so its row can point to it.
+ * @param index Index to add the frame to.
+ * @param columns Columns to decode span reports into.
+ * @param result Counts of the frames that aren't rows.
+ */
+static void indexFrame(const uint8_t *record, bool in_records, batchIndex *index, sensorDataColumns *columns,
+                       batchDecodeResult *result) {
+    const uint8_t port_number = record[0];
+    const uint8_t *payload = &record[UPLINK_RECORD_HEADER_SIZE];
+    const uint8_t len = record[1];
+    if (port_number == DIAGNOSTICS_PORT) {
+        spanStats stats[(uint8_t)SPAN::N_SPANS] = {};
+        if (decodeSpanReport(payload, len, stats, (uint8_t)SPAN::N_SPANS) == 0) {
+            result->n_invalid++;
+            return;
+        }
+        result->n_span_reports++;
+        spanReportColumns &reports = columns->span_reports;
+        reports.n_reports++;
+        reports.row.push_back(index->frames.size());
+        for (uint8_t s = 0; s < (uint8_t)SPAN::N_SPANS; s++) {
+            reports.spans[s].push_back(stats[s]);
+        }
+    } else if ((port_number >= SYSTEM_PORT_FIRST) && (port_number <= SYSTEM_PORT_LAST)) {
+        result->n_skipped++;
+    } else if (!(getMultiSamplePort(port_number) == PORTERROR)) {
+        const portSchema &port = getMultiSamplePort(port_number);
+        const uint8_t sample_len = port.payloadLength();
+        index->sample_payloads.resize(MAX_FRAME_SAMPLES * sample_len);
+        uint8_t *samples = index->sample_payloads.data();
+        uint8_t n_samples = port.decodePayloadToPayloads(payload, len, samples, MAX_FRAME_SAMPLES);
+        if (n_samples == 0) {
+            result->n_invalid++;
+            return;
+        }
+        result->n_multi_sample_frames++;
+        for (uint8_t s = 0; s < n_samples; s++) {
+            index->addRebuilt(port.port_number, &samples[s * sample_len], sample_len);
+        }
+    } else if (in_records) {
+        index->frames.push_back(record);
+    } else {
+        index->addRebuilt(port_number, payload, len);
+    }
+}
+
+batchDecodeResult decodeUplinkBatch(const uint8_t *records, size_t len, sensorDataColumns *columns,
+                                    unsigned n_threads) {
+    batchDecodeResult result = {};
+    columns->span_reports.clear();
+
+    // Index the records, as each frame's position depends on the length of every frame before it
+    batchIndex index;
+    index.frames.reserve(len / (UPLINK_RECORD_HEADER_SIZE + 2));
+    fragmentReassembler reassembler;
+    uint8_t reassembled[UPLINK_RECORD_HEADER_SIZE + UINT8_MAX] = {};
+    size_t pos = 0;
+    while ((pos + UPLINK_RECORD_HEADER_SIZE) <= len) {
+        size_t record_len = UPLINK_RECORD_HEADER_SIZE + records[pos + 1];
+        if ((pos + record_len) > len) {
+            break;
+        }
+        if (records[pos] == FRAGMENT_PORT) {
+            result.n_fragments++;
+            if (reassembler.addFragment(&records[pos + UPLINK_RECORD_HEADER_SIZE], records[pos + 1])) {
+                reassembled[0] = reassembler.port();
+                reassembled[1] = reassembler.length();
+                memcpy(&reassembled[UPLINK_RECORD_HEADER_SIZE], reassembler.payload(), reassembler.length());
+                indexFrame(reassembled, false, &index, columns, &result);
+            }
+        } else {
+            indexFrame(&records[pos], true, &index, columns, &result);
+        }
+        pos += record_len;
+    }
+    for (const auto &rebuilt_row : index.rebuilt_rows) {
+        index.frames[rebuilt_row.first] = &index.rebuilt[rebuilt_row.second];
+    }
+    std::vector<const uint8_t *> &frames = index.frames;
+    result.n_frames = frames.size();
+    result.dropped_fragments = reassembler.droppedFragments();
+    result.bytes_used = pos;
+    result.truncated = (pos < len);
+
+    columns->reset(result.n_frames);
+
+    // Split the frames into chunks of whole bitmap words, one per thread
+    size_t n_words = (result.n_frames + FRAMES_PER_WORD - 1) / FRAMES_PER_WORD;
+    if (n_threads == 0) {
+        n_threads = std::thread::hardware_concurrency();
+    }
+    size_t max_threads = (n_words + MIN_WORDS_PER_THREAD - 1) / MIN_WORDS_PER_THREAD;
+    if (n_threads > max_threads) {
+        n_threads = (unsigned)max_threads;
+    }
+    if (n_threads == 0) {
+        n_threads = 1;
+    }
+    size_t frames_per_chunk = ((n_words + n_threads - 1) / n_threads) * FRAMES_PER_WORD;
+
+    std::vector<std::thread> workers;
+    size_t first = 0;
+    for (unsigned t = 1; (t < n_threads) && (first < result.n_frames); t++) {
+        size_t last = (first + frames_per_chunk < result.n_frames) ? (first + frames_per_chunk) : result.n_frames;
+        workers.emplace_back(decodeChunk, frames.data(), first, last, columns);
+        first = last;
+    }
+    // the calling thread decodes the last chunk
+    decodeChunk(frames.data(), first, result.n_frames, columns);
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return result;
+}
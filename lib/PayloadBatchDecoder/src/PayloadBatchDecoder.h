@@ -0,0 +1,130 @@
+#ifndef PAYLOAD_BATCH_DECODER_H
+#define PAYLOAD_BATCH_DECODER_H
+
+/**
+ * @file PayloadBatchDecoder.h
+ * @author Kalina Knight
+ * @brief Server-side decoder for batches of PortSchema uplinks.
+ * Decodes a buffer of (port, length, payload) records into one array per sensor field plus a validity bitmap per
+ * field, splitting the batch across threads. Multi-sample frames get a row per sample, and span reports columns of
+ * their own.
+ *
+ * Every field is decoded with the same fieldCodec the firmware encodes with, so the values are bit-for-bit the same as
+ * portSchema::decodePayloadToSensorData() gives frame by frame.
+ *
+ * @version 0.1
+ * @date 2022-02-17
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "PayloadFragments.h" /**< Frames sent in fragments on FRAGMENT_PORT. */
+#include "PortSchema.h"       /**< Go here to see existing and define new sensor/port schemas. */
+#include "SpanReport.h"       /**< Span reports sent on DIAGNOSTICS_PORT. */
+
+#define UPLINK_RECORD_HEADER_SIZE 2   /**< Each record is: port (1 byte), payload length (1 byte), payload. */
+#define SYSTEM_PORT_FIRST         200 /**< First port of the custom system/control messages, which aren't samples. */
+#define SYSTEM_PORT_LAST          222 /**< Last port of the custom system/control messages. */
+
+/**
+ * @brief Span reports decoded from a batch of uplinks, stored as a column per span.
+ * Entry i of every column belongs to report i of the batch. Spans a report doesn't have (e.g. from older firmware) are
+ * 0.
+ */
+struct spanReportColumns {
+    size_t n_reports = 0;                                 /**< Number of reports decoded. */
+    std::vector<size_t> row;                              /**< Sensor data rows before the report in the batch. */
+    std::vector<spanStats> spans[(uint8_t)SPAN::N_SPANS]; /**< Times of each SPAN. */
+
+    /**
+     * @brief Remove every report.
+     */
+    void clear(void);
+};
+
+/**
+ * @brief Sensor data decoded from a batch of uplinks, stored as a column per sensor field.
+ * Entry i of every column belongs to row i of the batch: a frame, or a sample of a multi-sample frame. Fields a row
+ * doesn't include, or that are invalid, are 0 with their validity bit cleared - the same as the sensorData given by
+ * portSchema::decodePayloadToSensorData() (or decodePayloadToSamples()).
+ */
+struct sensorDataColumns {
+    size_t n_frames = 0;              /**< Number of rows decoded. */
+    std::vector<uint8_t> port;        /**< Port number of each row (the samples' port for a multi-sample frame). */
+    std::vector<float> battery_mv;    /**< Battery mV. */
+    std::vector<float> temperature;   /**< Temperature: degrees C. */
+    std::vector<float> humidity;      /**< Relative humidity: %. */
+    std::vector<uint32_t> pressure;   /**< Air pressure: Pa. */
+    std::vector<uint32_t> gas_resist; /**< Gas Resistance doesn't have units. */
+    std::vector<float> latitude;      /**< Location latitude in degrees. */
+    std::vector<float> longitude;     /**< Location longitude in degrees. */
+    std::vector<float> analog_mv;     /**< Analog sensor mV. */
+    std::vector<uint32_t> timestamp;  /**< When the sample was taken: Unix time in s. */
+    /** Validity bitmap of each SENSOR_FIELD: bit (i % 64) of word (i / 64) is set if frame i's field is valid. */
+    std::vector<uint64_t> validity[MAX_PORT_FIELDS];
+    spanReportColumns span_reports; /**< Span reports in the batch. */
+
+    /**
+     * @brief Check if a frame's field was included in the payload and is valid.
+     * @param field Sensor field.
+     * @param frame Frame index in the batch.
+     * @return True if it's valid, false if not.
+     */
+    bool isValid(SENSOR_FIELD field, size_t frame) const {
+        return ((validity[(uint8_t)field][frame / 64] >> (frame % 64)) & 1);
+    };
+
+    /**
+     * @brief Clear and size every sensor data column for n rows. The span reports are left as they are.
+     * @param n Number of rows.
+     */
+    void reset(size_t n);
+};
+
+/** @brief Outcome of decoding a batch. */
+struct batchDecodeResult {
+    size_t n_frames;              /**< Number of rows decoded, including frames reassembled from fragments. */
+    size_t bytes_used;            /**< Bytes of the record buffer that were decoded. */
+    bool truncated;               /**< True if the buffer ended part way through a record, which was not decoded. */
+    size_t n_fragments;           /**< Number of fragment records (on FRAGMENT_PORT). */
+    size_t dropped_fragments;     /**< Fragments of frames that couldn't be reassembled, e.g. one was lost. */
+    size_t n_multi_sample_frames; /**< Multi-sample frames, each decoded into a row per sample. */
+    size_t n_span_reports;        /**< Span reports (on DIAGNOSTICS_PORT), decoded into the span_reports columns. */
+    size_t n_skipped;             /**< Other system/control messages, e.g. clock sync requests, which aren't decoded. */
+    size_t n_invalid;             /**< Multi-sample frames & span reports that couldn't be decoded, e.g. too short. */
+};
+
+/**
+ * @brief Append an uplink record to a batch record buffer.
+ * @param records Record buffer to append to.
+ * @param port Port number of the uplink.
+ * @param payload Uplink payload.
+ * @param len Length of the payload.
+ */
+void appendUplinkRecord(std::vector<uint8_t> *records, uint8_t port, const uint8_t *payload, uint8_t len);
+
+/**
+ * @brief Decode a batch of uplink records into columns.
+ * @details The records are indexed in one pass, which also reassembles frames sent in fragments (PayloadFragments.h):
+ * a reassembled frame is decoded in place of its last fragment, so the batch must be one device's uplinks in the
+ * order they were sent. A multi-sample frame (on port + MULTI_SAMPLE_PORT_OFFSET) is split back into its samples'
+ * payloads, each decoded as a row on the samples' port, and span reports (on DIAGNOSTICS_PORT) are decoded into the
+ * span_reports columns. Other system/control messages (ports SYSTEM_PORT_FIRST - SYSTEM_PORT_LAST) are skipped. The
+ * rows are then split into chunks of whole bitmap words (multiples of 64 rows) that are decoded in parallel, so
+ * threads never share a bitmap word. Within a chunk each run of rows on the same port is decoded together: the port is
+ * looked up once per run, then every row in the run is decoded by a decoder specialised for that port, with its encode
+ * plan unrolled at compile time.
+ * @param records Record buffer: back to back records of port (1 byte), payload length (1 byte), payload.
+ * @param len Length of the record buffer.
+ * @param columns Columns to decode into. They're resized to the number of rows.
+ * @param n_threads Number of threads to decode with. 0 uses one per hardware thread.
+ * @return Number of rows & bytes decoded, if the buffer was truncated, and the frames that weren't rows.
+ */
+batchDecodeResult decodeUplinkBatch(const uint8_t *records, size_t len, sensorDataColumns *columns,
+                                    unsigned n_threads = 0);
+
+#endif // PAYLOAD_BATCH_DECODER_H
@@ -29,7 +29,7 @@ portSchema port_list[PORT_LIST_LENGTH] = {
 uint8_t p;
 
 // fill with fake data, making sure to set the validity flag to true
-sensorData sensor_data = { 1, true, 2, true, 3, true, 4, true, 5, true, 6, 7, true };
+sensorData sensor_data = { 1, true, 2, true, 3, true, 4, true, 5, true, 6, 7, true, 8, true, 9, true };
 
 // Sensor reading interval in [ms] = 30 seconds.
 const int encoding_interval = 30000;
@@ -47,7 +47,7 @@ void fillPayload(void);
 void setup() {
     // initialise the logging module - function does nothing if APP_LOG_LEVEL in Logging.h = NONE
     initLogging();
-    log(LOG_LEVEL::INFO,
+    LOG(LOG_LEVEL::INFO,
         "\n======================================"
         "\nWelcome to Port Schema LoRaWAN Example"
         "\n======================================");
@@ -70,10 +70,10 @@ void loop() {
     // every encoding_interval ms check if connected and then send sensor payload
     delay(encoding_interval);
     if (isLoRaWANConnected()) {
-        log(LOG_LEVEL::DEBUG, "Send payload");
+        LOG(LOG_LEVEL::DEBUG, "Send payload");
         if (p == 0) {
             // log sensor data
-            log(LOG_LEVEL::INFO,
+            LOG(LOG_LEVEL::INFO,
                 "Sensor Data: {b: %.2f mV | t: %.2f C | h: %.2f %% | p: %lu Pa | g: %lu | l: %.5f, %.5f}",
                 sensor_data.battery_mv.value, sensor_data.temperature.value, sensor_data.humidity.value,
                 sensor_data.pressure.value, sensor_data.gas_resist.value, sensor_data.location.latitude,
@@ -86,7 +86,7 @@ void loop() {
         // send data
         sendLoRaWANFrame(&lorawan_payload);
     } else {
-        log(LOG_LEVEL::DEBUG, "LoRaWAN not connected. Try again later.");
+        LOG(LOG_LEVEL::DEBUG, "LoRaWAN not connected. Try again later.");
     }
 }
 
@@ -111,5 +111,5 @@ void fillPayload(void) {
     for (int b = 0; b < lorawan_payload.buffsize; b++) {
         snprintf(encoded_payload_bytes, sizeof(encoded_payload_bytes), "%s%02X ", encoded_payload_bytes, payload_buffer[b]);
     }
-    log(LOG_LEVEL::INFO, "Port: %2.d | Payload: %s", lorawan_payload.port, encoded_payload_bytes);
+    LOG(LOG_LEVEL::INFO, "Port: %2.d | Payload: %s", lorawan_payload.port, encoded_payload_bytes);
 }
@@ -0,0 +1,165 @@
+#ifndef BIT_STREAM_H
+#define BIT_STREAM_H
+
+/**
+ * @file BitStream.h
+ * @author Kalina Knight
+ * @brief Writer & reader for packing values of any bit width (0-32) into a byte buffer, MSB first.
+ * The first value written starts at the MSB of buffer[0], so a stream of whole bytes is laid out exactly the same as
+ * the byte-aligned big-endian fields in SensorPortSchema.h.
+ *
+ * @version 0.1
+ * @date 2022-02-18
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+/** @brief Packs values of any bit width into a buffer, MSB first. */
+class bitWriter {
+  public:
+    /**
+     * @brief Start writing at the given bit of the buffer.
+     * @param buffer Buffer to write into. Bits after the write position are overwritten.
+     * @param len Length of the buffer in bytes.
+     * @param start_bit Bit to start writing at.
+     */
+    bitWriter(uint8_t *buffer, uint8_t len, uint16_t start_bit = 0)
+        : buffer(buffer), capacity((uint16_t)(len * 8)), pos(start_bit){};
+
+    /**
+     * @brief Write the lowest n_bits of value.
+     * @param value Value to write.
+     * @param n_bits Number of bits (0-32).
+     * @return True if successful. False if it didn't fit, in which case nothing is written.
+     */
+    bool write(uint32_t value, uint8_t n_bits) {
+        if ((pos + n_bits) > capacity) {
+            return false;
+        }
+        if (n_bits == 0) {
+            return true;
+        }
+        // The value spans at most 5 bytes, so it's merged into them as a single 64 bit window
+        uint8_t *bytes = &buffer[pos / 8];
+        uint8_t n_bytes = (uint8_t)(((pos % 8) + n_bits + 7) / 8);
+        uint8_t shift = (uint8_t)((n_bytes * 8) - (pos % 8) - n_bits);
+        uint64_t mask = (((uint64_t)1 << n_bits) - 1) << shift;
+        uint64_t window = 0;
+        for (uint8_t i = 0; i < n_bytes; i++) {
+            window = (window << 8) | bytes[i];
+        }
+        window = (window & ~mask) | (((uint64_t)value << shift) & mask);
+        for (uint8_t i = n_bytes; i > 0; i--) {
+            bytes[i - 1] = (uint8_t)window;
+            window >>= 8;
+        }
+        pos += n_bits;
+        return true;
+    };
+
+    /**
+     * @brief Number of bits written, including start_bit.
+     * @return Bit position.
+     */
+    uint16_t bitLength(void) const { return pos; };
+
+    /**
+     * @brief Number of bytes used, including the last partially written byte.
+     * @return Length in bytes.
+     */
+    uint8_t byteLength(void) const { return (uint8_t)((pos + 7) / 8); };
+
+  private:
+    uint8_t *buffer;
+    uint16_t capacity; /**< Bits in the buffer. */
+    uint16_t pos;      /**< Next bit to write. */
+};
+
+/** @brief Unpacks values of any bit width from a buffer, MSB first. */
+class bitReader {
+  public:
+    /**
+     * @brief Start reading at the given bit of the buffer.
+     * @param buffer Buffer to read from.
+     * @param len Length of the buffer in bytes.
+     * @param start_bit Bit to start reading at.
+     */
+    bitReader(const uint8_t *buffer, uint8_t len, uint16_t start_bit = 0)
+        : buffer(buffer), capacity((uint16_t)(len * 8)), pos(start_bit){};
+
+    /**
+     * @brief Read an n_bits wide value.
+     * @param value Value read, zero extended.
+     * @param n_bits Number of bits (0-32).
+     * @return True if successful. False if the buffer doesn't have n_bits left, in which case nothing is read.
+     */
+    bool read(uint32_t *value, uint8_t n_bits) {
+        if ((pos + n_bits) > capacity) {
+            return false;
+        }
+        if (n_bits == 0) {
+            *value = 0;
+            return true;
+        }
+        // The value spans at most 5 bytes, so they're read into a single 64 bit window
+        const uint8_t *bytes = &buffer[pos / 8];
+        uint8_t n_bytes = (uint8_t)(((pos % 8) + n_bits + 7) / 8);
+        uint8_t shift = (uint8_t)((n_bytes * 8) - (pos % 8) - n_bits);
+        uint64_t window = 0;
+        for (uint8_t i = 0; i < n_bytes; i++) {
+            window = (window << 8) | bytes[i];
+        }
+        *value = (uint32_t)((window >> shift) & (((uint64_t)1 << n_bits) - 1));
+        pos += n_bits;
+        return true;
+    };
+
+    /**
+     * @brief Number of bits read, including start_bit.
+     * @return Bit position.
+     */
+    uint16_t bitPosition(void) const { return pos; };
+
+    /**
+     * @brief Number of bits left to read.
+     * @return Bits left.
+     */
+    uint16_t bitsLeft(void) const { return (capacity - pos); };
+
+  private:
+    const uint8_t *buffer;
+    uint16_t capacity; /**< Bits in the buffer. */
+    uint16_t pos;      /**< Next bit to read. */
+};
+
+/**
+ * @brief Map a signed value to unsigned so small magnitudes of either sign have few significant bits (zigzag encoding):
+ * 0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3, ...
+ * @param value Signed value.
+ * @return Zigzag encoded value.
+ */
+constexpr uint32_t zigzagEncode(int32_t value) {
+    return (((uint32_t)value << 1) ^ (uint32_t)(value < 0 ? -1 : 0));
+}
+
+/**
+ * @brief Reverse zigzagEncode().
+ * @param value Zigzag encoded value.
+ * @return Signed value.
+ */
+constexpr int32_t zigzagDecode(uint32_t value) {
+    return (int32_t)((value >> 1) ^ (0U - (value & 1)));
+}
+
+/**
+ * @brief Number of significant bits in a value i.e. the width needed to write it.
+ * @param value Value.
+ * @return Bits needed (0 for 0).
+ */
+constexpr uint8_t bitWidth(uint32_t value) {
+    return (value == 0) ? 0 : (uint8_t)(32 - __builtin_clz(value));
+}
+
+#endif // BIT_STREAM_H
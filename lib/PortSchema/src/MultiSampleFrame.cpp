@@ -0,0 +1,274 @@
+#include "BitStream.h"
+#include "PortSchema.h"
+
+#include <string.h>
+
+/**
+ * @brief Read the raw (unscaled, not sign extended) bits of a field.
+ * @param payload Single sample payload to read the field from.
+ * @param field Where the field is in the payload.
+ * @return Field bits.
+ */
+static uint32_t readFieldBits(const uint8_t *payload, const portFieldPlan &field) {
+    uint32_t bits = 0;
+    bitReader reader(payload, PAYLOAD_BUFFER_SIZE, field.bit_offset);
+    reader.read(&bits, field.n_bits);
+    return bits;
+}
+
+/**
+ * @brief Write the raw bits of a field.
+ * @param bits Field bits.
+ * @param payload Single sample payload to write the field to.
+ * @param field Where the field is in the payload.
+ */
+static void writeFieldBits(uint32_t bits, uint8_t *payload, const portFieldPlan &field) {
+    bitWriter writer(payload, PAYLOAD_BUFFER_SIZE, field.bit_offset);
+    writer.write(bits, field.n_bits);
+}
+
+/**
+ * @brief Zigzag encoded difference between two values of a field.
+ * The difference wraps around at the field width, so it never needs more bits than the field itself.
+ * @param previous Previous field bits.
+ * @param current Current field bits.
+ * @param n_bits Width of the field in bits.
+ * @return Zigzag encoded difference.
+ */
+static uint32_t fieldDelta(uint32_t previous, uint32_t current, uint8_t n_bits) {
+    uint32_t mask = (UINT32_MAX >> (32 - n_bits));
+    uint32_t sign_bit = ((mask >> 1) + 1);
+    uint32_t difference = ((current - previous) & mask);
+    return zigzagEncode((int32_t)((difference ^ sign_bit) - sign_bit));
+}
+
+/**
+ * @brief Reverse fieldDelta().
+ * @param previous Previous field bits.
+ * @param delta Zigzag encoded difference.
+ * @param n_bits Width of the field in bits.
+ * @return Current field bits.
+ */
+static uint32_t applyFieldDelta(uint32_t previous, uint32_t delta, uint8_t n_bits) {
+    uint32_t mask = (UINT32_MAX >> (32 - n_bits));
+    return ((previous + (uint32_t)zigzagDecode(delta)) & mask);
+}
+
+/**
+ * @brief Find the timestamp in a port's plan, as its deltas are sent relative to the frame's base interval.
+ * @param plan Encoding plan of the port.
+ * @return The timestamp field, or nullptr if the port doesn't send one.
+ */
+static const portFieldPlan *findTimestampField(const portEncodePlan &plan) {
+    for (uint8_t f = 0; f < plan.n_fields; f++) {
+        if (plan.fields[f].field == SENSOR_FIELD::TIMESTAMP) {
+            return &plan.fields[f];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief The bits a field's delta is taken from: the previous sample's, plus the base interval for the timestamp.
+ * @param previous Previous single sample payload.
+ * @param field Where the field is in the payload.
+ * @param base_interval Base interval of the frame's timestamps.
+ * @return Field bits, not masked to the field width (fieldDelta() & applyFieldDelta() wrap around anyway).
+ */
+static uint32_t deltaReference(const uint8_t *previous, const portFieldPlan &field, int32_t base_interval) {
+    uint32_t bits = readFieldBits(previous, field);
+    if (field.field == SENSOR_FIELD::TIMESTAMP) {
+        bits += (uint32_t)base_interval;
+    }
+    return bits;
+}
+
+/**
+ * @brief Encode a multi-sample frame, see portSchema::encodeSamplesToPayload().
+ * @tparam GET_SAMPLE Callable as getSample(uint8_t i, uint8_t *payload), which writes the single sample payload of
+ * sample i (encoded by the port) to payload.
+ * @param port Port the samples are encoded by.
+ * @param getSample Gets the encoded samples.
+ * @param n_samples Number of samples.
+ * @param payload_buffer Payload buffer for data to be written into.
+ * @param max_len Max length of the frame.
+ * @param n_encoded Number of samples encoded into the frame.
+ * @return Total length of data encoded to payload_buffer, 0 if not even the first sample fits.
+ */
+template <typename GET_SAMPLE>
+static uint8_t encodeFrame(const portSchema &port, GET_SAMPLE getSample, uint8_t n_samples, uint8_t *payload_buffer,
+                           uint8_t max_len, uint8_t *n_encoded) {
+    const portEncodePlan &plan = port.plan;
+    *n_encoded = 0;
+    const uint8_t first_sample_end = 1 + plan.length; // sample count + first sample
+    if ((n_samples == 0) || (first_sample_end > max_len)) {
+        return 0;
+    }
+
+    uint8_t previous[PAYLOAD_BUFFER_SIZE] = {};
+    uint8_t current[PAYLOAD_BUFFER_SIZE] = {};
+    uint8_t widths[MAX_PORT_FIELDS] = {};
+
+    // The timestamp's base interval is set by the first two samples, and is only sent if there's more than one
+    uint16_t header_bits = (first_sample_end * 8) + (plan.n_fields * MULTI_SAMPLE_WIDTH_BITS);
+    const portFieldPlan *timestamp_field = findTimestampField(plan);
+    uint32_t base_interval = 0; // zigzag encoded
+    getSample(0, previous);
+    if ((timestamp_field != nullptr) && (n_samples > 1)) {
+        getSample(1, current);
+        base_interval = fieldDelta(readFieldBits(previous, *timestamp_field), readFieldBits(current, *timestamp_field),
+                                   timestamp_field->n_bits);
+        header_bits += MULTI_SAMPLE_WIDTH_BITS + bitWidth(base_interval);
+    }
+
+    /* Work out how many samples fit: each sample adds the sum of the field widths, but a sample that needs a wider
+     * field than the samples before it also widens that field for every sample already in the frame. */
+    uint8_t n = 1;
+    for (; (n < n_samples) && (n < MAX_FRAME_SAMPLES); n++) {
+        getSample(n, current);
+        uint8_t new_widths[MAX_PORT_FIELDS] = {};
+        uint16_t sample_bits = 0;
+        for (uint8_t f = 0; f < plan.n_fields; f++) {
+            const portFieldPlan &field = plan.fields[f];
+            uint8_t width = bitWidth(fieldDelta(deltaReference(previous, field, zigzagDecode(base_interval)),
+                                                readFieldBits(current, field), field.n_bits));
+            new_widths[f] = (width > widths[f]) ? width : widths[f];
+            sample_bits += new_widths[f];
+        }
+        if (((header_bits + (uint32_t)n * sample_bits + 7) / 8) > max_len) {
+            break;
+        }
+        memcpy(widths, new_widths, sizeof(widths));
+        memcpy(previous, current, plan.length);
+    }
+
+    // Write the frame
+    payload_buffer[0] = n;
+    getSample(0, &payload_buffer[1]);
+    *n_encoded = n;
+    if (n == 1) {
+        return first_sample_end;
+    }
+
+    memset(&payload_buffer[first_sample_end], 0, max_len - first_sample_end);
+    bitWriter writer(payload_buffer, max_len, first_sample_end * 8);
+    for (uint8_t f = 0; f < plan.n_fields; f++) {
+        writer.write(widths[f], MULTI_SAMPLE_WIDTH_BITS);
+    }
+    if (timestamp_field != nullptr) {
+        writer.write(bitWidth(base_interval), MULTI_SAMPLE_WIDTH_BITS);
+        writer.write(base_interval, bitWidth(base_interval));
+    }
+    memcpy(previous, &payload_buffer[1], plan.length);
+    for (uint8_t s = 1; s < n; s++) {
+        getSample(s, current);
+        for (uint8_t f = 0; f < plan.n_fields; f++) {
+            const portFieldPlan &field = plan.fields[f];
+            writer.write(fieldDelta(deltaReference(previous, field, zigzagDecode(base_interval)),
+                                    readFieldBits(current, field), field.n_bits),
+                         widths[f]);
+        }
+        memcpy(previous, current, plan.length);
+    }
+    return writer.byteLength();
+}
+
+uint8_t portSchema::encodeSamplesToPayload(const sensorData *samples, uint8_t n_samples, uint8_t *payload_buffer,
+                                           uint8_t max_len, uint8_t *n_encoded) const {
+    auto getSample = [&](uint8_t i, uint8_t *payload) { encodeSensorDataToPayload(&samples[i], payload); };
+    return encodeFrame(*this, getSample, n_samples, payload_buffer, max_len, n_encoded);
+}
+
+uint8_t portSchema::encodePayloadsToPayload(const uint8_t *payloads, uint8_t n_samples, uint8_t *payload_buffer,
+                                            uint8_t max_len, uint8_t *n_encoded) const {
+    auto getSample = [&](uint8_t i, uint8_t *payload) { memcpy(payload, &payloads[i * plan.length], plan.length); };
+    return encodeFrame(*this, getSample, n_samples, payload_buffer, max_len, n_encoded);
+}
+
+/**
+ * @brief Decode a multi-sample frame, see portSchema::decodePayloadToSamples().
+ * @tparam PUT_SAMPLE Callable as putSample(uint8_t i, const uint8_t *payload), which is given the single sample
+ * payload of sample i (encoded by the port).
+ * @param port Port the samples are encoded by.
+ * @param buffer Payload buffer to be decoded.
+ * @param len Length of payload buffer.
+ * @param putSample Takes the decoded samples.
+ * @param max_samples Max number of samples to decode.
+ * @return Number of samples decoded, 0 if the frame is invalid.
+ */
+template <typename PUT_SAMPLE>
+static uint8_t decodeFrame(const portSchema &port, const uint8_t *buffer, uint8_t len, PUT_SAMPLE putSample,
+                           uint8_t max_samples) {
+    const portEncodePlan &plan = port.plan;
+    const uint8_t first_sample_end = 1 + plan.length;
+    if ((len < first_sample_end) || (buffer[0] == 0) || (max_samples == 0)) {
+        return 0;
+    }
+    uint8_t n = (buffer[0] < max_samples) ? buffer[0] : max_samples;
+
+    // Each sample is rebuilt as a single sample payload
+    uint8_t sample_payload[PAYLOAD_BUFFER_SIZE] = {};
+    memcpy(sample_payload, &buffer[1], plan.length);
+    putSample(0, sample_payload);
+    if (n == 1) {
+        return 1;
+    }
+
+    bitReader reader(buffer, len, first_sample_end * 8);
+    uint8_t widths[MAX_PORT_FIELDS] = {};
+    for (uint8_t f = 0; f < plan.n_fields; f++) {
+        uint32_t width = 0;
+        if (!reader.read(&width, MULTI_SAMPLE_WIDTH_BITS) || (width > 32)) {
+            return 1;
+        }
+        widths[f] = (uint8_t)width;
+    }
+    uint32_t base_interval = 0;
+    if (findTimestampField(plan) != nullptr) {
+        uint32_t width = 0;
+        if (!reader.read(&width, MULTI_SAMPLE_WIDTH_BITS) || (width > 32) ||
+            !reader.read(&base_interval, (uint8_t)width)) {
+            return 1;
+        }
+    }
+
+    for (uint8_t s = 1; s < n; s++) {
+        for (uint8_t f = 0; f < plan.n_fields; f++) {
+            const portFieldPlan &field = plan.fields[f];
+            uint32_t delta = 0;
+            if (!reader.read(&delta, widths[f])) {
+                // the frame is shorter than its sample count says
+                return s;
+            }
+            writeFieldBits(applyFieldDelta(deltaReference(sample_payload, field, zigzagDecode(base_interval)), delta,
+                                           field.n_bits),
+                           sample_payload, field);
+        }
+        putSample(s, sample_payload);
+    }
+    return n;
+}
+
+uint8_t portSchema::decodePayloadToSamples(const uint8_t *buffer, uint8_t len, sensorData *samples,
+                                           uint8_t max_samples) const {
+    // decoded just like a single sample payload
+    auto putSample = [&](uint8_t i, const uint8_t *payload) {
+        samples[i] = decodePayloadToSensorData(payload, plan.length);
+    };
+    return decodeFrame(*this, buffer, len, putSample, max_samples);
+}
+
+uint8_t portSchema::decodePayloadToPayloads(const uint8_t *buffer, uint8_t len, uint8_t *payloads,
+                                            uint8_t max_samples) const {
+    auto putSample = [&](uint8_t i, const uint8_t *payload) {
+        memcpy(&payloads[i * plan.length], payload, plan.length);
+    };
+    return decodeFrame(*this, buffer, len, putSample, max_samples);
+}
+
+const portSchema &getMultiSamplePort(uint8_t port_number) {
+    if (port_number < MULTI_SAMPLE_PORT_OFFSET) {
+        return PORTERROR;
+    }
+    return getPort(port_number - MULTI_SAMPLE_PORT_OFFSET);
+}
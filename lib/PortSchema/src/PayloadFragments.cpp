@@ -0,0 +1,88 @@
+#include "PayloadFragments.h"
+
+#include <string.h>
+
+#define FRAGMENT_LAST_FLAG  0x08 /**< Set in the header of the last fragment of a frame. */
+#define FRAGMENT_INDEX_MASK 0x07
+
+uint8_t fragmentCount(uint8_t len, uint8_t max_len) {
+    if (len <= max_len) {
+        return 1;
+    }
+    if ((len > PAYLOAD_BUFFER_SIZE) || (max_len <= FIRST_FRAGMENT_HEADER_LENGTH)) {
+        return 0;
+    }
+    // the first fragment also carries the port
+    uint8_t first_data_len = max_len - FIRST_FRAGMENT_HEADER_LENGTH;
+    uint8_t data_len = max_len - FRAGMENT_HEADER_LENGTH;
+    uint16_t n_fragments = 1 + ((len - first_data_len) + data_len - 1) / data_len;
+    return (n_fragments <= MAX_FRAGMENTS) ? (uint8_t)n_fragments : 0;
+}
+
+uint8_t encodeFragment(const uint8_t *payload, uint8_t len, uint8_t port, uint8_t frame_id, uint8_t index,
+                       uint8_t max_len, uint8_t *fragment) {
+    uint8_t n_fragments = fragmentCount(len, max_len);
+    if ((index >= n_fragments) || (max_len <= FIRST_FRAGMENT_HEADER_LENGTH)) {
+        return 0;
+    }
+    uint8_t header_len = FRAGMENT_HEADER_LENGTH;
+    uint8_t offset = 0;
+    if (index == 0) {
+        header_len = FIRST_FRAGMENT_HEADER_LENGTH;
+        fragment[1] = port;
+    } else {
+        offset = (max_len - FIRST_FRAGMENT_HEADER_LENGTH) + (index - 1) * (max_len - FRAGMENT_HEADER_LENGTH);
+    }
+    uint8_t data_len = len - offset;
+    if (data_len > (max_len - header_len)) {
+        data_len = max_len - header_len;
+    }
+    fragment[0] = (uint8_t)((frame_id << 4) | ((index == (n_fragments - 1)) ? FRAGMENT_LAST_FLAG : 0) | index);
+    memcpy(&fragment[header_len], &payload[offset], data_len);
+    return header_len + data_len;
+}
+
+bool fragmentReassembler::addFragment(const uint8_t *fragment, uint8_t len) {
+    if (len < FRAGMENT_HEADER_LENGTH) {
+        dropped++;
+        return false;
+    }
+    uint8_t id = fragment[0] >> 4;
+    uint8_t index = fragment[0] & FRAGMENT_INDEX_MASK;
+    uint8_t header_len = FRAGMENT_HEADER_LENGTH;
+
+    if (index == 0) {
+        // a new frame, the rest of the last one is never coming
+        dropped += next_index;
+        next_index = 0;
+        if (len < FIRST_FRAGMENT_HEADER_LENGTH) {
+            dropped++;
+            return false;
+        }
+        header_len = FIRST_FRAGMENT_HEADER_LENGTH;
+        frame_id = id;
+        frame_port = fragment[1];
+        frame_len = 0;
+    } else if ((next_index == 0) || (id != frame_id) || (index != next_index)) {
+        // a fragment before it is missing, so the frame can't be reassembled
+        dropped += next_index + 1;
+        next_index = 0;
+        return false;
+    }
+
+    uint8_t data_len = len - header_len;
+    if ((frame_len + data_len) > PAYLOAD_BUFFER_SIZE) {
+        dropped += next_index + 1;
+        next_index = 0;
+        return false;
+    }
+    memcpy(&buffer[frame_len], &fragment[header_len], data_len);
+    frame_len += data_len;
+
+    if (fragment[0] & FRAGMENT_LAST_FLAG) {
+        next_index = 0;
+        return true;
+    }
+    next_index = index + 1;
+    return false;
+}
@@ -0,0 +1,96 @@
+#ifndef PAYLOAD_FRAGMENTS_H
+#define PAYLOAD_FRAGMENTS_H
+
+/**
+ * @file PayloadFragments.h
+ * @author Kalina Knight
+ * @brief Splits a frame that is too long for the current datarate into fragments, and reassembles them.
+ * Fragments are sent one per uplink on FRAGMENT_PORT, each with a 1 byte header: the frame id (4 bits), a last
+ * fragment flag (1 bit) & the fragment index (3 bits). The first fragment also carries the port of the whole frame:
+ *
+ *     | frame id << 4 | last << 3 | index | (index 0 only) port | data... |
+ *
+ * Every fragment but the last is the full max length, so the reassembler only needs them in order.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+#include "PortSchema.h"
+
+#define FRAGMENT_PORT                201 /**< Port the fragments are sent on, in the custom system/control range. */
+#define MAX_FRAGMENTS                8   /**< Max fragments of a frame, as the index is sent in 3 bits. */
+#define FRAGMENT_HEADER_LENGTH       1   /**< Frame id, last flag & index. */
+#define FIRST_FRAGMENT_HEADER_LENGTH 2   /**< The header plus the port of the whole frame. */
+
+/**
+ * @brief Number of fragments a frame needs.
+ * @param len Length of the frame.
+ * @param max_len Max length of each fragment e.g. the max payload of the current datarate.
+ * @return Number of fragments, 1 if the frame fits as it is. 0 if it can't be split into MAX_FRAGMENTS or fewer, or
+ * is longer than PAYLOAD_BUFFER_SIZE so it can't be reassembled.
+ */
+uint8_t fragmentCount(uint8_t len, uint8_t max_len);
+
+/**
+ * @brief Encode one fragment of a frame.
+ * @param payload The whole frame.
+ * @param len Length of the frame.
+ * @param port Port of the frame, sent in the first fragment.
+ * @param frame_id Id of the frame (0-15), the same for each of its fragments & different from the last frame's.
+ * @param index Index of the fragment to encode, from 0 to fragmentCount() - 1.
+ * @param max_len Max length of each fragment, the same for every fragment of the frame.
+ * @param fragment Buffer to encode the fragment into, at least max_len long.
+ * @return Length of the fragment, 0 if the index is out of range or the frame can't be split.
+ */
+uint8_t encodeFragment(const uint8_t *payload, uint8_t len, uint8_t port, uint8_t frame_id, uint8_t index,
+                       uint8_t max_len, uint8_t *fragment);
+
+/**
+ * @brief Reassembles the fragments of one device's frames, received in order.
+ * A missing fragment drops the rest of its frame, the next frame is reassembled as usual from its first fragment.
+ */
+class fragmentReassembler {
+  public:
+    /**
+     * @brief Add the next fragment received on FRAGMENT_PORT.
+     * @param fragment The fragment.
+     * @param len Length of the fragment.
+     * @return True once the frame is whole, see port(), payload() & length().
+     */
+    bool addFragment(const uint8_t *fragment, uint8_t len);
+
+    /**
+     * @brief Port of the frame reassembled by the last addFragment().
+     */
+    uint8_t port(void) const { return frame_port; };
+
+    /**
+     * @brief The frame reassembled by the last addFragment().
+     */
+    const uint8_t *payload(void) const { return buffer; };
+
+    /**
+     * @brief Length of the frame reassembled by the last addFragment().
+     */
+    uint8_t length(void) const { return frame_len; };
+
+    /**
+     * @brief Number of fragments dropped, as a fragment before them was missing or they were malformed.
+     */
+    uint32_t droppedFragments(void) const { return dropped; };
+
+  private:
+    uint8_t buffer[PAYLOAD_BUFFER_SIZE] = {};
+    uint8_t frame_port = 0;
+    uint8_t frame_len = 0;
+    uint8_t frame_id = 0;
+    uint8_t next_index = 0; /**< Index of the fragment expected next, 0 if waiting for a first fragment. */
+    uint32_t dropped = 0;
+};
+
+#endif // PAYLOAD_FRAGMENTS_H
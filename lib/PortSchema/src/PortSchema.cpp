@@ -1,155 +1,242 @@
 #include "PortSchema.h"
 
-uint8_t portSchema::encodeSensorDataToPayload(sensorData *sensor_data, uint8_t *payload_buffer, uint8_t start_pos) {
-    /* If the data should be included in the payload according to the portSchema, then encode the value.
-     * he order of these if statements is the order the sensor data will be encoded into the payload and should match
-     * the schema.
-     * The buffsize is increased by the amount of data encoded in each step.
-     */
-    uint8_t payload_length = start_pos;
-    if (sendBatteryVoltage) {
-        payload_length = batteryVoltageSchema.encodeData(
-            sensor_data->battery_mv.value, sensor_data->battery_mv.is_valid, payload_buffer, payload_length);
-    }
-    if (sendTemperature) {
-        payload_length = temperatureSchema.encodeData(sensor_data->temperature.value, sensor_data->temperature.is_valid,
-                                                      payload_buffer, payload_length);
-    }
-    if (sendRelativeHumidity) {
-        payload_length = relativeHumiditySchema.encodeData(sensor_data->humidity.value, sensor_data->humidity.is_valid,
-                                                           payload_buffer, payload_length);
+/**
+ * @brief Bit-pack the sensor data of a compact port into the payload.
+ * @param plan Encoding plan of the port.
+ * @param sensor_data Sensor data to be encoded.
+ * @param writer Bit stream to write the fields to.
+ */
+static void encodeCompactFields(const portEncodePlan &plan, const sensorData *sensor_data, bitWriter *writer) {
+    for (uint8_t f = 0; f < plan.n_fields; f++) {
+        switch (plan.fields[f].field) {
+            case SENSOR_FIELD::BATTERY_VOLTAGE:
+                fieldCodec<compactBatteryVoltageSchema>::encode(sensor_data->battery_mv.value,
+                                                                sensor_data->battery_mv.is_valid, writer);
+                break;
+            case SENSOR_FIELD::TEMPERATURE:
+                fieldCodec<compactTemperatureSchema>::encode(sensor_data->temperature.value,
+                                                             sensor_data->temperature.is_valid, writer);
+                break;
+            case SENSOR_FIELD::RELATIVE_HUMIDITY:
+                fieldCodec<compactRelativeHumiditySchema>::encode(sensor_data->humidity.value,
+                                                                  sensor_data->humidity.is_valid, writer);
+                break;
+            case SENSOR_FIELD::AIR_PRESSURE:
+                fieldCodec<compactAirPressureSchema>::encode(sensor_data->pressure.value,
+                                                             sensor_data->pressure.is_valid, writer);
+                break;
+            case SENSOR_FIELD::GAS_RESISTANCE:
+                fieldCodec<compactGasResistanceSchema>::encode(sensor_data->gas_resist.value,
+                                                               sensor_data->gas_resist.is_valid, writer);
+                break;
+            case SENSOR_FIELD::LATITUDE:
+                fieldCodec<compactLocationSchema>::encode(sensor_data->location.latitude,
+                                                          sensor_data->location.is_valid, writer);
+                break;
+            case SENSOR_FIELD::LONGITUDE:
+                fieldCodec<compactLocationSchema>::encode(sensor_data->location.longitude,
+                                                          sensor_data->location.is_valid, writer);
+                break;
+            case SENSOR_FIELD::ANALOG:
+                fieldCodec<compactAnalogSchema>::encode(sensor_data->analog_mv.value, sensor_data->analog_mv.is_valid,
+                                                        writer);
+                break;
+            case SENSOR_FIELD::TIMESTAMP:
+                fieldCodec<timestampSchema>::encode(sensor_data->timestamp.value, sensor_data->timestamp.is_valid,
+                                                    writer);
+                break;
+        }
     }
-    if (sendAirPressure) {
-        payload_length = airPressureSchema.encodeData(sensor_data->pressure.value, sensor_data->pressure.is_valid,
-                                                      payload_buffer, payload_length);
+}
+
+/**
+ * @brief Unpack the sensor data of a compact port from the payload.
+ * @param plan Encoding plan of the port.
+ * @param sensor_data Decoded sensor data.
+ * @param reader Bit stream to read the fields from.
+ */
+static void decodeCompactFields(const portEncodePlan &plan, sensorData *sensor_data, bitReader *reader) {
+    for (uint8_t f = 0; f < plan.n_fields; f++) {
+        if (reader->bitsLeft() < plan.fields[f].n_bits) {
+            // the rest of the fields are missing from the buffer
+            break;
+        }
+        switch (plan.fields[f].field) {
+            case SENSOR_FIELD::BATTERY_VOLTAGE:
+                fieldCodec<compactBatteryVoltageSchema>::decode(&sensor_data->battery_mv.value,
+                                                                &sensor_data->battery_mv.is_valid, reader);
+                break;
+            case SENSOR_FIELD::TEMPERATURE:
+                fieldCodec<compactTemperatureSchema>::decode(&sensor_data->temperature.value,
+                                                             &sensor_data->temperature.is_valid, reader);
+                break;
+            case SENSOR_FIELD::RELATIVE_HUMIDITY:
+                fieldCodec<compactRelativeHumiditySchema>::decode(&sensor_data->humidity.value,
+                                                                  &sensor_data->humidity.is_valid, reader);
+                break;
+            case SENSOR_FIELD::AIR_PRESSURE:
+                fieldCodec<compactAirPressureSchema>::decode(&sensor_data->pressure.value,
+                                                             &sensor_data->pressure.is_valid, reader);
+                break;
+            case SENSOR_FIELD::GAS_RESISTANCE:
+                fieldCodec<compactGasResistanceSchema>::decode(&sensor_data->gas_resist.value,
+                                                               &sensor_data->gas_resist.is_valid, reader);
+                break;
+            case SENSOR_FIELD::LATITUDE:
+                fieldCodec<compactLocationSchema>::decode(&sensor_data->location.latitude,
+                                                          &sensor_data->location.is_valid, reader);
+                break;
+            case SENSOR_FIELD::LONGITUDE:
+                fieldCodec<compactLocationSchema>::decode(&sensor_data->location.longitude,
+                                                          &sensor_data->location.is_valid, reader);
+                break;
+            case SENSOR_FIELD::ANALOG:
+                fieldCodec<compactAnalogSchema>::decode(&sensor_data->analog_mv.value,
+                                                        &sensor_data->analog_mv.is_valid, reader);
+                break;
+            case SENSOR_FIELD::TIMESTAMP:
+                fieldCodec<timestampSchema>::decode(&sensor_data->timestamp.value, &sensor_data->timestamp.is_valid,
+                                                    reader);
+                break;
+        }
     }
-    if (sendGasResistance) {
-        payload_length = gasResistanceSchema.encodeData(sensor_data->gas_resist.value, sensor_data->gas_resist.is_valid,
-                                                        payload_buffer, payload_length);
+}
+
+uint8_t portSchema::encodeSensorDataToPayload(const sensorData *sensor_data, uint8_t *payload_buffer, uint8_t start_pos) const {
+    /* The plan holds the fields to encode in the order they're placed in the payload, along with their offsets.
+     * It's generated from the port's SEND_* flags at compile time, so no flags need to be checked here.
+     */
+    if (plan.compact) {
+        bitWriter writer(&payload_buffer[start_pos], plan.length);
+        encodeCompactFields(plan, sensor_data, &writer);
+        writer.write(0, (uint8_t)((plan.length * 8) - plan.n_bits)); // pad the last byte
+        return (start_pos + plan.length);
     }
-    if (sendLocation) {
-        payload_length = locationSchema.encodeData(sensor_data->location.latitude, sensor_data->location.is_valid,
-                                                   payload_buffer, payload_length);
-        payload_length = locationSchema.encodeData(sensor_data->location.longitude, sensor_data->location.is_valid,
-                                                   payload_buffer, payload_length);
+
+    for (uint8_t f = 0; f < plan.n_fields; f++) {
+        uint8_t pos = start_pos + plan.fields[f].offset;
+        switch (plan.fields[f].field) {
+            case SENSOR_FIELD::BATTERY_VOLTAGE:
+                fieldCodec<batteryVoltageSchema>::encode(sensor_data->battery_mv.value,
+                                                         sensor_data->battery_mv.is_valid, payload_buffer, pos);
+                break;
+            case SENSOR_FIELD::TEMPERATURE:
+                fieldCodec<temperatureSchema>::encode(sensor_data->temperature.value,
+                                                      sensor_data->temperature.is_valid, payload_buffer, pos);
+                break;
+            case SENSOR_FIELD::RELATIVE_HUMIDITY:
+                fieldCodec<relativeHumiditySchema>::encode(sensor_data->humidity.value, sensor_data->humidity.is_valid,
+                                                           payload_buffer, pos);
+                break;
+            case SENSOR_FIELD::AIR_PRESSURE:
+                fieldCodec<airPressureSchema>::encode(sensor_data->pressure.value, sensor_data->pressure.is_valid,
+                                                      payload_buffer, pos);
+                break;
+            case SENSOR_FIELD::GAS_RESISTANCE:
+                fieldCodec<gasResistanceSchema>::encode(sensor_data->gas_resist.value,
+                                                        sensor_data->gas_resist.is_valid, payload_buffer, pos);
+                break;
+            case SENSOR_FIELD::LATITUDE:
+                fieldCodec<locationSchema>::encode(sensor_data->location.latitude, sensor_data->location.is_valid,
+                                                   payload_buffer, pos);
+                break;
+            case SENSOR_FIELD::LONGITUDE:
+                fieldCodec<locationSchema>::encode(sensor_data->location.longitude, sensor_data->location.is_valid,
+                                                   payload_buffer, pos);
+                break;
+            case SENSOR_FIELD::ANALOG:
+                fieldCodec<analogSchema>::encode(sensor_data->analog_mv.value, sensor_data->analog_mv.is_valid,
+                                                 payload_buffer, pos);
+                break;
+            case SENSOR_FIELD::TIMESTAMP:
+                fieldCodec<timestampSchema>::encode(sensor_data->timestamp.value, sensor_data->timestamp.is_valid,
+                                                    payload_buffer, pos);
+                break;
+        }
     }
-    return payload_length;
+    return (start_pos + plan.length);
 }
 
-sensorData portSchema::decodePayloadToSensorData(uint8_t *buffer, uint8_t len, uint8_t start_pos) {
+sensorData portSchema::decodePayloadToSensorData(const uint8_t *buffer, uint8_t len, uint8_t start_pos) const {
     sensorData sensor_data = {};
-    uint8_t buff_pos = start_pos;
 
-    if (sendBatteryVoltage && (buff_pos < len)) {
-        buff_pos = batteryVoltageSchema.decodeData(&sensor_data.battery_mv.value, &sensor_data.battery_mv.is_valid, buffer, buff_pos);
-    }
-    if (sendTemperature && (buff_pos < len)) {
-        buff_pos = temperatureSchema.decodeData(&sensor_data.temperature.value, &sensor_data.temperature.is_valid, buffer, buff_pos);
-    }
-    if (sendRelativeHumidity && (buff_pos < len)) {
-        buff_pos = relativeHumiditySchema.decodeData(&sensor_data.humidity.value, &sensor_data.humidity.is_valid, buffer, buff_pos);
+    if (plan.compact) {
+        bitReader reader(&buffer[start_pos], (len > start_pos) ? (len - start_pos) : 0);
+        decodeCompactFields(plan, &sensor_data, &reader);
+        return sensor_data;
     }
-    if (sendAirPressure && (buff_pos < len)) {
-        buff_pos = airPressureSchema.decodeData(&sensor_data.pressure.value, &sensor_data.pressure.is_valid, buffer, buff_pos);
-    }
-    if (sendGasResistance && (buff_pos < len)) {
-        buff_pos = gasResistanceSchema.decodeData(&sensor_data.gas_resist.value, &sensor_data.gas_resist.is_valid, buffer, buff_pos);
-    }
-    if (sendLocation && (buff_pos < len)) {
-        buff_pos = locationSchema.decodeData(&sensor_data.location.latitude, &sensor_data.location.is_valid, buffer, buff_pos);
-        buff_pos = locationSchema.decodeData(&sensor_data.location.longitude, &sensor_data.location.is_valid, buffer, buff_pos);
+
+    for (uint8_t f = 0; f < plan.n_fields; f++) {
+        uint8_t pos = start_pos + plan.fields[f].offset;
+        if ((pos + getFieldSchema(plan.fields[f].field).bytesPerValue()) > len) {
+            // the rest of the fields are missing from the buffer
+            break;
+        }
+        switch (plan.fields[f].field) {
+            case SENSOR_FIELD::BATTERY_VOLTAGE:
+                fieldCodec<batteryVoltageSchema>::decode(&sensor_data.battery_mv.value,
+                                                         &sensor_data.battery_mv.is_valid, buffer, pos);
+                break;
+            case SENSOR_FIELD::TEMPERATURE:
+                fieldCodec<temperatureSchema>::decode(&sensor_data.temperature.value,
+                                                      &sensor_data.temperature.is_valid, buffer, pos);
+                break;
+            case SENSOR_FIELD::RELATIVE_HUMIDITY:
+                fieldCodec<relativeHumiditySchema>::decode(&sensor_data.humidity.value, &sensor_data.humidity.is_valid,
+                                                           buffer, pos);
+                break;
+            case SENSOR_FIELD::AIR_PRESSURE:
+                fieldCodec<airPressureSchema>::decode(&sensor_data.pressure.value, &sensor_data.pressure.is_valid,
+                                                      buffer, pos);
+                break;
+            case SENSOR_FIELD::GAS_RESISTANCE:
+                fieldCodec<gasResistanceSchema>::decode(&sensor_data.gas_resist.value,
+                                                        &sensor_data.gas_resist.is_valid, buffer, pos);
+                break;
+            case SENSOR_FIELD::LATITUDE:
+                fieldCodec<locationSchema>::decode(&sensor_data.location.latitude, &sensor_data.location.is_valid,
+                                                   buffer, pos);
+                break;
+            case SENSOR_FIELD::LONGITUDE:
+                fieldCodec<locationSchema>::decode(&sensor_data.location.longitude, &sensor_data.location.is_valid,
+                                                   buffer, pos);
+                break;
+            case SENSOR_FIELD::ANALOG:
+                fieldCodec<analogSchema>::decode(&sensor_data.analog_mv.value, &sensor_data.analog_mv.is_valid, buffer,
+                                                 pos);
+                break;
+            case SENSOR_FIELD::TIMESTAMP:
+                fieldCodec<timestampSchema>::decode(&sensor_data.timestamp.value, &sensor_data.timestamp.is_valid,
+                                                    buffer, pos);
+                break;
+        }
     }
 
     return sensor_data;
 }
 
-bool portSchema::operator==(const portSchema &port2) {
-    // clang-format off
-    return ((port_number          == port2.port_number         ) &&
-            (sendBatteryVoltage   == port2.sendBatteryVoltage  ) &&
-            (sendTemperature      == port2.sendTemperature     ) &&
-            (sendRelativeHumidity == port2.sendRelativeHumidity) &&
-            (sendAirPressure      == port2.sendAirPressure     ) &&
-            (sendGasResistance    == port2.sendGasResistance   ) &&
-            (sendLocation         == port2.sendLocation        ));
-    // clang-format on
+bool portSchema::setPayloadTimestamp(uint8_t *payload, uint32_t timestamp) const {
+    for (uint8_t f = 0; f < plan.n_fields; f++) {
+        if (plan.fields[f].field == SENSOR_FIELD::TIMESTAMP) {
+            bitWriter writer(payload, plan.length, plan.fields[f].bit_offset);
+            fieldCodec<timestampSchema>::encode(timestamp, true, &writer);
+            return true;
+        }
+    }
+    return false;
 }
 
-portSchema &portSchema::operator+(const portSchema &port2) const {
-    portSchema combined_port = PORTERROR;
-    // clang-format off
-    combined_port.port_number = 0;
-    combined_port.sendBatteryVoltage   = (this->sendBatteryVoltage   || port2.sendBatteryVoltage  );
-    combined_port.sendTemperature      = (this->sendTemperature      || port2.sendTemperature     );
-    combined_port.sendRelativeHumidity = (this->sendRelativeHumidity || port2.sendRelativeHumidity);
-    combined_port.sendAirPressure      = (this->sendAirPressure      || port2.sendAirPressure     );
-    combined_port.sendGasResistance    = (this->sendGasResistance    || port2.sendGasResistance   );
-    combined_port.sendLocation         = (this->sendLocation         || port2.sendLocation        );
-    // clang-format on
-    return combined_port;
+bool portSchema::operator==(const portSchema &port2) const {
+    return ((port_number == port2.port_number) && (sensors == port2.sensors));
 }
 
-portSchema getPort(uint8_t port_number) {
-    switch (port_number) {
-        case 1: {
-            return PORT1;
-        }
-        case 2: {
-            return PORT2;
-        }
-        case 3: {
-            return PORT3;
-        }
-        case 4: {
-            return PORT4;
-        }
-        case 5: {
-            return PORT5;
-        }
-        case 6: {
-            return PORT6;
-        }
-        case 7: {
-            return PORT7;
-        }
-        case 8: {
-            return PORT8;
-        }
-        case 9: {
-            return PORT9;
-        }
-        case 50: {
-            return PORT50;
-        }
-        case 51: {
-            return PORT51;
-        }
-        case 52: {
-            return PORT52;
-        }
-        case 53: {
-            return PORT53;
-        }
-        case 54: {
-            return PORT54;
-        }
-        case 55: {
-            return PORT55;
-        }
-        case 56: {
-            return PORT56;
-        }
-        case 57: {
-            return PORT57;
-        }
-        case 58: {
-            return PORT58;
-        }
-        case 59: {
-            return PORT59;
-        }
-        default: {
-            return PORTERROR;
-        }
+portSchema portSchema::operator+(const portSchema &port2) const {
+    return portSchema(0, (sensors | port2.sensors));
+}
+
+const portSchema &getPort(uint8_t port_number) {
+    if (port_number >= PORT_TABLE_SIZE) {
+        return PORTERROR;
     }
-}
\ No newline at end of file
+    return PORT_TABLE.ports[port_number];
+}
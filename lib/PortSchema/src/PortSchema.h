@@ -7,7 +7,13 @@
  * @brief Port schema definition as descibed the README.
  * Schema's include the functions for encoding and decoding the data to the payload as well.
  *
- * @version 0.1
+ * Ports are declared as constexpr bitmasks of the SEND_* flags below. Each port carries an encode plan that is
+ * generated at compile time from those flags: the sequence of sensor fields in the payload, the offset & width of each
+ * field and the total encoded length. Ports with the COMPACT_FIELDS flag use the sub-byte compact schemas, bit-packed
+ * into the payload. The encoder/decoder simply walk the plan, and getPort() is a constant time lookup
+ * into a table indexed by port number.
+ *
+ * @version 0.2
  * @date 2021-08-24
  *
  * @copyright (c) 2021 Kalina Knight - MIT License
@@ -15,40 +21,271 @@
 
 #include "SensorPortSchema.h" /**< Go here for the individual sensor schema definitions. */
 
+#ifndef PAYLOAD_BUFFER_SIZE
+#define PAYLOAD_BUFFER_SIZE 64 /**< Data payload buffer size. Every port must fit in this. */
+#endif
+
+#define MULTI_SAMPLE_PORT_OFFSET 100 /**< Multi-sample frames of port X are sent on port X + MULTI_SAMPLE_PORT_OFFSET. */
+#define MULTI_SAMPLE_WIDTH_BITS  6   /**< Bits used to send the delta width (0-32) of each field in a multi-sample frame. */
+#define MAX_FRAME_SAMPLES        255 /**< Max samples in a multi-sample frame, as the count is sent in 1 byte. */
+
+/**
+ * @brief Flags for if the sensors data is included in a port.
+ * The bit order is also the order the sensor data is encoded into the payload.
+ */
+static constexpr uint16_t SEND_BATTERY_VOLTAGE = (1 << 0);
+static constexpr uint16_t SEND_TEMPERATURE = (1 << 1);
+static constexpr uint16_t SEND_RELATIVE_HUMIDITY = (1 << 2);
+static constexpr uint16_t SEND_AIR_PRESSURE = (1 << 3);
+static constexpr uint16_t SEND_GAS_RESISTANCE = (1 << 4);
+static constexpr uint16_t SEND_LOCATION = (1 << 5);
+static constexpr uint16_t SEND_ANALOG = (1 << 6);
+/* An example of a new sensor:
+static constexpr uint16_t SEND_NEW_SENSOR = (1 << 9);
+*/
+/** Not a sensor: encode the port's sensor data with the compact (sub-byte) schemas, bit-packed into the payload. */
+static constexpr uint16_t COMPACT_FIELDS = (1 << 7);
+/** When the sample was taken (timestampSchema, also used by compact ports), encoded after the sensor data. */
+static constexpr uint16_t SEND_TIMESTAMP = (1 << 8);
+
+/** @brief Individual values that can be encoded into a payload, in encoding order. */
+enum class SENSOR_FIELD : uint8_t {
+    BATTERY_VOLTAGE,
+    TEMPERATURE,
+    RELATIVE_HUMIDITY,
+    AIR_PRESSURE,
+    GAS_RESISTANCE,
+    LATITUDE,
+    LONGITUDE,
+    ANALOG,
+    TIMESTAMP,
+};
+
+#define MAX_PORT_FIELDS 9 /**< Max number of values a port can encode i.e. every SENSOR_FIELD. */
+
+/**
+ * @brief Get the sensor port schema used to encode the given field.
+ * @param field Sensor field.
+ * @param compact Get the compact schema used by ports with the COMPACT_FIELDS flag.
+ * @return Sensor port schema of the field.
+ */
+constexpr const sensorPortSchema &getFieldSchema(SENSOR_FIELD field, bool compact = false) {
+    switch (field) {
+        case SENSOR_FIELD::BATTERY_VOLTAGE:
+            return compact ? compactBatteryVoltageSchema : batteryVoltageSchema;
+        case SENSOR_FIELD::TEMPERATURE:
+            return compact ? compactTemperatureSchema : temperatureSchema;
+        case SENSOR_FIELD::RELATIVE_HUMIDITY:
+            return compact ? compactRelativeHumiditySchema : relativeHumiditySchema;
+        case SENSOR_FIELD::AIR_PRESSURE:
+            return compact ? compactAirPressureSchema : airPressureSchema;
+        case SENSOR_FIELD::GAS_RESISTANCE:
+            return compact ? compactGasResistanceSchema : gasResistanceSchema;
+        case SENSOR_FIELD::ANALOG:
+            return compact ? compactAnalogSchema : analogSchema;
+        case SENSOR_FIELD::TIMESTAMP:
+            return timestampSchema; // already as narrow as seconds since 1970 can be
+        case SENSOR_FIELD::LATITUDE:
+        case SENSOR_FIELD::LONGITUDE:
+        default:
+            return compact ? compactLocationSchema : locationSchema;
+    }
+}
+
+/** @brief Where a single field is placed in the payload. */
+struct portFieldPlan {
+    SENSOR_FIELD field;  /**< Sensor field to encode. */
+    uint8_t offset;      /**< Byte offset of the field from the start of the port's data (byte aligned plans only). */
+    uint16_t bit_offset; /**< Bit offset of the field from the start of the port's data. */
+    uint8_t n_bits;      /**< Width of the field in bits. */
+};
+
+/** @brief Pre-computed encoding plan of a port: the fields in payload order with their offsets. */
+struct portEncodePlan {
+    uint8_t n_fields;                       /**< Number of fields in the plan. */
+    uint8_t length;                         /**< Total encoded length in bytes, including any padding bits. */
+    uint16_t n_bits;                        /**< Total encoded length in bits. */
+    bool compact;                           /**< Fields use the compact schemas, and so must be bit-packed. */
+    portFieldPlan fields[MAX_PORT_FIELDS]; /**< Fields in the order they're encoded. */
+};
+
+/**
+ * @brief Build the encoding plan for the given set of SEND_* flags.
+ * @param sensors Bitmask of SEND_* flags.
+ * @return Encoding plan.
+ */
+constexpr portEncodePlan makePortEncodePlan(uint16_t sensors) {
+    // clang-format off
+    constexpr struct {
+        uint16_t flag;
+        SENSOR_FIELD field;
+    } FIELD_ORDER[MAX_PORT_FIELDS] = {
+        { SEND_BATTERY_VOLTAGE,   SENSOR_FIELD::BATTERY_VOLTAGE   },
+        { SEND_TEMPERATURE,       SENSOR_FIELD::TEMPERATURE       },
+        { SEND_RELATIVE_HUMIDITY, SENSOR_FIELD::RELATIVE_HUMIDITY },
+        { SEND_AIR_PRESSURE,      SENSOR_FIELD::AIR_PRESSURE      },
+        { SEND_GAS_RESISTANCE,    SENSOR_FIELD::GAS_RESISTANCE    },
+        { SEND_LOCATION,          SENSOR_FIELD::LATITUDE          },
+        { SEND_LOCATION,          SENSOR_FIELD::LONGITUDE         },
+        { SEND_ANALOG,            SENSOR_FIELD::ANALOG            },
+        { SEND_TIMESTAMP,         SENSOR_FIELD::TIMESTAMP         },
+    };
+    // clang-format on
+
+    portEncodePlan plan = {};
+    plan.compact = (sensors & COMPACT_FIELDS);
+    for (uint8_t i = 0; i < MAX_PORT_FIELDS; i++) {
+        if (sensors & FIELD_ORDER[i].flag) {
+            portFieldPlan &field_plan = plan.fields[plan.n_fields];
+            field_plan.field = FIELD_ORDER[i].field;
+            field_plan.offset = (uint8_t)(plan.n_bits / 8);
+            field_plan.bit_offset = plan.n_bits;
+            field_plan.n_bits = getFieldSchema(FIELD_ORDER[i].field, plan.compact).bitsPerValue();
+            plan.n_bits += field_plan.n_bits;
+            plan.n_fields++;
+        }
+    }
+    plan.length = (uint8_t)((plan.n_bits + 7) / 8);
+    return plan;
+}
+
 /** @brief portSchema describes which sensor data to include in each port and hence the payload. */
 struct portSchema {
     uint8_t port_number;
+    uint16_t sensors;    /**< Bitmask of SEND_* flags for the sensor data included in this port. */
+    portEncodePlan plan; /**< Generated from sensors. */
+
+    /**
+     * @brief Construct an invalid port (see PORTERROR).
+     */
+    constexpr portSchema(void) : portSchema(__UINT8_MAX__, 0){};
+
+    /**
+     * @brief Construct a port and generate its encoding plan.
+     * @param port_number LoRaWAN FPort.
+     * @param sensors Bitmask of SEND_* flags.
+     */
+    constexpr portSchema(uint8_t port_number, uint16_t sensors)
+        : port_number(port_number), sensors(sensors), plan(makePortEncodePlan(sensors)){};
 
-    /**< Flags for if the sensors data is included in this port. */
-    bool sendBatteryVoltage;
-    bool sendTemperature;
-    bool sendRelativeHumidity;
-    bool sendAirPressure;
-    bool sendGasResistance;
-    bool sendLocation;
+    /**< Checks for if the sensors data is included in this port. */
+    constexpr bool sendBatteryVoltage(void) const { return (sensors & SEND_BATTERY_VOLTAGE); };
+    constexpr bool sendTemperature(void) const { return (sensors & SEND_TEMPERATURE); };
+    constexpr bool sendRelativeHumidity(void) const { return (sensors & SEND_RELATIVE_HUMIDITY); };
+    constexpr bool sendAirPressure(void) const { return (sensors & SEND_AIR_PRESSURE); };
+    constexpr bool sendGasResistance(void) const { return (sensors & SEND_GAS_RESISTANCE); };
+    constexpr bool sendLocation(void) const { return (sensors & SEND_LOCATION); };
+    constexpr bool sendAnalog(void) const { return (sensors & SEND_ANALOG); };
+    constexpr bool sendTimestamp(void) const { return (sensors & SEND_TIMESTAMP); };
     /* An example of a new sensor:
-    bool sendNewSensor;
+    constexpr bool sendNewSensor(void) const { return (sensors & SEND_NEW_SENSOR); };
     */
 
+    /**
+     * @brief Check if the port uses the compact (sub-byte) schemas.
+     * @return True if the port has the COMPACT_FIELDS flag.
+     */
+    constexpr bool compactFields(void) const { return (sensors & COMPACT_FIELDS); };
+
+    /**
+     * @brief Length of the payload encoded by this port.
+     * @return Encoded length in bytes.
+     */
+    constexpr uint8_t payloadLength(void) const { return plan.length; };
+
     /**
      * @brief Encodes the given sensor data into the payload according to the port's schema.
-     * Calls sensorPortSchema::encodeData for each sensor.
+     * Walks the port's encoding plan calling fieldCodec<schema>::encode() for each field. Compact ports are bit-packed
+     * through a bitWriter, with the last byte padded with 0s.
      * @param sensor_data Sensor data to be encoded.
      * @param payload_buffer Payload buffer for data to be written into.
      * @param start_pos Start encoding data at this byte. Defaults to 0.
      * @return Total length of data encoded to payload_buffer.
      */
-    uint8_t encodeSensorDataToPayload(sensorData *sensor_data, uint8_t *payload_buffer, uint8_t start_pos = 0);
+    uint8_t encodeSensorDataToPayload(const sensorData *sensor_data, uint8_t *payload_buffer, uint8_t start_pos = 0) const;
 
     /**
      * @brief Decodes the given payload into the sensor data according to the port's schema.
-     * Calls sensorPortSchema::decodeData for each sensor.
+     * Walks the port's encoding plan calling fieldCodec<schema>::decode() for each field that fits in len. Compact
+     * ports are read through a bitReader.
      * @param buffer Payload buffer to be decoded.
      * @param len Length of payload buffer.
      * @param start_pos Start decoding data at this byte. Defaults to 0.
      * @return Decoded sensor data.
      */
-    sensorData decodePayloadToSensorData(uint8_t *buffer, uint8_t len, uint8_t start_pos = 0);
+    sensorData decodePayloadToSensorData(const uint8_t *buffer, uint8_t len, uint8_t start_pos = 0) const;
+
+    /**
+     * @brief Overwrites the timestamp of a payload encoded by this port, leaving the bits of every other field as they
+     * are. e.g. to timestamp a stored sample once the wall clock is known.
+     * @param payload Payload encoded by encodeSensorDataToPayload(), from its start_pos.
+     * @param timestamp Valid timestamp to encode.
+     * @return False if the port doesn't send a timestamp.
+     */
+    bool setPayloadTimestamp(uint8_t *payload, uint32_t timestamp) const;
+
+    /**
+     * @brief Port number that multi-sample frames of this port are sent on.
+     * @return LoRaWAN FPort.
+     */
+    constexpr uint8_t multiSamplePortNumber(void) const { return (port_number + MULTI_SAMPLE_PORT_OFFSET); };
+
+    /**
+     * @brief Encodes consecutive samples into a single multi-sample frame, as many as fit in max_len.
+     * @details The frame is: the number of samples (1 byte), the first sample encoded in full exactly as
+     * encodeSensorDataToPayload(), then (if there's more than one sample) the bit width of each field's deltas
+     * (MULTI_SAMPLE_WIDTH_BITS each), then for each following sample the zigzag encoded difference of each field from
+     * the previous sample, bit-packed at its field's width. The width of each field adapts to the largest difference
+     * in the frame. Send it on multiSamplePortNumber().
+     * Timestamps are sent relative to a base interval instead: for ports that send a timestamp, the widths are followed
+     * by the width (MULTI_SAMPLE_WIDTH_BITS) & zigzag encoded value of the base interval, the difference between the
+     * first two timestamps. The delta of each following timestamp is then its difference from the previous timestamp +
+     * the base interval, so samples taken at a regular interval cost 0 bits of timestamp each.
+     * @param samples Samples to be encoded, oldest first.
+     * @param n_samples Number of samples.
+     * @param payload_buffer Payload buffer for data to be written into.
+     * @param max_len Max length of the frame e.g. the max payload of the current datarate.
+     * @param n_encoded Number of samples encoded into the frame, starting from samples[0].
+     * @return Total length of data encoded to payload_buffer, 0 if not even the first sample fits.
+     */
+    uint8_t encodeSamplesToPayload(const sensorData *samples, uint8_t n_samples, uint8_t *payload_buffer,
+                                   uint8_t max_len, uint8_t *n_encoded) const;
+
+    /**
+     * @brief Encodes consecutive samples that are already encoded by this port into a single multi-sample frame, as
+     * encodeSamplesToPayload(). The encoded fields are used as they are, so the samples are sent exactly as they were
+     * encoded e.g. samples stored by a sampleQueue.
+     * @param payloads Samples encoded by encodeSensorDataToPayload(), payloadLength() bytes each, back to back.
+     * @param n_samples Number of samples.
+     * @param payload_buffer Payload buffer for data to be written into.
+     * @param max_len Max length of the frame e.g. the max payload of the current datarate.
+     * @param n_encoded Number of samples encoded into the frame, starting from the first.
+     * @return Total length of data encoded to payload_buffer, 0 if not even the first sample fits.
+     */
+    uint8_t encodePayloadsToPayload(const uint8_t *payloads, uint8_t n_samples, uint8_t *payload_buffer,
+                                    uint8_t max_len, uint8_t *n_encoded) const;
+
+    /**
+     * @brief Decodes a multi-sample frame encoded by encodeSamplesToPayload().
+     * Each sample is decoded exactly as decodePayloadToSensorData() would decode it sent on its own.
+     * @param buffer Payload buffer to be decoded.
+     * @param len Length of payload buffer.
+     * @param samples Decoded samples, oldest first.
+     * @param max_samples Max number of samples to decode into samples.
+     * @return Number of samples decoded, 0 if the frame is invalid.
+     */
+    uint8_t decodePayloadToSamples(const uint8_t *buffer, uint8_t len, sensorData *samples, uint8_t max_samples) const;
+
+    /**
+     * @brief Decodes a multi-sample frame encoded by encodeSamplesToPayload() back into the single sample payloads it
+     * was made of, the reverse of encodePayloadsToPayload() e.g. to decode them with a payload decoder.
+     * @param buffer Payload buffer to be decoded.
+     * @param len Length of payload buffer.
+     * @param payloads Decoded samples, payloadLength() bytes each, back to back, oldest first.
+     * @param max_samples Max number of samples to decode into payloads.
+     * @return Number of samples decoded, 0 if the frame is invalid.
+     */
+    uint8_t decodePayloadToPayloads(const uint8_t *buffer, uint8_t len, uint8_t *payloads, uint8_t max_samples) const;
 
     /**
      * @brief Compares for full equivalence between two port objects.
@@ -56,7 +293,7 @@ struct portSchema {
      * @param port2 Second port that this port is compared to.
      * @return True if they're equivalent, false if not.
      */
-    bool operator==(const portSchema &port2);
+    bool operator==(const portSchema &port2) const;
 
     /**
      * @brief Combines two ports into separate port.
@@ -66,228 +303,181 @@ struct portSchema {
      * @param port2 Second port that this port is combined with.
      * @return Another port schema object that combines the given ports.
      */
-    portSchema &operator+(const portSchema &port2) const;
+    portSchema operator+(const portSchema &port2) const;
 };
 
 /**
  * @brief Get the Port object for the given port number.
+ * Constant time lookup into PORT_TABLE.
  * @param port_number
- * @return Returns the portSchema.
+ * @return Returns the portSchema, or PORTERROR if the port number is not defined.
  */
-portSchema getPort(uint8_t port_number);
+const portSchema &getPort(uint8_t port_number);
+
+/**
+ * @brief Get the Port object that multi-sample frames on the given port number are made of.
+ * @param port_number Port number the multi-sample frame was sent on.
+ * @return Returns the portSchema, or PORTERROR if the port number is not a multi-sample port of a defined port.
+ */
+const portSchema &getMultiSamplePort(uint8_t port_number);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // SCHEMA DEFINITIONS: See readme for definitions in tabular format.
 
-const portSchema PORTERROR = {
-    __UINT8_MAX__, // port_number
-    false,         // sendBatteryVoltage
-    false,         // sendTemperature
-    false,         // sendRelativeHumidity
-    false,         // sendAirPressure
-    false,         // sendGasResistance
-    false          // sendLocation
-};
+inline constexpr portSchema PORTERROR = {};
 
-const portSchema PORT1 = {
-    1,     // port_number
-    true,  // sendBatteryVoltage
-    false, // sendTemperature
-    false, // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    false  // sendLocation
-};
+// clang-format off
+inline constexpr portSchema PORT1  = { 1,  SEND_BATTERY_VOLTAGE };
+inline constexpr portSchema PORT2  = { 2,  SEND_TEMPERATURE };
+inline constexpr portSchema PORT3  = { 3,  SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE };
+inline constexpr portSchema PORT4  = { 4,  SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY };
+inline constexpr portSchema PORT5  = { 5,  SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY };
+inline constexpr portSchema PORT6  = { 6,  SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_AIR_PRESSURE };
+inline constexpr portSchema PORT7  = { 7,  SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_AIR_PRESSURE };
+inline constexpr portSchema PORT8  = { 8,  SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_AIR_PRESSURE | SEND_GAS_RESISTANCE };
+inline constexpr portSchema PORT9  = { 9,  SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_AIR_PRESSURE |
+                                           SEND_GAS_RESISTANCE };
+inline constexpr portSchema PORT50 = { 50, SEND_LOCATION };
+inline constexpr portSchema PORT51 = { 51, SEND_BATTERY_VOLTAGE | SEND_LOCATION };
+inline constexpr portSchema PORT52 = { 52, SEND_TEMPERATURE | SEND_LOCATION };
+inline constexpr portSchema PORT53 = { 53, SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE | SEND_LOCATION };
+inline constexpr portSchema PORT54 = { 54, SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_LOCATION };
+inline constexpr portSchema PORT55 = { 55, SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_LOCATION };
+inline constexpr portSchema PORT56 = { 56, SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_AIR_PRESSURE | SEND_LOCATION };
+inline constexpr portSchema PORT57 = { 57, SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_AIR_PRESSURE |
+                                           SEND_LOCATION };
+inline constexpr portSchema PORT58 = { 58, SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_AIR_PRESSURE | SEND_GAS_RESISTANCE |
+                                           SEND_LOCATION };
+inline constexpr portSchema PORT59 = { 59, SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_AIR_PRESSURE |
+                                           SEND_GAS_RESISTANCE | SEND_LOCATION };
+// clang-format on
 
-const portSchema PORT2 = {
-    2,     // port_number
-    false, // sendBatteryVoltage
-    true,  // sendTemperature
-    false, // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    false  // sendLocation
-};
+/* Compact ports: ports 1-9 & 50-59 with sub-byte fields, numbered port_number + 10. */
+inline constexpr portSchema PORT11 = { 11, PORT1.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT12 = { 12, PORT2.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT13 = { 13, PORT3.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT14 = { 14, PORT4.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT15 = { 15, PORT5.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT16 = { 16, PORT6.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT17 = { 17, PORT7.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT18 = { 18, PORT8.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT19 = { 19, PORT9.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT60 = { 60, PORT50.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT61 = { 61, PORT51.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT62 = { 62, PORT52.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT63 = { 63, PORT53.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT64 = { 64, PORT54.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT65 = { 65, PORT55.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT66 = { 66, PORT56.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT67 = { 67, PORT57.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT68 = { 68, PORT58.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT69 = { 69, PORT59.sensors | COMPACT_FIELDS };
 
-const portSchema PORT3 = {
-    3,     // port_number
-    true,  // sendBatteryVoltage
-    true,  // sendTemperature
-    false, // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    false  // sendLocation
-};
+/* Timestamped ports: ports 1-9 & 11-19 with when each sample was taken, numbered port_number + 20. */
+inline constexpr portSchema PORT21 = { 21, PORT1.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT22 = { 22, PORT2.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT23 = { 23, PORT3.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT24 = { 24, PORT4.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT25 = { 25, PORT5.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT26 = { 26, PORT6.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT27 = { 27, PORT7.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT28 = { 28, PORT8.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT29 = { 29, PORT9.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT31 = { 31, PORT11.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT32 = { 32, PORT12.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT33 = { 33, PORT13.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT34 = { 34, PORT14.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT35 = { 35, PORT15.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT36 = { 36, PORT16.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT37 = { 37, PORT17.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT38 = { 38, PORT18.sensors | SEND_TIMESTAMP };
+inline constexpr portSchema PORT39 = { 39, PORT19.sensors | SEND_TIMESTAMP };
 
-const portSchema PORT4 = {
-    4,     // port_number
-    false, // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    false  // sendLocation
-};
-
-const portSchema PORT5 = {
-    5,     // port_number
-    true,  // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    false  // sendLocation
-};
-
-const portSchema PORT6 = {
-    6,     // port_number
-    false, // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    true,  // sendAirPressure
-    false, // sendGasResistance
-    false  // sendLocation
-};
-const portSchema PORT7 = {
-    7,     // port_number
-    true,  // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    true,  // sendAirPressure
-    false, // sendGasResistance
-    false  // sendLocation
-};
+/* Analog ports: an analog sensor (e.g. a RAK5801 or RAK5811), on its own & with temperature & humidity. */
+// clang-format off
+inline constexpr portSchema PORT40 = { 40, SEND_ANALOG };
+inline constexpr portSchema PORT41 = { 41, SEND_BATTERY_VOLTAGE | SEND_ANALOG };
+inline constexpr portSchema PORT42 = { 42, SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY | SEND_ANALOG };
+inline constexpr portSchema PORT43 = { 43, SEND_BATTERY_VOLTAGE | SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY |
+                                           SEND_ANALOG };
+// clang-format on
 
-const portSchema PORT8 = {
-    8,     // port_number
-    false, // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    true,  // sendAirPressure
-    true,  // sendGasResistance
-    false  // sendLocation
-};
+/* Compact analog ports: ports 40-43 with sub-byte fields, numbered port_number + 4. */
+inline constexpr portSchema PORT44 = { 44, PORT40.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT45 = { 45, PORT41.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT46 = { 46, PORT42.sensors | COMPACT_FIELDS };
+inline constexpr portSchema PORT47 = { 47, PORT43.sensors | COMPACT_FIELDS };
 
-const portSchema PORT9 = {
-    9,    // port_number
-    true, // sendBatteryVoltage
-    true, // sendTemperature
-    true, // sendRelativeHumidity
-    true, // sendAirPressure
-    true, // sendGasResistance
-    false // sendLocation
-};
+/* An example of a new port:
+inline constexpr portSchema PORTX = { X, SEND_BATTERY_VOLTAGE | SEND_NEW_SENSOR };
+*/
 
-const portSchema PORT50 = {
-    50,    // port_number
-    false, // sendBatteryVoltage
-    false, // sendTemperature
-    false, // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    true   // sendLocation
+/** @brief Every defined port. Add new ports here so they're included in PORT_TABLE. */
+inline constexpr portSchema DEFINED_PORTS[] = {
+    PORT1,  PORT2,  PORT3,  PORT4,  PORT5,  PORT6,  PORT7,  PORT8,  PORT9,  PORT11, PORT12, PORT13, PORT14,
+    PORT15, PORT16, PORT17, PORT18, PORT19, PORT21, PORT22, PORT23, PORT24, PORT25, PORT26, PORT27, PORT28,
+    PORT29, PORT31, PORT32, PORT33, PORT34, PORT35, PORT36, PORT37, PORT38, PORT39, PORT40, PORT41, PORT42,
+    PORT43, PORT44, PORT45, PORT46, PORT47, PORT50, PORT51, PORT52, PORT53, PORT54, PORT55, PORT56, PORT57,
+    PORT58, PORT59, PORT60, PORT61, PORT62, PORT63, PORT64, PORT65, PORT66, PORT67, PORT68, PORT69,
 };
 
-const portSchema PORT51 = {
-    51,    // port_number
-    true,  // sendBatteryVoltage
-    false, // sendTemperature
-    false, // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    true   // sendLocation
-};
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-const portSchema PORT52 = {
-    52,    // port_number
-    false, // sendBatteryVoltage
-    true,  // sendTemperature
-    false, // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    true   // sendLocation
-};
+// PORT LOOKUP TABLE: generated from DEFINED_PORTS at compile time.
 
-const portSchema PORT53 = {
-    53,    // port_number
-    true,  // sendBatteryVoltage
-    true,  // sendTemperature
-    false, // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    true   // sendLocation
-};
+#define PORT_TABLE_SIZE 70 /**< Highest defined port number + 1. Increase if a higher port number is defined. */
 
-const portSchema PORT54 = {
-    54,    // port_number
-    false, // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    true   // sendLocation
+/** @brief Table of ports indexed by port number. Port numbers that aren't defined hold PORTERROR. */
+struct portTable {
+    portSchema ports[PORT_TABLE_SIZE];
 };
 
-const portSchema PORT55 = {
-    55,    // port_number
-    true,  // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    true   // sendLocation
-};
+/**
+ * @brief Generate the port lookup table from DEFINED_PORTS.
+ * @return Port table.
+ */
+constexpr portTable makePortTable(void) {
+    portTable table = {};
+    for (const portSchema &port : DEFINED_PORTS) {
+        table.ports[port.port_number] = port;
+    }
+    return table;
+}
 
-const portSchema PORT56 = {
-    56,    // port_number
-    false, // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    true,  // sendAirPressure
-    false, // sendGasResistance
-    true   // sendLocation
-};
-const portSchema PORT57 = {
-    57,    // port_number
-    true,  // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    true,  // sendAirPressure
-    false, // sendGasResistance
-    true   // sendLocation
-};
+/**
+ * @brief Checks every defined port has a unique port number that fits in PORT_TABLE.
+ * @return True if all ports can be placed in the table.
+ */
+constexpr bool definedPortsFitTable(void) {
+    bool used[PORT_TABLE_SIZE] = {};
+    for (const portSchema &port : DEFINED_PORTS) {
+        if ((port.port_number >= PORT_TABLE_SIZE) || used[port.port_number]) {
+            return false;
+        }
+        used[port.port_number] = true;
+    }
+    return true;
+}
 
-const portSchema PORT58 = {
-    58,    // port_number
-    false, // sendBatteryVoltage
-    true,  // sendTemperature
-    true,  // sendRelativeHumidity
-    true,  // sendAirPressure
-    true,  // sendGasResistance
-    true   // sendLocation
-};
+/**
+ * @brief Checks every defined port's encoded length fits in the payload buffer.
+ * @return True if all ports fit in PAYLOAD_BUFFER_SIZE.
+ */
+constexpr bool definedPortsFitPayload(void) {
+    for (const portSchema &port : DEFINED_PORTS) {
+        if (port.payloadLength() > PAYLOAD_BUFFER_SIZE) {
+            return false;
+        }
+    }
+    return true;
+}
 
-const portSchema PORT59 = {
-    59,   // port_number
-    true, // sendBatteryVoltage
-    true, // sendTemperature
-    true, // sendRelativeHumidity
-    true, // sendAirPressure
-    true, // sendGasResistance
-    true  // sendLocation
-};
+static_assert(definedPortsFitTable(), "Port numbers must be unique and less than PORT_TABLE_SIZE.");
+static_assert(definedPortsFitPayload(), "Every defined port must fit in PAYLOAD_BUFFER_SIZE.");
+static_assert((PORT_TABLE_SIZE + MULTI_SAMPLE_PORT_OFFSET) <= 200,
+              "Multi-sample ports must not overlap the system/control ports (200 onwards).");
 
-/* An example of a new port:
-const portSchema PORTX = {
-    X,     // port_number
-    false, // sendBatteryVoltage
-    false, // sendTemperature
-    false, // sendRelativeHumidity
-    false, // sendAirPressure
-    false, // sendGasResistance
-    false  // sendLocation
-};
-*/
+inline constexpr portTable PORT_TABLE = makePortTable();
 
-#endif // PORT_SCHEMA_H
\ No newline at end of file
+#endif // PORT_SCHEMA_H
@@ -1,60 +1,68 @@
 #include "SensorPortSchema.h"
 
 /**
- * @brief Byte encodes the given sensor data into the payload according to the given sensor port schema.
- * If the sensor data is not valid, for whatever reason, a value close to max (for the number of bytes) will be
- * encoded instead. The decoder then knows to ignore the data as it is invalid. If the data is invalid a segment of
- * 0x7F7F7F7F (signed) or 0xFFFFFFFF (unsigned) will be encoded and sent instead of the invalid data. E.g. For an
- * invalid 2 byte signed the value will be 0x7f7f.
+ * @brief Byte encodes the given sensor data into the payload as a BYTES wide field.
+ * @details The runtime counterpart of fieldCodec::encode(), used when the schema is only known at runtime.
  * @param sensor_data Sensor data to encode. This template allows the type of sensor_data to be flexible (to a point).
  * @param valid Validity of given sensor data.
  * @param payload_buffer LoRaWAN payload with buffer for data to be written into.
  * @param buf_pos Start encoding from this byte.
- * @param sensor_schema Sensor port schema that determines how the data is encoded.
+ * @param sensor_schema Sensor port schema that determines how the data is scaled.
  * @return New total length of data encoded to payload_buffer - includes buf_pos.
  */
-template <typename T>
-uint8_t encodeDataWithSchema(T sensor_data, bool valid, uint8_t *payload_buffer, uint8_t buf_pos, const sensorPortSchema *sensor_schema) {
-    long long data_to_encode = 0;
-    // Check validity
-    if (valid) {
-        /* Perform float maths to scale the data and assign the result to an int.
-         * This discards any decimal values not captured by the scale factor */
-        data_to_encode = (long long)((double)sensor_data * (double)sensor_schema->scale_factor);
-    } else {
-        /* If the data is invalid, a (close to) max value will be sent through.
-         * A max value received by the decoder should be ignored */
-        if (sensor_schema->is_signed) {
-            // 0x7f... must be sent instead of 0xff for signed values as the first bit is used to indicate sign
-            data_to_encode = 0x7F7F7F7F;
+template <uint8_t BYTES, bool SIGNED, typename T>
+static uint8_t encodeFixedWidth(T sensor_data, bool valid, uint8_t *payload_buffer, uint8_t buf_pos, const sensorPortSchema *sensor_schema) {
+    typedef fixedWidthField<BYTES, SIGNED> field;
+    typename field::raw_t raw = 0;
+    int32_t integer_scale = (sensor_schema->offset == 0) ? integerScale(sensor_schema->scale_factor) : 0;
+    if constexpr (std::is_integral<T>::value) {
+        if (integer_scale != 0) {
+            raw = field::scaleInteger(sensor_data, integer_scale);
         } else {
-            data_to_encode = 0xFFFFFFFF;
+            raw = field::scaleFloat((float)sensor_data - sensor_schema->offset, sensor_schema->scale_factor);
         }
+    } else {
+        valid = valid && !isnan((float)sensor_data);
+        raw = field::scaleFloat((float)sensor_data - sensor_schema->offset, sensor_schema->scale_factor);
     }
+    field::write(valid ? raw : (typename field::raw_t)field::INVALID, &payload_buffer[buf_pos]);
+    return (buf_pos + BYTES);
+}
 
-    if (!sensor_schema->is_signed && (data_to_encode < 0)) {
-        Log.warn("A signed value is being sent for a sensor port schema that is unsigned.");
-    }
-
-    // The total bytes assigned to the sensor is assumed to be split equally amongst the number of values used
-    // to represent the sensor data.
-    int data_size = sensor_schema->n_bytes / sensor_schema->n_values;
-
-    // Bitwise encode the data
-    uint8_t i = 0;
-    uint8_t j = (data_size - 1);
-    for (; i < data_size; i++, j--) {
-        // This is a generalised form of basic MSB bitwise encoding
-        uint8_t bitshift = j * 8; // 8 bits in a byte
-        if (j > 0) {
-            payload_buffer[buf_pos + i] = (uint8_t)((data_to_encode & (0xFF << bitshift)) >> bitshift);
-        } else {
-            payload_buffer[buf_pos + i] = (uint8_t)(data_to_encode & 0xFF);
-        }
+/**
+ * @brief Byte encodes the given sensor data into the payload according to the given sensor port schema.
+ * See sensorPortSchema::encodeData() in SensorPortSchema.h for details.
+ * @param sensor_data Sensor data to encode. This template allows the type of sensor_data to be flexible (to a point).
+ * @param valid Validity of given sensor data.
+ * @param payload_buffer LoRaWAN payload with buffer for data to be written into.
+ * @param buf_pos Start encoding from this byte.
+ * @param sensor_schema Sensor port schema that determines how the data is encoded.
+ * @return New total length of data encoded to payload_buffer - includes buf_pos, or buf_pos if the schema's width
+ * isn't supported.
+ */
+template <typename T>
+uint8_t encodeDataWithSchema(T sensor_data, bool valid, uint8_t *payload_buffer, uint8_t buf_pos, const sensorPortSchema *sensor_schema) {
+    // bytesPerValue() is 0 for schemas that aren't byte aligned, which aren't supported
+    switch ((sensor_schema->bytesPerValue() << 1) | sensor_schema->is_signed) {
+        case (1 << 1):
+            return encodeFixedWidth<1, false>(sensor_data, valid, payload_buffer, buf_pos, sensor_schema);
+        case (1 << 1) | 1:
+            return encodeFixedWidth<1, true>(sensor_data, valid, payload_buffer, buf_pos, sensor_schema);
+        case (2 << 1):
+            return encodeFixedWidth<2, false>(sensor_data, valid, payload_buffer, buf_pos, sensor_schema);
+        case (2 << 1) | 1:
+            return encodeFixedWidth<2, true>(sensor_data, valid, payload_buffer, buf_pos, sensor_schema);
+        case (3 << 1):
+            return encodeFixedWidth<3, false>(sensor_data, valid, payload_buffer, buf_pos, sensor_schema);
+        case (3 << 1) | 1:
+            return encodeFixedWidth<3, true>(sensor_data, valid, payload_buffer, buf_pos, sensor_schema);
+        case (4 << 1):
+            return encodeFixedWidth<4, false>(sensor_data, valid, payload_buffer, buf_pos, sensor_schema);
+        case (4 << 1) | 1:
+            return encodeFixedWidth<4, true>(sensor_data, valid, payload_buffer, buf_pos, sensor_schema);
+        default:
+            return buf_pos;
     }
-
-    // return the new buffer length
-    return (buf_pos + i);
 }
 
 /**
@@ -83,6 +91,33 @@ uint8_t sensorPortSchema::encodeData(float sensor_data, bool valid, uint8_t *pay
     return (encodeDataWithSchema(sensor_data, valid, payload_buffer, current_buffer_len, this));
 }
 
+/**
+ * @brief Byte decodes a BYTES wide field from the buffer into the sensor data.
+ * @details The runtime counterpart of fieldCodec::decode(), used when the schema is only known at runtime.
+ * @param sensor_data Resulting decoded sensor data, left untouched if it's invalid.
+ * @param valid Validity of the decoded sensor data.
+ * @param buffer Buffer that data will be decoded from.
+ * @param buf_pos Start decoding from this byte.
+ * @param sensor_schema Sensor port schema that determines how the data is scaled.
+ * @return New total length of data decoded from buffer - includes buf_pos.
+ */
+template <uint8_t BYTES, bool SIGNED, typename T>
+static uint8_t decodeFixedWidth(T *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buf_pos, const sensorPortSchema *sensor_schema) {
+    typedef fixedWidthField<BYTES, SIGNED> field;
+    typename field::raw_t raw = field::read(&buffer[buf_pos], valid);
+    if (*valid) {
+        int32_t integer_scale = (sensor_schema->offset == 0) ? integerScale(sensor_schema->scale_factor) : 0;
+        if (std::is_integral<T>::value && (integer_scale != 0)) {
+            *sensor_data = field::template unscaleInteger<T>(raw, integer_scale);
+        } else if (sensor_schema->offset != 0) {
+            *sensor_data = (T)(((float)raw / sensor_schema->scale_factor) + sensor_schema->offset);
+        } else {
+            *sensor_data = field::template unscaleFloat<T>(raw, sensor_schema->scale_factor);
+        }
+    }
+    return (buf_pos + BYTES);
+}
+
 /**
  * @brief Byte decodes the given buffer into the sensor data according to the given sensor port schema.
  * If the sensor data is not valid, for whatever reason, the valid flag will be set to false and no data will be decoded
@@ -93,38 +128,33 @@ uint8_t sensorPortSchema::encodeData(float sensor_data, bool valid, uint8_t *pay
  * @param buffer Buffer that data will be decoded from.
  * @param buf_pos Start decoding from this byte.
  * @param sensor_schema Sensor port schema that determines how the data is decoded.
- * @return New total length of data decoded from buffer - includes buf_pos.
+ * @return New total length of data decoded from buffer - includes buf_pos, or buf_pos if the schema's width isn't
+ * supported.
  */
 template <typename T>
-uint8_t decodeDataWithSchema(T *sensor_data, bool *valid, uint8_t *buffer, uint8_t buf_pos, const sensorPortSchema *sensor_schema) {
-    long long data_to_decode = 0;
-
-    // The total bytes assigned to the sensor is assumed to be split equally amongst the number of values used
-    // to represent the sensor data.
-    int data_size = sensor_schema->n_bytes / sensor_schema->n_values;
-
-    // Bitwise decode the data
-    uint8_t i = 0;
-    uint8_t j = (data_size - 1);
-    for (; i < data_size; i++, j--) {
-        // This is a generalised form of basic MSB bitwise decoding
-        uint8_t bitshift = j * 8; // 8 bits in a byte
-        if (j > 0) {
-            data_to_decode += (long long)(buffer[buf_pos + i] << bitshift);
-        } else {
-            data_to_decode += (long long)(buffer[buf_pos + i]);
-        }
+uint8_t decodeDataWithSchema(T *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buf_pos, const sensorPortSchema *sensor_schema) {
+    // bytesPerValue() is 0 for schemas that aren't byte aligned, which aren't supported
+    switch ((sensor_schema->bytesPerValue() << 1) | sensor_schema->is_signed) {
+        case (1 << 1):
+            return decodeFixedWidth<1, false>(sensor_data, valid, buffer, buf_pos, sensor_schema);
+        case (1 << 1) | 1:
+            return decodeFixedWidth<1, true>(sensor_data, valid, buffer, buf_pos, sensor_schema);
+        case (2 << 1):
+            return decodeFixedWidth<2, false>(sensor_data, valid, buffer, buf_pos, sensor_schema);
+        case (2 << 1) | 1:
+            return decodeFixedWidth<2, true>(sensor_data, valid, buffer, buf_pos, sensor_schema);
+        case (3 << 1):
+            return decodeFixedWidth<3, false>(sensor_data, valid, buffer, buf_pos, sensor_schema);
+        case (3 << 1) | 1:
+            return decodeFixedWidth<3, true>(sensor_data, valid, buffer, buf_pos, sensor_schema);
+        case (4 << 1):
+            return decodeFixedWidth<4, false>(sensor_data, valid, buffer, buf_pos, sensor_schema);
+        case (4 << 1) | 1:
+            return decodeFixedWidth<4, true>(sensor_data, valid, buffer, buf_pos, sensor_schema);
+        default:
+            *valid = false;
+            return buf_pos;
     }
-
-    if ((sensor_schema->is_signed && (data_to_decode == 0x7F7F7F7F)) || (data_to_decode == 0xFFFFFFFF)) {
-        *valid = false;
-    } else {
-        *valid = true;
-        *sensor_data = (T)(((double)data_to_decode) / (double)sensor_schema->scale_factor);
-    }
-
-    // return the new buffer length
-    return (buf_pos + i);
 }
 
 /**
@@ -133,22 +163,22 @@ uint8_t decodeDataWithSchema(T *sensor_data, bool *valid, uint8_t *buffer, uint8
  * sensorPortSchema.
  */
 
-uint8_t sensorPortSchema::decodeData(uint8_t *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const {
+uint8_t sensorPortSchema::decodeData(uint8_t *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const {
     return (decodeDataWithSchema(sensor_data, valid, buffer, buff_pos, this));
 }
 
-uint8_t sensorPortSchema::decodeData(uint16_t *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const {
+uint8_t sensorPortSchema::decodeData(uint16_t *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const {
     return (decodeDataWithSchema(sensor_data, valid, buffer, buff_pos, this));
 }
 
-uint8_t sensorPortSchema::decodeData(uint32_t *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const {
+uint8_t sensorPortSchema::decodeData(uint32_t *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const {
     return (decodeDataWithSchema(sensor_data, valid, buffer, buff_pos, this));
 }
 
-uint8_t sensorPortSchema::decodeData(int *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const {
+uint8_t sensorPortSchema::decodeData(int *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const {
     return (decodeDataWithSchema(sensor_data, valid, buffer, buff_pos, this));
 }
 
-uint8_t sensorPortSchema::decodeData(float *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const {
+uint8_t sensorPortSchema::decodeData(float *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const {
     return (decodeDataWithSchema(sensor_data, valid, buffer, buff_pos, this));
 }
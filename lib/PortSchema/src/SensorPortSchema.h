@@ -14,6 +14,10 @@
  */
 
 #include <math.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "BitStream.h"
 
 /**
  * @brief Struct with data from sensors and their validity.
@@ -46,6 +50,14 @@ struct sensorData {
         float longitude;
         bool is_valid;
     } location; /**< Location latitude & longitude in degrees. */
+    struct {
+        float value;
+        bool is_valid;
+    } analog_mv; /**< Analog sensor (e.g. RAK5801 4-20mA or RAK5811 0-5V): mV at the sensor. */
+    struct {
+        uint32_t value;
+        bool is_valid;
+    } timestamp; /**< When the sample was taken: Unix time in s (see WallClock.h). Invalid until the clock is set. */
 };
 
 /** @brief sensorPortSchema describes how each sensors data should be encoded. */
@@ -56,15 +68,40 @@ class sensorPortSchema {
     float scale_factor; /**< Only int values are encoded. To send a float value, mulitply by scale_factor to encode;
                              then divide by scale_factor to decode. */
     bool is_signed;     /**< Value has a sign and hence can be negative. */
+    uint8_t n_bits = 0; /**< Total length in bits, for values that aren't a whole number of bytes wide. Leave as 0
+                             (n_bytes * 8) for byte aligned values, and set n_bytes to 0 otherwise. */
+    float offset = 0;   /**< Subtracted before scaling to encode; added back after decoding. Shifts the range of the
+                             value so a narrower field can hold it, e.g. air pressure from 30000 Pa. */
+
+    /**
+     * @brief Number of bytes used to encode each value, as n_bytes is split equally amongst n_values.
+     * @return Bytes per value, 0 if the schema isn't byte aligned.
+     */
+    constexpr uint8_t bytesPerValue(void) const { return (n_bytes / n_values); };
+
+    /**
+     * @brief Number of bits used to encode each value, as the length is split equally amongst n_values.
+     * @return Bits per value.
+     */
+    constexpr uint8_t bitsPerValue(void) const { return (n_bits != 0) ? (n_bits / n_values) : (8 * bytesPerValue()); };
+
+    /**
+     * @brief Check if each value is a whole number of bytes wide, and so can be encoded by encodeData().
+     * @return True if byte aligned.
+     */
+    constexpr bool isByteAligned(void) const { return ((bitsPerValue() % 8) == 0); };
 
     /**
      * @brief Byte encodes the given sensor data into the payload according to the sensor port schema.
-     * @details Calls a template function defined in PortSchema.cpp that can take in sensor_data of various types.
+     * @details Dispatches on the schema's width & sign to a fixedWidthField (below) at runtime. When the schema is
+     * known at compile time use fieldCodec<schema>::encode() instead, which is what portSchema does.
+     * Only byte aligned schemas are supported, see isByteAligned(). Nothing is encoded for other schemas.
      * Feel free to add a new sensor_data type overload of encodeData() if necessary.
      * If the sensor data is not valid, for whatever reason, a value close to max (for the number of bytes) will be
      * encoded instead. The decoder then knows to ignore the data as it is invalid. If the data is invalid a segment of
      * 0x7F7F7F7F (signed) or 0xFFFFFFFF (unsigned) will be encoded and sent instead of the invalid data. E.g. For an
-     * invalid 2 byte signed the value will be 0x7f7f.
+     * invalid 2 byte signed the value will be 0x7f7f. Valid data is clamped to the range of the field, stopping short
+     * of the invalid value.
      * @param sensor_data Sensor data to encode (valid data types: int, float, uint8_t, uint16_t, uint32_t).
      * @param valid Validity of given sensor data.
      * @param payload_buffer Payload buffer for data to be written into.
@@ -79,7 +116,9 @@ class sensorPortSchema {
 
     /**
      * @brief Byte decodes the given buffer into the sensor data according to the given sensor port schema.
-     * @details Calls a template function defined in PortSchema.cpp that can return sensor_data of various types.
+     * @details Dispatches on the schema's width & sign to a fixedWidthField (below) at runtime. When the schema is
+     * known at compile time use fieldCodec<schema>::decode() instead, which is what portSchema does.
+     * Only byte aligned schemas are supported, see isByteAligned(). Other schemas are decoded as invalid.
      * Feel free to add a new sensor_data type overload of decodeData() if necessary.
      * If the sensor data is not valid, for whatever reason, the valid flag will be set to false and no data will be
      * decoded to sensor_data.
@@ -89,69 +128,76 @@ class sensorPortSchema {
      * @param buf_pos Start decoding from this byte, used to avoid header data.
      * @return Total length of data decoded from buffer.
      */
-    uint8_t decodeData(int *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const;
-    uint8_t decodeData(float *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const;
-    uint8_t decodeData(uint8_t *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const;
-    uint8_t decodeData(uint16_t *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const;
-    uint8_t decodeData(uint32_t *sensor_data, bool *valid, uint8_t *buffer, uint8_t buff_pos) const;
+    uint8_t decodeData(int *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const;
+    uint8_t decodeData(float *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const;
+    uint8_t decodeData(uint8_t *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const;
+    uint8_t decodeData(uint16_t *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const;
+    uint8_t decodeData(uint32_t *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buff_pos) const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // SCHEMA DEFINITIONS: See readme for definitions in tabular format.
 
-static const sensorPortSchema timestampSchema = { // units: s
+static constexpr sensorPortSchema timestampSchema = { // units: s
     .n_bytes = 4,
     .n_values = 1,
     .scale_factor = 1,
     .is_signed = false
 };
 
-static const sensorPortSchema batteryVoltageSchema = { // units: mV
+static constexpr sensorPortSchema batteryVoltageSchema = { // units: mV
     .n_bytes = 2,
     .n_values = 1,
     .scale_factor = 1,
     .is_signed = false
 };
 
-static const sensorPortSchema temperatureSchema = { // units: degrees C
+static constexpr sensorPortSchema temperatureSchema = { // units: degrees C
     .n_bytes = 2,
     .n_values = 1,
-    .scale_factor = pow(10.0, 2), // 2 decimal places
+    .scale_factor = 1e2F, // 10^2: 2 decimal places
     .is_signed = true
 };
 
 /** NOTE: relativeHumidity could instead have the same schema as temperature if more resolution is desired. */
-static const sensorPortSchema relativeHumiditySchema = { // units: %
+static constexpr sensorPortSchema relativeHumiditySchema = { // units: %
     .n_bytes = 1,
     .n_values = 1,
     .scale_factor = (float)(UINT8_MAX / 100.0), // percentage (0->100) is scaled to a byte (0->255)
     .is_signed = false
 };
 
-static const sensorPortSchema airPressureSchema = { // units: Pa
+static constexpr sensorPortSchema airPressureSchema = { // units: Pa
     .n_bytes = 4,
     .n_values = 1,
     .scale_factor = 1,
     .is_signed = false
 };
 
-static const sensorPortSchema gasResistanceSchema = { // units: ??
+static constexpr sensorPortSchema gasResistanceSchema = { // units: ??
     .n_bytes = 4,
     .n_values = 1,
     .scale_factor = 1,
     .is_signed = false
 };
 
-static const sensorPortSchema locationSchema = { // units: degrees
+static constexpr sensorPortSchema locationSchema = { // units: degrees
     .n_bytes = 8,                                // split equally: 4 bytes lat, 4 bytes lng
     .n_values = 2,                               // lat and lng
-    .scale_factor = pow(10.0, 4),                // 4 decimal places
+    .scale_factor = 1e4F,                        // 10^4: 4 decimal places
     .is_signed = true
 };
 
+static constexpr sensorPortSchema analogSchema = { // units: mV
+    .n_bytes = 2,
+    .n_values = 1,
+    .scale_factor = 1,
+    .is_signed = false
+};
+
 /* An example of a new sensor:
-static const sensorPortSchema newSensorSchema = {
+static constexpr sensorPortSchema newSensorSchema = {
     .n_bytes = 1,
     .n_values = 1,
     .scale_factor = 1,
@@ -159,4 +205,380 @@ static const sensorPortSchema newSensorSchema = {
 };
 */
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// COMPACT SCHEMA DEFINITIONS: Sub-byte versions of the schemas above, used by the compact ports (see PortSchema.h).
+// Each is only as wide as the range & resolution of the sensor needs.
+
+static constexpr sensorPortSchema compactBatteryVoltageSchema = { // units: mV
+    .n_bytes = 0,
+    .n_values = 1,
+    .scale_factor = 1,
+    .is_signed = false,
+    .n_bits = 12,   // 2000 -> 6094 mV
+    .offset = 2000
+};
+
+static constexpr sensorPortSchema compactTemperatureSchema = { // units: degrees C
+    .n_bytes = 0,
+    .n_values = 1,
+    .scale_factor = 1e1F, // 10^1: 1 decimal place
+    .is_signed = true,
+    .n_bits = 11          // -102.4 -> 102.2 degrees C
+};
+
+static constexpr sensorPortSchema compactRelativeHumiditySchema = { // units: %
+    .n_bytes = 0,
+    .n_values = 1,
+    .scale_factor = 1,
+    .is_signed = false,
+    .n_bits = 7 // 0 -> 126 %
+};
+
+static constexpr sensorPortSchema compactAirPressureSchema = { // units: Pa
+    .n_bytes = 0,
+    .n_values = 1,
+    .scale_factor = 1,
+    .is_signed = false,
+    .n_bits = 17,   // 30000 -> 161070 Pa
+    .offset = 30000
+};
+
+static constexpr sensorPortSchema compactGasResistanceSchema = { // units: ??
+    .n_bytes = 0,
+    .n_values = 1,
+    .scale_factor = 1e-2F, // resolution of 100
+    .is_signed = false,
+    .n_bits = 18           // 0 -> 26214200
+};
+
+static constexpr sensorPortSchema compactLocationSchema = { // units: degrees
+    .n_bytes = 0,
+    .n_values = 2,        // lat and lng
+    .scale_factor = 1e4F, // 10^4: 4 decimal places
+    .is_signed = true,
+    .n_bits = 44          // split equally: 22 bits lat, 22 bits lng (-209.7152 -> 209.7150 degrees)
+};
+
+static constexpr sensorPortSchema compactAnalogSchema = { // units: mV
+    .n_bytes = 0,
+    .n_values = 1,
+    .scale_factor = 1,
+    .is_signed = false,
+    .n_bits = 13 // 0 -> 8190 mV
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// FIELD CODECS
+
+/**
+ * @brief Big-endian (MSB first) byte order for a field of BYTES bytes.
+ * Specialised for each width so every read/write is fully unrolled, with no loop or branch per byte.
+ * @tparam BYTES Width of the field in bytes (1-4).
+ */
+template <uint8_t BYTES> struct bigEndian;
+
+template <> struct bigEndian<1> {
+    static inline void write(uint32_t bits, uint8_t *buffer) { buffer[0] = (uint8_t)bits; }
+    static inline uint32_t read(const uint8_t *buffer) { return buffer[0]; }
+};
+
+template <> struct bigEndian<2> {
+    static inline void write(uint32_t bits, uint8_t *buffer) {
+        buffer[0] = (uint8_t)(bits >> 8);
+        buffer[1] = (uint8_t)bits;
+    }
+    static inline uint32_t read(const uint8_t *buffer) { return (((uint32_t)buffer[0] << 8) | buffer[1]); }
+};
+
+template <> struct bigEndian<3> {
+    static inline void write(uint32_t bits, uint8_t *buffer) {
+        buffer[0] = (uint8_t)(bits >> 16);
+        buffer[1] = (uint8_t)(bits >> 8);
+        buffer[2] = (uint8_t)bits;
+    }
+    static inline uint32_t read(const uint8_t *buffer) {
+        return (((uint32_t)buffer[0] << 16) | ((uint32_t)buffer[1] << 8) | buffer[2]);
+    }
+};
+
+template <> struct bigEndian<4> {
+    static inline void write(uint32_t bits, uint8_t *buffer) {
+        buffer[0] = (uint8_t)(bits >> 24);
+        buffer[1] = (uint8_t)(bits >> 16);
+        buffer[2] = (uint8_t)(bits >> 8);
+        buffer[3] = (uint8_t)bits;
+    }
+    static inline uint32_t read(const uint8_t *buffer) {
+        return (((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3]);
+    }
+};
+
+/**
+ * @brief A BITS wide, optionally signed integer field, and the scaling of sensor data to/from it.
+ * @details All maths is done in 32 bits: integer data with an integer scale factor (and no offset) is scaled with
+ * integer maths only, anything else in single precision float (which the nRF52840 has hardware for). Nothing uses
+ * double or long long. Scaled values are truncated towards zero, then clamped to [MIN_RAW, MAX_RAW] so valid data can
+ * never wrap around or be encoded as the INVALID marker.
+ * The field is read/written MSB first through a bitWriter/bitReader, so it can start at any bit of the payload.
+ * @tparam BITS Width of the field in bits (2-32).
+ * @tparam SIGNED Field is two's complement signed.
+ */
+template <uint8_t BITS, bool SIGNED> struct bitField {
+    static_assert((BITS >= 2) && (BITS <= 32), "fields must be 2-32 bits wide");
+
+    typedef typename std::conditional<SIGNED, int32_t, uint32_t>::type raw_t; /**< Type of the unscaled field value. */
+
+    static constexpr uint32_t MASK = (UINT32_MAX >> (32 - BITS)); /**< Bits used by the field. */
+    static constexpr uint32_t SIGN_BIT = ((MASK >> 1) + 1);       /**< MSB of the field. */
+    /** Marker encoded for invalid data: 0x7F... (signed) or 0xFF... (unsigned) cut down to the field width for whole
+     * bytes, otherwise the largest signed value (0b011...1) or all ones. */
+    static constexpr uint32_t INVALID = SIGNED ? (((BITS % 8) == 0) ? (0x7F7F7F7FUL & MASK) : (MASK >> 1)) : MASK;
+    static constexpr raw_t MIN_RAW = SIGNED ? (raw_t)(-(int32_t)(MASK >> 1) - 1) : 0; /**< Smallest valid value. */
+    static constexpr raw_t MAX_RAW = (raw_t)(INVALID - 1);                             /**< Largest valid value. */
+
+    /**
+     * @brief Write the field to a bit stream.
+     * @param raw Unscaled field value.
+     * @param writer Bit stream to write the BITS bits to.
+     */
+    static inline void write(raw_t raw, bitWriter *writer) { writer->write((uint32_t)raw & MASK, BITS); }
+
+    /**
+     * @brief Read the field from a bit stream, sign extending it if it's signed.
+     * @param reader Bit stream to read the BITS bits from.
+     * @param valid Set to false if the field holds the INVALID marker or is missing from the stream, true otherwise.
+     * @return Unscaled field value.
+     */
+    static inline raw_t read(bitReader *reader, bool *valid) {
+        uint32_t bits = INVALID;
+        reader->read(&bits, BITS);
+        return fromBits(bits, valid);
+    }
+
+    /**
+     * @brief Convert the bits of the field to its value, sign extending it if it's signed.
+     * @param bits Field bits.
+     * @param valid Set to false if the field holds the INVALID marker, true otherwise.
+     * @return Unscaled field value.
+     */
+    static inline raw_t fromBits(uint32_t bits, bool *valid) {
+        *valid = (bits != INVALID);
+        if constexpr (SIGNED) {
+            // flipping then subtracting the sign bit sign extends it through the upper bits
+            return (raw_t)((bits ^ SIGN_BIT) - SIGN_BIT);
+        }
+        return (raw_t)bits;
+    }
+
+    /**
+     * @brief Scale sensor data to the field with float maths, clamping it to the field range.
+     * @param sensor_data Sensor data to scale (NaN should be treated as invalid before calling this).
+     * @param scale_factor Schema scale factor.
+     * @return Unscaled field value.
+     */
+    static inline raw_t scaleFloat(float sensor_data, float scale_factor) {
+        float scaled = sensor_data * scale_factor;
+        /* The bounds are compared as floats before converting, as converting an out of range float is undefined.
+         * If (float)MAX_RAW rounds up past MAX_RAW every float below it still fits, so this is safe either way. */
+        if (scaled <= (float)MIN_RAW) {
+            return MIN_RAW;
+        }
+        if (scaled >= (float)MAX_RAW) {
+            return MAX_RAW;
+        }
+        return (raw_t)scaled;
+    }
+
+    /**
+     * @brief Scale integer sensor data to the field with integer maths, clamping it to the field range.
+     * @details The data is clamped to [MIN_RAW / scale, MAX_RAW / scale] before it's multiplied, so it can't overflow.
+     * @param sensor_data Sensor data to scale.
+     * @param scale Schema scale factor as an integer (>= 1).
+     * @return Unscaled field value.
+     */
+    template <typename T> static inline raw_t scaleInteger(T sensor_data, int32_t scale) {
+        static_assert(std::is_integral<T>::value, "only integer data can be scaled with integer maths");
+        if constexpr (std::is_signed<T>::value) {
+            if (sensor_data < 0) {
+                if (!SIGNED || ((int32_t)sensor_data < (int32_t)(MIN_RAW / scale))) {
+                    return MIN_RAW;
+                }
+                return (raw_t)((int32_t)sensor_data * scale);
+            }
+        }
+        if ((uint32_t)sensor_data > (uint32_t)(MAX_RAW / scale)) {
+            return MAX_RAW;
+        }
+        return (raw_t)((uint32_t)sensor_data * (uint32_t)scale);
+    }
+
+    /**
+     * @brief Unscale the field to sensor data with float maths.
+     * @param raw Unscaled field value.
+     * @param scale_factor Schema scale factor.
+     * @return Sensor data.
+     */
+    template <typename T> static inline T unscaleFloat(raw_t raw, float scale_factor) {
+        return (T)((float)raw / scale_factor);
+    }
+
+    /**
+     * @brief Unscale the field to integer sensor data with integer maths (truncating towards zero).
+     * @param raw Unscaled field value.
+     * @param scale Schema scale factor as an integer (>= 1).
+     * @return Sensor data.
+     */
+    template <typename T> static inline T unscaleInteger(raw_t raw, int32_t scale) { return (T)(raw / (raw_t)scale); }
+};
+
+/**
+ * @brief A byte aligned bitField, which can also be read/written straight from/to a byte in the buffer.
+ * @tparam BYTES Width of the field in bytes (1-4).
+ * @tparam SIGNED Field is two's complement signed.
+ */
+template <uint8_t BYTES, bool SIGNED> struct fixedWidthField : bitField<8 * BYTES, SIGNED> {
+    static_assert((BYTES >= 1) && (BYTES <= 4), "fields must be 1-4 bytes wide");
+
+    typedef bitField<8 * BYTES, SIGNED> bits;
+    typedef typename bits::raw_t raw_t;
+    using bits::read;
+    using bits::write;
+
+    /**
+     * @brief Write the field to the buffer.
+     * @param raw Unscaled field value.
+     * @param buffer Buffer to write the BYTES bytes to.
+     */
+    static inline void write(raw_t raw, uint8_t *buffer) { bigEndian<BYTES>::write((uint32_t)raw, buffer); }
+
+    /**
+     * @brief Read the field from the buffer, sign extending it if it's signed.
+     * @param buffer Buffer to read the BYTES bytes from.
+     * @param valid Set to false if the field holds the INVALID marker, true otherwise.
+     * @return Unscaled field value.
+     */
+    static inline raw_t read(const uint8_t *buffer, bool *valid) {
+        return bits::fromBits(bigEndian<BYTES>::read(buffer), valid);
+    }
+};
+
+/**
+ * @brief The scale factor as an integer, if it is a whole number that integer data can be multiplied by.
+ * @param scale_factor Schema scale factor.
+ * @return scale_factor as an integer, or 0 if it needs float maths.
+ */
+constexpr int32_t integerScale(float scale_factor) {
+    return ((scale_factor >= 1) && (scale_factor <= (float)INT32_MAX) && (scale_factor == (float)(int32_t)scale_factor))
+               ? (int32_t)scale_factor
+               : 0;
+}
+
+/**
+ * @brief Encoder/decoder for one sensorPortSchema, with all of the schema's parameters known at compile time.
+ * @details e.g. fieldCodec<temperatureSchema>::encode(21.37F, true, buffer, pos) compiles down to a float multiply,
+ * clamp and two byte stores. Use this over sensorPortSchema::encodeData()/decodeData() wherever the schema is fixed.
+ * Byte aligned schemas can be encoded at a byte position of a buffer or into a bit stream, others only into a bit
+ * stream.
+ * @tparam SCHEMA The sensor's schema e.g. temperatureSchema.
+ */
+template <const sensorPortSchema &SCHEMA> struct fieldCodec {
+    static constexpr uint8_t BITS = SCHEMA.bitsPerValue(); /**< Width of each value in bits. */
+    typedef bitField<BITS, SCHEMA.is_signed> field;        /**< The field each value is encoded to. */
+    typedef typename field::raw_t raw_t;                   /**< Type of the unscaled field value. */
+    /** Scale factor for integer maths, or 0 if float maths is needed. */
+    static constexpr int32_t INTEGER_SCALE = (SCHEMA.offset == 0) ? integerScale(SCHEMA.scale_factor) : 0;
+
+    /**
+     * @brief Scale one value to the field, or INVALID if it's invalid.
+     * @param sensor_data Sensor data to scale.
+     * @param valid Validity of given sensor data.
+     * @return Unscaled field value.
+     */
+    template <typename T> static inline raw_t toRaw(T sensor_data, bool valid) {
+        raw_t raw;
+        if constexpr (std::is_integral<T>::value && (INTEGER_SCALE != 0)) {
+            raw = field::scaleInteger(sensor_data, INTEGER_SCALE);
+        } else {
+            valid = valid && !isnan((float)sensor_data);
+            if constexpr (SCHEMA.offset != 0) {
+                raw = field::scaleFloat((float)sensor_data - SCHEMA.offset, SCHEMA.scale_factor);
+            } else {
+                raw = field::scaleFloat((float)sensor_data, SCHEMA.scale_factor);
+            }
+        }
+        return valid ? raw : (raw_t)field::INVALID;
+    }
+
+    /**
+     * @brief Unscale one valid field value to sensor data.
+     * @param raw Unscaled field value.
+     * @return Sensor data.
+     */
+    template <typename T> static inline T fromRaw(raw_t raw) {
+        if constexpr (std::is_integral<T>::value && (INTEGER_SCALE != 0)) {
+            return field::template unscaleInteger<T>(raw, INTEGER_SCALE);
+        } else if constexpr (SCHEMA.offset != 0) {
+            return (T)(((float)raw / SCHEMA.scale_factor) + SCHEMA.offset);
+        } else {
+            return field::template unscaleFloat<T>(raw, SCHEMA.scale_factor);
+        }
+    }
+
+    /**
+     * @brief Encode one value at a byte of the buffer, as sensorPortSchema::encodeData(). Byte aligned schemas only.
+     * @param sensor_data Sensor data to encode.
+     * @param valid Validity of given sensor data.
+     * @param payload_buffer Payload buffer for data to be written into.
+     * @param buf_pos Start encoding from this byte.
+     * @return New total length of data encoded to payload_buffer - includes buf_pos.
+     */
+    template <typename T> static inline uint8_t encode(T sensor_data, bool valid, uint8_t *payload_buffer, uint8_t buf_pos) {
+        static_assert(SCHEMA.isByteAligned(), "only byte aligned schemas can be encoded at a byte, use a bitWriter");
+        fixedWidthField<BITS / 8, SCHEMA.is_signed>::write(toRaw(sensor_data, valid), &payload_buffer[buf_pos]);
+        return (buf_pos + (BITS / 8));
+    }
+
+    /**
+     * @brief Encode one value into a bit stream.
+     * @param sensor_data Sensor data to encode.
+     * @param valid Validity of given sensor data.
+     * @param writer Bit stream to write BITS bits to.
+     */
+    template <typename T> static inline void encode(T sensor_data, bool valid, bitWriter *writer) {
+        field::write(toRaw(sensor_data, valid), writer);
+    }
+
+    /**
+     * @brief Decode one value from a byte of the buffer, as sensorPortSchema::decodeData(). Byte aligned schemas only.
+     * @param sensor_data Resulting decoded sensor data, left untouched if it's invalid.
+     * @param valid Validity of the decoded sensor data.
+     * @param buffer Buffer that data will be decoded from.
+     * @param buf_pos Start decoding from this byte.
+     * @return New total length of data decoded from buffer - includes buf_pos.
+     */
+    template <typename T> static inline uint8_t decode(T *sensor_data, bool *valid, const uint8_t *buffer, uint8_t buf_pos) {
+        static_assert(SCHEMA.isByteAligned(), "only byte aligned schemas can be decoded at a byte, use a bitReader");
+        raw_t raw = fixedWidthField<BITS / 8, SCHEMA.is_signed>::read(&buffer[buf_pos], valid);
+        if (*valid) {
+            *sensor_data = fromRaw<T>(raw);
+        }
+        return (buf_pos + (BITS / 8));
+    }
+
+    /**
+     * @brief Decode one value from a bit stream.
+     * @param sensor_data Resulting decoded sensor data, left untouched if it's invalid.
+     * @param valid Validity of the decoded sensor data, false if it's missing from the stream.
+     * @param reader Bit stream to read BITS bits from.
+     */
+    template <typename T> static inline void decode(T *sensor_data, bool *valid, bitReader *reader) {
+        raw_t raw = field::read(reader, valid);
+        if (*valid) {
+            *sensor_data = fromRaw<T>(raw);
+        }
+    }
+};
+
 #endif // SENSOR_PORT_SCHEMA_H
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "CycleCounter.h"
+
+#ifdef ARDUINO_ARCH_NRF52
+
+void cycleCounterInit(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // enable the trace & debug blocks (DWT)
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#else
+
+#include <chrono>
+
+static std::chrono::steady_clock::time_point counter_start = std::chrono::steady_clock::now();
+
+void cycleCounterInit(void) {
+    counter_start = std::chrono::steady_clock::now();
+}
+
+uint32_t cycleCounterRead(void) {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - counter_start)
+        .count();
+}
+
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+/**
+ * @file CycleCounter.h
+ * @author Kalina Knight
+ * @brief A free running counter for timing short sections of code.
+ * On the RAK4631 (nRF52840) this is the Cortex-M4 DWT cycle counter, which counts CPU cycles at 64MHz.
+ * On the host (native environment) it counts nanoseconds of the steady clock.
+ *
+ * The counter is 32-bit, so a single measurement can't be longer than ~67s on the RAK4631 or ~4.2s on the host.
+ * Always subtract counts as uint32_t so a wrap between two reads is handled.
+ *
+ * @version 0.1
+ * @date 2022-02-14
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#ifdef ARDUINO_ARCH_NRF52
+#define CYCLE_COUNTER_HZ F_CPU /**< CPU clock = 64MHz. */
+#else
+#define CYCLE_COUNTER_HZ 1000000000UL /**< Steady clock nanoseconds. */
+#endif
+
+/**
+ * @brief Enable the cycle counter. Must be called once before cycleCounterRead().
+ */
+void cycleCounterInit(void);
+
+/**
+ * @brief Read the cycle counter.
+ * @return Current count.
+ */
+#ifdef ARDUINO_ARCH_NRF52
+inline uint32_t cycleCounterRead(void) {
+    return DWT->CYCCNT;
+}
+#else
+uint32_t cycleCounterRead(void);
+#endif
+
+/**
+ * @brief Convert a number of cycles to nanoseconds.
+ * @param cycles Number of cycles (the difference between two reads).
+ * @return Nanoseconds.
+ */
+inline uint64_t cyclesToNs(uint32_t cycles) {
+    return (((uint64_t)cycles * 1000000000ULL) / CYCLE_COUNTER_HZ);
+}
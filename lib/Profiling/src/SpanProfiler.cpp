@@ -0,0 +1,134 @@
+#include "SpanProfiler.h"
+
+#include "CycleCounter.h"
+
+#ifdef ARDUINO_ARCH_NRF52
+#define SPAN_CYCLE_CLOCK_HZ  CYCLE_COUNTER_HZ
+#define SPAN_UPTIME_CLOCK_HZ configTICK_RATE_HZ /**< The FreeRTOS tick, from the RTC. */
+#else
+#include "NativeSim.h"
+#define SPAN_CYCLE_CLOCK_HZ  1000000UL /**< Simulated microseconds. */
+#define SPAN_UPTIME_CLOCK_HZ 1000000UL /**< Simulated microseconds. */
+#endif
+
+#define SPAN_CAN_SLEEP 0x01 /**< Can sleep, so it's timed with the uptime tick: the cycle counter stops in WFE. */
+#define SPAN_UNPAIRED  0x02 /**< Begun & ended in different places, so a begin restarts it rather than nesting. */
+
+// how each span is timed, see SPAN_CAN_SLEEP & SPAN_UNPAIRED
+static const uint8_t span_flags[] = {
+    SPAN_CAN_SLEEP | SPAN_UNPAIRED, // WAKE, incl. the sensor reads
+    SPAN_CAN_SLEEP,                 // SENSOR_INIT, the sensors' init delays
+    SPAN_CAN_SLEEP,                 // SENSOR_READ, while the sensors convert
+    0,                              // ENCODE
+    0,                              // LOGGING
+    0,                              // LORAWAN_SEND
+    SPAN_CAN_SLEEP | SPAN_UNPAIRED, // RX_WINDOWS, ended by the LoRaWAN handlers
+};
+static_assert(sizeof(span_flags) / sizeof(span_flags[0]) == (size_t)SPAN::N_SPANS, "Flag the new SPAN.");
+
+/**
+ * @brief A span's times, in ticks of its span clock.
+ */
+struct spanTimes {
+    uint32_t count;
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint64_t total_ticks;
+    uint32_t begin_ticks; /**< Clock at the outermost begin. */
+    uint8_t depth;        /**< Begins not ended yet. */
+};
+
+static spanTimes spans[(size_t)SPAN::N_SPANS] = {};
+
+/**
+ * @brief Read the clock of a span: the uptime tick if it can sleep, otherwise the cycle counter.
+ * @param span The span.
+ * @return Ticks, see SPAN_UPTIME_CLOCK_HZ & SPAN_CYCLE_CLOCK_HZ.
+ */
+static inline uint32_t spanClockRead(SPAN span) {
+#ifdef ARDUINO_ARCH_NRF52
+    if (span_flags[(size_t)span] & SPAN_CAN_SLEEP) {
+        return xTaskGetTickCount();
+    }
+    return cycleCounterRead();
+#else
+    (void)span;
+    return (uint32_t)nativeSimMicros();
+#endif
+}
+
+/**
+ * @brief Convert ticks of a span's clock to microseconds.
+ * @param span The span.
+ * @param ticks Ticks.
+ * @return Microseconds.
+ */
+static inline uint32_t spanTicksToMicros(SPAN span, uint64_t ticks) {
+    uint32_t clock_hz = (span_flags[(size_t)span] & SPAN_CAN_SLEEP) ? SPAN_UPTIME_CLOCK_HZ : SPAN_CYCLE_CLOCK_HZ;
+    return (uint32_t)((ticks * 1000000ULL) / clock_hz);
+}
+
+void initSpans(void) {
+#ifdef ARDUINO_ARCH_NRF52
+    cycleCounterInit();
+#endif
+    for (spanTimes &times : spans) {
+        times = {};
+    }
+}
+
+void spanBegin(SPAN span) {
+    spanTimes &times = spans[(size_t)span];
+    if (span_flags[(size_t)span] & SPAN_UNPAIRED) {
+        // an end that never came (e.g. a missed LoRaWAN handler) mustn't stop it being timed again
+        times.depth = 1;
+        times.begin_ticks = spanClockRead(span);
+        return;
+    }
+    if (times.depth++ == 0) {
+        times.begin_ticks = spanClockRead(span);
+    }
+}
+
+void spanEnd(SPAN span) {
+    spanTimes &times = spans[(size_t)span];
+    if ((times.depth == 0) || (--times.depth != 0)) {
+        return;
+    }
+    uint32_t ticks = spanClockRead(span) - times.begin_ticks; // as uint32_t, so a wrap is handled
+    if ((times.count == 0) || (ticks < times.min_ticks)) {
+        times.min_ticks = ticks;
+    }
+    if (ticks > times.max_ticks) {
+        times.max_ticks = ticks;
+    }
+    times.total_ticks += ticks;
+    times.count++;
+}
+
+spanStats getSpanStats(SPAN span) {
+    const spanTimes &times = spans[(size_t)span];
+    if (times.count == 0) {
+        return {};
+    }
+    return { times.count, spanTicksToMicros(span, times.min_ticks),
+             spanTicksToMicros(span, times.total_ticks / times.count), spanTicksToMicros(span, times.max_ticks) };
+}
+
+void resetSpans(void) {
+    for (spanTimes &times : spans) {
+        // keep the begin of a span being timed
+        times.count = 0;
+        times.min_ticks = 0;
+        times.max_ticks = 0;
+        times.total_ticks = 0;
+    }
+}
+
+uint8_t encodeSpanReport(uint8_t *buffer, uint8_t max_len) {
+    spanStats stats[(size_t)SPAN::N_SPANS];
+    for (uint8_t s = 0; s < (uint8_t)SPAN::N_SPANS; s++) {
+        stats[s] = getSpanStats((SPAN)s);
+    }
+    return encodeSpanReport(stats, buffer, max_len);
+}
@@ -0,0 +1,104 @@
+#pragma once
+/**
+ * @file SpanProfiler.h
+ * @author Kalina Knight
+ * @brief Named spans for finding out what the awake time is spent on: each span's min/avg/max time is kept, to be
+ * logged or sent as a compact diagnostics uplink. The spans & the report's format are in SpanReport.h.
+ *
+ * The libraries mark their spans with SPAN_SCOPE(), or SPAN_BEGIN() & SPAN_END() for a span that ends somewhere else
+ * (e.g. in a callback). These compile to nothing unless APP_PROFILE_SPANS is 1. A span that's begun again before it's
+ * ended (e.g. a function that calls itself) is only timed from the outermost begin to the outermost end, except
+ * the spans begun & ended in different places (WAKE & RX_WINDOWS): a begin restarts them, so an end that never came
+ * (e.g. a missed LoRaWAN handler) only loses that one time. Spans aren't locked, so the few that can be begun by
+ * another task (e.g. LOGGING in a LoRaWAN handler) are best effort.
+ *
+ * On the RAK4631 the spans that can sleep (WAKE, SENSOR_INIT, SENSOR_READ & RX_WINDOWS) are timed with the FreeRTOS
+ * tick (the RTC, ~1 ms resolution), as the cycle counter stops while the CPU sleeps in WFE. The rest are only ever
+ * awake, so they're timed with the cycle counter (CycleCounter.h) to the CPU cycle, but can't be longer than ~67s. On
+ * the host they're all timed in simulated microseconds (NativeSim.h), so delay() & the RX windows count as they would
+ * on the device.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "SpanReport.h" /**< The spans & their report. */
+
+// Set to 1 to time the spans, or with a build flag: -DAPP_PROFILE_SPANS=1 (as the native & wiscore_rak4631
+// environments do). At 0 the SPAN_* macros compile to nothing, e.g. for the benchmarks.
+#ifndef APP_PROFILE_SPANS
+#define APP_PROFILE_SPANS 0
+#endif
+
+/**
+ * @brief Start the span clock & reset the spans. Call once at startup, before any span.
+ */
+void initSpans(void);
+
+/**
+ * @brief Start timing a span. Use SPAN_BEGIN() rather than calling this, so it compiles out.
+ * @param span The span.
+ */
+void spanBegin(SPAN span);
+
+/**
+ * @brief Stop timing a span & add the time to its stats. Ignored if it isn't being timed.
+ * Use SPAN_END() rather than calling this, so it compiles out.
+ * @param span The span.
+ */
+void spanEnd(SPAN span);
+
+/**
+ * @brief Get the times of a span since the spans were last reset.
+ * @param span The span.
+ * @return The times.
+ */
+spanStats getSpanStats(SPAN span);
+
+/**
+ * @brief Reset the stats of every span, e.g. once they're reported. Spans being timed carry on.
+ */
+void resetSpans(void);
+
+/**
+ * @brief Encode the stats of every span into a span report to send on DIAGNOSTICS_PORT, see encodeSpanReport() in
+ * SpanReport.h.
+ * @param buffer Buffer to encode the report into.
+ * @param max_len Length of the buffer.
+ * @return Length of the report, 0 if it doesn't fit.
+ */
+uint8_t encodeSpanReport(uint8_t *buffer, uint8_t max_len);
+
+/**
+ * @brief Times a span until the end of the scope, see SPAN_SCOPE().
+ */
+class spanScope {
+  public:
+    spanScope(SPAN span) : span(span) { spanBegin(span); };
+    ~spanScope() { spanEnd(span); };
+
+  private:
+    const SPAN span;
+};
+
+#if APP_PROFILE_SPANS
+#define SPAN_BEGIN(span)       spanBegin(span)
+#define SPAN_END(span)         spanEnd(span)
+#define SPAN_SCOPE(span)       spanScope SPAN_SCOPE_NAME(__LINE__)(span)
+#define SPAN_SCOPE_NAME(line)  SPAN_SCOPE_NAME_(line)
+#define SPAN_SCOPE_NAME_(line) span_scope_##line
+#else
+#define SPAN_BEGIN(span) \
+    do {                 \
+    } while (0)
+#define SPAN_END(span) \
+    do {               \
+    } while (0)
+#define SPAN_SCOPE(span) \
+    do {                 \
+    } while (0)
+#endif
@@ -0,0 +1,69 @@
+#include "SpanReport.h"
+
+static const char *const span_names[] = { "WAKE",    "SENSOR_INIT",  "SENSOR_READ", "ENCODE",
+                                          "LOGGING", "LORAWAN_SEND", "RX_WINDOWS" };
+static_assert(sizeof(span_names) / sizeof(span_names[0]) == (size_t)SPAN::N_SPANS, "Name the new SPAN.");
+
+/**
+ * @brief Put a time into the span report: mantissa << exponent microseconds, rounded down.
+ * @param buffer Where to put it, 2 bytes.
+ * @param us The time, saturating at SPAN_REPORT_MAX_US so the exponent fits its 4 bits.
+ */
+static void putReportTime(uint8_t *buffer, uint32_t us) {
+    if (us > SPAN_REPORT_MAX_US) {
+        us = SPAN_REPORT_MAX_US;
+    }
+    uint8_t exponent = 0;
+    while ((us >> SPAN_REPORT_MANTISSA_BITS) != 0) {
+        us >>= 1;
+        exponent++;
+    }
+    uint16_t value = (uint16_t)((us << SPAN_REPORT_EXPONENT_BITS) | exponent);
+    buffer[0] = (uint8_t)(value >> 8);
+    buffer[1] = (uint8_t)value;
+}
+
+/**
+ * @brief Get a time out of the span report, see putReportTime().
+ * @param buffer Where it is, 2 bytes.
+ * @return The time in microseconds.
+ */
+static uint32_t getReportTime(const uint8_t *buffer) {
+    uint16_t value = (uint16_t)((buffer[0] << 8) | buffer[1]);
+    return ((uint32_t)(value >> SPAN_REPORT_EXPONENT_BITS) << (value & ((1U << SPAN_REPORT_EXPONENT_BITS) - 1)));
+}
+
+const char *spanName(SPAN span) {
+    return (span < SPAN::N_SPANS) ? span_names[(size_t)span] : "";
+}
+
+uint8_t encodeSpanReport(const spanStats *stats, uint8_t *buffer, uint8_t max_len) {
+    const uint8_t n_spans = (uint8_t)SPAN::N_SPANS;
+    uint8_t len = SPAN_REPORT_HEADER_LENGTH + n_spans * SPAN_REPORT_SPAN_LENGTH;
+    if (len > max_len) {
+        return 0;
+    }
+    buffer[0] = n_spans;
+    uint8_t *span_buffer = &buffer[SPAN_REPORT_HEADER_LENGTH];
+    for (uint8_t s = 0; s < n_spans; s++, span_buffer += SPAN_REPORT_SPAN_LENGTH) {
+        span_buffer[0] = (stats[s].count > UINT8_MAX) ? UINT8_MAX : (uint8_t)stats[s].count;
+        putReportTime(&span_buffer[1], stats[s].min_us);
+        putReportTime(&span_buffer[3], stats[s].avg_us);
+        putReportTime(&span_buffer[5], stats[s].max_us);
+    }
+    return len;
+}
+
+uint8_t decodeSpanReport(const uint8_t *buffer, uint8_t len, spanStats *stats, uint8_t max_spans) {
+    if ((len < SPAN_REPORT_HEADER_LENGTH) ||
+        (len < (SPAN_REPORT_HEADER_LENGTH + buffer[0] * SPAN_REPORT_SPAN_LENGTH))) {
+        return 0;
+    }
+    uint8_t n_spans = (buffer[0] < max_spans) ? buffer[0] : max_spans;
+    const uint8_t *span_buffer = &buffer[SPAN_REPORT_HEADER_LENGTH];
+    for (uint8_t s = 0; s < n_spans; s++, span_buffer += SPAN_REPORT_SPAN_LENGTH) {
+        stats[s] = { span_buffer[0], getReportTime(&span_buffer[1]), getReportTime(&span_buffer[3]),
+                     getReportTime(&span_buffer[5]) };
+    }
+    return n_spans;
+}
@@ -0,0 +1,81 @@
+#pragma once
+/**
+ * @file SpanReport.h
+ * @author Kalina Knight
+ * @brief The spans & the compact report of their times sent on DIAGNOSTICS_PORT, see SpanProfiler.h for timing them.
+ * Plain C++ without Arduino, so the report can also be decoded on the server (e.g. by the PayloadBatchDecoder).
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DIAGNOSTICS_PORT          203 /**< Port of the span report, in the custom system/control range. */
+#define SPAN_REPORT_HEADER_LENGTH 1   /**< Number of spans. */
+#define SPAN_REPORT_SPAN_LENGTH   7   /**< Count, then the min, avg & max time of a span. */
+#define SPAN_REPORT_MANTISSA_BITS 12  /**< Times are sent as mantissa << exponent microseconds. */
+#define SPAN_REPORT_EXPONENT_BITS 4   /**< So the exponent is at most 15. */
+/** Longest time a report holds, 0xFFF << 15 us = ~134 s. Longer times (e.g. a span timed with the uptime tick) are
+ * sent as this. */
+#define SPAN_REPORT_MAX_US (((1UL << SPAN_REPORT_MANTISSA_BITS) - 1) << ((1U << SPAN_REPORT_EXPONENT_BITS) - 1))
+
+/**
+ * @brief The spans. New spans go before N_SPANS, so the span report stays readable by older decoders.
+ */
+enum class SPAN : uint8_t {
+    WAKE,         /**< A whole wake of the loop task, from the semaphore to sleeping on it again. */
+    SENSOR_INIT,  /**< initSensors(). */
+    SENSOR_READ,  /**< getSensorData(). */
+    ENCODE,       /**< Encoding a frame to send (fillFrame()), or a sample into the queue (sampleQueue::push()). */
+    LOGGING,      /**< Formatting a log into the log buffer. It's written out while the application sleeps. */
+    LORAWAN_SEND, /**< Handing an uplink to the LoRaWAN stack, lmh_send(). */
+    RX_WINDOWS,   /**< From handing an uplink over until it's done with: its time on air & RX windows. */
+    N_SPANS       /**< Number of spans, not a span. */
+};
+
+/**
+ * @brief Times of a span since the spans were last reset, see getSpanStats().
+ */
+struct spanStats {
+    uint32_t count;  /**< Times the span was timed. */
+    uint32_t min_us; /**< Shortest time in microseconds, 0 if never timed. */
+    uint32_t avg_us; /**< Average time in microseconds. */
+    uint32_t max_us; /**< Longest time in microseconds. */
+};
+
+/**
+ * @brief Name of a span, e.g. to log it.
+ * @param span The span.
+ * @return The name, e.g. "SENSOR_READ".
+ */
+const char *spanName(SPAN span);
+
+/**
+ * @brief Encode the stats of every span into a compact report to send on DIAGNOSTICS_PORT:
+ *
+ *     | number of spans | for each span: count (saturates at 255) | min | avg | max |
+ *
+ * Each time is 2 bytes big endian: a 12 bit mantissa then a 4 bit exponent, for mantissa << exponent microseconds,
+ * so up to ~134 s (SPAN_REPORT_MAX_US) to within 0.05%. Longer times saturate at SPAN_REPORT_MAX_US.
+ * @param stats Times of each span, indexed by SPAN.
+ * @param buffer Buffer to encode the report into.
+ * @param max_len Length of the buffer.
+ * @return Length of the report, 0 if it doesn't fit.
+ */
+uint8_t encodeSpanReport(const spanStats *stats, uint8_t *buffer, uint8_t max_len);
+
+/**
+ * @brief Decode a span report made by encodeSpanReport(), e.g. on the server. A report with more spans than
+ * max_spans (e.g. from newer firmware) has its first max_spans decoded.
+ * @param buffer Span report.
+ * @param len Length of the report.
+ * @param stats Times of each span, indexed by SPAN. The count saturates at 255, the times at SPAN_REPORT_MAX_US, &
+ * they're rounded down.
+ * @param max_spans Max number of spans to decode into stats.
+ * @return Number of spans decoded, 0 if the report is invalid (or empty).
+ */
+uint8_t decodeSpanReport(const uint8_t *buffer, uint8_t len, spanStats *stats, uint8_t max_spans);
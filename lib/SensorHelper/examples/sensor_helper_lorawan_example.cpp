@@ -45,7 +45,7 @@ void setup() {
     // initialise the logging module - function does nothing if APP_LOG_LEVEL in
     // Logging.h = NONE
     initLogging();
-    log(LOG_LEVEL::INFO,
+    LOG(LOG_LEVEL::INFO,
         "\n========================================"
         "\nWelcome to Sensor Helper LoRaWAN Example"
         "\n========================================");
@@ -72,13 +72,13 @@ void loop() {
     // payload
     delay(sensor_reading_interval);
     if (isLoRaWANConnected()) {
-        log(LOG_LEVEL::DEBUG, "Send payload");
+        LOG(LOG_LEVEL::DEBUG, "Send payload");
         // fill lora data buffer
         fillPayload();
         // send data
         sendLoRaWANFrame(&lorawan_payload);
     } else {
-        log(LOG_LEVEL::DEBUG, "LoRaWAN not connected. Try again later.");
+        LOG(LOG_LEVEL::DEBUG, "LoRaWAN not connected. Try again later.");
     }
 }
 
@@ -92,7 +92,7 @@ void fillPayload(void) {
     sensorData sensor_data = {};
     sensor_data = getSensorData(&payload_port);
 
-    log(LOG_LEVEL::INFO,
+    LOG(LOG_LEVEL::INFO,
         "b: %.2f %% | t: %.2f C | h: %.2f %% | p: %lu Pa | g: %lu | l: %.5f, "
         "%.5f",
         sensor_data.battery_mv.value, sensor_data.temperature.value, sensor_data.humidity.value, sensor_data.pressure.value,
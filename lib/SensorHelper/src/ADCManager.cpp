@@ -0,0 +1,214 @@
+#define LOG_MODULE_ID LOG_MODULE::SENSORS // see setLogLevel() in Logging.h
+
+#include "ADCManager.h"
+
+#include <nrf.h>
+
+/**
+ * @brief Results of a scan, written by EasyDMA: each SAMPLE task writes a result per channel, in channel order.
+ */
+static int16_t scan_results[ADC_MAX_BURST_SAMPLES * ADC_MAX_CHANNELS];
+
+/**
+ * @brief Get the SAADC analog input of a pin.
+ * The RAK4631's Arduino pin numbers are its GPIO numbers (P0.xx), so this is the nRF52840's AIN mapping.
+ * @param pin Sensor pin number.
+ * @return Analog input 0-7, or -1 if the pin isn't one.
+ */
+static int8_t pinToAnalogInput(uint8_t pin) {
+    switch (pin) {
+        case 2:
+            return 0;
+        case 3:
+            return 1;
+        case 4:
+            return 2;
+        case 5:
+            return 3;
+        case 28:
+            return 4;
+        case 29:
+            return 5;
+        case 30:
+            return 6;
+        case 31:
+            return 7;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * @brief Get the SAADC channel config of an analog reference: the gain & reference that give its input range.
+ * @param analog_ref ADC analog reference.
+ * @return CH[n].CONFIG, less the acquisition time & burst.
+ */
+static uint32_t referenceConfig(_eAnalogReference analog_ref) {
+    uint32_t gain = SAADC_CH_CONFIG_GAIN_Gain1_6;
+    uint32_t reference = SAADC_CH_CONFIG_REFSEL_Internal;
+    switch (analog_ref) {
+        case AR_DEFAULT:
+            // same as case AR_INTERNAL
+        case AR_INTERNAL: // 0.6V Ref * 6 = 0..3.6V
+            gain = SAADC_CH_CONFIG_GAIN_Gain1_6;
+            break;
+        case AR_INTERNAL_3_0: // 0.6V Ref * 5 = 0..3.0V
+            gain = SAADC_CH_CONFIG_GAIN_Gain1_5;
+            break;
+        case AR_INTERNAL_2_4: // 0.6V Ref * 4 = 0..2.4V
+            gain = SAADC_CH_CONFIG_GAIN_Gain1_4;
+            break;
+        case AR_INTERNAL_1_8: // 0.6V Ref * 3 = 0..1.8V
+            gain = SAADC_CH_CONFIG_GAIN_Gain1_3;
+            break;
+        case AR_INTERNAL_1_2: // 0.6V Ref * 2 = 0..1.2V
+            gain = SAADC_CH_CONFIG_GAIN_Gain1_2;
+            break;
+        case AR_VDD4: // VDD/4 Ref * 4 = 0..VDD
+            gain = SAADC_CH_CONFIG_GAIN_Gain1_4;
+            reference = SAADC_CH_CONFIG_REFSEL_VDD1_4;
+            break;
+    }
+    return ((SAADC_CH_CONFIG_RESP_Bypass << SAADC_CH_CONFIG_RESP_Pos) |
+            (SAADC_CH_CONFIG_RESN_Bypass << SAADC_CH_CONFIG_RESN_Pos) | (gain << SAADC_CH_CONFIG_GAIN_Pos) |
+            (reference << SAADC_CH_CONFIG_REFSEL_Pos) | (SAADC_CH_CONFIG_MODE_SE << SAADC_CH_CONFIG_MODE_Pos));
+}
+
+/**
+ * @brief Get the SAADC resolution of a number of bits, as the Arduino core rounds it.
+ * @param resolution ADC resolution in bits.
+ * @return RESOLUTION value.
+ */
+static uint32_t saadcResolution(int resolution) {
+    if (resolution <= 8) {
+        return SAADC_RESOLUTION_VAL_8bit;
+    } else if (resolution <= 10) {
+        return SAADC_RESOLUTION_VAL_10bit;
+    } else if (resolution <= 12) {
+        return SAADC_RESOLUTION_VAL_12bit;
+    }
+    return SAADC_RESOLUTION_VAL_14bit;
+}
+
+/**
+ * @brief Get the SAADC oversampling of a number of samples.
+ * @param oversampling Samples averaged into each result, a power of 2 up to 256. 0 or 1 disables oversampling.
+ * @return OVERSAMPLE value, log2 of the samples.
+ */
+static uint32_t saadcOversample(uint32_t oversampling) {
+    uint32_t oversample = 0;
+    while ((oversample < 8) && ((2UL << oversample) <= oversampling)) {
+        oversample++;
+    }
+    return oversample;
+}
+
+bool adcManager::addSensor(AnalogSensor *sensor) {
+    for (uint8_t i = 0; i < n_channels; i++) {
+        if (channels[i].sensor == sensor) {
+            return true;
+        }
+    }
+    int8_t analog_input = pinToAnalogInput(sensor->getPin());
+    if (analog_input < 0) {
+        LOG(LOG_LEVEL::ERROR, "Pin %u isn't an analog input.", sensor->getPin());
+        return false;
+    }
+    if (n_channels >= ADC_MAX_CHANNELS) {
+        LOG(LOG_LEVEL::ERROR, "Too many sensors to scan, the max is %u.", ADC_MAX_CHANNELS);
+        return false;
+    }
+    channels[n_channels++] = { sensor, (uint8_t)analog_input, NAN };
+    return true;
+}
+
+void adcManager::clear(void) {
+    n_channels = 0;
+}
+
+bool adcManager::scan(void) {
+    if (n_channels == 0) {
+        return false;
+    }
+
+    // the resolution & oversampling are shared by the channels, so the finest of the sensors' is used
+    int resolution = 0;
+    uint32_t oversampling = 0;
+    uint8_t n_samples = 1;
+    for (uint8_t i = 0; i < n_channels; i++) {
+        const AnalogSensor *sensor = channels[i].sensor;
+        resolution = (sensor->getResolution() > resolution) ? sensor->getResolution() : resolution;
+        oversampling = (sensor->getOversampling() > oversampling) ? sensor->getOversampling() : oversampling;
+        n_samples = (sensor->getBurstSamples() > n_samples) ? sensor->getBurstSamples() : n_samples;
+    }
+    uint32_t saadc_resolution = saadcResolution(resolution);
+    uint32_t oversample = saadcOversample(oversampling);
+    // oversampling several channels needs each result's samples taken in a burst
+    uint32_t burst = (oversample > 0) ? SAADC_CH_CONFIG_BURST_Enabled : SAADC_CH_CONFIG_BURST_Disabled;
+
+    NRF_SAADC->RESOLUTION = saadc_resolution;
+    NRF_SAADC->OVERSAMPLE = oversample;
+    NRF_SAADC->SAMPLERATE = (SAADC_SAMPLERATE_MODE_Task << SAADC_SAMPLERATE_MODE_Pos);
+    for (uint8_t ch = 0; ch < SAADC_CH_NUM; ch++) {
+        NRF_SAADC->CH[ch].PSELN = SAADC_CH_PSELN_PSELN_NC;
+        if (ch < n_channels) {
+            NRF_SAADC->CH[ch].CONFIG = referenceConfig(channels[ch].sensor->getAnalogReference()) |
+                                       (ADC_SCAN_ACQUISITION << SAADC_CH_CONFIG_TACQ_Pos) |
+                                       (burst << SAADC_CH_CONFIG_BURST_Pos);
+            NRF_SAADC->CH[ch].PSELP = SAADC_CH_PSELP_PSELP_AnalogInput0 + channels[ch].analog_input;
+        } else {
+            NRF_SAADC->CH[ch].PSELP = SAADC_CH_PSELP_PSELP_NC;
+        }
+    }
+    NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Enabled;
+
+    // a SAMPLE task per sample of the longest burst, each converting every channel into the next n_channels results
+    for (uint8_t s = 0; s < n_samples; s++) {
+        NRF_SAADC->RESULT.PTR = (uintptr_t)&scan_results[s * n_channels];
+        NRF_SAADC->RESULT.MAXCNT = n_channels;
+
+        NRF_SAADC->EVENTS_STARTED = 0;
+        NRF_SAADC->TASKS_START = 1;
+        while (NRF_SAADC->EVENTS_STARTED == 0) {
+        }
+        NRF_SAADC->EVENTS_END = 0;
+        NRF_SAADC->TASKS_SAMPLE = 1;
+        while (NRF_SAADC->EVENTS_END == 0) {
+        }
+    }
+
+    NRF_SAADC->EVENTS_STOPPED = 0;
+    NRF_SAADC->TASKS_STOP = 1;
+    while (NRF_SAADC->EVENTS_STOPPED == 0) {
+    }
+    NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Disabled;
+    // disconnected, as the Arduino core's analogRead() only sets channel 0 up
+    for (uint8_t ch = 0; ch < n_channels; ch++) {
+        NRF_SAADC->CH[ch].PSELP = SAADC_CH_PSELP_PSELP_NC;
+    }
+
+    // reduce each sensor's own burst of the samples, as AnalogSensor would
+    int scan_resolution = 8 + (2 * (int)saadc_resolution);
+    for (uint8_t i = 0; i < n_channels; i++) {
+        AnalogSensor *sensor = channels[i].sensor;
+        uint32_t samples[ADC_MAX_BURST_SAMPLES];
+        uint8_t burst_samples = sensor->getBurstSamples();
+        for (uint8_t s = 0; s < burst_samples; s++) {
+            int16_t result = scan_results[(s * n_channels) + i];
+            samples[s] = (result > 0) ? (uint32_t)result : 0; // single ended results can be a little negative
+        }
+        float raw = reduceADCSamples(samples, burst_samples, sensor->getReduction());
+        channels[i].mv = sensor->rawToMV(raw, scan_resolution);
+        LOG(LOG_LEVEL::DEBUG, "ADC pin %u: %.2f mV", sensor->getPin(), channels[i].mv);
+    }
+    return true;
+}
+
+float adcManager::getMV(const AnalogSensor *sensor) const {
+    for (uint8_t i = 0; i < n_channels; i++) {
+        if (channels[i].sensor == sensor) {
+            return channels[i].mv;
+        }
+    }
+    return NAN;
+}
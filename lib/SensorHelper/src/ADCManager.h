@@ -0,0 +1,78 @@
+#pragma once
+/**
+ * @file ADCManager.h
+ * @author Kalina Knight
+ * @brief adcManager reads every registered AnalogSensor (e.g. the BatteryLevel & a RAK5801 or RAK5811) together, with
+ * one scan of the SAADC.
+ *
+ * Each sensor gets its own SAADC channel, with the gain & reference of its analog reference, so each SAMPLE task
+ * converts every sensor one after another. A scan is a single short ADC session: the SAADC is set up & enabled once,
+ * sampled for the longest burst of the sensors, then stopped & disabled. Each sensor's burst is then reduced as
+ * AnalogSensor would, and converted with its own compensation factor.
+ *
+ * The resolution & oversampling are shared by the channels of the SAADC, so a scan uses the finest of the sensors'.
+ * AnalogSensor::getSensorMV() can still be used between scans, as the Arduino core sets the SAADC up for every read.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include "AnalogSensor.h" /**< Class to read a sensor using the onboard ADC. Plus BatteryLevel class. */
+
+// Acquisition time of each channel, long enough for the source resistance of the sensors, or with a build flag e.g.
+// -DADC_SCAN_ACQUISITION=SAADC_CH_CONFIG_TACQ_10us for a high impedance divider
+#ifndef ADC_SCAN_ACQUISITION
+#define ADC_SCAN_ACQUISITION SAADC_CH_CONFIG_TACQ_3us
+#endif
+
+#define ADC_MAX_CHANNELS 8 /**< Most sensors in a scan, one per SAADC channel. */
+
+class adcManager {
+  public:
+    /**
+     * @brief Add a sensor to the scan. Set the sensor up (e.g. ADCInit()) first.
+     * @param sensor Sensor, which must outlive the adcManager.
+     * @return True if it was added or already is. False if it's on a pin that isn't an analog input, or the scan is
+     * full.
+     */
+    bool addSensor(AnalogSensor *sensor);
+
+    /**
+     * @brief Remove every sensor from the scan.
+     */
+    void clear(void);
+
+    /**
+     * @brief Get the number of sensors in the scan.
+     * @return Number of sensors.
+     */
+    inline uint8_t getChannelCount(void) const { return n_channels; };
+
+    /**
+     * @brief Read every sensor with one scan of the SAADC. Blocks for the scan, which takes microseconds.
+     * @return True if the sensors were read. False if there aren't any.
+     */
+    bool scan(void);
+
+    /**
+     * @brief Get a sensor's reading from the last scan.
+     * @param sensor Sensor.
+     * @return Sensor reading in mV, or NAN if it isn't in the scan or hasn't been scanned yet.
+     */
+    float getMV(const AnalogSensor *sensor) const;
+
+  private:
+    /**
+     * @brief A sensor & its reading.
+     */
+    struct adcChannel {
+        AnalogSensor *sensor;
+        uint8_t analog_input; // SAADC analog input (AINx) of the sensor pin
+        float mv;             // Reading of the last scan
+    };
+
+    adcChannel channels[ADC_MAX_CHANNELS] = {};
+    uint8_t n_channels = 0;
+};
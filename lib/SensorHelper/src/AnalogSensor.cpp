@@ -1,18 +1,28 @@
+#define LOG_MODULE_ID LOG_MODULE::SENSORS // see setLogLevel() in Logging.h
+
 #include "AnalogSensor.h"
 
-AnalogSensor::AnalogSensor(uint8_t pin) {
-    AnalogSensor(pin, DEFAULT_ANALOG_REFERENCE, DEFAULT_ANALOG_RESOLUTION);
-}
+/**
+ * @brief ADC parameters last set up, shared by every AnalogSensor as there's the one ADC.
+ */
+static struct {
+    bool is_valid;
+    _eAnalogReference analog_ref;
+    int analog_resolution;
+    uint32_t oversampling;
+} adc_config = {};
 
-AnalogSensor::AnalogSensor(uint8_t pin, _eAnalogReference analog_ref, int analog_resolution) {
-    AnalogSensor(pin, analog_ref, analog_resolution, DEFAULT_OVERSAMPLING);
-}
+AnalogSensor::AnalogSensor(uint8_t pin) : AnalogSensor(pin, DEFAULT_ANALOG_REFERENCE, DEFAULT_ANALOG_RESOLUTION) {}
+
+AnalogSensor::AnalogSensor(uint8_t pin, _eAnalogReference analog_ref, int analog_resolution)
+    : AnalogSensor(pin, analog_ref, analog_resolution, DEFAULT_OVERSAMPLING) {}
 
 AnalogSensor::AnalogSensor(uint8_t pin, _eAnalogReference analog_ref, int analog_resolution, uint32_t oversampling) {
     this->pin = pin;
     this->analog_ref = analog_ref;
     this->analog_resolution = analog_resolution;
     this->oversampling = oversampling;
+    setRealMVPerLSB();
 }
 
 void AnalogSensor::ADCInit(uint8_t pin_mode) {
@@ -27,26 +37,92 @@ void AnalogSensor::setCompensationFactor(float comp_factor) {
     setRealMVPerLSB();
 };
 
+void AnalogSensor::setBurst(uint8_t n_samples, ADC_REDUCTION reduction) {
+    if (n_samples == 0) {
+        n_samples = 1;
+    } else if (n_samples > ADC_MAX_BURST_SAMPLES) {
+        n_samples = ADC_MAX_BURST_SAMPLES;
+    }
+    this->burst_samples = n_samples;
+    this->reduction = reduction;
+}
+
 float AnalogSensor::getSensorMV(void) {
-    // set the ADC params each time in case the adc is being used for multiple sensors
+    startReading();
+    return collectMV();
+}
+
+uint32_t AnalogSensor::startReading(void) {
+    configureADC();
+    return millis();
+}
+
+float AnalogSensor::collectMV(void) {
+    // in case another sensor has used the ADC since startReading()
+    configureADC();
+
+    // Get a burst of raw ADC readings
+    float sensor_mv = readMV();
+
+    LOG(LOG_LEVEL::DEBUG, "ADC: %.2f mV", sensor_mv);
+
+    return sensor_mv;
+}
+
+void AnalogSensor::resetADCConfig(void) {
+    adc_config.is_valid = false;
+}
+
+void AnalogSensor::configureADC(void) {
+    if (adc_config.is_valid && (adc_config.analog_ref == analog_ref) &&
+        (adc_config.analog_resolution == analog_resolution) && (adc_config.oversampling == oversampling)) {
+        return;
+    }
     analogReference(analog_ref);
     analogReadResolution(analog_resolution);
     analogOversampling(oversampling);
+    adc_config = { true, analog_ref, analog_resolution, oversampling };
 
-    // Let the ADC settle
-    delay(1);
+    // the first sample after a change may be off, so throw it away rather than waiting for the ADC to settle
+    analogRead(pin);
+}
 
-    // Get a raw ADC reading
-    float sensor_mv = readMV();
+float reduceADCSamples(uint32_t *samples, uint8_t n_samples, ADC_REDUCTION reduction) {
+    if (reduction == ADC_REDUCTION::MEAN) {
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < n_samples; i++) {
+            sum += samples[i];
+        }
+        return ((float)sum / n_samples);
+    }
 
-    log(LOG_LEVEL::DEBUG, "ADC: %.2f mV", sensor_mv);
+    // median: insertion sort, the burst is short
+    for (uint8_t i = 1; i < n_samples; i++) {
+        uint32_t sample = samples[i];
+        uint8_t j = i;
+        for (; (j > 0) && (samples[j - 1] > sample); j--) {
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = sample;
+    }
+    uint8_t middle = n_samples / 2;
+    if (n_samples % 2) {
+        return (float)samples[middle];
+    }
+    return ((float)(samples[middle - 1] + samples[middle]) / 2);
+}
 
-    return sensor_mv;
+float AnalogSensor::readBurst(void) {
+    uint32_t samples[ADC_MAX_BURST_SAMPLES];
+    for (uint8_t i = 0; i < burst_samples; i++) {
+        samples[i] = analogRead(pin);
+    }
+    return reduceADCSamples(samples, burst_samples, reduction);
 }
 
 float AnalogSensor::readMV(void) {
     // Get the raw ADC value
-    float raw = analogRead(pin);
+    float raw = readBurst();
     // return converted raw ADC value
     return (raw * real_MV_per_LSB);
 }
@@ -69,11 +145,11 @@ void AnalogSensor::setRealMVPerLSB() {
         case AR_INTERNAL_1_8: // 0.6V Ref * 3 = 0..1.8V
             adc_analog_ref_mv = 1800;
             break;
-        case AR_INTERNAL_1_2: // 0.6V Ref * 2 = 0..1.6V
-            adc_analog_ref_mv = 1600;
+        case AR_INTERNAL_1_2: // 0.6V Ref * 2 = 0..1.2V
+            adc_analog_ref_mv = 1200;
             break;
-        case AR_VDD4: // 3.3V Ref / 4 = 0..0.825V
-            adc_analog_ref_mv = 825;
+        case AR_VDD4: // VDD/4 Ref * 4 = 0..3.3V
+            adc_analog_ref_mv = 3300;
             break;
     }
 
@@ -126,6 +202,6 @@ float BatteryLevel::mvToSoC(float mvolts) {
         vbat_soc = 100.0;
     }
 
-    log(LOG_LEVEL::DEBUG, "LIPO: %.2f mV = %.2f%%", mvolts, vbat_soc);
+    LOG(LOG_LEVEL::DEBUG, "LIPO: %.2f mV = %.2f%%", mvolts, vbat_soc);
     return vbat_soc;
 }
@@ -1,8 +1,14 @@
+#pragma once
 /**
  * @file AnalogSensor.h
  * @author Kalina Knight
  * @brief Class that uses the onboard ADC to read an analog sensor.
  * If using the RAK5811 board extension then set the compensation factor to 1/0.6.
+ *
+ * A reading is a short burst of samples taken back to back, each averaged on-chip by the SAADC's oversampling, and
+ * reduced to one value by their mean or median. The ADC is only set up again when a sensor with different ADC
+ * parameters is read, and the first sample after that is thrown away rather than waiting for the ADC to settle.
+ * To read several sensors at once, with one scan of the ADC, register them with an adcManager (ADCManager.h).
  * @version 0.1
  * @date 2021-09-10
  *
@@ -13,9 +19,29 @@
 
 #include "Logging.h" /**< Go here to change the logging level for the entire application. */
 
+/**
+ * @brief How the samples of a burst are reduced to a reading.
+ */
+enum class ADC_REDUCTION : uint8_t {
+    MEAN,   /**< Average of the samples, for the finest resolution. */
+    MEDIAN, /**< Middle sample, so a spike (e.g. from the radio) doesn't move the reading. */
+};
+
 static const _eAnalogReference DEFAULT_ANALOG_REFERENCE = AR_DEFAULT; // Analog reference to default = 3.6V.
-static const int DEFAULT_ANALOG_RESOLUTION = 10;                      // Resolution to default 10-bit (0..4095).
+static const int DEFAULT_ANALOG_RESOLUTION = 10;                      // Resolution to default 10-bit (0..1023).
 static const uint32_t DEFAULT_OVERSAMPLING = 0;                       // Oversampling disabled
+static const uint8_t DEFAULT_BURST_SAMPLES = 5;                       // Samples of a reading, taken back to back
+static const ADC_REDUCTION DEFAULT_REDUCTION = ADC_REDUCTION::MEDIAN;  // Reduction of the burst to a reading
+static const uint8_t ADC_MAX_BURST_SAMPLES = 16;                      // Most samples of a burst
+
+/**
+ * @brief Reduce a burst of raw samples to one value.
+ * @param samples Samples of the burst, sorted in place for ADC_REDUCTION::MEDIAN.
+ * @param n_samples Number of samples, 1 to ADC_MAX_BURST_SAMPLES.
+ * @param reduction How the samples are reduced.
+ * @return Reduced raw ADC value.
+ */
+float reduceADCSamples(uint32_t *samples, uint8_t n_samples, ADC_REDUCTION reduction);
 
 /**
  * @brief AnalogSensor uses the onboard ADC to find the voltage of an analog sensor.
@@ -57,14 +83,72 @@ class AnalogSensor {
      */
     void setCompensationFactor(float comp_factor);
 
+    /**
+     * @brief Set the burst of samples each reading is made of.
+     * e.g. setBurst(1) for a single sample, or setBurst(8, ADC_REDUCTION::MEAN) for a finer resolution.
+     * @param n_samples Samples of a reading, 1 to ADC_MAX_BURST_SAMPLES.
+     * @param reduction How the samples are reduced to a reading.
+     */
+    void setBurst(uint8_t n_samples, ADC_REDUCTION reduction = DEFAULT_REDUCTION);
+
     /**
      * @brief Get the sensor reading.
+     * Same as startReading(), then collectMV().
      * Uses the ADC parameters passed in object instantiation.
      * @return Sensor reading in mV.
      */
     float getSensorMV(void);
 
+    /**
+     * @brief Set the ADC up for this sensor, if it isn't already.
+     * @return The millis() the sensor can be read at, i.e. now, as the ADC needs no time to settle.
+     */
+    uint32_t startReading(void);
+
+    /**
+     * @brief Read the sensor with a burst of samples. Sets the ADC up for this sensor again if another sensor has
+     * changed it since startReading().
+     * @return Sensor reading in mV.
+     */
+    float collectMV(void);
+
+    /**
+     * @brief Forget the ADC parameters last set up, so the next reading sets them all again.
+     * Call this after setting the ADC up directly, e.g. with analogReference().
+     */
+    static void resetADCConfig(void);
+
+    /**
+     * @brief Convert a raw ADC value to the sensor voltage, incl. the compensation factor.
+     * @param raw Raw ADC value, e.g. reduced from a scan by an adcManager.
+     * @param resolution ADC resolution the value was sampled at, which may differ from this sensor's.
+     * @return Sensor voltage in mV.
+     */
+    inline float rawToMV(float raw, int resolution) const {
+        return (raw * real_MV_per_LSB * powf(2, (float)(analog_resolution - resolution)));
+    };
+
+    // ADC parameters of the sensor, e.g. for an adcManager to scan it with
+    inline uint8_t getPin(void) const { return pin; };                              /**< Sensor pin number. */
+    inline _eAnalogReference getAnalogReference(void) const { return analog_ref; }; /**< ADC analog reference. */
+    inline int getResolution(void) const { return analog_resolution; };             /**< ADC resolution. */
+    inline uint32_t getOversampling(void) const { return oversampling; };           /**< ADC oversampling. */
+    inline uint8_t getBurstSamples(void) const { return burst_samples; };           /**< Samples of a reading. */
+    inline ADC_REDUCTION getReduction(void) const { return reduction; };            /**< Reduction of the burst. */
+
   private:
+    /**
+     * @brief Set the ADC parameters of this sensor, unless they're the ones already set up.
+     * After a change the first sample is thrown away.
+     */
+    void configureADC(void);
+
+    /**
+     * @brief Read a burst of raw samples & reduce them.
+     * @return Reduced raw ADC value.
+     */
+    float readBurst(void);
+
     /**
      * @brief Read sensor voltage.
      * @return Reading in mV.
@@ -77,16 +161,19 @@ class AnalogSensor {
      */
     void setRealMVPerLSB();
 
-    uint8_t pin;                   // Sensor pin number
-    _eAnalogReference analog_ref;  // ADC analog reference
-    int analog_resolution;         // ADC resolution
-    uint32_t oversampling;         // ADC oversampling
-    float compensation_factor = 1; // Compensation factor sensor/pin - depends on the board hardware.
-    float real_MV_per_LSB;         // Conversion factor that turns the raw ADC reading into the voltage
+    uint8_t pin;                                   // Sensor pin number
+    _eAnalogReference analog_ref;                  // ADC analog reference
+    int analog_resolution;                         // ADC resolution
+    uint32_t oversampling;                         // ADC oversampling
+    float compensation_factor = 1;                 // Compensation factor sensor/pin - depends on the board hardware.
+    float real_MV_per_LSB;                         // Conversion factor that turns the raw ADC reading into the voltage
+    uint8_t burst_samples = DEFAULT_BURST_SAMPLES; // Samples of a reading
+    ADC_REDUCTION reduction = DEFAULT_REDUCTION;   // Reduction of the burst to a reading
 };
 
 static const uint8_t BATTERY_PIN = WB_A0;
 static const float BATTERY_COMPENSATION_FACTOR = 1.73; // Compensation factor for the VBAT divider - depends on the board.
+static const uint32_t BATTERY_OVERSAMPLING = 8;        // On-chip averaging of each sample of the battery voltage
 
 /**
  * @brief BatteryLevel inherits the AnalogSensor class adding an SoC function for sending via LoRaWAN.
@@ -98,19 +185,19 @@ class BatteryLevel : public AnalogSensor {
      * pin = BATTERY_PIN.
      * analog_ref = 3.0V (default = 3.6V).
      * analog_resolution = 12-bit (0..4095).
-     * oversampling = DEFAULT_OVERSAMPLING.
+     * oversampling = BATTERY_OVERSAMPLING.
      */
-    BatteryLevel(void) : AnalogSensor(BATTERY_PIN, AR_INTERNAL_3_0, 12, DEFAULT_OVERSAMPLING){};
+    BatteryLevel(void) : AnalogSensor(BATTERY_PIN, AR_INTERNAL_3_0, 12, BATTERY_OVERSAMPLING){};
 
     /**
      * @brief Construct a new Battery Level object.
      * pin = BATTERY_PIN.
-     * oversampling = DEFAULT_OVERSAMPLING.
+     * oversampling = BATTERY_OVERSAMPLING.
      * @param analog_ref ADC analog reference.
      * @param analog_resolution ADC resolution.
      */
     BatteryLevel(_eAnalogReference analog_ref, int analog_resolution)
-        : AnalogSensor(BATTERY_PIN, analog_ref, analog_resolution, DEFAULT_OVERSAMPLING){};
+        : AnalogSensor(BATTERY_PIN, analog_ref, analog_resolution, BATTERY_OVERSAMPLING){};
 
     /**
      * @brief Gets the ADC ready by setting the compensation factor to BATTERY_COMPENSATION_FACTOR.
@@ -1,15 +1,100 @@
+#define LOG_MODULE_ID LOG_MODULE::SENSORS // see setLogLevel() in Logging.h
+
 #include "RAK1901_helper.h"
 
-bool RAK1901::init(void) {
+bool RAK1901::init(RAK1901_MODE mode) {
     Wire.begin(); // The default settings use Wire (default Arduino I2C port).
     // Wire.setClock(400000); // I2C speed is global for that bus, so using 400kHz or 100kHz is recommended.
+    power_mode = mode;
 
     // SHTC3 functions return value of type "SHTC3_Status_TypeDef".
-    return (begin() == SHTC3_Status_Nominal);
+    if (begin() != SHTC3_Status_Nominal) {
+        return false;
+    }
+    // it powers up idle, so sleep until the first reading
+    return (sleep() == SHTC3_Status_Nominal);
 }
 
-bool RAK1901::dataReady(void) {
-    update();
-    // SHTC3 functions return value of type "SHTC3_Status_TypeDef".
+uint32_t RAK1901::startReading(void) {
+    if (measuring) {
+        // the last measurement wasn't collected, so the SHTC3 is still busy with it
+        collectReading();
+    }
+    if (wake() != SHTC3_Status_Nominal) {
+        return 0;
+    }
+    // polling mode, temperature first
+    uint16_t command = (power_mode == RAK1901_MODE::LOW_POWER) ? SHTC3_CMD_CSD_TF_LPM : SHTC3_CMD_CSD_TF_NPM;
+    if (!sendCommand(command)) {
+        // it may still be waking up
+        delayMicroseconds(RAK1901_WAKEUP_US);
+        if (!sendCommand(command)) {
+            lastStatus = SHTC3_Status_Error;
+            sleep();
+            return 0;
+        }
+    }
+    measuring = true;
+    meas_start_us = micros();
+    // rounded up, plus a ms as millis() may be about to tick over
+    return (millis() + ((measurementMicros() + 999) / 1000) + 1);
+}
+
+bool RAK1901::collectReading(void) {
+    if (!measuring) {
+        return false;
+    }
+    measuring = false;
+    uint32_t elapsed_us = micros() - meas_start_us;
+    if (elapsed_us < measurementMicros()) {
+        delayMicroseconds(measurementMicros() - elapsed_us);
+    }
+
+    // NACKed until the measurement is done
+    uint8_t n_read = 0;
+    for (uint8_t tries = 0; (n_read != 6) && (tries < RAK1901_POLL_TRIES); tries++) {
+        if (tries > 0) {
+            delayMicroseconds(RAK1901_POLL_US);
+        }
+        n_read = Wire.requestFrom((uint8_t)RAK1901_I2C_ADDRESS, (size_t)6);
+    }
+    if (n_read != 6) {
+        LOG(LOG_LEVEL::ERROR, "RAK1901 measurement not ready.");
+        lastStatus = SHTC3_Status_Error;
+        sleep();
+        return false;
+    }
+    passTcrc = readWord(&T);
+    passRHcrc = readWord(&RH);
+    SHTC3_Status_TypeDef status = (passTcrc && passRHcrc) ? SHTC3_Status_Nominal : SHTC3_Status_CRC_Fail;
+
+    sleep();
+    // SHTC3 functions return value of type "SHTC3_Status_TypeDef", keep the measurement's rather than the sleep's
+    lastStatus = status;
     return (lastStatus == SHTC3_Status_Nominal);
-}
\ No newline at end of file
+}
+
+bool RAK1901::sendCommand(uint16_t command) {
+    Wire.beginTransmission(RAK1901_I2C_ADDRESS);
+    Wire.write((uint8_t)(command >> 8));
+    Wire.write((uint8_t)command);
+    return (Wire.endTransmission() == 0);
+}
+
+bool RAK1901::readWord(uint16_t *word) {
+    uint8_t msb = (uint8_t)Wire.read();
+    uint8_t lsb = (uint8_t)Wire.read();
+    uint8_t crc = (uint8_t)Wire.read();
+    *word = (uint16_t)((msb << 8) | lsb);
+
+    // CRC-8, polynomial 0x31 initialised to 0xFF, see the SHTC3 datasheet
+    const uint8_t bytes[2] = { msb, lsb };
+    uint8_t check = 0xFF;
+    for (uint8_t byte : bytes) {
+        check ^= byte;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            check = (check & 0x80) ? (uint8_t)((check << 1) ^ 0x31) : (uint8_t)(check << 1);
+        }
+    }
+    return (check == crc);
+}
@@ -4,6 +4,10 @@
  * @brief RAK1901 class inherits the SHTC3 class and adds functions to simplify initialisation and reading for the
  * SensorHelper application.
  *
+ * The SHTC3 is kept asleep between readings, as it otherwise idles at many times its sleep current. Measurements are
+ * made in polling mode (clock stretching disabled), so the bus isn't held & the MCU can sleep while it measures:
+ * startReading() wakes it up & starts a measurement, collectReading() fetches the result & puts it back to sleep.
+ *
  * @version 0.1
  * @date 2021-08-13
  *
@@ -14,20 +18,74 @@
 
 #include "Logging.h"
 
+// Set to 1 to measure in low power mode by default, or with a build flag: -DRAK1901_LOW_POWER_MODE=1
+#ifndef RAK1901_LOW_POWER_MODE
+#define RAK1901_LOW_POWER_MODE 0
+#endif
+
+#define RAK1901_I2C_ADDRESS       0x70  /**< SHTC3 7 bit I2C address. */
+#define RAK1901_WAKEUP_US         240   /**< Max time from waking the SHTC3 up until it takes commands. */
+#define RAK1901_MEAS_NORMAL_US    12100 /**< Max measurement time in normal power mode. */
+#define RAK1901_MEAS_LOW_POWER_US 800   /**< Max measurement time in low power mode. */
+#define RAK1901_POLL_US           100   /**< Time between polls of a measurement that isn't done when collected. */
+#define RAK1901_POLL_TRIES        10    /**< Polls before giving up on a measurement. */
+
+/**
+ * @brief SHTC3 measurement modes.
+ */
+enum class RAK1901_MODE : uint8_t {
+    NORMAL_POWER, /**< Up to 12.1 ms a measurement, the full repeatability. */
+    LOW_POWER,    /**< Up to 0.8 ms a measurement, so far less energy, at a lower repeatability. */
+};
+
 class RAK1901 : public SHTC3 {
   public:
     /**
-     * @brief Initialises the temperature & humidity sensor.
+     * @brief Initialises the temperature & humidity sensor & puts it to sleep until the first reading.
      * Calls Wire.begin() in the process.
+     * @param mode Measurement mode.
      * @return True if successfull. False if not.
      */
-    bool init(void);
+    bool init(RAK1901_MODE mode = (RAK1901_LOW_POWER_MODE ? RAK1901_MODE::LOW_POWER : RAK1901_MODE::NORMAL_POWER));
 
     /**
-     * @brief Gets the temperature & humidity data ready.
+     * @brief Set the measurement mode of the next readings.
+     * @param mode Measurement mode.
+     */
+    inline void setMeasurementMode(RAK1901_MODE mode) { power_mode = mode; };
+
+    /**
+     * @brief Get the measurement mode.
+     * @return Measurement mode.
+     */
+    inline RAK1901_MODE getMeasurementMode(void) const { return power_mode; };
+
+    /**
+     * @brief Expected (max) time of a reading in the current mode, from waking the SHTC3 up to the result.
+     * @return Conversion time in microseconds.
+     */
+    inline uint32_t conversionMicros(void) const { return (RAK1901_WAKEUP_US + measurementMicros()); };
+
+    /**
+     * @brief Gets the temperature & humidity data ready, waiting for the measurement.
+     * Same as startReading() then collectReading().
      * @return True if data is ready. False if not.
      */
-    bool dataReady(void);
+    inline bool dataReady(void) { return ((startReading() != 0) && collectReading()); };
+
+    /**
+     * @brief Wake the SHTC3 up & start a measurement, without waiting for it. Collect it with collectReading() once it's
+     * ready, and sleep in the meantime.
+     * @return The millis() the measurement will be ready at, or 0 if it couldn't be started.
+     */
+    uint32_t startReading(void);
+
+    /**
+     * @brief Collect the measurement started by startReading(), waiting for it if it isn't done yet, then put the
+     * SHTC3 back to sleep.
+     * @return True if data is ready. False if not.
+     */
+    bool collectReading(void);
 
     /**
      * @brief Get temperature.
@@ -40,4 +98,31 @@ class RAK1901 : public SHTC3 {
      * @return Relative humidity as a percentage.
      */
     inline float getHumidity(void) { return toPercent(); };
+
+  private:
+    /**
+     * @brief Max measurement time in the current mode.
+     * @return Microseconds.
+     */
+    inline uint32_t measurementMicros(void) const {
+        return (power_mode == RAK1901_MODE::LOW_POWER) ? RAK1901_MEAS_LOW_POWER_US : RAK1901_MEAS_NORMAL_US;
+    };
+
+    /**
+     * @brief Send a command to the SHTC3.
+     * @param command The command.
+     * @return True if it was ACKed.
+     */
+    bool sendCommand(uint16_t command);
+
+    /**
+     * @brief Read a word of a measurement & check its CRC.
+     * @param word Set to the word.
+     * @return True if the CRC passed.
+     */
+    bool readWord(uint16_t *word);
+
+    RAK1901_MODE power_mode = RAK1901_MODE::NORMAL_POWER;
+    bool measuring = false;     /**< A measurement was started & not collected yet. */
+    uint32_t meas_start_us = 0; /**< micros() the measurement was started at. */
 };
@@ -1,9 +1,11 @@
+#define LOG_MODULE_ID LOG_MODULE::SENSORS // see setLogLevel() in Logging.h
+
 #include "RAK1906_helper.h"
 
 bool RAK1906::init(initRAK1906Sensors *initSensors) {
     Wire.begin();
     if (!begin(BME680_ADDRESS)) {
-        log(LOG_LEVEL::ERROR, "Could not find a valid BME680 sensor, check wiring!");
+        LOG(LOG_LEVEL::ERROR, "Could not find a valid BME680 sensor, check wiring!");
         return false;
     }
 
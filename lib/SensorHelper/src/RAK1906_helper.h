@@ -52,11 +52,33 @@ class RAK1906 : public Adafruit_BME680 {
     bool init(initRAK1906Sensors *initSensors);
 
     /**
-     * @brief Gets the environmental sensing unit data ready.
+     * @brief Gets the environmental sensing unit data ready, waiting for the measurement.
+     * Same as startReading() then collectReading().
      * @return True if data is ready. False if not.
      */
     inline bool dataReady(void) { return performReading(); };
 
+    /**
+     * @brief Start a measurement, without waiting for it. Collect it with collectReading() once it's ready, and sleep
+     * in the meantime rather than waiting in collectReading(): with the gas heater on a measurement takes ~180 ms.
+     * @return The millis() the measurement will be ready at, or 0 if it couldn't be started. If a measurement is
+     * already in progress it's the ready time of that one.
+     */
+    inline uint32_t startReading(void) { return beginReading(); };
+
+    /**
+     * @brief Time left until the measurement started by startReading() is ready.
+     * @return Remaining ms, 0 once ready, or -1 if no measurement was started.
+     */
+    inline int remainingMillis(void) { return remainingReadingMillis(); };
+
+    /**
+     * @brief Collect the measurement started by startReading(), waiting for it if it isn't ready yet. Starts one if
+     * none was started.
+     * @return True if data is ready. False if not.
+     */
+    inline bool collectReading(void) { return endReading(); };
+
     /**
      * @brief Get temperature.
      * @return Temperature in degrees celcius.
@@ -0,0 +1,229 @@
+#define LOG_MODULE_ID LOG_MODULE::SENSORS // see setLogLevel() in Logging.h
+
+#include "SampleScheduler.h"
+
+#include "Logging.h"
+#include "SensorHelper.h"
+
+static_assert(SAMPLE_SCHEDULER_MAX_CHANNELS <= 32, "The due channels are a 32-bit mask.");
+
+/**
+ * @brief Check if a field has moved by more than the deadband, or become valid or invalid.
+ * @param field The new reading of the field.
+ * @param last The field's last reported reading.
+ * @param deadband Change needed, in the field's units.
+ * @return True if changed.
+ */
+template <typename T> static bool fieldChanged(const T &field, const T &last, float deadband) {
+    return ((field.is_valid != last.is_valid) ||
+            (field.is_valid && (fabsf((float)field.value - (float)last.value) > deadband)));
+}
+
+/**
+ * @brief Copy the fields of the given sensors from a reading into the held sample.
+ * @param held Held sample to update.
+ * @param reading The reading.
+ * @param sensors SEND_* flags of the sensors that were read.
+ */
+static void holdReading(sensorData *held, const sensorData &reading, uint16_t sensors) {
+    if (sensors & SEND_BATTERY_VOLTAGE) {
+        held->battery_mv = reading.battery_mv;
+    }
+    if (sensors & SEND_TEMPERATURE) {
+        held->temperature = reading.temperature;
+    }
+    if (sensors & SEND_RELATIVE_HUMIDITY) {
+        held->humidity = reading.humidity;
+    }
+    if (sensors & SEND_AIR_PRESSURE) {
+        held->pressure = reading.pressure;
+    }
+    if (sensors & SEND_GAS_RESISTANCE) {
+        held->gas_resist = reading.gas_resist;
+    }
+    if (sensors & SEND_LOCATION) {
+        held->location = reading.location;
+    }
+    if (sensors & SEND_ANALOG) {
+        held->analog_mv = reading.analog_mv;
+    }
+    // the sample is taken now, whichever channels were read
+    held->timestamp = reading.timestamp;
+}
+
+void sampleScheduler::begin(uint32_t uptime_s) {
+    for (uint8_t i = 0; i < n_channels; i++) {
+        next_reading_s[i] = uptime_s;
+    }
+    next_uplink_s = uptime_s + max_uplink_interval_s;
+    last_sample_s = uptime_s;
+    held = {};
+    reported = {};
+    n_pending = 0;
+    frame_samples = 0;
+    stats = {};
+}
+
+bool sampleScheduler::sampleIfDue(uint32_t uptime_s) {
+    uint16_t due_sensors = 0;
+    uint32_t due_channels = 0;
+    for (uint8_t i = 0; i < n_channels; i++) {
+        uint16_t sensors = channels[i].sensors & port.sensors;
+        if ((sensors == 0) || (uptime_s < next_reading_s[i])) {
+            continue;
+        }
+        due_sensors |= sensors;
+        due_channels |= (1UL << i);
+        stats.readings++;
+        // keep to the channel's phase, unless it's fallen more than a period behind
+        uint32_t period_s = channels[i].period_s * rate_divider;
+        next_reading_s[i] += period_s;
+        if (next_reading_s[i] <= uptime_s) {
+            next_reading_s[i] = uptime_s + period_s;
+        }
+    }
+    if (due_sensors == 0) {
+        return false;
+    }
+
+    const portSchema read_port(0, due_sensors | (port.sensors & SEND_TIMESTAMP));
+    sensorData reading = getSensorData(&read_port);
+
+    // report by exception: only add a sample if a channel has changed, or is due a heartbeat
+    bool report = false;
+    bool heartbeat = false;
+    for (uint8_t i = 0; i < n_channels; i++) {
+        if ((due_channels & (1UL << i)) == 0) {
+            continue;
+        }
+        const samplingChannel &channel = channels[i];
+        if ((channel.deadband <= 0) || changed(reading, channel.sensors & port.sensors, channel.deadband)) {
+            report = true;
+        } else if ((channel.max_silence_s != 0) && ((uptime_s - last_sample_s) >= channel.max_silence_s)) {
+            heartbeat = true;
+        }
+    }
+    holdReading(&held, reading, due_sensors);
+    if (!report && !heartbeat) {
+        stats.suppressed++;
+        return false;
+    }
+    if (!report) {
+        stats.heartbeats++;
+    }
+    reported = held;
+    last_sample_s = uptime_s;
+
+    if (n_pending == SAMPLE_SCHEDULER_MAX_SAMPLES) {
+        // drop the oldest, the last fillFrame() no longer matches so it can't be popped
+        memmove(&pending[0], &pending[1], (SAMPLE_SCHEDULER_MAX_SAMPLES - 1) * sizeof(sensorData));
+        n_pending--;
+        frame_samples = 0;
+        stats.dropped++;
+        LOG(LOG_LEVEL::WARN, "Too many pending samples, the oldest was dropped.");
+    }
+    pending[n_pending++] = held;
+    stats.samples++;
+    return true;
+}
+
+bool sampleScheduler::uplinkDue(uint32_t uptime_s, uint8_t max_len, bool send_empty) {
+    if (uptime_s < next_uplink_s) {
+        if (!frameFull(max_len)) {
+            return false;
+        }
+        stats.full_uplinks++;
+    }
+    next_uplink_s = uptime_s + max_uplink_interval_s * rate_divider;
+    if ((n_pending == 0) && !send_empty) {
+        // nothing has changed since the last uplink
+        stats.suppressed_uplinks++;
+        return false;
+    }
+    stats.uplinks++;
+    return true;
+}
+
+bool sampleScheduler::changed(const sensorData &reading, uint16_t sensors, float deadband) const {
+    return (((sensors & SEND_BATTERY_VOLTAGE) && fieldChanged(reading.battery_mv, reported.battery_mv, deadband)) ||
+            ((sensors & SEND_TEMPERATURE) && fieldChanged(reading.temperature, reported.temperature, deadband)) ||
+            ((sensors & SEND_RELATIVE_HUMIDITY) && fieldChanged(reading.humidity, reported.humidity, deadband)) ||
+            ((sensors & SEND_AIR_PRESSURE) && fieldChanged(reading.pressure, reported.pressure, deadband)) ||
+            ((sensors & SEND_GAS_RESISTANCE) && fieldChanged(reading.gas_resist, reported.gas_resist, deadband)) ||
+            ((sensors & SEND_ANALOG) && fieldChanged(reading.analog_mv, reported.analog_mv, deadband)) ||
+            ((sensors & SEND_LOCATION) &&
+             ((reading.location.is_valid != reported.location.is_valid) ||
+              (reading.location.is_valid &&
+               ((fabsf(reading.location.latitude - reported.location.latitude) > deadband) ||
+                (fabsf(reading.location.longitude - reported.location.longitude) > deadband))))));
+}
+
+bool sampleScheduler::frameFull(uint8_t max_len) const {
+    if (n_pending < 2) {
+        return (n_pending == 1) && (port.payloadLength() >= max_len);
+    }
+    if (max_len > PAYLOAD_BUFFER_SIZE) {
+        max_len = PAYLOAD_BUFFER_SIZE;
+    }
+    uint8_t buffer[PAYLOAD_BUFFER_SIZE];
+    uint8_t n_encoded = 0;
+    uint8_t len = port.encodeSamplesToPayload(pending, n_pending, buffer, max_len, &n_encoded);
+    if (n_encoded < n_pending) {
+        return true;
+    }
+    if (n_pending < 3) {
+        // the second sample also adds the widths of the deltas, so it's no guide to the next
+        return false;
+    }
+    // full if the room left is less than the last sample took
+    uint8_t previous_len = port.encodeSamplesToPayload(pending, n_pending - 1, buffer, max_len, &n_encoded);
+    return ((max_len - len) < (len - previous_len));
+}
+
+uint32_t sampleScheduler::nextEventUptime(void) const {
+    uint32_t next_s = next_uplink_s;
+    for (uint8_t i = 0; i < n_channels; i++) {
+        if (((channels[i].sensors & port.sensors) != 0) && (next_reading_s[i] < next_s)) {
+            next_s = next_reading_s[i];
+        }
+    }
+    return next_s;
+}
+
+uint8_t sampleScheduler::fillFrame(uint8_t *buffer, uint8_t max_len, uint8_t *port_number, uint8_t *len) {
+    SPAN_SCOPE(SPAN::ENCODE);
+    frame_samples = 0;
+    *len = 0;
+    if (n_pending == 0) {
+        return 0;
+    }
+    if (max_len > PAYLOAD_BUFFER_SIZE) {
+        max_len = PAYLOAD_BUFFER_SIZE;
+    }
+
+    if (n_pending > 1) {
+        *len = port.encodeSamplesToPayload(pending, n_pending, buffer, max_len, &frame_samples);
+        *port_number = port.multiSamplePortNumber();
+    }
+    if ((frame_samples == 0) || (frame_samples == 1)) {
+        // the usual single sample frame, sent in fragments if it's longer than max_len
+        *port_number = port.port_number;
+        *len = port.encodeSensorDataToPayload(&pending[0], buffer);
+        frame_samples = 1;
+    }
+    return frame_samples;
+}
+
+void sampleScheduler::pop(void) {
+    if (frame_samples == 0) {
+        return;
+    }
+    n_pending -= frame_samples;
+    memmove(&pending[0], &pending[frame_samples], n_pending * sizeof(sensorData));
+    frame_samples = 0;
+}
+
+void sampleScheduler::clear(void) {
+    n_pending = 0;
+    frame_samples = 0;
+}
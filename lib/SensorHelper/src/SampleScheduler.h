@@ -0,0 +1,195 @@
+#pragma once
+/**
+ * @file SampleScheduler.h
+ * @author Kalina Knight
+ * @brief Multi-rate sampling: each sensor channel is read at its own period, and uplinks are scheduled separately.
+ *
+ * Each samplingChannel is a group of sensors (SEND_* flags) read together at the channel's period, e.g. the battery
+ * hourly and temperature & humidity every minute. Whenever a channel is due its sensors are read, and a sample of the
+ * whole port is added to the pending samples: the fields of the channels that weren't due hold their last reading, so
+ * they cost 0 bits in a multi-sample frame (see PortSchema.h).
+ *
+ * Readings can be reported by exception: a channel with a deadband only adds a sample when one of its fields has moved
+ * by more than the deadband since the last sample, or its max_silence_s has passed (a heartbeat). Readings that don't
+ * are suppressed, and so are uplinks with no samples to send.
+ *
+ * Uplinks are due at most max_uplink_interval_s apart, or sooner once the pending samples fill a frame, so the radio
+ * wakes far less often than the sensors. Either send the pending samples with fillFrame() & pop(), or push each sample
+ * to a sampleQueue (SampleQueue.h) as it's taken and clear() them at each uplink.
+ *
+ * The whole schedule can be slowed down with setRateDivider(), e.g. while the airtime budget is running low (see
+ * Airtime.h): the channels are read less often and more samples are batched into each uplink.
+ *
+ * All times are uptimes in seconds, from uptimeSeconds() (WallClock.h).
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "PortSchema.h"
+
+#ifndef SAMPLE_SCHEDULER_MAX_CHANNELS
+#define SAMPLE_SCHEDULER_MAX_CHANNELS 8 /**< Up to 32. */
+#endif
+
+#ifndef SAMPLE_SCHEDULER_MAX_SAMPLES
+#define SAMPLE_SCHEDULER_MAX_SAMPLES 64 /**< Max pending samples, then the oldest is dropped. ~60 bytes RAM each. */
+#endif
+
+/**
+ * @brief A group of sensors read together at the same period.
+ */
+struct samplingChannel {
+    uint16_t sensors;       /**< SEND_* flags of the sensors, e.g. SEND_TEMPERATURE | SEND_RELATIVE_HUMIDITY. */
+    uint32_t period_s;      /**< Time between readings. */
+    float deadband;         /**< Change of any field (in its own units) needed to add a sample. 0 adds every reading. */
+    uint32_t max_silence_s; /**< Add a sample at least this often, even without a change. 0 for no heartbeat. */
+};
+
+/**
+ * @brief Counters for a sampleScheduler, see sampleScheduler::getStats().
+ */
+struct sampleSchedulerStats {
+    uint32_t samples;            /**< Samples added to the pending samples. */
+    uint32_t readings;           /**< Channel readings, at least one per sample. */
+    uint32_t uplinks;            /**< Uplinks that were due. */
+    uint32_t full_uplinks;       /**< Uplinks due early because the pending samples filled a frame. */
+    uint32_t dropped;            /**< Pending samples dropped as SAMPLE_SCHEDULER_MAX_SAMPLES were pending. */
+    uint32_t suppressed;         /**< Sensor readings not added as a sample, as they were within the deadband. */
+    uint32_t heartbeats;         /**< Samples added only because a channel's max_silence_s had passed. */
+    uint32_t suppressed_uplinks; /**< Uplinks that were due with no samples to send, so no frame was sent. */
+};
+
+class sampleScheduler {
+  public:
+    /**
+     * @brief A scheduler for the sensors of a port. Nothing is scheduled until begin().
+     * @param port Port the samples are sent on. Only the channels' sensors that are in the port are read.
+     * @param channels The channels, up to SAMPLE_SCHEDULER_MAX_CHANNELS. The array must outlive the scheduler.
+     * @param n_channels Number of channels.
+     * @param max_uplink_interval_s Longest time between uplinks, i.e. the most a sample waits to be sent.
+     */
+    sampleScheduler(const portSchema &port, const samplingChannel *channels, uint8_t n_channels,
+                    uint32_t max_uplink_interval_s)
+        : port(port), channels(channels),
+          n_channels((n_channels < SAMPLE_SCHEDULER_MAX_CHANNELS) ? n_channels : SAMPLE_SCHEDULER_MAX_CHANNELS),
+          max_uplink_interval_s(max_uplink_interval_s){};
+
+    /**
+     * @brief Start the schedule: every channel is due straight away, the first uplink max_uplink_interval_s later.
+     * @param uptime_s Current uptime.
+     */
+    void begin(uint32_t uptime_s);
+
+    /**
+     * @brief Read the channels that are due, if any, and add a sample with their readings to the pending samples.
+     * The sample isn't added if every channel read is within its deadband & not due a heartbeat.
+     * @param uptime_s Current uptime.
+     * @return True if a sample was added, see latestSample().
+     */
+    bool sampleIfDue(uint32_t uptime_s);
+
+    /**
+     * @brief Check if an uplink is due: max_uplink_interval_s since the last one, or the pending samples fill a frame.
+     * Returns true once per uplink, the next is then due max_uplink_interval_s later. An uplink with no pending samples
+     * is suppressed, unless frames must be sent anyway e.g. for a backlog in a sampleQueue.
+     * @param uptime_s Current uptime.
+     * @param max_len Max length of the frame e.g. the max payload of the current datarate.
+     * @param send_empty True to have the uplink due even with no pending samples.
+     * @return True if an uplink is due.
+     */
+    bool uplinkDue(uint32_t uptime_s, uint8_t max_len, bool send_empty = false);
+
+    /**
+     * @brief Slow the schedule down: every channel period & the max uplink interval are multiplied by the divider, from
+     * the next reading & uplink on. Heartbeats stay at each channel's max_silence_s.
+     * @param divider 1 for the schedule as given, 2 for half as often etc.
+     */
+    void setRateDivider(uint8_t divider) { rate_divider = (divider > 0) ? divider : 1; };
+
+    /**
+     * @brief The divider set by setRateDivider().
+     */
+    uint8_t rateDivider(void) const { return rate_divider; };
+
+    /**
+     * @brief When to wake next: the next channel reading or uplink.
+     * @return Uptime of the next event, which may be now or in the past if it's overdue.
+     */
+    uint32_t nextEventUptime(void) const;
+
+    /**
+     * @brief Fill a frame with the oldest pending samples, as many as fit.
+     * The samples stay pending until pop(), so the frame can be filled again if sending fails. A sample that's longer
+     * than max_len on its own is filled as the usual single sample frame, for sendLoRaWANFrame() to send in fragments.
+     * @param buffer Frame buffer, PAYLOAD_BUFFER_SIZE long.
+     * @param max_len Max length of the frame e.g. the max payload of the current datarate, up to PAYLOAD_BUFFER_SIZE.
+     * @param port_number Returns the port to send the frame on: a multi-sample frame, or the usual single sample frame.
+     * @param len Returns the frame length.
+     * @return Number of samples in the frame, 0 if there are none pending.
+     */
+    uint8_t fillFrame(uint8_t *buffer, uint8_t max_len, uint8_t *port_number, uint8_t *len);
+
+    /**
+     * @brief Remove the samples of the last fillFrame() from the pending samples, once the frame has been sent.
+     */
+    void pop(void);
+
+    /**
+     * @brief Remove all pending samples, e.g. when they're already queued elsewhere.
+     */
+    void clear(void);
+
+    /**
+     * @brief The sample added by the last sampleIfDue().
+     * @return The sample, all invalid before the first.
+     */
+    const sensorData &latestSample(void) const { return held; };
+
+    /**
+     * @brief Number of samples waiting to be sent.
+     */
+    uint8_t pendingSamples(void) const { return n_pending; };
+
+    /**
+     * @brief Get the counters.
+     * @return The counters.
+     */
+    sampleSchedulerStats getStats(void) const { return stats; };
+
+  private:
+    /**
+     * @brief Check if any field of the given sensors has moved by more than the deadband since the last sample.
+     * @param reading The new reading.
+     * @param sensors SEND_* flags of the sensors to check.
+     * @param deadband Change needed, in each field's own units.
+     * @return True if changed, or a field became valid or invalid.
+     */
+    bool changed(const sensorData &reading, uint16_t sensors, float deadband) const;
+
+    /**
+     * @brief Check if the pending samples fill a frame: they don't all fit, or the next sample likely won't.
+     * @param max_len Max length of the frame.
+     * @return True if full.
+     */
+    bool frameFull(uint8_t max_len) const;
+
+    const portSchema port;
+    const samplingChannel *channels;
+    const uint8_t n_channels;
+    const uint32_t max_uplink_interval_s;
+    uint32_t next_reading_s[SAMPLE_SCHEDULER_MAX_CHANNELS] = {}; /**< Uptime each channel is due next. */
+    uint32_t next_uplink_s = 0;                                  /**< Uptime the next uplink is due, at the latest. */
+    uint32_t last_sample_s = 0;                                  /**< Uptime of the last sample added. */
+    sensorData held = {};                                        /**< Last reading of every channel. */
+    sensorData reported = {};                                    /**< Readings in the last sample added. */
+    sensorData pending[SAMPLE_SCHEDULER_MAX_SAMPLES];            /**< Samples not sent yet, oldest first. */
+    uint8_t n_pending = 0;
+    uint8_t frame_samples = 0; /**< Samples in the last fillFrame(), 0 if there's nothing to pop. */
+    uint8_t rate_divider = 1;  /**< See setRateDivider(). */
+    sampleSchedulerStats stats = {};
+};
@@ -1,3 +1,5 @@
+#define LOG_MODULE_ID LOG_MODULE::SENSORS // see setLogLevel() in Logging.h
+
 #include "SensorHelper.h"
 
 /**
@@ -16,14 +18,21 @@ bool USERAK1906 = false;
 RAK1901 tempHumiSensor;
 RAK1906 enviroSensor;
 BatteryLevel batLvl;
+AnalogSensor analogSensor(ANALOG_SENSOR_PIN, ANALOG_SENSOR_REFERENCE, ANALOG_SENSOR_RESOLUTION,
+                          ANALOG_SENSOR_OVERSAMPLING);
 // GPSClass gps;
-// AnalogSensor analogsensorexample(sensor pin, ADC reference voltage, ADC resolution, ADC oversampling);
+
+/**
+ * @brief The battery & analog sensor, read together with one scan of the ADC.
+ */
+adcManager adcChannels;
 
 bool initSensors(const portSchema *port_settings, bool useRAK1901, bool useRAK1906) {
-    log(LOG_LEVEL::DEBUG, "Initialising sensors...");
+    SPAN_SCOPE(SPAN::SENSOR_INIT);
+    LOG(LOG_LEVEL::DEBUG, "Initialising sensors...");
 
     if (useRAK1901 && useRAK1906) {
-        log(LOG_LEVEL::WARN, "Cannot use both SHTC3(RAK1901) & BME680(RAK1906). The RAK1906 will be used by default.");
+        LOG(LOG_LEVEL::WARN, "Cannot use both SHTC3(RAK1901) & BME680(RAK1906). The RAK1906 will be used by default.");
         USERAK1906 = useRAK1906;
         USERAK1901 = false;
     } else {
@@ -31,102 +40,182 @@ bool initSensors(const portSchema *port_settings, bool useRAK1901, bool useRAK19
         USERAK1906 = useRAK1906;
     }
 
-    // battery voltage setup
-    if (port_settings->sendBatteryVoltage) {
+    // battery voltage & analog sensor setup, scanned together
+    adcChannels.clear();
+    if (port_settings->sendBatteryVoltage()) {
         batLvl.ADCInit();
+        adcChannels.addSensor(&batLvl);
+    }
+    if (port_settings->sendAnalog()) {
+        // unpowered until it's read
+        pinMode(ANALOG_SENSOR_POWER_PIN, OUTPUT);
+        digitalWrite(ANALOG_SENSOR_POWER_PIN, LOW);
+        analogSensor.ADCInit();
+        analogSensor.setCompensationFactor(ANALOG_SENSOR_COMPENSATION_FACTOR);
+        if (!adcChannels.addSensor(&analogSensor)) {
+            LOG(LOG_LEVEL::ERROR, "Unable to initialise the analog sensor.");
+            return false;
+        }
     }
 
     // 1906 or 1901 setup
-    if (port_settings->sendTemperature || port_settings->sendRelativeHumidity || port_settings->sendAirPressure ||
-        port_settings->sendGasResistance) {
+    if (port_settings->sendTemperature() || port_settings->sendRelativeHumidity() || port_settings->sendAirPressure() ||
+        port_settings->sendGasResistance()) {
         if (USERAK1906) {
             // Environmental (RAK1906) sensor setup
             initRAK1906Sensors init_sensors = {
-                port_settings->sendTemperature,
-                port_settings->sendRelativeHumidity,
-                port_settings->sendAirPressure,
-                port_settings->sendGasResistance,
+                port_settings->sendTemperature(),
+                port_settings->sendRelativeHumidity(),
+                port_settings->sendAirPressure(),
+                port_settings->sendGasResistance(),
             };
             if (!enviroSensor.init(&init_sensors)) {
-                log(LOG_LEVEL::ERROR, "Unable to initialise the RAK1906.");
+                LOG(LOG_LEVEL::ERROR, "Unable to initialise the RAK1906.");
                 return false;
             }
         } else if (USERAK1901) {
-            if (port_settings->sendAirPressure || port_settings->sendGasResistance) {
-                log(LOG_LEVEL::ERROR, "The RAK1901 sensor cannot provide air pressure or gas resistance.");
+            if (port_settings->sendAirPressure() || port_settings->sendGasResistance()) {
+                LOG(LOG_LEVEL::ERROR, "The RAK1901 sensor cannot provide air pressure or gas resistance.");
                 return false;
-            } else if (port_settings->sendTemperature || port_settings->sendRelativeHumidity) {
+            } else if (port_settings->sendTemperature() || port_settings->sendRelativeHumidity()) {
                 // Temperature and humidity (tempHumiSensor) sensor setup
                 if (!tempHumiSensor.init()) {
-                    log(LOG_LEVEL::ERROR, "Unable to initialise the RAK1901.");
+                    LOG(LOG_LEVEL::ERROR, "Unable to initialise the RAK1901.");
                     return false;
                 }
             }
         } else {
-            log(LOG_LEVEL::ERROR, "No sensor chosen to read temp/humi/pressure/gas.");
+            LOG(LOG_LEVEL::ERROR, "No sensor chosen to read temp/humi/pressure/gas.");
             return false;
         }
     } else if (USERAK1901 || USERAK1906) {
-        log(LOG_LEVEL::WARN, "Neither a RAK1901 or RAK1906 is required for this port.");
+        LOG(LOG_LEVEL::WARN, "Neither a RAK1901 or RAK1906 is required for this port.");
     }
 
-    // if (port_settings->sendLocation) {
+    // if (port_settings->sendLocation()) {
     //     gps.init();
     // }
 
     return true;
 }
 
-sensorData getSensorData(const portSchema *port_settings) {
-    sensorData data = {};
+/**
+ * @brief Sensor pipeline stages: how each sensor is started & collected, see SensorPipeline.h.
+ * The slowest sensors are started first, so the quicker ones are started & read while they convert.
+ */
+static bool enviroNeeded(const portSchema *port_settings) {
+    return USERAK1906 && (port_settings->sendTemperature() || port_settings->sendRelativeHumidity() ||
+                          port_settings->sendAirPressure() || port_settings->sendGasResistance());
+}
 
-    if (port_settings->sendBatteryVoltage) {
-        data.battery_mv.value = batLvl.getSensorMV();
-        data.battery_mv.is_valid = true;
+static bool enviroStart(const portSchema *port_settings, uint32_t *ready_ms) {
+    (void)port_settings;
+    *ready_ms = enviroSensor.startReading();
+    return (*ready_ms != 0);
+}
+
+static bool enviroCollect(const portSchema *port_settings, sensorData *data) {
+    if (!enviroSensor.collectReading()) {
+        return false;
+    }
+    if (port_settings->sendTemperature()) {
+        data->temperature.value = enviroSensor.getTemperature();
+        data->temperature.is_valid = true;
+    }
+    if (port_settings->sendRelativeHumidity()) {
+        data->humidity.value = enviroSensor.getHumidity();
+        data->humidity.is_valid = true;
     }
+    if (port_settings->sendAirPressure()) {
+        data->pressure.value = enviroSensor.getPressure();
+        data->pressure.is_valid = true;
+    }
+    if (port_settings->sendGasResistance()) {
+        data->gas_resist.value = enviroSensor.getGasResistance();
+        data->gas_resist.is_valid = true;
+    }
+    return true;
+}
 
-    if (port_settings->sendTemperature || port_settings->sendRelativeHumidity || port_settings->sendAirPressure ||
-        port_settings->sendGasResistance) {
-        if (USERAK1906) {
-            if (enviroSensor.dataReady()) {
-                if (port_settings->sendTemperature) {
-                    data.temperature.value = enviroSensor.getTemperature();
-                    data.temperature.is_valid = true;
-                }
-                if (port_settings->sendRelativeHumidity) {
-                    data.humidity.value = enviroSensor.getHumidity();
-                    data.humidity.is_valid = true;
-                }
-                if (port_settings->sendAirPressure) {
-                    data.pressure.value = enviroSensor.getPressure();
-                    data.pressure.is_valid = true;
-                }
-                if (port_settings->sendGasResistance) {
-                    data.gas_resist.value = enviroSensor.getGasResistance();
-                    data.gas_resist.is_valid = true;
-                }
-            }
-        } else if (USERAK1901) {
-            if (tempHumiSensor.dataReady()) {
-                if (port_settings->sendTemperature) {
-                    data.temperature.value = tempHumiSensor.getTemperature();
-                    data.temperature.is_valid = true;
-                }
-                if (port_settings->sendRelativeHumidity) {
-                    data.humidity.value = tempHumiSensor.getHumidity();
-                    data.humidity.is_valid = true;
-                }
-            }
-        }
+static bool adcNeeded(const portSchema *port_settings) {
+    return port_settings->sendBatteryVoltage() || port_settings->sendAnalog();
+}
+
+static bool adcStart(const portSchema *port_settings, uint32_t *ready_ms) {
+    *ready_ms = millis();
+    if (port_settings->sendAnalog()) {
+        // scanned once the analog sensor's output has settled
+        digitalWrite(ANALOG_SENSOR_POWER_PIN, HIGH);
+        *ready_ms += ANALOG_SENSOR_SETTLE_MS;
     }
+    return true;
+}
 
-    // if (port_settings->sendLocation) {
-    //     if (valid gps data) {
-    //         data.location.latitude = gps.getLatitude();
-    //         data.location.longitude = gps.getLongitude();
-    //         data.location.is_valid = true;
-    //     }
-    // }
+static bool adcCollect(const portSchema *port_settings, sensorData *data) {
+    // the scan blocks, but only for microseconds
+    bool scanned = adcChannels.scan();
+    if (port_settings->sendAnalog()) {
+        digitalWrite(ANALOG_SENSOR_POWER_PIN, LOW);
+    }
+    if (!scanned) {
+        return false;
+    }
+    if (port_settings->sendBatteryVoltage()) {
+        data->battery_mv.value = adcChannels.getMV(&batLvl);
+        data->battery_mv.is_valid = !isnan(data->battery_mv.value);
+    }
+    if (port_settings->sendAnalog()) {
+        data->analog_mv.value = adcChannels.getMV(&analogSensor);
+        data->analog_mv.is_valid = !isnan(data->analog_mv.value);
+    }
+    return true;
+}
+
+static bool tempHumiNeeded(const portSchema *port_settings) {
+    return USERAK1901 && !USERAK1906 && (port_settings->sendTemperature() || port_settings->sendRelativeHumidity());
+}
+
+static bool tempHumiStart(const portSchema *port_settings, uint32_t *ready_ms) {
+    (void)port_settings;
+    *ready_ms = tempHumiSensor.startReading();
+    return (*ready_ms != 0);
+}
+
+static bool tempHumiCollect(const portSchema *port_settings, sensorData *data) {
+    if (!tempHumiSensor.collectReading()) {
+        return false;
+    }
+    if (port_settings->sendTemperature()) {
+        data->temperature.value = tempHumiSensor.getTemperature();
+        data->temperature.is_valid = true;
+    }
+    if (port_settings->sendRelativeHumidity()) {
+        data->humidity.value = tempHumiSensor.getHumidity();
+        data->humidity.is_valid = true;
+    }
+    return true;
+}
+
+static const sensorStage sensor_stages[] = {
+    { "RAK1906", enviroNeeded, enviroStart, enviroCollect },
+    { "RAK1901", tempHumiNeeded, tempHumiStart, tempHumiCollect },
+    { "ADC", adcNeeded, adcStart, adcCollect },
+};
+
+static const sensorPipeline sensor_pipeline(sensor_stages, sizeof(sensor_stages) / sizeof(sensor_stages[0]));
+
+sensorData getSensorData(const portSchema *port_settings) {
+    SPAN_SCOPE(SPAN::SENSOR_READ);
+    sensorData data = {};
+
+    // stamped as the readings start, invalid until the wall clock has been set
+    if (port_settings->sendTimestamp() && wallClockIsSet()) {
+        data.timestamp.value = wallClockNow();
+        data.timestamp.is_valid = true;
+    }
+
+    // every sensor the port needs is started, then collected once the slowest is ready
+    sensor_pipeline.read(port_settings, &data);
 
     return data;
-}
\ No newline at end of file
+}
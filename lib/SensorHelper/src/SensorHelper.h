@@ -13,17 +13,52 @@
  * initialised and put into their idle state manually by the firmware, and hence will waste a lot of power doing
  * nothing.
  *
+ * The analog sensor (SEND_ANALOG) defaults to a RAK5811 (0-5V) on WB_A1, see the ANALOG_SENSOR_* build flags below.
+ * The RAK5801 (4-20mA) & RAK5811 are only powered while WB_IO1 is high, so it's raised for each reading of the analog
+ * sensor and dropped after the ADC scan, see ANALOG_SENSOR_POWER_PIN & ANALOG_SENSOR_SETTLE_MS.
+ *
  * @version 0.1
  * @date 2021-08-24
  *
  * @copyright (c) 2021 Kalina Knight - MIT License
  */
 
+#include "ADCManager.h"     /**< Reads the battery & analog sensor with one scan of the ADC. */
 #include "AnalogSensor.h"   /**< Class to read a sensor using the onboard ADC. Plus BatteryLevel class. */
 #include "Logging.h"        /**< Go here to change the logging level for the entire application. */
 #include "PortSchema.h"     /**< Go here for portSchema definitions. */
 #include "RAK1901_helper.h" /**< Wrapper for SHTC3 library. */
 #include "RAK1906_helper.h" /**< Wrapper for BME680 library. */
+#include "SensorPipeline.h" /**< Reads the sensors concurrently. */
+#include "SpanProfiler.h"   /**< Spans of the awake time. */
+#include "WallClock.h"      /**< Wall clock for timestamping samples. */
+
+// Analog sensor (SEND_ANALOG), or set with build flags. The default is a RAK5811: 0-5V through a 0.6 divider, read
+// against the 3.0V reference. For a RAK5801 (4-20mA): -DANALOG_SENSOR_REFERENCE=AR_INTERNAL
+// -DANALOG_SENSOR_COMPENSATION_FACTOR=1, which reads the mV across its 149.9 Ohm resistor, so mA = mV / 149.9.
+#ifndef ANALOG_SENSOR_PIN
+#define ANALOG_SENSOR_PIN WB_A1
+#endif
+#ifndef ANALOG_SENSOR_REFERENCE
+#define ANALOG_SENSOR_REFERENCE AR_INTERNAL_3_0
+#endif
+#ifndef ANALOG_SENSOR_RESOLUTION
+#define ANALOG_SENSOR_RESOLUTION 12
+#endif
+#ifndef ANALOG_SENSOR_OVERSAMPLING
+#define ANALOG_SENSOR_OVERSAMPLING 8
+#endif
+#ifndef ANALOG_SENSOR_COMPENSATION_FACTOR
+#define ANALOG_SENSOR_COMPENSATION_FACTOR (1 / 0.6)
+#endif
+// The RAK5801 & RAK5811 are powered (incl. the sensor on them) while WB_IO1 is high, and read once their output has
+// settled. Raise ANALOG_SENSOR_SETTLE_MS for a sensor that takes longer to start up, e.g. a 4-20mA transmitter.
+#ifndef ANALOG_SENSOR_POWER_PIN
+#define ANALOG_SENSOR_POWER_PIN WB_IO1
+#endif
+#ifndef ANALOG_SENSOR_SETTLE_MS
+#define ANALOG_SENSOR_SETTLE_MS 100
+#endif
 
 /**
  * @brief Initialise the given sensors based on the port schema.
@@ -36,7 +71,8 @@
 bool initSensors(const portSchema *port_settings, bool useRAK1901, bool useRAK1906);
 
 /**
- * @brief Get the sensor data.
+ * @brief Get the sensor data. Every sensor the port needs is started, then collected once the slowest is ready, with
+ * the task asleep in between (see SensorPipeline.h).
  * @param port_settings Pointer to port schema for this app.
  * @return The sensor data in sensorData struct format.
  */
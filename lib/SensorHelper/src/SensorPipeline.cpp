@@ -0,0 +1,48 @@
+#define LOG_MODULE_ID LOG_MODULE::SENSORS // see setLogLevel() in Logging.h
+
+#include "SensorPipeline.h"
+
+#include "Logging.h"
+
+void sleepUntilMillis(uint32_t ready_ms) {
+    int32_t remaining_ms = (int32_t)(ready_ms - (uint32_t)millis());
+    if (remaining_ms > 0) {
+        // a tick over, so it's ready on waking
+        vTaskDelay(pdMS_TO_TICKS(remaining_ms) + 1);
+    }
+}
+
+uint8_t sensorPipeline::read(const portSchema *port_settings, sensorData *data) const {
+    uint16_t started = 0; // bit per stage
+    uint8_t n_failed = 0;
+    uint32_t now_ms = millis();
+    uint32_t ready_ms = now_ms;
+
+    for (uint8_t i = 0; i < n_stages; i++) {
+        const sensorStage &stage = stages[i];
+        if (!stage.needed(port_settings)) {
+            continue;
+        }
+        uint32_t stage_ready_ms = now_ms;
+        if (!stage.start(port_settings, &stage_ready_ms)) {
+            LOG(LOG_LEVEL::WARN, "Unable to start the %s.", stage.name);
+            n_failed++;
+            continue;
+        }
+        started |= (1U << i);
+        // the latest, as a difference so a millis() wrap is handled
+        if ((int32_t)(stage_ready_ms - ready_ms) > 0) {
+            ready_ms = stage_ready_ms;
+        }
+    }
+
+    sleepUntilMillis(ready_ms);
+
+    for (uint8_t i = 0; i < n_stages; i++) {
+        if ((started & (1U << i)) && !stages[i].collect(port_settings, data)) {
+            LOG(LOG_LEVEL::WARN, "Unable to read the %s.", stages[i].name);
+            n_failed++;
+        }
+    }
+    return n_failed;
+}
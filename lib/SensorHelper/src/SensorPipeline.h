@@ -0,0 +1,86 @@
+#pragma once
+/**
+ * @file SensorPipeline.h
+ * @author Kalina Knight
+ * @brief Reads the sensors of a port concurrently: every sensor the port needs is started up front, the task sleeps
+ * until the last of them is ready, then they're all collected. So a read takes as long as the slowest sensor, rather
+ * than the sum of them all.
+ *
+ * Each sensor is a sensorStage: a start() that triggers a measurement and says when it'll be ready, and a collect()
+ * that fetches it into the sensorData. A sensor that can only be read blocking does its whole read in start() and is
+ * ready straight away, so it's read while the other sensors convert. Put those after the sensors that convert by
+ * themselves, so they're started first.
+ *
+ * The task sleeps with vTaskDelay(), so FreeRTOS idles the MCU until the sensors are ready.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+#include "PortSchema.h" /**< Go here for portSchema definitions. */
+
+#define SENSOR_PIPELINE_MAX_STAGES 16 /**< Most stages a sensorPipeline can have. */
+
+/**
+ * @brief A sensor's part in a sensorPipeline.
+ */
+struct sensorStage {
+    const char *name; /**< Name of the sensor, for the logs. */
+
+    /**
+     * @brief Check if the port needs the sensor.
+     * @param port_settings Port being read.
+     * @return True if the sensor should be read.
+     */
+    bool (*needed)(const portSchema *port_settings);
+
+    /**
+     * @brief Start a measurement.
+     * @param port_settings Port being read, e.g. for the parts of the sensor to power up.
+     * @param ready_ms Set to the millis() the measurement will be ready at.
+     * @return True if started. False if not, and it won't be collected.
+     */
+    bool (*start)(const portSchema *port_settings, uint32_t *ready_ms);
+
+    /**
+     * @brief Collect the measurement into the data, once it's ready.
+     * @param port_settings Port being read, for the fields it needs.
+     * @param data Sensor data to fill.
+     * @return True if successful. False if not, the fields are left invalid.
+     */
+    bool (*collect)(const portSchema *port_settings, sensorData *data);
+};
+
+class sensorPipeline {
+  public:
+    /**
+     * @brief A pipeline of the given stages.
+     * @param stages Stages, started in this order. Must outlive the pipeline.
+     * @param n_stages Number of stages, up to SENSOR_PIPELINE_MAX_STAGES.
+     */
+    sensorPipeline(const sensorStage *stages, uint8_t n_stages)
+        : stages(stages), n_stages((n_stages > SENSOR_PIPELINE_MAX_STAGES) ? SENSOR_PIPELINE_MAX_STAGES : n_stages){};
+
+    /**
+     * @brief Read every sensor the port needs: start them all, sleep until the last is ready, then collect them all.
+     * @param port_settings Port to read.
+     * @param data Sensor data to fill. Fields of sensors that aren't needed, or failed, are left as they are.
+     * @return Number of sensors that failed to start or collect.
+     */
+    uint8_t read(const portSchema *port_settings, sensorData *data) const;
+
+  private:
+    const sensorStage *stages;
+    const uint8_t n_stages;
+};
+
+/**
+ * @brief Block the task until the given millis(), so the MCU sleeps rather than busy waiting. Returns straight away
+ * if it has already passed.
+ * @param ready_ms The millis() to wake up at.
+ */
+void sleepUntilMillis(uint32_t ready_ms);
@@ -0,0 +1,45 @@
+#include "WallClock.h"
+
+// extends the 32-bit tick count, see uptimeMillis()
+static uint32_t last_ticks = 0;
+static uint32_t tick_wraps = 0;
+
+// wall clock = uptime + offset, once set
+static bool wall_clock_set = false;
+static int64_t wall_clock_offset_ms = 0;
+
+uint64_t uptimeMillis(void) {
+    uint32_t ticks = xTaskGetTickCount();
+    if (ticks < last_ticks) {
+        tick_wraps++;
+    }
+    last_ticks = ticks;
+    uint64_t ticks64 = ((uint64_t)tick_wraps << 32) | ticks;
+    return ((ticks64 * 1000) / configTICK_RATE_HZ);
+}
+
+bool wallClockIsSet(void) {
+    return wall_clock_set;
+}
+
+uint32_t wallClockNow(void) {
+    return (uint32_t)(((int64_t)uptimeMillis() + wall_clock_offset_ms) / 1000);
+}
+
+void setWallClock(uint32_t unix_time) {
+    wall_clock_offset_ms = ((int64_t)unix_time * 1000) - (int64_t)uptimeMillis();
+    wall_clock_set = true;
+}
+
+void adjustWallClock(int32_t correction_s) {
+    wall_clock_offset_ms += (int64_t)correction_s * 1000;
+    wall_clock_set = true;
+}
+
+bool wallClockAt(uint32_t uptime_s, uint32_t *unix_time) {
+    if (!wall_clock_set) {
+        return false;
+    }
+    *unix_time = (uint32_t)((((int64_t)uptime_s * 1000) + wall_clock_offset_ms) / 1000);
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+/**
+ * @file WallClock.h
+ * @author Kalina Knight
+ * @brief Wall clock (Unix time) for timestamping samples, kept from the RTC while the device sleeps.
+ *
+ * The FreeRTOS tick on the nRF52840 is driven by RTC1 from the 32.768kHz LF clock, which keeps running while the device
+ * sleeps on a semaphore, so the tick count is an uptime that doesn't stop in low power mode. It's a 32-bit count at
+ * configTICK_RATE_HZ (1024) that wraps every ~48.5 days, so it's extended to 64 bits here: any wall clock function
+ * must be called at least once per wrap, which the app timer does many times over.
+ *
+ * The wall clock is the uptime plus an offset, set once the network tells the device the time (e.g. by the LoRaWAN
+ * clock sync in LoRaWAN_functs.h). Until then samples are timestamped as invalid, or stamped later from their uptime
+ * with wallClockAt().
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+/**
+ * @brief Time since startup from the RTC tick count, including time asleep.
+ * @return Milliseconds since startup.
+ */
+uint64_t uptimeMillis(void);
+
+/**
+ * @brief Time since startup from the RTC tick count, including time asleep.
+ * @return Seconds since startup.
+ */
+inline uint32_t uptimeSeconds(void) {
+    return (uint32_t)(uptimeMillis() / 1000);
+};
+
+/**
+ * @brief Check if the wall clock has been set with setWallClock() or adjustWallClock().
+ * @return True if wallClockNow() is the real time.
+ */
+bool wallClockIsSet(void);
+
+/**
+ * @brief Get the current wall clock time.
+ * @return Unix time in seconds, or the seconds since startup if the wall clock hasn't been set.
+ */
+uint32_t wallClockNow(void);
+
+/**
+ * @brief Set the wall clock.
+ * @param unix_time Current Unix time in seconds.
+ */
+void setWallClock(uint32_t unix_time);
+
+/**
+ * @brief Move the wall clock by a correction, e.g. the TimeCorrection of a LoRaWAN clock sync answer.
+ * Sets the wall clock if it isn't set already, treating wallClockNow() (the uptime) as the time being corrected.
+ * @param correction_s Seconds to add to the wall clock.
+ */
+void adjustWallClock(int32_t correction_s);
+
+/**
+ * @brief Convert an uptime to its wall clock time, e.g. to timestamp a sample taken before the wall clock was set.
+ * Only valid for uptimes since this startup.
+ * @param uptime_s Seconds since startup, from uptimeSeconds().
+ * @param unix_time Returns the Unix time in seconds.
+ * @return False if the wall clock hasn't been set.
+ */
+bool wallClockAt(uint32_t uptime_s, uint32_t *unix_time);
@@ -0,0 +1,108 @@
+#pragma once
+/**
+ * @file Adafruit_BME680.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the Adafruit BME680 library (RAK1906).
+ * Readings come from the simulated environment in NativeSim.h. A measurement takes as long as the real sensor would
+ * for the oversampling & gas heater settings, following the BME68x datasheet/Bosch driver.
+ *
+ * @version 0.1
+ * @date 2022-02-07
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define BME68X_DEFAULT_ADDRESS (0x77)
+
+#define BME68X_OS_NONE 0
+#define BME68X_OS_1X   1
+#define BME68X_OS_2X   2
+#define BME68X_OS_4X   3
+#define BME68X_OS_8X   4
+#define BME68X_OS_16X  5
+
+#define BME68X_FILTER_OFF      0
+#define BME68X_FILTER_SIZE_1   1
+#define BME68X_FILTER_SIZE_3   2
+#define BME68X_FILTER_SIZE_7   3
+#define BME68X_FILTER_SIZE_15  4
+#define BME68X_FILTER_SIZE_31  5
+#define BME68X_FILTER_SIZE_63  6
+#define BME68X_FILTER_SIZE_127 7
+
+#define BME680_OS_16X  BME68X_OS_16X
+#define BME680_OS_8X   BME68X_OS_8X
+#define BME680_OS_4X   BME68X_OS_4X
+#define BME680_OS_2X   BME68X_OS_2X
+#define BME680_OS_1X   BME68X_OS_1X
+#define BME680_OS_NONE BME68X_OS_NONE
+
+#define BME680_FILTER_SIZE_127 BME68X_FILTER_SIZE_127
+#define BME680_FILTER_SIZE_63  BME68X_FILTER_SIZE_63
+#define BME680_FILTER_SIZE_31  BME68X_FILTER_SIZE_31
+#define BME680_FILTER_SIZE_15  BME68X_FILTER_SIZE_15
+#define BME680_FILTER_SIZE_7   BME68X_FILTER_SIZE_7
+#define BME680_FILTER_SIZE_3   BME68X_FILTER_SIZE_3
+#define BME680_FILTER_SIZE_1   BME68X_FILTER_SIZE_1
+#define BME680_FILTER_SIZE_0   BME68X_FILTER_OFF
+
+class Adafruit_BME680 {
+  public:
+    /** Value returned by remainingReadingMillis */
+    static const int reading_not_started = -1;
+    static const int reading_complete = 0;
+
+    Adafruit_BME680(TwoWire *theWire = &Wire) { (void)theWire; };
+
+    bool begin(uint8_t addr = BME68X_DEFAULT_ADDRESS, bool initSettings = true);
+
+    bool setTemperatureOversampling(uint8_t os);
+    bool setPressureOversampling(uint8_t os);
+    bool setHumidityOversampling(uint8_t os);
+    bool setIIRFilterSize(uint8_t fs);
+    bool setGasHeater(uint16_t heaterTemp, uint16_t heaterTime);
+
+    /**
+     * @brief Perform a reading, blocking until it's complete.
+     */
+    bool performReading(void);
+
+    /**
+     * @brief Begin a reading asynchronously.
+     * @return When the reading will be ready as absolute time in millis(), or 0 on failure.
+     */
+    uint32_t beginReading(void);
+
+    /**
+     * @brief End an asynchronous reading, blocking until it's complete if necessary.
+     */
+    bool endReading(void);
+
+    /**
+     * @brief Time left until the asynchronous reading is complete.
+     * @return Remaining millis, reading_complete (0) when ready, or reading_not_started (-1).
+     */
+    int remainingReadingMillis(void);
+
+    float temperature = 0;
+    uint32_t pressure = 0;
+    float humidity = 0;
+    uint32_t gas_resistance = 0;
+
+  private:
+    /**
+     * @brief Measurement duration for the current settings.
+     * @return Duration in ms.
+     */
+    uint32_t measurementDurationMs(void);
+
+    uint8_t os_temp = BME68X_OS_8X;
+    uint8_t os_pres = BME68X_OS_4X;
+    uint8_t os_hum = BME68X_OS_2X;
+    uint16_t heater_time_ms = 0;
+    uint32_t meas_start = 0;
+    uint32_t meas_period = 0;
+};
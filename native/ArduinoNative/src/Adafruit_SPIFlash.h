@@ -0,0 +1,69 @@
+#pragma once
+/**
+ * @file Adafruit_SPIFlash.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the Adafruit SPIFlash library, simulating the RAK15001's GD25Q16C in RAM.
+ * Behaves like NOR flash: erased bytes are 0xFF and writing can only clear bits, so writing over data without erasing
+ * it first corrupts it like the real thing. Writes & erases take the datasheet's typical page program & sector erase
+ * times (awake). See NativeSim.h to save the flash image to a file.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <SPI.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SFLASH_SECTOR_SIZE 4096
+#define SFLASH_PAGE_SIZE   256
+
+typedef struct {
+    uint32_t total_size;
+    uint16_t start_up_time_us;
+    uint8_t manufacturer_id;
+    uint8_t memory_type;
+    uint8_t capacity;
+    uint8_t max_clock_speed_mhz;
+    uint8_t quad_enable_bit_mask;
+    bool has_sector_protection : 1;
+    bool supports_fast_read : 1;
+    bool supports_qspi : 1;
+    bool supports_qspi_writes : 1;
+    bool write_status_register_split : 1;
+    bool single_status_byte : 1;
+    bool is_fram : 1;
+} SPIFlash_Device_t;
+
+class Adafruit_FlashTransport_SPI {
+  public:
+    Adafruit_FlashTransport_SPI(uint8_t ss, SPIClass &spi) {
+        (void)ss;
+        (void)spi;
+    };
+};
+
+class Adafruit_SPIFlash {
+  public:
+    explicit Adafruit_SPIFlash(Adafruit_FlashTransport_SPI *transport) { (void)transport; };
+
+    /**
+     * @brief Starts the simulated flash, which is the size given by the device (2 MB if none).
+     * The contents are kept if it's started again, like a real flash after a reset.
+     */
+    bool begin(SPIFlash_Device_t const *flash_devs = NULL, size_t count = 1);
+    void end(void){};
+
+    uint32_t getJEDECID(void);
+    uint32_t size(void);
+    uint16_t numPages(void) { return size() / SFLASH_PAGE_SIZE; };
+    uint16_t pageSize(void) { return SFLASH_PAGE_SIZE; };
+    void waitUntilReady(void){};
+
+    bool eraseSector(uint32_t sectorNumber);
+    bool eraseChip(void);
+    uint32_t readBuffer(uint32_t address, uint8_t *buffer, uint32_t len);
+    uint32_t writeBuffer(uint32_t address, uint8_t const *buffer, uint32_t len);
+};
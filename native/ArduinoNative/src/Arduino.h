@@ -0,0 +1,86 @@
+#pragma once
+/**
+ * @file Arduino.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the parts of the Adafruit nRF52 Arduino core used by this repo.
+ * Time is simulated: millis()/micros() return the real time spent running plus any time "spent" in delay() or sleeping
+ * on a semaphore, which is skipped instead of waited for. See NativeSim.h.
+ *
+ * @version 0.1
+ * @date 2022-02-07
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "SoftwareTimer.h"
+
+typedef unsigned long ulong;
+typedef uint8_t byte;
+
+// Digital IO
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+// WisBlock RAK4631 pins
+#define LED_BUILTIN 35
+#define LED_CONN    36
+#define WB_A0       5
+#define WB_A1       31
+#define WB_IO1      17
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+
+// Time
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// Analog - mirrors the nRF52 SAADC options
+enum _eAnalogReference {
+    AR_DEFAULT,
+    AR_INTERNAL,     // 0.6V Ref * 6 = 0..3.6V
+    AR_INTERNAL_3_0, // 0.6V Ref * 5 = 0..3.0V
+    AR_INTERNAL_2_4, // 0.6V Ref * 4 = 0..2.4V
+    AR_INTERNAL_1_8, // 0.6V Ref * 3 = 0..1.8V
+    AR_INTERNAL_1_2, // 0.6V Ref * 2 = 0..1.2V
+    AR_VDD4          // VDD/4 REF * 4 = 0..VDD
+};
+
+void analogReference(_eAnalogReference mode);
+void analogReadResolution(uint8_t res);
+void analogOversampling(uint32_t ulOversampling);
+uint32_t analogRead(uint32_t pin);
+
+// Serial
+class NativeSerial {
+  public:
+    void begin(unsigned long baud) { (void)baud; };
+    void end(void){};
+    void flush(void) { fflush(stdout); };
+    size_t print(const char *str) { return fputs(str, stdout) >= 0 ? strlen(str) : 0; };
+    size_t println(const char *str) { return print(str) + print("\n"); };
+    size_t println(void) { return print("\n"); };
+    size_t write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); };
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    operator bool() { return true; };
+};
+
+extern NativeSerial Serial;
+
+// Sketch entry points - called by the native main() in ArduinoNative.cpp
+void setup(void);
+void loop(void);
@@ -0,0 +1,697 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Arduino.h"
+#include "NativeSim.h"
+#include "nrf.h"
+
+NativeSerial Serial;
+
+int NativeSerial::printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int ret = vprintf(format, args);
+    va_end(args);
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SIMULATED TIME
+
+static const std::chrono::steady_clock::time_point sim_start = std::chrono::steady_clock::now();
+static uint64_t skipped_us = 0; // time skipped by delay() & sleeping
+static uint64_t slept_us = 0;   // time skipped by sleeping only
+static uint64_t sim_duration_us = NATIVE_SIM_DEFAULT_DURATION_MS * 1000ULL;
+static bool sim_stopped = false;
+
+#define MAX_NATIVE_TIMERS 16
+static NativeTimer *timers[MAX_NATIVE_TIMERS] = {};
+
+uint64_t nativeSimMicros(void) {
+    uint64_t real_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sim_start).count();
+    return (real_us + skipped_us);
+}
+
+uint32_t nativeSimUnixTime(void) {
+    return (uint32_t)(NATIVE_SIM_START_UNIX_TIME + (nativeSimMicros() / 1000000));
+}
+
+/**
+ * @brief Find the active timer that fires next.
+ * @return The timer, or nullptr if none are active.
+ */
+static NativeTimer *nextTimer(void) {
+    NativeTimer *next = nullptr;
+    for (NativeTimer *timer : timers) {
+        if ((timer != nullptr) && timer->active && ((next == nullptr) || (timer->expiry_us < next->expiry_us))) {
+            next = timer;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Run the given timer's callback and re-arm it if repeating.
+ * @param timer Timer that has expired.
+ */
+static void fireTimer(NativeTimer *timer) {
+    if (timer->repeating) {
+        timer->expiry_us += (uint64_t)timer->period_ms * 1000;
+    } else {
+        timer->active = false;
+    }
+    if (timer->callback != nullptr) {
+        timer->callback(timer);
+    }
+}
+
+/**
+ * @brief Skip forward to the given simulated time, firing any timers that expire before it.
+ * @param target_us Simulated time to skip to.
+ * @param stop_on_timer Return as soon as a timer has fired.
+ * @return True if a timer fired.
+ */
+static bool skipTo(uint64_t target_us, bool stop_on_timer) {
+    bool fired = false;
+    NativeTimer *timer = nextTimer();
+    while ((timer != nullptr) && (timer->expiry_us <= target_us)) {
+        uint64_t now_us = nativeSimMicros();
+        if (timer->expiry_us > now_us) {
+            skipped_us += (timer->expiry_us - now_us);
+        }
+        fireTimer(timer);
+        fired = true;
+        if (stop_on_timer) {
+            return fired;
+        }
+        timer = nextTimer();
+    }
+    uint64_t now_us = nativeSimMicros();
+    if (target_us > now_us) {
+        skipped_us += (target_us - now_us);
+    }
+    return fired;
+}
+
+void nativeSimAdvanceMicros(uint64_t us) {
+    skipTo(nativeSimMicros() + us, false);
+}
+
+bool nativeSimSleepUntilNextTimer(uint64_t timeout_us) {
+    uint64_t start_us = nativeSimMicros();
+    // timeout_us may be UINT64_MAX - (a slightly earlier) now, so don't let the end wrap around
+    uint64_t end_us = (timeout_us > (UINT64_MAX - start_us)) ? UINT64_MAX : (start_us + timeout_us);
+    // never sleep past the end of the simulation
+    if (end_us > sim_duration_us) {
+        end_us = (start_us < sim_duration_us) ? sim_duration_us : start_us;
+    }
+    bool fired = skipTo(end_us, true);
+    slept_us += (nativeSimMicros() - start_us);
+    return fired;
+}
+
+uint64_t nativeSimSleptMicros(void) {
+    return slept_us;
+}
+
+void nativeSimSetDuration(uint64_t duration_ms) {
+    sim_duration_us = duration_ms * 1000;
+}
+
+bool nativeSimRunning(void) {
+    return (!sim_stopped && (nativeSimMicros() < sim_duration_us));
+}
+
+void nativeSimStop(void) {
+    sim_stopped = true;
+}
+
+void nativeSimAddTimer(NativeTimer *timer) {
+    for (NativeTimer *&slot : timers) {
+        if ((slot == timer) || (slot == nullptr)) {
+            slot = timer;
+            return;
+        }
+    }
+    fprintf(stderr, "Too many SoftwareTimers for the native simulation (max %d).\n", MAX_NATIVE_TIMERS);
+    exit(EXIT_FAILURE);
+}
+
+void nativeSimRemoveTimer(NativeTimer *timer) {
+    for (NativeTimer *&slot : timers) {
+        if (slot == timer) {
+            slot = nullptr;
+        }
+    }
+}
+
+unsigned long millis(void) {
+    return (unsigned long)(nativeSimMicros() / 1000);
+}
+
+unsigned long micros(void) {
+    return (unsigned long)nativeSimMicros();
+}
+
+void delay(uint32_t ms) {
+    uint64_t end_us = nativeSimMicros() + ((uint64_t)ms * 1000);
+    if (end_us < sim_duration_us) {
+        nativeSimAdvanceMicros((uint64_t)ms * 1000);
+        return;
+    }
+    // a delay past the end of the simulation parks the sketch (e.g. a benchmark that's done), which the core's
+    // vTaskDelay() would sleep through, so sleep it & stop straight away if there's nothing left to wake up to
+    while (nativeSimRunning() && (nativeSimMicros() < end_us)) {
+        if (nextTimer() == nullptr) {
+            nativeSimStop();
+            return;
+        }
+        nativeSimSleepUntilNextTimer(end_us - nativeSimMicros());
+    }
+}
+
+void delayMicroseconds(uint32_t us) {
+    nativeSimAdvanceMicros(us);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SIMULATED ENVIRONMENT
+
+/**
+ * @brief Position in the simulated day.
+ * @return 0 -> 1 over 24 hours of simulated time.
+ */
+static float dayFraction(void) {
+    const uint64_t US_IN_DAY = 24ULL * 60 * 60 * 1000 * 1000;
+    return (float)(nativeSimMicros() % US_IN_DAY) / (float)US_IN_DAY;
+}
+
+float nativeSimTemperatureC(void) {
+    return 18.0F + (6.0F * sinf(2.0F * (float)M_PI * dayFraction()));
+}
+
+float nativeSimHumidity(void) {
+    return 60.0F - (15.0F * sinf(2.0F * (float)M_PI * dayFraction()));
+}
+
+uint32_t nativeSimPressurePa(void) {
+    return (uint32_t)(101325.0F + (250.0F * cosf(2.0F * (float)M_PI * dayFraction())));
+}
+
+uint32_t nativeSimGasResistance(void) {
+    return (uint32_t)(50000.0F + (5000.0F * sinf(4.0F * (float)M_PI * dayFraction())));
+}
+
+float nativeSimPinMV(uint32_t pin) {
+    if (pin == WB_A0) {
+        // 1.73 divider on VBAT with the battery slowly discharging from 4.1V
+        float battery_mv = 4100.0F - (float)(nativeSimMicros() / (60ULL * 60 * 1000 * 1000)); // -1mV/hour
+        return (battery_mv / 1.73F);
+    }
+    if ((pin == WB_A1) && (digitalRead(WB_IO1) == LOW)) {
+        // the RAK5801/RAK5811 is unpowered, so its output is pulled down
+        return 0.0F;
+    }
+    return 1500.0F;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// DIGITAL & ANALOG IO
+
+#define NATIVE_MAX_PINS 48
+static uint8_t pin_state[NATIVE_MAX_PINS] = {};
+
+void pinMode(uint32_t pin, uint32_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint32_t pin, uint32_t value) {
+    if (pin < NATIVE_MAX_PINS) {
+        pin_state[pin] = (value != LOW);
+    }
+}
+
+int digitalRead(uint32_t pin) {
+    return (pin < NATIVE_MAX_PINS) ? pin_state[pin] : LOW;
+}
+
+static _eAnalogReference analog_reference = AR_DEFAULT;
+static uint8_t analog_resolution = 10;
+static uint32_t analog_oversampling = 1;
+static uint32_t noise_seed = 12345;
+
+// SAADC timing, with the Arduino core's 3us acquisition time
+#define SAADC_START_US       2 // START task until STARTED
+#define SAADC_STOP_US        3 // STOP task until STOPPED
+#define SAADC_ACQUISITION_US 3
+#define SAADC_CONVERSION_US  2
+
+/**
+ * @brief Sample a pin as the SAADC would.
+ * @param pin Analog pin.
+ * @param full_scale_mv Input voltage of the largest raw value, i.e. the reference / gain.
+ * @param resolution Resolution in bits.
+ * @param oversampling Samples averaged into the result.
+ * @return Raw value.
+ */
+static uint32_t samplePin(uint32_t pin, float full_scale_mv, uint8_t resolution, uint32_t oversampling) {
+    // +-8mV of noise, reduced by oversampling
+    noise_seed = (noise_seed * 1103515245U) + 12345U;
+    float noise_mv = ((float)((noise_seed >> 16) % 1601) / 100.0F) - 8.0F;
+    noise_mv /= sqrtf((float)oversampling);
+
+    float max_raw = (float)((1UL << resolution) - 1);
+    float raw = ((nativeSimPinMV(pin) + noise_mv) / full_scale_mv) * (max_raw + 1);
+    if (raw < 0) {
+        raw = 0;
+    } else if (raw > max_raw) {
+        raw = max_raw;
+    }
+    return (uint32_t)raw;
+}
+
+void analogReference(_eAnalogReference mode) {
+    analog_reference = mode;
+}
+
+void analogReadResolution(uint8_t res) {
+    analog_resolution = res;
+}
+
+void analogOversampling(uint32_t ulOversampling) {
+    analog_oversampling = (ulOversampling == 0) ? 1 : ulOversampling;
+}
+
+uint32_t analogRead(uint32_t pin) {
+    float reference_mv = 3600;
+    switch (analog_reference) {
+        case AR_DEFAULT:
+        case AR_INTERNAL:
+            reference_mv = 3600;
+            break;
+        case AR_INTERNAL_3_0:
+            reference_mv = 3000;
+            break;
+        case AR_INTERNAL_2_4:
+            reference_mv = 2400;
+            break;
+        case AR_INTERNAL_1_8:
+            reference_mv = 1800;
+            break;
+        case AR_INTERNAL_1_2:
+            reference_mv = 1200;
+            break;
+        case AR_VDD4:
+            reference_mv = 3300;
+            break;
+    }
+
+    // SAADC: started & stopped for every read, with a burst of acquisitions & conversions per oversample
+    nativeSimAdvanceMicros(SAADC_START_US + SAADC_STOP_US +
+                           (analog_oversampling * (SAADC_ACQUISITION_US + SAADC_CONVERSION_US)));
+
+    return samplePin(pin, reference_mv, analog_resolution, analog_oversampling);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SAADC REGISTERS (nrf.h)
+
+NRF_SAADC_Type native_saadc = {};
+
+static bool saadc_started = false;
+static uintptr_t saadc_ptr = 0; // RESULT.PTR & MAXCNT latched by START
+static uint32_t saadc_maxcnt = 0;
+static uint32_t saadc_amount = 0;
+
+static const uint8_t SAADC_ANALOG_INPUT_PINS[] = { 2, 3, 4, 5, 28, 29, 30, 31 }; // GPIO of AIN0-7
+static const float SAADC_GAINS[] = { 1.0F / 6, 1.0F / 5, 1.0F / 4, 1.0F / 3, 1.0F / 2, 1, 2, 4 };
+static const uint8_t SAADC_ACQUISITION_TIMES_US[] = { 3, 5, 10, 15, 20, 40, 40, 40 };
+
+void nativeSAADCStart(void) {
+    if (native_saadc.ENABLE != SAADC_ENABLE_ENABLE_Enabled) {
+        return;
+    }
+    nativeSimAdvanceMicros(SAADC_START_US);
+    saadc_ptr = native_saadc.RESULT.PTR;
+    saadc_maxcnt = native_saadc.RESULT.MAXCNT;
+    saadc_amount = 0;
+    saadc_started = true;
+    native_saadc.EVENTS_STARTED = 1;
+}
+
+void nativeSAADCSample(void) {
+    if (!saadc_started) {
+        return;
+    }
+    uint8_t resolution = 8 + (2 * (native_saadc.RESOLUTION & 0x3));
+    uint32_t oversampling = 1UL << ((native_saadc.OVERSAMPLE <= 8) ? native_saadc.OVERSAMPLE : 8);
+    int16_t *results = (int16_t *)saadc_ptr;
+
+    // scan every channel that's connected, each written to RAM as it's done
+    for (uint8_t ch = 0; (ch < SAADC_CH_NUM) && (saadc_amount < saadc_maxcnt); ch++) {
+        uint32_t input = native_saadc.CH[ch].PSELP;
+        if ((input < SAADC_CH_PSELP_PSELP_AnalogInput0) || (input > SAADC_CH_PSELP_PSELP_AnalogInput7)) {
+            continue; // not connected, or VDD which isn't simulated
+        }
+        uint32_t config = native_saadc.CH[ch].CONFIG;
+        float gain = SAADC_GAINS[(config & SAADC_CH_CONFIG_GAIN_Msk) >> SAADC_CH_CONFIG_GAIN_Pos];
+        bool vdd_reference = ((config & SAADC_CH_CONFIG_REFSEL_Msk) >> SAADC_CH_CONFIG_REFSEL_Pos);
+        float reference_mv = vdd_reference ? (3300.0F / 4) : 600.0F;
+        uint8_t acquisition_us = SAADC_ACQUISITION_TIMES_US[(config & SAADC_CH_CONFIG_TACQ_Msk) >>
+                                                            SAADC_CH_CONFIG_TACQ_Pos];
+
+        nativeSimAdvanceMicros(oversampling * (acquisition_us + SAADC_CONVERSION_US));
+        uint8_t pin = SAADC_ANALOG_INPUT_PINS[input - SAADC_CH_PSELP_PSELP_AnalogInput0];
+        results[saadc_amount++] = (int16_t)samplePin(pin, reference_mv / gain, resolution, oversampling);
+        native_saadc.EVENTS_DONE = 1;
+        native_saadc.EVENTS_RESULTDONE = 1;
+    }
+
+    if (saadc_amount >= saadc_maxcnt) {
+        native_saadc.RESULT.AMOUNT = saadc_amount;
+        native_saadc.EVENTS_END = 1;
+    }
+}
+
+void nativeSAADCStop(void) {
+    nativeSimAdvanceMicros(SAADC_STOP_US);
+    native_saadc.RESULT.AMOUNT = saadc_amount;
+    saadc_started = false;
+    native_saadc.EVENTS_STOPPED = 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SOFTWARE TIMER
+
+SoftwareTimer::SoftwareTimer(void) : timer{ 0, nullptr, nullptr, true, false, 0 } {}
+
+SoftwareTimer::~SoftwareTimer(void) {
+    nativeSimRemoveTimer(&timer);
+}
+
+void SoftwareTimer::begin(uint32_t ms, TimerCallbackFunction_t callback, void *timerID, bool repeating) {
+    timer.period_ms = ms;
+    timer.callback = callback;
+    timer.timer_id = timerID;
+    timer.repeating = repeating;
+    timer.active = false;
+    nativeSimAddTimer(&timer);
+}
+
+void SoftwareTimer::start(void) {
+    timer.expiry_us = nativeSimMicros() + ((uint64_t)timer.period_ms * 1000);
+    timer.active = true;
+}
+
+void SoftwareTimer::stop(void) {
+    timer.active = false;
+}
+
+void SoftwareTimer::reset(void) {
+    start();
+}
+
+void SoftwareTimer::setPeriod(uint32_t ms) {
+    timer.period_ms = ms;
+    if (timer.active) {
+        start();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SEMAPHORES & TASKS
+
+// Tasks run on their own threads, but only one runs at a time like on the single core nRF52: the running task keeps
+// going until it blocks on a semaphore or vTaskDelay(), then the highest priority ready task runs. If none are ready
+// time skips to the next timer or task timeout. There is no preemption.
+
+struct NativeSemaphore {
+    bool given;
+};
+
+struct NativeTask {
+    TaskFunction_t function;
+    void *parameters;
+    UBaseType_t priority;
+    bool blocked;
+    NativeSemaphore *waiting_on; /**< Semaphore the task is blocked on, if any. */
+    uint64_t wake_us;            /**< Simulated time the task times out, UINT64_MAX for never. */
+};
+
+#define MAX_NATIVE_TASKS 8
+static NativeTask loop_task = { nullptr, nullptr, TASK_PRIO_LOW, false, nullptr, UINT64_MAX }; /**< setup/loop */
+static NativeTask *tasks[MAX_NATIVE_TASKS] = { &loop_task };
+static NativeTask *running_task = &loop_task;
+static thread_local NativeTask *this_task = &loop_task;
+static bool loop_task_last = false; /**< The loop task only runs once no other task can, see nativeSimRunTasks(). */
+// never destroyed as task threads are still waiting on them when the program exits
+static std::mutex *task_mutex = new std::mutex();
+static std::condition_variable *task_switched = new std::condition_variable();
+
+/**
+ * @brief Whether a task can run.
+ * The loop task is always ready once the simulation is over so the sketch can finish.
+ */
+static bool taskReady(NativeTask *task) {
+    return (!task->blocked || ((task->waiting_on != nullptr) && task->waiting_on->given) ||
+            (nativeSimMicros() >= task->wake_us) || ((task == &loop_task) && !nativeSimRunning()));
+}
+
+/**
+ * @brief Find the highest priority ready task, preferring the given task out of equals.
+ * @return The task, or nullptr if none are ready.
+ */
+static NativeTask *nextReadyTask(NativeTask *preferred) {
+    NativeTask *next = ((preferred != nullptr) && taskReady(preferred)) ? preferred : nullptr;
+    for (NativeTask *task : tasks) {
+        if ((task != nullptr) && taskReady(task) && ((next == nullptr) || (task->priority > next->priority))) {
+            next = task;
+        }
+    }
+    if (loop_task_last && (next == &loop_task)) {
+        // look again without it
+        next = ((preferred != nullptr) && (preferred != &loop_task) && taskReady(preferred)) ? preferred : nullptr;
+        for (NativeTask *task : tasks) {
+            if ((task != nullptr) && (task != &loop_task) && taskReady(task) &&
+                ((next == nullptr) || (task->priority > next->priority))) {
+                next = task;
+            }
+        }
+        if (next == nullptr) {
+            next = &loop_task;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Hand over to another task and wait until this task runs again.
+ */
+static void switchTo(NativeTask *next) {
+    std::unique_lock<std::mutex> lock(*task_mutex);
+    running_task = next;
+    task_switched->notify_all();
+    task_switched->wait(lock, [] { return (running_task == this_task); });
+}
+
+/**
+ * @brief Block the running task until it's ready again, running other tasks or sleeping in the meantime.
+ * @param semaphore Semaphore to wait to be given, or nullptr.
+ * @param wake_us Simulated time to time out at, or UINT64_MAX.
+ */
+static void blockTask(NativeSemaphore *semaphore, uint64_t wake_us) {
+    NativeTask *self = this_task;
+    self->blocked = true;
+    self->waiting_on = semaphore;
+    self->wake_us = wake_us;
+
+    NativeTask *next;
+    while ((next = nextReadyTask(self)) != self) {
+        if (next != nullptr) {
+            switchTo(next);
+            continue;
+        }
+        // nothing can run, so sleep until the next timer or timeout
+        uint64_t earliest_wake_us = UINT64_MAX;
+        for (NativeTask *task : tasks) {
+            if ((task != nullptr) && (task->wake_us < earliest_wake_us)) {
+                earliest_wake_us = task->wake_us;
+            }
+        }
+        uint64_t now_us = nativeSimMicros();
+        bool fired = nativeSimSleepUntilNextTimer((earliest_wake_us > now_us) ? (earliest_wake_us - now_us) : 0);
+        if (!fired && (earliest_wake_us == UINT64_MAX) && nativeSimRunning()) {
+            // no timer or timeout left that could wake a task up, so it would sleep forever
+            nativeSimStop();
+        }
+    }
+    self->blocked = false;
+    self->waiting_on = nullptr;
+    self->wake_us = UINT64_MAX;
+}
+
+/**
+ * @brief Thread of a task: waits for its first turn, then runs the task function.
+ */
+static void runTask(NativeTask *task) {
+    this_task = task;
+    {
+        std::unique_lock<std::mutex> lock(*task_mutex);
+        task_switched->wait(lock, [task] { return (running_task == task); });
+    }
+    task->function(task->parameters);
+    // a FreeRTOS task must never return, but if it does, block it forever
+    blockTask(nullptr, UINT64_MAX);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return new NativeSemaphore{ false };
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    uint64_t timeout_us = (ticks == portMAX_DELAY) ? UINT64_MAX : (((uint64_t)ticks * 1000000) / configTICK_RATE_HZ);
+    uint64_t end_us = (timeout_us == UINT64_MAX) ? UINT64_MAX : (nativeSimMicros() + timeout_us);
+
+    while (!semaphore->given) {
+        if ((nativeSimMicros() >= end_us) || ((this_task == &loop_task) && !nativeSimRunning())) {
+            return pdFALSE;
+        }
+        blockTask(semaphore, end_us);
+    }
+    semaphore->given = false;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    if (semaphore->given) {
+        return pdFALSE;
+    }
+    semaphore->given = true;
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint16_t stack_depth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *created_task) {
+    (void)name;
+    (void)stack_depth;
+    for (NativeTask *&slot : tasks) {
+        if (slot == nullptr) {
+            slot = new NativeTask{ function, parameters, priority, false, nullptr, UINT64_MAX };
+            std::thread(runTask, slot).detach();
+            if (created_task != nullptr) {
+                *created_task = slot;
+            }
+            return pdPASS;
+        }
+    }
+    return pdFAIL;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    uint64_t end_us = nativeSimMicros() + (((uint64_t)ticks * 1000000) / configTICK_RATE_HZ);
+    while (nativeSimMicros() < end_us) {
+        if ((this_task == &loop_task) && !nativeSimRunning()) {
+            return;
+        }
+        blockTask(nullptr, end_us);
+    }
+}
+
+void nativeSimRunTasks(void) {
+    // let every other task that's ready run until they're all blocked, even if they're lower priority
+    loop_task_last = true;
+    NativeTask *next;
+    while ((next = nextReadyTask(nullptr)) != &loop_task) {
+        switchTo(next);
+    }
+    loop_task_last = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// MAIN
+
+static uint32_t n_checks = 0;
+static uint32_t n_failed_checks = 0;
+
+bool nativeSimCheck(bool passed, const char *condition, const char *file, int line) {
+    n_checks++;
+    if (!passed) {
+        n_failed_checks++;
+        fflush(stdout);
+        fprintf(stderr, "[native] %s:%d: check failed: %s\n", file, line, condition);
+    }
+    return passed;
+}
+
+/**
+ * @brief Runs the sketch: setup() once, then loop() until the simulation is over.
+ * Usage: program [simulated duration in ms] [flash image] [--link-down <from ms>-<to ms>]
+ *                [--path-loss <dB>[-<dB at the end>]]
+ * The flash image is loaded at the start (if it exists) and saved at the end, so a run continues from the last one.
+ * --link-down simulates a network outage, see nativeSimSetLinkDown().
+ * --path-loss simulates the link budget, changing linearly over the run if given an end, see nativeSimSetPathLoss().
+ */
+int main(int argc, char *argv[]) {
+    int n_positional = 0;
+    const char *flash_image = nullptr;
+    uint64_t duration_ms = NATIVE_SIM_DEFAULT_DURATION_MS;
+    float path_loss_from_db = 0;
+    float path_loss_to_db = 0;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--link-down") == 0) && ((i + 1) < argc)) {
+            char *to = nullptr;
+            uint64_t from_ms = strtoull(argv[++i], &to, 10);
+            nativeSimSetLinkDown(from_ms, (*to == '-') ? strtoull(to + 1, nullptr, 10) : UINT64_MAX);
+        } else if ((strcmp(argv[i], "--path-loss") == 0) && ((i + 1) < argc)) {
+            char *to = nullptr;
+            path_loss_from_db = strtof(argv[++i], &to);
+            path_loss_to_db = (*to == '-') ? strtof(to + 1, nullptr) : path_loss_from_db;
+        } else if (n_positional++ == 0) {
+            duration_ms = strtoull(argv[i], nullptr, 10);
+            nativeSimSetDuration(duration_ms);
+        } else {
+            flash_image = argv[i];
+        }
+    }
+    nativeSimSetPathLoss(path_loss_from_db, path_loss_to_db, duration_ms);
+    if (flash_image != nullptr) {
+        nativeSimLoadFlash(flash_image);
+    }
+
+    setup();
+    while (nativeSimRunning()) {
+        loop();
+    }
+
+    // give any lower priority tasks (e.g. the log drain task) a last chance to finish their work
+    nativeSimRunTasks();
+    if (flash_image != nullptr) {
+        nativeSimSaveFlash(flash_image);
+    }
+
+    uint64_t sim_us = nativeSimMicros();
+    uint64_t awake_us = sim_us - nativeSimSleptMicros();
+    fflush(stdout);
+    fprintf(stderr, "[native] simulated %.3f s, awake %.3f s (%.4f%%)\n", (double)sim_us / 1e6, (double)awake_us / 1e6,
+            (sim_us > 0) ? (100.0 * (double)awake_us / (double)sim_us) : 0.0);
+    if (n_checks > 0) {
+        fprintf(stderr, "[native] %lu of %lu checks failed\n", (unsigned long)n_failed_checks,
+                (unsigned long)n_checks);
+    }
+    return (n_failed_checks > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Adafruit_SPIFlash.h"
+#include "NativeSim.h"
+
+SPIClass SPI;
+
+// GD25Q16C datasheet typical times
+#define FLASH_PAGE_PROGRAM_US 600
+#define FLASH_SECTOR_ERASE_US 50000
+#define FLASH_CHIP_ERASE_US   15000000ULL
+#define FLASH_DEFAULT_SIZE    (1UL << 21)
+
+// The one simulated chip, shared by every Adafruit_SPIFlash & kept across begin()
+static std::vector<uint8_t> flash_memory;
+static uint32_t flash_jedec_id = 0xC84015; // GD25Q16C
+
+bool Adafruit_SPIFlash::begin(SPIFlash_Device_t const *flash_devs, size_t count) {
+    (void)count;
+    uint32_t total_size = (flash_devs != NULL) ? flash_devs->total_size : FLASH_DEFAULT_SIZE;
+    if (flash_devs != NULL) {
+        flash_jedec_id = ((uint32_t)flash_devs->manufacturer_id << 16) | ((uint32_t)flash_devs->memory_type << 8) |
+                         flash_devs->capacity;
+    }
+    if (flash_memory.size() != total_size) {
+        flash_memory.resize(total_size, 0xFF); // a new chip comes erased
+    }
+    nativeSimAdvanceMicros((flash_devs != NULL) ? flash_devs->start_up_time_us : 0);
+    return true;
+}
+
+uint32_t Adafruit_SPIFlash::getJEDECID(void) {
+    return flash_jedec_id;
+}
+
+uint32_t Adafruit_SPIFlash::size(void) {
+    return flash_memory.size();
+}
+
+bool Adafruit_SPIFlash::eraseSector(uint32_t sectorNumber) {
+    if ((sectorNumber + 1) * SFLASH_SECTOR_SIZE > flash_memory.size()) {
+        return false;
+    }
+    memset(&flash_memory[sectorNumber * SFLASH_SECTOR_SIZE], 0xFF, SFLASH_SECTOR_SIZE);
+    nativeSimAdvanceMicros(FLASH_SECTOR_ERASE_US);
+    return true;
+}
+
+bool Adafruit_SPIFlash::eraseChip(void) {
+    memset(flash_memory.data(), 0xFF, flash_memory.size());
+    nativeSimAdvanceMicros(FLASH_CHIP_ERASE_US);
+    return true;
+}
+
+uint32_t Adafruit_SPIFlash::readBuffer(uint32_t address, uint8_t *buffer, uint32_t len) {
+    if (address + len > flash_memory.size()) {
+        return 0;
+    }
+    memcpy(buffer, &flash_memory[address], len);
+    // command + address, then 8 bits per byte at 15 MHz
+    nativeSimAdvanceMicros(3 + (len * 8) / 15);
+    return len;
+}
+
+uint32_t Adafruit_SPIFlash::writeBuffer(uint32_t address, uint8_t const *buffer, uint32_t len) {
+    if (address + len > flash_memory.size()) {
+        return 0;
+    }
+    // programmed a page at a time like the real library, NOR flash can only clear bits
+    uint32_t remaining = len;
+    while (remaining > 0) {
+        uint32_t page_len = SFLASH_PAGE_SIZE - (address % SFLASH_PAGE_SIZE);
+        if (page_len > remaining) {
+            page_len = remaining;
+        }
+        for (uint32_t i = 0; i < page_len; i++) {
+            flash_memory[address + i] &= buffer[i];
+        }
+        nativeSimAdvanceMicros(FLASH_PAGE_PROGRAM_US);
+        address += page_len;
+        buffer += page_len;
+        remaining -= page_len;
+    }
+    return len;
+}
+
+bool nativeSimLoadFlash(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    flash_memory.assign(FLASH_DEFAULT_SIZE, 0xFF);
+    size_t len = fread(flash_memory.data(), 1, flash_memory.size(), file);
+    fclose(file);
+    return len > 0;
+}
+
+bool nativeSimSaveFlash(const char *path) {
+    if (flash_memory.empty()) {
+        return false;
+    }
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    size_t len = fwrite(flash_memory.data(), 1, flash_memory.size(), file);
+    fclose(file);
+    return len == flash_memory.size();
+}
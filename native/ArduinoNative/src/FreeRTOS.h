@@ -0,0 +1,90 @@
+#pragma once
+/**
+ * @file FreeRTOS.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the FreeRTOS task, semaphore & timer API used by this repo.
+ * Only one task runs at a time and only until it blocks, there is no preemption. When a task takes a semaphore that
+ * hasn't been given, the highest priority ready task runs instead. If no task is ready the device "sleeps" by jumping
+ * the simulated clock forward to the next SoftwareTimer expiry (running its callback) or task timeout.
+ *
+ * @version 0.1
+ * @date 2022-02-07
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdPASS  (pdTRUE)
+#define pdFAIL  (pdFALSE)
+
+#define configTICK_RATE_HZ   1024 // Same as the nRF52 port
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define portTICK_PERIOD_MS   ((TickType_t)1000 / configTICK_RATE_HZ)
+#define xTaskGetTickCount()  (pdMS_TO_TICKS(millis()))
+
+struct NativeSemaphore;
+typedef NativeSemaphore *SemaphoreHandle_t;
+
+struct NativeTask;
+typedef NativeTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *parameters);
+
+#define configMINIMAL_STACK_SIZE 100
+
+// Same as the Adafruit nRF52 core. setup() & loop() run in a TASK_PRIO_LOW task.
+enum {
+    TASK_PRIO_LOWEST = 0,
+    TASK_PRIO_LOW = 1,
+    TASK_PRIO_NORMAL = 2,
+    TASK_PRIO_HIGH = 3,
+    TASK_PRIO_HIGHEST = 4,
+};
+
+struct NativeTimer;
+typedef NativeTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+
+/**
+ * @brief Create a binary semaphore (created empty).
+ */
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+
+/**
+ * @brief Take the semaphore, sleeping (in simulated time) for up to ticks until it's given.
+ * @return pdTRUE if taken, pdFALSE if timed out or nothing is left that could give it.
+ */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+
+/**
+ * @brief Give the semaphore.
+ */
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+// There are no interrupts on the host, so the ISR version is the same as a normal give.
+#define xSemaphoreGiveFromISR(semaphore, higher_priority_task_woken) xSemaphoreGive(semaphore)
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+
+/**
+ * @brief Create a task. It first runs when the running task blocks and it's the highest priority ready task.
+ * @return pdPASS, or pdFAIL if there are too many tasks.
+ */
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint16_t stack_depth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *created_task);
+
+/**
+ * @brief Block the task for the given ticks of simulated time, letting other tasks run or sleeping meanwhile.
+ */
+void vTaskDelay(TickType_t ticks);
+
+// Critical sections do nothing on a single threaded host
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
@@ -0,0 +1,140 @@
+#pragma once
+/**
+ * @file LoRaWan-RAK4630.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the SX126x-Arduino LoRaMac handler (lmh_*) API used by this repo.
+ * The simulated network accepts the join straight away and every uplink is printed instead of transmitted. Each uplink
+ * is finished with (lmh_unconf_finished / lmh_conf_result) 2 s later, after its RX windows, and lmh_send() is busy
+ * until then. During an outage (nativeSimSetLinkDown()) joins fail and uplinks are lost. Clock sync requests (TS003
+ * AppTimeReq on port 202) are answered with a downlink (lmh_RxData) at the end of their RX windows.
+ *
+ * @version 0.1
+ * @date 2022-02-07
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+
+typedef enum eDeviceClass {
+    CLASS_A,
+    CLASS_B,
+    CLASS_C,
+} DeviceClass_t;
+
+typedef enum eLoRaMacRegion_t {
+    LORAMAC_REGION_AS923,
+    LORAMAC_REGION_AU915,
+    LORAMAC_REGION_CN470,
+    LORAMAC_REGION_CN779,
+    LORAMAC_REGION_EU433,
+    LORAMAC_REGION_EU868,
+    LORAMAC_REGION_KR920,
+    LORAMAC_REGION_IN865,
+    LORAMAC_REGION_US915,
+    LORAMAC_REGION_RU864,
+} LoRaMacRegion_t;
+
+typedef enum {
+    LMH_UNCONFIRMED_MSG = 0,
+    LMH_CONFIRMED_MSG = !LMH_UNCONFIRMED_MSG,
+} lmh_confirm;
+
+typedef enum {
+    LMH_SUCCESS = 0,
+    LMH_BUSY = -1,
+    LMH_ERROR = -2,
+} lmh_error_status;
+
+typedef enum {
+    LMH_RESET = 0,
+    LMH_SET = 1,
+    LMH_ONGOING = 2,
+    LMH_FAILED = 3,
+} lmh_join_status;
+
+#define LORAWAN_ADR_ON           1
+#define LORAWAN_ADR_OFF          0
+#define LORAWAN_PUBLIC_NETWORK   true
+#define LORAWAN_DUTYCYCLE_ON     true
+#define LORAWAN_DUTYCYCLE_OFF    false
+#define LORAWAN_DEFAULT_DATARATE DR_3
+#define LORAWAN_DEFAULT_TX_POWER TX_POWER_0
+
+#define DR_0  0
+#define DR_1  1
+#define DR_2  2
+#define DR_3  3
+#define DR_4  4
+#define DR_5  5
+#define DR_6  6
+#define DR_7  7
+#define DR_8  8
+#define DR_9  9
+#define DR_10 10
+#define DR_11 11
+#define DR_12 12
+#define DR_13 13
+
+#define TX_POWER_0  0
+#define TX_POWER_1  1
+#define TX_POWER_2  2
+#define TX_POWER_3  3
+#define TX_POWER_4  4
+#define TX_POWER_5  5
+#define TX_POWER_6  6
+#define TX_POWER_7  7
+#define TX_POWER_8  8
+#define TX_POWER_9  9
+#define TX_POWER_10 10
+
+/** @brief Application data of an uplink or downlink. */
+typedef struct {
+    uint8_t *buffer;
+    uint8_t buffsize;
+    uint8_t port;
+    int16_t rssi;
+    int8_t snr;
+} lmh_app_data_t;
+
+/** @brief LoRaWAN settings passed to lmh_init(). */
+typedef struct {
+    bool adr_enable;
+    int8_t tx_data_rate;
+    bool enable_public_network;
+    uint8_t nb_trials;
+    int8_t tx_power;
+    bool duty_cycle;
+} lmh_param_t;
+
+/** @brief Callbacks passed to lmh_init(). */
+typedef struct {
+    uint8_t (*BoardGetBatteryLevel)(void);
+    void (*BoardGetUniqueId)(uint8_t *id);
+    uint32_t (*BoardGetRandomSeed)(void);
+    void (*lmh_RxData)(lmh_app_data_t *app_data);
+    void (*lmh_has_joined)(void);
+    void (*lmh_ConfirmClass)(DeviceClass_t Class);
+    void (*lmh_has_joined_failed)(void);
+    void (*lmh_unconf_finished)(void);
+    void (*lmh_conf_result)(bool result);
+} lmh_callback_t;
+
+uint32_t lora_rak4630_init(void);
+
+uint8_t BoardGetBatteryLevel(void);
+void BoardGetUniqueId(uint8_t *id);
+uint32_t BoardGetRandomSeed(void);
+
+lmh_error_status lmh_init(lmh_callback_t *callbacks, lmh_param_t lora_param, bool otaa,
+                          DeviceClass_t nodeClass = CLASS_A, LoRaMacRegion_t region = LORAMAC_REGION_EU868,
+                          bool region_change = false);
+void lmh_setDevEui(uint8_t *userDevEui);
+void lmh_setAppEui(uint8_t *userAppEui);
+void lmh_setAppKey(uint8_t *userAppKey);
+void lmh_join(void);
+lmh_join_status lmh_join_status_get(void);
+lmh_error_status lmh_send(lmh_app_data_t *app_data, lmh_confirm is_txconfirmed);
+lmh_error_status lmh_class_request(DeviceClass_t newClass);
+void lmh_datarate_set(uint8_t data_rate, bool enable_adr);
+void lmh_tx_power_set(uint8_t tx_power);
@@ -0,0 +1,310 @@
+#include "LoRaWan-RAK4630.h"
+
+#include "NativeSim.h"
+#include "mac/region/RegionAU915.h"
+
+#include <random>
+
+#define NATIVE_LORAWAN_RX_WINDOWS_MS 2000  /**< An uplink is finished with once its RX2 window (2 s after) is over. */
+#define NATIVE_LORAWAN_JOIN_TRIAL_MS 7000  /**< Each join request waits ~6 s for the join accept. */
+
+// LoRaWAN TS003 clock sync, answered by the simulated network server
+#define NATIVE_LORAWAN_CLOCK_SYNC_PORT 202
+#define NATIVE_LORAWAN_GPS_UNIX_OFFSET (315964800UL - 18UL) /**< GPS epoch in Unix time, less the leap seconds. */
+
+// simulated link budget, see nativeSimSetPathLoss()
+#define NATIVE_LORAWAN_MAX_TX_DBM      22   /**< TX_POWER_0, the RAK4631's max. Each TX_POWER step is 2 dB less. */
+#define NATIVE_LORAWAN_GATEWAY_TX_DBM  27   /**< Downlink TX power. */
+#define NATIVE_LORAWAN_NOISE_FLOOR_DBM -117 /**< Noise in 125 kHz, with a 6 dB noise figure. */
+#define NATIVE_LORAWAN_FADE_DB         3    /**< Standard deviation of the random fade of each frame. */
+#define NATIVE_LORAWAN_MAX_SNR_DB      10   /**< The SX1262 reports a strong signal's SNR as ~10 dB. */
+#define NATIVE_LORAWAN_SF12_SNR_DB     -20  /**< SNR SF12 needs at the gateway, each SF below it needs 2.5 dB more. */
+static float path_loss_from_db = 0;
+static float path_loss_to_db = 0;
+static uint64_t path_loss_over_ms = 0;
+static std::mt19937 fade_rng(0x5EED); // the same fades every run
+
+static lmh_callback_t *lmh_callbacks = nullptr;
+static lmh_param_t lmh_params = {};
+static lmh_join_status join_status = LMH_RESET;
+
+// simulated network outage, see nativeSimSetLinkDown()
+static uint64_t link_down_from_ms = 0;
+static uint64_t link_down_to_ms = 0;
+
+// the uplink in progress
+static SoftwareTimer tx_done_timer;
+static bool tx_busy = false;
+static bool tx_confirmed = false;
+static bool tx_delivered = false;
+
+// downlink received in the RX windows of the uplink in progress
+static uint8_t rx_buffer[16];
+static lmh_app_data_t rx_data = { rx_buffer, 0, 0, -60, 8 };
+
+static SoftwareTimer join_failed_timer;
+
+void nativeSimSetLinkDown(uint64_t from_ms, uint64_t to_ms) {
+    link_down_from_ms = from_ms;
+    link_down_to_ms = to_ms;
+}
+
+bool nativeSimLinkUp(void) {
+    uint64_t now_ms = nativeSimMicros() / 1000;
+    return !((now_ms >= link_down_from_ms) && (now_ms < link_down_to_ms));
+}
+
+void nativeSimSetPathLoss(float from_db, float to_db, uint64_t over_ms) {
+    path_loss_from_db = from_db;
+    path_loss_to_db = to_db;
+    path_loss_over_ms = over_ms;
+}
+
+/**
+ * @brief Whether the link budget is simulated, see nativeSimSetPathLoss().
+ */
+static bool linkBudgetSimulated(void) {
+    return ((path_loss_from_db > 0) || (path_loss_to_db > 0));
+}
+
+/**
+ * @brief Path loss right now, plus a random fade for this frame.
+ * @return Path loss in dB.
+ */
+static float pathLossDb(void) {
+    float loss_db = path_loss_to_db;
+    uint64_t now_ms = nativeSimMicros() / 1000;
+    if (now_ms < path_loss_over_ms) {
+        loss_db = path_loss_from_db + (path_loss_to_db - path_loss_from_db) * ((float)now_ms / path_loss_over_ms);
+    }
+    std::normal_distribution<float> fade_db(0, NATIVE_LORAWAN_FADE_DB);
+    return loss_db - fade_db(fade_rng);
+}
+
+/**
+ * @brief Whether the region (AU915, like the stack's regional parameters) defines an uplink datarate.
+ * @param datarate The datarate.
+ * @return True if defined.
+ */
+static bool uplinkDatarate(uint8_t datarate) {
+    return (datarate <= AU915_TX_MAX_DATARATE) && (DataratesAU915[datarate] != 0);
+}
+
+/**
+ * @brief SNR an uplink datarate needs at the gateway, in 125 kHz terms: 500 kHz has 6 dB more noise.
+ * @param datarate The datarate.
+ * @return The SNR in dB.
+ */
+static float requiredSnrDb(uint8_t datarate) {
+    float snr_db = NATIVE_LORAWAN_SF12_SNR_DB + 2.5f * (12 - DataratesAU915[datarate]);
+    return snr_db + ((BandwidthsAU915[datarate] == 500000) ? 6 : 0);
+}
+
+/**
+ * @brief Whether an uplink at the current datarate & TX power is heard by the gateway.
+ * @param snr_db Returns its SNR at the gateway.
+ * @return True if heard, always with a perfect link.
+ */
+static bool uplinkHeard(float *snr_db) {
+    *snr_db = NATIVE_LORAWAN_MAX_SNR_DB;
+    if (!linkBudgetSimulated()) {
+        return true;
+    }
+    float tx_dbm = NATIVE_LORAWAN_MAX_TX_DBM - 2.0f * lmh_params.tx_power;
+    *snr_db = tx_dbm - pathLossDb() - NATIVE_LORAWAN_NOISE_FLOOR_DBM;
+    return (*snr_db >= requiredSnrDb(lmh_params.tx_data_rate));
+}
+
+/**
+ * @brief Sets the RSSI & SNR of the downlink received in the RX windows.
+ */
+static void setDownlinkQuality(void) {
+    if (!linkBudgetSimulated()) {
+        return;
+    }
+    float rssi_dbm = NATIVE_LORAWAN_GATEWAY_TX_DBM - pathLossDb();
+    float snr_db = rssi_dbm - NATIVE_LORAWAN_NOISE_FLOOR_DBM;
+    rx_data.rssi = (int16_t)rssi_dbm;
+    rx_data.snr = (int8_t)((snr_db < NATIVE_LORAWAN_MAX_SNR_DB) ? snr_db : NATIVE_LORAWAN_MAX_SNR_DB);
+}
+
+/**
+ * @brief Ends the uplink in progress after its RX windows, like the LoRaMac handler does.
+ */
+static void txDoneTimeoutHandler(TimerHandle_t unused) {
+    (void)unused;
+    tx_busy = false;
+    if (lmh_callbacks == nullptr) {
+        return;
+    }
+    if ((rx_data.buffsize > 0) && (lmh_callbacks->lmh_RxData != nullptr)) {
+        lmh_callbacks->lmh_RxData(&rx_data);
+    }
+    rx_data.buffsize = 0;
+    if (tx_confirmed) {
+        if (lmh_callbacks->lmh_conf_result != nullptr) {
+            lmh_callbacks->lmh_conf_result(tx_delivered);
+        }
+    } else if (lmh_callbacks->lmh_unconf_finished != nullptr) {
+        lmh_callbacks->lmh_unconf_finished();
+    }
+}
+
+/**
+ * @brief Answers a clock sync AppTimeReq like a network server's clock sync package, with the difference between the
+ * simulated GPS time & the device's time when the uplink was received.
+ * @param app_data The AppTimeReq uplink.
+ */
+static void answerClockSync(const lmh_app_data_t *app_data) {
+    const uint8_t *request = app_data->buffer;
+    if ((app_data->buffsize < 6) || (request[0] != 0x01)) {
+        return;
+    }
+    uint32_t device_time = request[1] | (request[2] << 8) | (request[3] << 16) | ((uint32_t)request[4] << 24);
+    uint32_t correction = (nativeSimUnixTime() - NATIVE_LORAWAN_GPS_UNIX_OFFSET) - device_time;
+    rx_buffer[0] = 0x01; // AppTimeAns
+    for (uint8_t i = 0; i < 4; i++) {
+        rx_buffer[1 + i] = (uint8_t)(correction >> (8 * i));
+    }
+    rx_buffer[5] = request[5] & 0x0F; // TokenAns
+    rx_data.buffsize = 6;
+    rx_data.port = NATIVE_LORAWAN_CLOCK_SYNC_PORT;
+    setDownlinkQuality();
+}
+
+/**
+ * @brief Fails the join once all its trials have gone unanswered.
+ */
+static void joinFailedTimeoutHandler(TimerHandle_t unused) {
+    (void)unused;
+    join_status = LMH_FAILED;
+    if ((lmh_callbacks != nullptr) && (lmh_callbacks->lmh_has_joined_failed != nullptr)) {
+        lmh_callbacks->lmh_has_joined_failed();
+    }
+}
+
+uint32_t lora_rak4630_init(void) {
+    return 0;
+}
+
+uint8_t BoardGetBatteryLevel(void) {
+    return 254; // 255 = unable to measure, 1-254 = level
+}
+
+void BoardGetUniqueId(uint8_t *id) {
+    for (uint8_t i = 0; i < 8; i++) {
+        id[i] = i;
+    }
+}
+
+uint32_t BoardGetRandomSeed(void) {
+    return 0x5EED;
+}
+
+lmh_error_status lmh_init(lmh_callback_t *callbacks, lmh_param_t lora_param, bool otaa, DeviceClass_t nodeClass,
+                          LoRaMacRegion_t region, bool region_change) {
+    (void)otaa;
+    (void)nodeClass;
+    (void)region;
+    (void)region_change;
+    if (!uplinkDatarate(lora_param.tx_data_rate)) {
+        return LMH_ERROR;
+    }
+    lmh_callbacks = callbacks;
+    lmh_params = lora_param;
+    join_status = LMH_RESET;
+    return LMH_SUCCESS;
+}
+
+void lmh_setDevEui(uint8_t *userDevEui) {
+    (void)userDevEui;
+}
+
+void lmh_setAppEui(uint8_t *userAppEui) {
+    (void)userAppEui;
+}
+
+void lmh_setAppKey(uint8_t *userAppKey) {
+    (void)userAppKey;
+}
+
+void lmh_join(void) {
+    bool heard = false;
+    for (uint8_t trial = 0; (trial < lmh_params.nb_trials) && !heard; trial++) {
+        float snr_db;
+        heard = uplinkHeard(&snr_db);
+    }
+    if (!nativeSimLinkUp() || !heard) {
+        // no answer to any of the join trials
+        join_status = LMH_ONGOING;
+        join_failed_timer.begin(NATIVE_LORAWAN_JOIN_TRIAL_MS * lmh_params.nb_trials, joinFailedTimeoutHandler, nullptr,
+                                false);
+        join_failed_timer.start();
+        return;
+    }
+    // the simulated network accepts the join straight away
+    join_status = LMH_SET;
+    if ((lmh_callbacks != nullptr) && (lmh_callbacks->lmh_has_joined != nullptr)) {
+        lmh_callbacks->lmh_has_joined();
+    }
+}
+
+lmh_join_status lmh_join_status_get(void) {
+    return join_status;
+}
+
+lmh_error_status lmh_send(lmh_app_data_t *app_data, lmh_confirm is_txconfirmed) {
+    if (join_status != LMH_SET) {
+        return LMH_ERROR;
+    }
+    if (tx_busy) {
+        // still in the RX windows of the last uplink
+        return LMH_BUSY;
+    }
+    uint8_t max_payload = MaxPayloadOfDatarateAU915[lmh_params.tx_data_rate];
+    if (app_data->buffsize > max_payload) {
+        printf("[lmh_send] t=%lu ms DR%d port %d (%d bytes): too long, max %d bytes\n", millis(),
+               lmh_params.tx_data_rate, app_data->port, app_data->buffsize, max_payload);
+        return LMH_ERROR;
+    }
+
+    // during an outage or a fade the uplink goes nowhere, which the device only finds out about if it's confirmed
+    float snr_db;
+    tx_delivered = uplinkHeard(&snr_db) && nativeSimLinkUp();
+    printf("[lmh_send] t=%lu ms DR%d %s port %d (%d bytes):", millis(), lmh_params.tx_data_rate,
+           (is_txconfirmed == LMH_CONFIRMED_MSG) ? "confirmed" : "unconfirmed", app_data->port, app_data->buffsize);
+    for (uint8_t i = 0; i < app_data->buffsize; i++) {
+        printf(" %02X", app_data->buffer[i]);
+    }
+    if (linkBudgetSimulated()) {
+        printf(" [TX_POWER_%d, SNR %.1f dB]", lmh_params.tx_power, snr_db);
+    }
+    printf(tx_delivered ? "\n" : " (lost)\n");
+    if (tx_delivered && (app_data->port == NATIVE_LORAWAN_CLOCK_SYNC_PORT)) {
+        answerClockSync(app_data);
+    }
+
+    tx_busy = true;
+    tx_confirmed = (is_txconfirmed == LMH_CONFIRMED_MSG);
+    tx_done_timer.begin(NATIVE_LORAWAN_RX_WINDOWS_MS, txDoneTimeoutHandler, nullptr, false);
+    tx_done_timer.start();
+    return LMH_SUCCESS;
+}
+
+lmh_error_status lmh_class_request(DeviceClass_t newClass) {
+    (void)newClass;
+    return LMH_SUCCESS;
+}
+
+void lmh_datarate_set(uint8_t data_rate, bool enable_adr) {
+    // LoRaMac doesn't take a datarate the region doesn't define
+    if (!uplinkDatarate(data_rate)) {
+        return;
+    }
+    lmh_params.tx_data_rate = data_rate;
+    lmh_params.adr_enable = enable_adr;
+}
+
+void lmh_tx_power_set(uint8_t tx_power) {
+    lmh_params.tx_power = tx_power;
+}
@@ -0,0 +1,146 @@
+#pragma once
+/**
+ * @file NativeSim.h
+ * @author Kalina Knight
+ * @brief Simulation controls for the native (host) environment.
+ *
+ * Simulated time = real time spent running on the host + time skipped by delay() & semaphore sleeps. The time skipped
+ * while sleeping on a semaphore is tracked separately so the awake time of a sketch can be reported.
+ *
+ * The simulated environment (temperature, humidity, etc.) follows a simple daily cycle so the simulated sensors return
+ * plausible, slowly changing values.
+ *
+ * @version 0.1
+ * @date 2022-02-07
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+#include "SoftwareTimer.h"
+
+#define NATIVE_SIM_DEFAULT_DURATION_MS (60UL * 60UL * 1000UL) /**< Simulate 1 hour unless told otherwise. */
+#define NATIVE_SIM_START_UNIX_TIME     1644969600UL           /**< Real time the simulation starts: 2022-02-16. */
+
+/**
+ * @brief Current simulated time.
+ * @return Microseconds since the simulation started.
+ */
+uint64_t nativeSimMicros(void);
+
+/**
+ * @brief Real (wall clock) time in the simulation, e.g. for the network's answer to a clock sync request.
+ * @return Unix time in seconds.
+ */
+uint32_t nativeSimUnixTime(void);
+
+/**
+ * @brief Skip simulated time while awake (e.g. delay()), firing any timers that expire along the way.
+ * @param us Microseconds to skip.
+ */
+void nativeSimAdvanceMicros(uint64_t us);
+
+/**
+ * @brief Sleep in simulated time until the next timer fires or until the timeout passes.
+ * @param timeout_us Max microseconds to sleep.
+ * @return True if a timer fired, false if the timeout was reached or there is nothing to wake up to.
+ */
+bool nativeSimSleepUntilNextTimer(uint64_t timeout_us);
+
+/**
+ * @brief Total simulated time spent asleep on a semaphore.
+ * @return Microseconds asleep.
+ */
+uint64_t nativeSimSleptMicros(void);
+
+/**
+ * @brief Set how long the simulation runs for before main() stops calling loop().
+ * @param duration_ms Simulated milliseconds.
+ */
+void nativeSimSetDuration(uint64_t duration_ms);
+
+/**
+ * @brief Whether the simulation should keep running.
+ * @return False once the duration has passed or the sketch sleeps with nothing left to wake it.
+ */
+bool nativeSimRunning(void);
+
+/**
+ * @brief Stop the simulation after the current loop().
+ */
+void nativeSimStop(void);
+
+/**
+ * @brief Run any other tasks that are ready until they have all blocked, e.g. to let them finish at the end.
+ */
+void nativeSimRunTasks(void);
+
+/**
+ * @brief Load the simulated flash (Adafruit_SPIFlash.h) from an image file, e.g. one saved by a previous run.
+ * @param path Image file.
+ * @return False if the file can't be read, in which case the flash starts erased.
+ */
+bool nativeSimLoadFlash(const char *path);
+
+/**
+ * @brief Save the simulated flash to an image file, as if read out of the chip.
+ * @param path Image file.
+ * @return False if the flash wasn't used or the file can't be written.
+ */
+bool nativeSimSaveFlash(const char *path);
+
+/**
+ * @brief Simulate a network outage (e.g. the gateway is down): joins fail and uplinks are lost in between.
+ * @param from_ms Simulated time the outage starts.
+ * @param to_ms Simulated time the outage ends.
+ */
+void nativeSimSetLinkDown(uint64_t from_ms, uint64_t to_ms);
+
+/**
+ * @brief Whether the simulated network can be reached right now.
+ * @return False during the outage set by nativeSimSetLinkDown().
+ */
+bool nativeSimLinkUp(void);
+
+/**
+ * @brief Simulate the link budget to the gateway, e.g. to test link adaptation. Each uplink & join is only heard if its
+ * SNR at the gateway (from its TX power, the path loss & a random fade) is above the floor of its datarate, and
+ * downlinks carry the RSSI & SNR the device would measure. 0 dB (the default) is a perfect link.
+ * @param from_db Path loss at the start, in dB e.g. 120 near a gateway, 140 at the edge of coverage.
+ * @param to_db Path loss at over_ms, e.g. as the device moves away from the gateway.
+ * @param over_ms Simulated time the path loss changes from from_db to to_db over, linearly.
+ */
+void nativeSimSetPathLoss(float from_db, float to_db, uint64_t over_ms);
+
+/**
+ * @brief Record the result of a check in a native check sketch (see checks/), printing it if it failed. Once the sketch
+ * is done main() exits with EXIT_FAILURE if any check failed, so the checks can be run by scripts & CI.
+ * Use NATIVE_CHECK() rather than calling this directly.
+ * @param passed Whether the condition held.
+ * @param condition The condition, as written.
+ * @param file Source file of the check.
+ * @param line Line of the check.
+ * @return passed, so a failed check can be followed up e.g. with more detail.
+ */
+bool nativeSimCheck(bool passed, const char *condition, const char *file, int line);
+#define NATIVE_CHECK(condition) nativeSimCheck((condition), #condition, __FILE__, __LINE__)
+
+// Timer registry used by SoftwareTimer
+void nativeSimAddTimer(NativeTimer *timer);
+void nativeSimRemoveTimer(NativeTimer *timer);
+
+// Simulated environment
+float nativeSimTemperatureC(void);
+float nativeSimHumidity(void);
+uint32_t nativeSimPressurePa(void);
+uint32_t nativeSimGasResistance(void);
+
+/**
+ * @brief Simulated voltage on an analog pin.
+ * The battery (WB_A0) discharges slowly, the other pins read a mid-scale sensor output, WB_A1 only while its
+ * RAK5801/RAK5811 is powered (WB_IO1 high).
+ * @param pin Analog pin.
+ * @return Voltage at the pin in mV.
+ */
+float nativeSimPinMV(uint32_t pin);
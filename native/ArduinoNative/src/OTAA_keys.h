@@ -0,0 +1,16 @@
+#pragma once
+/**
+ * @file OTAA_keys.h
+ * @author Kalina Knight
+ * @brief Placeholder OTAA keys so sketches build in the native environment.
+ * The simulated network accepts any keys. See the LoRaWAN_functs README for the real OTAA_keys.h.
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+uint8_t OTAA_KEY_APP_EUI[8] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+uint8_t OTAA_KEY_DEV_EUI[8] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+uint8_t OTAA_KEY_APP_KEY[16] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
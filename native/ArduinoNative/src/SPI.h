@@ -0,0 +1,24 @@
+#pragma once
+/**
+ * @file SPI.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the Arduino SPI library.
+ * The simulated flash doesn't use the bus, so it only needs to exist.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+#define SS 26 // RAK4631 SPI CS
+
+class SPIClass {
+  public:
+    void begin(void){};
+    void end(void){};
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,382 @@
+#include "Adafruit_BME680.h"
+#include "NativeSim.h"
+#include "SparkFun_SHTC3.h"
+#include "Wire.h"
+
+TwoWire Wire;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// SHTC3 (RAK1901)
+// The SHTC3 is simulated as an I2C device behind Wire, so it can be driven through the SparkFun library or directly.
+
+#define SHTC3_ADDRESS     0x70
+#define SHTC3_WAKEUP_US   240   // datasheet max wake up time
+#define SHTC3_MEAS_NPM_US 12100 // datasheet max normal power measurement time
+#define SHTC3_MEAS_LPM_US 800   // datasheet max low power measurement time
+#define SHTC3_POLL_US     100   // time between polls of a measurement in polling mode
+
+#define SHTC3_CMD_WAKEUP  0x3517
+#define SHTC3_CMD_SLEEP   0xB098
+#define SHTC3_CMD_RESET   0x805D
+#define SHTC3_CMD_READ_ID 0xEFC8
+
+/**
+ * @brief What the simulated SHTC3 returns on the next read.
+ */
+enum class SHTC3_PENDING : uint8_t { NONE, ID, MEASUREMENT };
+
+/**
+ * @brief The simulated SHTC3. It powers up idle (awake), as the real one does.
+ */
+static struct {
+    bool asleep;
+    uint64_t awake_us;                        /**< Accepts commands from this time, after a wake up. */
+    SHTC3_PENDING pending;                    /**< What the next read returns. */
+    SHTC3_MeasurementModes_TypeDef meas_mode; /**< Mode of the measurement, if one is pending. */
+    uint64_t ready_us;                        /**< Time the measurement is done. */
+} shtc3_device = { false, 0, SHTC3_PENDING::NONE, SHTC3_CMD_CSE_RHF_NPM, 0 };
+
+/**
+ * @brief SHTC3 CRC-8: polynomial 0x31, initialised to 0xFF.
+ */
+static uint8_t shtc3Crc(uint16_t word) {
+    uint8_t crc = 0xFF;
+    uint8_t bytes[2] = { (uint8_t)(word >> 8), (uint8_t)word };
+    for (uint8_t byte : bytes) {
+        crc ^= byte;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Put a word & its CRC into a read.
+ */
+static void shtc3PutWord(uint8_t *buffer, uint16_t word) {
+    buffer[0] = (uint8_t)(word >> 8);
+    buffer[1] = (uint8_t)word;
+    buffer[2] = shtc3Crc(word);
+}
+
+static bool shtc3LowPower(SHTC3_MeasurementModes_TypeDef mode) {
+    return ((mode == SHTC3_CMD_CSE_RHF_LPM) || (mode == SHTC3_CMD_CSE_TF_LPM) || (mode == SHTC3_CMD_CSD_RHF_LPM) ||
+            (mode == SHTC3_CMD_CSD_TF_LPM));
+}
+
+static bool shtc3ClockStretching(SHTC3_MeasurementModes_TypeDef mode) {
+    return ((mode == SHTC3_CMD_CSE_RHF_NPM) || (mode == SHTC3_CMD_CSE_RHF_LPM) || (mode == SHTC3_CMD_CSE_TF_NPM) ||
+            (mode == SHTC3_CMD_CSE_TF_LPM));
+}
+
+static bool shtc3TemperatureFirst(SHTC3_MeasurementModes_TypeDef mode) {
+    return ((mode == SHTC3_CMD_CSE_TF_NPM) || (mode == SHTC3_CMD_CSE_TF_LPM) || (mode == SHTC3_CMD_CSD_TF_NPM) ||
+            (mode == SHTC3_CMD_CSD_TF_LPM));
+}
+
+/**
+ * @brief A write to the simulated SHTC3.
+ * @return True if ACKed.
+ */
+static bool shtc3Write(const uint8_t *data, uint8_t length) {
+    uint64_t now_us = nativeSimMicros();
+    if (length != 2) {
+        return false;
+    }
+    uint16_t command = (uint16_t)((data[0] << 8) | data[1]);
+    if (shtc3_device.asleep) {
+        // only wakes up
+        if (command != SHTC3_CMD_WAKEUP) {
+            return false;
+        }
+        shtc3_device.asleep = false;
+        shtc3_device.awake_us = now_us + SHTC3_WAKEUP_US;
+        return true;
+    }
+    if ((now_us < shtc3_device.awake_us) ||
+        ((shtc3_device.pending == SHTC3_PENDING::MEASUREMENT) && (now_us < shtc3_device.ready_us))) {
+        // still waking up or measuring
+        return false;
+    }
+    switch (command) {
+        case SHTC3_CMD_WAKEUP:
+            return true;
+        case SHTC3_CMD_SLEEP:
+            shtc3_device.asleep = true;
+            shtc3_device.pending = SHTC3_PENDING::NONE;
+            return true;
+        case SHTC3_CMD_RESET:
+            shtc3_device.pending = SHTC3_PENDING::NONE;
+            return true;
+        case SHTC3_CMD_READ_ID:
+            shtc3_device.pending = SHTC3_PENDING::ID;
+            return true;
+        case SHTC3_CMD_CSE_RHF_NPM:
+        case SHTC3_CMD_CSE_RHF_LPM:
+        case SHTC3_CMD_CSE_TF_NPM:
+        case SHTC3_CMD_CSE_TF_LPM:
+        case SHTC3_CMD_CSD_RHF_NPM:
+        case SHTC3_CMD_CSD_RHF_LPM:
+        case SHTC3_CMD_CSD_TF_NPM:
+        case SHTC3_CMD_CSD_TF_LPM: {
+            SHTC3_MeasurementModes_TypeDef mode = (SHTC3_MeasurementModes_TypeDef)command;
+            shtc3_device.pending = SHTC3_PENDING::MEASUREMENT;
+            shtc3_device.meas_mode = mode;
+            shtc3_device.ready_us = now_us + (shtc3LowPower(mode) ? SHTC3_MEAS_LPM_US : SHTC3_MEAS_NPM_US);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief A read from the simulated SHTC3.
+ * @return Bytes read, 0 if NACKed.
+ */
+static uint8_t shtc3Read(uint8_t *buffer, uint8_t length) {
+    if (shtc3_device.asleep || (nativeSimMicros() < shtc3_device.awake_us)) {
+        return 0;
+    }
+    if ((shtc3_device.pending == SHTC3_PENDING::ID) && (length >= 3)) {
+        shtc3_device.pending = SHTC3_PENDING::NONE;
+        shtc3PutWord(buffer, 0x0807);
+        return 3;
+    }
+    if ((shtc3_device.pending != SHTC3_PENDING::MEASUREMENT) || (length < 6)) {
+        return 0;
+    }
+    uint64_t now_us = nativeSimMicros();
+    if (now_us < shtc3_device.ready_us) {
+        if (!shtc3ClockStretching(shtc3_device.meas_mode)) {
+            // polling mode NACKs until the measurement is done
+            return 0;
+        }
+        // clock stretching holds the bus (& the CPU) until it's done
+        nativeSimAdvanceMicros(shtc3_device.ready_us - now_us);
+    }
+    shtc3_device.pending = SHTC3_PENDING::NONE;
+    uint16_t t = (uint16_t)(((nativeSimTemperatureC() + 45) / 175) * 65535);
+    uint16_t rh = (uint16_t)((nativeSimHumidity() / 100) * 65535);
+    bool t_first = shtc3TemperatureFirst(shtc3_device.meas_mode);
+    shtc3PutWord(&buffer[0], t_first ? t : rh);
+    shtc3PutWord(&buffer[3], t_first ? rh : t);
+    return 6;
+}
+
+/**
+ * @brief Send a command to the SHTC3 through Wire, as the SparkFun library does.
+ * @return True if ACKed.
+ */
+static bool shtc3SendCommand(TwoWire &wire, uint16_t command) {
+    wire.beginTransmission(SHTC3_ADDRESS);
+    wire.write((uint8_t)(command >> 8));
+    wire.write((uint8_t)command);
+    return (wire.endTransmission() == 0);
+}
+
+/**
+ * @brief Read a word & check its CRC.
+ * @return True if the CRC passed.
+ */
+static bool shtc3ReadWord(TwoWire &wire, uint16_t *word) {
+    uint8_t msb = (uint8_t)wire.read();
+    uint8_t lsb = (uint8_t)wire.read();
+    uint8_t crc = (uint8_t)wire.read();
+    *word = (uint16_t)((msb << 8) | lsb);
+    return (shtc3Crc(*word) == crc);
+}
+
+SHTC3_Status_TypeDef SHTC3::begin(TwoWire &wirePort) {
+    wire = &wirePort;
+    wake();
+    passIDcrc = false;
+    lastStatus = SHTC3_Status_Error;
+    if (shtc3SendCommand(*wire, SHTC3_CMD_READ_ID) && (wire->requestFrom(SHTC3_ADDRESS, 3) == 3)) {
+        passIDcrc = shtc3ReadWord(*wire, &ID);
+        lastStatus = passIDcrc ? SHTC3_Status_Nominal : SHTC3_Status_CRC_Fail;
+    }
+    return lastStatus;
+}
+
+SHTC3_Status_TypeDef SHTC3::sleep(bool hold) {
+    (void)hold;
+    lastStatus = shtc3SendCommand(*wire, SHTC3_CMD_SLEEP) ? SHTC3_Status_Nominal : SHTC3_Status_Error;
+    if (lastStatus == SHTC3_Status_Nominal) {
+        asleep = true;
+    }
+    return lastStatus;
+}
+
+SHTC3_Status_TypeDef SHTC3::wake(bool hold) {
+    (void)hold;
+    lastStatus = shtc3SendCommand(*wire, SHTC3_CMD_WAKEUP) ? SHTC3_Status_Nominal : SHTC3_Status_Error;
+    if (lastStatus == SHTC3_Status_Nominal) {
+        delayMicroseconds(SHTC3_WAKEUP_US);
+        asleep = false;
+    }
+    return lastStatus;
+}
+
+SHTC3_Status_TypeDef SHTC3::setMode(SHTC3_MeasurementModes_TypeDef mode) {
+    this->mode = mode;
+    lastStatus = SHTC3_Status_Nominal;
+    return lastStatus;
+}
+
+SHTC3_Status_TypeDef SHTC3::update(void) {
+    if (asleep) {
+        wake();
+    }
+    lastStatus = SHTC3_Status_Error;
+    if (!shtc3SendCommand(*wire, mode)) {
+        return lastStatus;
+    }
+    // clock stretching modes wait in requestFrom(), polling modes poll until the measurement is done
+    uint8_t n_read = 0;
+    for (uint16_t polls = 0; (n_read != 6) && (polls <= (SHTC3_MEAS_NPM_US / SHTC3_POLL_US)); polls++) {
+        if (polls > 0) {
+            delayMicroseconds(SHTC3_POLL_US);
+        }
+        n_read = wire->requestFrom(SHTC3_ADDRESS, 6);
+    }
+    if (n_read != 6) {
+        return lastStatus;
+    }
+    bool t_first = shtc3TemperatureFirst(mode);
+    bool first_crc = shtc3ReadWord(*wire, t_first ? &T : &RH);
+    bool second_crc = shtc3ReadWord(*wire, t_first ? &RH : &T);
+    passTcrc = t_first ? first_crc : second_crc;
+    passRHcrc = t_first ? second_crc : first_crc;
+    lastStatus = (passTcrc && passRHcrc) ? SHTC3_Status_Nominal : SHTC3_Status_CRC_Fail;
+    return lastStatus;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Wire (I2C)
+
+void TwoWire::beginTransmission(uint8_t address) {
+    tx_address = address;
+    tx_length = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (tx_length >= WIRE_BUFFER_LENGTH) {
+        return 0;
+    }
+    tx_buffer[tx_length++] = data;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool send_stop) {
+    (void)send_stop;
+    bool acked = (tx_address == SHTC3_ADDRESS) && shtc3Write(tx_buffer, tx_length);
+    tx_length = 0;
+    return acked ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool send_stop) {
+    (void)send_stop;
+    rx_index = 0;
+    rx_length = 0;
+    if (quantity > WIRE_BUFFER_LENGTH) {
+        quantity = WIRE_BUFFER_LENGTH;
+    }
+    if (address == SHTC3_ADDRESS) {
+        rx_length = shtc3Read(rx_buffer, (uint8_t)quantity);
+    }
+    return rx_length;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// BME680 (RAK1906)
+
+bool Adafruit_BME680::begin(uint8_t addr, bool initSettings) {
+    (void)addr;
+    if (initSettings) {
+        os_temp = BME68X_OS_8X;
+        os_hum = BME68X_OS_2X;
+        os_pres = BME68X_OS_4X;
+        heater_time_ms = 150;
+    }
+    return true;
+}
+
+bool Adafruit_BME680::setTemperatureOversampling(uint8_t os) {
+    os_temp = os;
+    return (os <= BME68X_OS_16X);
+}
+
+bool Adafruit_BME680::setPressureOversampling(uint8_t os) {
+    os_pres = os;
+    return (os <= BME68X_OS_16X);
+}
+
+bool Adafruit_BME680::setHumidityOversampling(uint8_t os) {
+    os_hum = os;
+    return (os <= BME68X_OS_16X);
+}
+
+bool Adafruit_BME680::setIIRFilterSize(uint8_t fs) {
+    return (fs <= BME68X_FILTER_SIZE_127);
+}
+
+bool Adafruit_BME680::setGasHeater(uint16_t heaterTemp, uint16_t heaterTime) {
+    heater_time_ms = ((heaterTemp == 0) || (heaterTime == 0)) ? 0 : heaterTime;
+    return true;
+}
+
+uint32_t Adafruit_BME680::measurementDurationMs(void) {
+    // Same as bme68x_get_meas_dur() in the Bosch driver
+    const uint8_t os_to_meas_cycles[6] = { 0, 1, 2, 4, 8, 16 };
+    uint32_t meas_cycles = os_to_meas_cycles[os_temp] + os_to_meas_cycles[os_pres] + os_to_meas_cycles[os_hum];
+    uint32_t meas_dur_us = (meas_cycles * 1963) + (477 * 4) + (477 * 5) + 1000; // TPH + switching + wake up
+    return ((meas_dur_us / 1000) + heater_time_ms);
+}
+
+uint32_t Adafruit_BME680::beginReading(void) {
+    if (meas_start != 0) {
+        // A measurement is already in progress
+        return (meas_start + meas_period);
+    }
+    meas_start = millis();
+    if (meas_start == 0) {
+        meas_start = 1; // 0 means no reading in progress
+    }
+    meas_period = measurementDurationMs();
+    return (meas_start + meas_period);
+}
+
+int Adafruit_BME680::remainingReadingMillis(void) {
+    if (meas_start != 0) {
+        int remaining = (int)meas_period - (int)(millis() - meas_start);
+        return (remaining < 0) ? reading_complete : remaining;
+    }
+    return reading_not_started;
+}
+
+bool Adafruit_BME680::endReading(void) {
+    if (beginReading() == 0) {
+        return false;
+    }
+    int remaining = remainingReadingMillis();
+    if (remaining > 0) {
+        // the Adafruit library busy waits here
+        delay((uint32_t)remaining);
+    }
+    meas_start = 0;
+
+    temperature = (os_temp == BME68X_OS_NONE) ? NAN : nativeSimTemperatureC();
+    humidity = (os_hum == BME68X_OS_NONE) ? NAN : nativeSimHumidity();
+    pressure = (os_pres == BME68X_OS_NONE) ? 0 : nativeSimPressurePa();
+    gas_resistance = (heater_time_ms == 0) ? 0 : nativeSimGasResistance();
+    return true;
+}
+
+bool Adafruit_BME680::performReading(void) {
+    return endReading();
+}
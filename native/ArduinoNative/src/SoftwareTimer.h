@@ -0,0 +1,45 @@
+#pragma once
+/**
+ * @file SoftwareTimer.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the Adafruit nRF52 core's SoftwareTimer.
+ * Timers fire in simulated time while the sketch is sleeping in xSemaphoreTake() or delay().
+ *
+ * @version 0.1
+ * @date 2022-02-07
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+
+/** @brief State of a timer, also used as its TimerHandle_t. */
+struct NativeTimer {
+    uint32_t period_ms;
+    TimerCallbackFunction_t callback;
+    void *timer_id;
+    bool repeating;
+    bool active;
+    uint64_t expiry_us; /**< Simulated time the timer next fires. */
+};
+
+class SoftwareTimer {
+  public:
+    SoftwareTimer(void);
+    ~SoftwareTimer(void);
+
+    void begin(uint32_t ms, TimerCallbackFunction_t callback, void *timerID = NULL, bool repeating = true);
+    TimerHandle_t getHandle(void) { return &timer; };
+
+    void start(void);
+    void stop(void);
+    void reset(void);
+    void setPeriod(uint32_t ms);
+    void setID(void *id) { timer.timer_id = id; };
+    void *getID(void) { return timer.timer_id; };
+
+  private:
+    NativeTimer timer;
+};
@@ -0,0 +1,62 @@
+#pragma once
+/**
+ * @file SparkFun_SHTC3.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the SparkFun SHTC3 library (RAK1901).
+ * Talks to the simulated SHTC3 through Wire (see SensorsNative.cpp), whose readings come from the simulated environment
+ * in NativeSim.h and take the SHTC3's datasheet wake up & measurement times.
+ *
+ * @version 0.1
+ * @date 2022-02-07
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+typedef enum {
+    SHTC3_Status_Nominal = 0,
+    SHTC3_Status_Error,
+    SHTC3_Status_CRC_Fail,
+    SHTC3_Status_ID_Fail,
+} SHTC3_Status_TypeDef;
+
+typedef enum {
+    SHTC3_CMD_CSE_RHF_NPM = 0x5C24, // Clock stretching, RH first, Normal power mode
+    SHTC3_CMD_CSE_RHF_LPM = 0x44DE, // Clock stretching, RH first, Low power mode
+    SHTC3_CMD_CSE_TF_NPM = 0x7CA2,  // Clock stretching, T first, Normal power mode
+    SHTC3_CMD_CSE_TF_LPM = 0x6458,  // Clock stretching, T first, Low power mode
+    SHTC3_CMD_CSD_RHF_NPM = 0xE058, // Polling, RH first, Normal power mode
+    SHTC3_CMD_CSD_RHF_LPM = 0x401A, // Polling, RH first, Low power mode
+    SHTC3_CMD_CSD_TF_NPM = 0x7866,  // Polling, T first, Normal power mode
+    SHTC3_CMD_CSD_TF_LPM = 0x609C,  // Polling, T first, Low power mode
+} SHTC3_MeasurementModes_TypeDef;
+
+class SHTC3 {
+  public:
+    SHTC3_Status_TypeDef lastStatus = SHTC3_Status_Nominal;
+    bool passRHcrc = false;
+    bool passTcrc = false;
+    bool passIDcrc = false;
+    uint16_t RH = 0;
+    uint16_t T = 0;
+    uint16_t ID = 0;
+
+    SHTC3_Status_TypeDef begin(TwoWire &wirePort = Wire);
+    SHTC3_Status_TypeDef sleep(bool hold = true);
+    SHTC3_Status_TypeDef wake(bool hold = true);
+    SHTC3_Status_TypeDef setMode(SHTC3_MeasurementModes_TypeDef mode = SHTC3_CMD_CSE_RHF_NPM);
+    SHTC3_MeasurementModes_TypeDef getMode(void) { return mode; };
+    SHTC3_Status_TypeDef update(void);
+    bool isConnected(void) { return true; };
+
+    float toDegC(void) { return -45 + 175 * ((float)T / 65535); };
+    float toDegF(void) { return (toDegC() * 1.8F) + 32; };
+    float toPercent(void) { return 100 * ((float)RH / 65535); };
+
+  private:
+    TwoWire *wire = &Wire;
+    SHTC3_MeasurementModes_TypeDef mode = SHTC3_CMD_CSE_RHF_NPM;
+    bool asleep = false;
+};
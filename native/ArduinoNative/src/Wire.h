@@ -0,0 +1,69 @@
+#pragma once
+/**
+ * @file Wire.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the Arduino I2C (Wire) library.
+ * Transfers go to the simulated I2C devices in SensorsNative.cpp (currently the SHTC3 of the RAK1901). A device that
+ * NACKs its address, e.g. an SHTC3 that's asleep or still measuring in polling mode, fails the transfer as on a real bus.
+ *
+ * @version 0.1
+ * @date 2022-02-07
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WIRE_BUFFER_LENGTH 32
+
+class TwoWire {
+  public:
+    void begin(void){};
+    void end(void){};
+    void setClock(uint32_t clock) { (void)clock; };
+
+    /**
+     * @brief Start a write to a device, sent by endTransmission().
+     */
+    void beginTransmission(uint8_t address);
+
+    /**
+     * @brief Queue a byte of the write.
+     * @return 1, or 0 if the buffer is full.
+     */
+    size_t write(uint8_t data);
+
+    /**
+     * @brief Send the write.
+     * @return 0 if successful, 2 if the address was NACKed.
+     */
+    uint8_t endTransmission(bool send_stop = true);
+
+    /**
+     * @brief Read from a device.
+     * @return Bytes read, 0 if the address was NACKed.
+     */
+    uint8_t requestFrom(uint8_t address, size_t quantity, bool send_stop = true);
+
+    /**
+     * @brief Bytes left of the last requestFrom().
+     */
+    int available(void) { return (rx_length - rx_index); };
+
+    /**
+     * @brief Next byte of the last requestFrom().
+     * @return The byte, or -1 if there are none left.
+     */
+    int read(void) { return (rx_index < rx_length) ? rx_buffer[rx_index++] : -1; };
+
+  private:
+    uint8_t tx_address = 0;
+    uint8_t tx_buffer[WIRE_BUFFER_LENGTH] = {};
+    uint8_t tx_length = 0;
+    uint8_t rx_buffer[WIRE_BUFFER_LENGTH] = {};
+    uint8_t rx_length = 0;
+    uint8_t rx_index = 0;
+};
+
+extern TwoWire Wire;
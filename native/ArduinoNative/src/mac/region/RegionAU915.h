@@ -0,0 +1,43 @@
+#pragma once
+/**
+ * @file RegionAU915.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the AU915 regional parameters of the SX126x-Arduino LoRaMac
+ * (mac/region/RegionAU915.h), just the datarate limits & tables this repo reads. The values are the stack's:
+ * LoRaWAN Regional Parameters RP002 AU915-928, without the uplink dwell time limit. DR_7 is RFU, DR_8 - DR_13 are the
+ * downlink datarates.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+#include "LoRaWan-RAK4630.h"
+
+#define AU915_TX_MIN_DATARATE DR_0 /**< Slowest uplink datarate. */
+#define AU915_TX_MAX_DATARATE DR_6 /**< Fastest uplink datarate. */
+
+/** Spreading factor of each datarate, 0 if RFU. */
+static const uint8_t DataratesAU915[] = { 12, 11, 10, 9, 8, 7, 8, 0, 12, 11, 10, 9, 8, 7, 0, 0 };
+
+/** Bandwidth of each datarate in Hz, 0 if RFU. */
+static const uint32_t BandwidthsAU915[] = { 125000, 125000, 125000, 125000, 125000, 125000, 500000, 0,
+                                            500000, 500000, 500000, 500000, 500000, 500000, 0,      0 };
+
+/** Max application payload of each datarate, 0 if RFU. */
+static const uint8_t MaxPayloadOfDatarateAU915[] = { 51, 51,  51,  115, 242, 242, 242, 0,
+                                                     53, 129, 242, 242, 242, 242, 0,   0 };
+
+/** Downlink datarate in RX1 for each uplink datarate (DR_0 - DR_6) & RX1 datarate offset (0 - 5). */
+static const int8_t DatarateOffsetsAU915[7][6] = {
+    { DR_8, DR_8, DR_8, DR_8, DR_8, DR_8 },      // DR_0
+    { DR_9, DR_8, DR_8, DR_8, DR_8, DR_8 },      // DR_1
+    { DR_10, DR_9, DR_8, DR_8, DR_8, DR_8 },     // DR_2
+    { DR_11, DR_10, DR_9, DR_8, DR_8, DR_8 },    // DR_3
+    { DR_12, DR_11, DR_10, DR_9, DR_8, DR_8 },   // DR_4
+    { DR_13, DR_12, DR_11, DR_10, DR_9, DR_8 },  // DR_5
+    { DR_13, DR_13, DR_12, DR_11, DR_10, DR_9 }, // DR_6
+};
@@ -0,0 +1,129 @@
+#pragma once
+/**
+ * @file nrf.h
+ * @author Kalina Knight
+ * @brief Host (native) stand-in for the parts of the nRF52840 MDK used by this repo: the SAADC registers.
+ * Writing a task runs it straight away in simulated time, which sets its events, so code that polls the events works
+ * unchanged. SAMPLE converts every enabled channel from the simulated pin voltages, taking the acquisition & conversion
+ * time of each, and writes the results to RAM as EasyDMA would. Only single ended, task triggered sampling is modelled.
+ *
+ * The register & field names & values are the MDK's, except RESULT.PTR is wide enough for a host pointer.
+ *
+ * @version 0.1
+ * @date 2022-02-16
+ *
+ * @copyright (c) 2021 Kalina Knight - MIT License
+ */
+
+#include <stdint.h>
+
+// SAADC channel inputs
+#define SAADC_CH_PSELP_PSELP_NC           0
+#define SAADC_CH_PSELP_PSELP_AnalogInput0 1
+#define SAADC_CH_PSELP_PSELP_AnalogInput1 2
+#define SAADC_CH_PSELP_PSELP_AnalogInput2 3
+#define SAADC_CH_PSELP_PSELP_AnalogInput3 4
+#define SAADC_CH_PSELP_PSELP_AnalogInput4 5
+#define SAADC_CH_PSELP_PSELP_AnalogInput5 6
+#define SAADC_CH_PSELP_PSELP_AnalogInput6 7
+#define SAADC_CH_PSELP_PSELP_AnalogInput7 8
+#define SAADC_CH_PSELN_PSELN_NC           0
+
+// SAADC channel configuration
+#define SAADC_CH_CONFIG_RESP_Pos        0
+#define SAADC_CH_CONFIG_RESP_Bypass     0
+#define SAADC_CH_CONFIG_RESN_Pos        4
+#define SAADC_CH_CONFIG_RESN_Bypass     0
+#define SAADC_CH_CONFIG_GAIN_Pos        8
+#define SAADC_CH_CONFIG_GAIN_Msk        (0x7UL << SAADC_CH_CONFIG_GAIN_Pos)
+#define SAADC_CH_CONFIG_GAIN_Gain1_6    0
+#define SAADC_CH_CONFIG_GAIN_Gain1_5    1
+#define SAADC_CH_CONFIG_GAIN_Gain1_4    2
+#define SAADC_CH_CONFIG_GAIN_Gain1_3    3
+#define SAADC_CH_CONFIG_GAIN_Gain1_2    4
+#define SAADC_CH_CONFIG_GAIN_Gain1      5
+#define SAADC_CH_CONFIG_GAIN_Gain2      6
+#define SAADC_CH_CONFIG_GAIN_Gain4      7
+#define SAADC_CH_CONFIG_REFSEL_Pos      12
+#define SAADC_CH_CONFIG_REFSEL_Msk      (0x1UL << SAADC_CH_CONFIG_REFSEL_Pos)
+#define SAADC_CH_CONFIG_REFSEL_Internal 0
+#define SAADC_CH_CONFIG_REFSEL_VDD1_4   1
+#define SAADC_CH_CONFIG_TACQ_Pos        16
+#define SAADC_CH_CONFIG_TACQ_Msk        (0x7UL << SAADC_CH_CONFIG_TACQ_Pos)
+#define SAADC_CH_CONFIG_TACQ_3us        0
+#define SAADC_CH_CONFIG_TACQ_5us        1
+#define SAADC_CH_CONFIG_TACQ_10us       2
+#define SAADC_CH_CONFIG_TACQ_15us       3
+#define SAADC_CH_CONFIG_TACQ_20us       4
+#define SAADC_CH_CONFIG_TACQ_40us       5
+#define SAADC_CH_CONFIG_MODE_Pos        20
+#define SAADC_CH_CONFIG_MODE_SE         0
+#define SAADC_CH_CONFIG_BURST_Pos       24
+#define SAADC_CH_CONFIG_BURST_Disabled  0
+#define SAADC_CH_CONFIG_BURST_Enabled   1
+
+// SAADC resolution & oversampling, shared by every channel
+#define SAADC_RESOLUTION_VAL_8bit          0
+#define SAADC_RESOLUTION_VAL_10bit         1
+#define SAADC_RESOLUTION_VAL_12bit         2
+#define SAADC_RESOLUTION_VAL_14bit         3
+#define SAADC_OVERSAMPLE_OVERSAMPLE_Bypass 0 // 2^OVERSAMPLE samples are averaged, up to Over256x = 8
+#define SAADC_OVERSAMPLE_OVERSAMPLE_Over2x 1
+#define SAADC_OVERSAMPLE_OVERSAMPLE_Over4x 2
+#define SAADC_OVERSAMPLE_OVERSAMPLE_Over8x 3
+#define SAADC_SAMPLERATE_MODE_Pos          12
+#define SAADC_SAMPLERATE_MODE_Task         0
+#define SAADC_ENABLE_ENABLE_Disabled       0
+#define SAADC_ENABLE_ENABLE_Enabled        1
+
+#define SAADC_CH_NUM 8 /**< Channels of the SAADC. */
+
+/**
+ * @brief A task register: writing it runs the task.
+ */
+struct nativeTask {
+    void (*trigger)(void);
+    nativeTask &operator=(uint32_t value) {
+        if (value != 0) {
+            trigger();
+        }
+        return *this;
+    };
+};
+
+// SAADC tasks, run by writing their registers
+void nativeSAADCStart(void);
+void nativeSAADCSample(void);
+void nativeSAADCStop(void);
+
+/**
+ * @brief SAADC registers.
+ */
+typedef struct {
+    nativeTask TASKS_START = { nativeSAADCStart };
+    nativeTask TASKS_SAMPLE = { nativeSAADCSample };
+    nativeTask TASKS_STOP = { nativeSAADCStop };
+    volatile uint32_t EVENTS_STARTED;
+    volatile uint32_t EVENTS_END;
+    volatile uint32_t EVENTS_DONE;
+    volatile uint32_t EVENTS_RESULTDONE;
+    volatile uint32_t EVENTS_STOPPED;
+    volatile uint32_t ENABLE;
+    struct {
+        volatile uint32_t PSELP;
+        volatile uint32_t PSELN;
+        volatile uint32_t CONFIG;
+        volatile uint32_t LIMIT;
+    } CH[SAADC_CH_NUM];
+    volatile uint32_t RESOLUTION;
+    volatile uint32_t OVERSAMPLE;
+    volatile uint32_t SAMPLERATE;
+    struct {
+        volatile uintptr_t PTR; // uint32_t on the nRF52
+        volatile uint32_t MAXCNT;
+        volatile uint32_t AMOUNT;
+    } RESULT;
+} NRF_SAADC_Type;
+
+extern NRF_SAADC_Type native_saadc;
+#define NRF_SAADC (&native_saadc)
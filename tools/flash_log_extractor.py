@@ -0,0 +1,120 @@
+"""
+Extracts the records of a flash log (see lib/FlashLog/src/FlashLog.h) from a flash image, oldest first.
+
+The image can be a full read of the flash, a flashLog::dump() captured from Serial or a native run's flash image, as
+long as the sectors are 4096 byte aligned. The sectors are found by their headers & put in order by sequence number,
+then the records are checked against their CRCs. Bad records (e.g. a write cut short by a reset) are skipped.
+
+The log records (FLOG) are one byte stream, so they're written out as is: text logs can be read straight away and
+binary logs can be piped into tools/log_decoder.py. The sample queue's records (FSMP, see lib/FlashLog/src/SampleQueue.h)
+can be printed one per line with --magic FSMP --records. The counters (sectors, records, erase counts) go to stderr.
+
+Usage:
+    python tools/flash_log_extractor.py <image file, or - for stdin> [--magic FLOG] [--records] [-o <output file>]
+
+e.g. the flash log example on the native environment:
+    <program> 86400000 flash.bin
+    python tools/flash_log_extractor.py flash.bin
+    python tools/flash_log_extractor.py flash.bin | python tools/log_decoder.py -
+"""
+
+import argparse
+import struct
+import sys
+
+SECTOR_SIZE = 4096
+PAGE_SIZE = 256
+SECTOR_HEADER = struct.Struct("<IIIHH")  # magic, sequence, erase count, reserved, CRC
+RECORD_HEADER_LENGTH = 3
+ERASED = 0xFF
+
+
+def crc16(data, crc=0xFFFF):
+    """Same as flashLogCRC() in FlashLog.cpp: CRC-16/CCITT-FALSE."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def magic_number(magic):
+    """Turns a 4 char magic (e.g. FLOG) into the number in the sector headers."""
+    return struct.unpack("<I", magic.encode("ascii"))[0]
+
+
+def find_sectors(image, magic):
+    """Returns [(sequence, erase count, offset)] of the valid sectors of the log, oldest first."""
+    sectors = []
+    for offset in range(0, len(image) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        sector_magic, sequence, erase_count, _, crc = SECTOR_HEADER.unpack_from(image, offset)
+        if (sector_magic == magic) and (crc == crc16(image[offset:offset + SECTOR_HEADER.size - 2])):
+            sectors.append((sequence, erase_count, offset))
+    sectors.sort()
+    # a dump can hold the same sector twice if it was taken while logging, keep the first
+    unique = []
+    for sector in sectors:
+        if not unique or unique[-1][0] != sector[0]:
+            unique.append(sector)
+    return unique
+
+
+def read_records(image, sector_offset, counters):
+    """Yields the data of the good records in a sector, in the same way as flashLog::findPageEnd()."""
+    for page_offset in range(0, SECTOR_SIZE, PAGE_SIZE):
+        page = image[sector_offset + page_offset:sector_offset + page_offset + PAGE_SIZE]
+        position = SECTOR_HEADER.size if page_offset == 0 else 0
+        while position + RECORD_HEADER_LENGTH < PAGE_SIZE:
+            length = page[position]
+            if length == ERASED:
+                break
+            end = position + RECORD_HEADER_LENGTH + length
+            data = page[position + RECORD_HEADER_LENGTH:end]
+            crc = struct.unpack_from("<H", page, position + 1)[0]
+            if (length == 0) or (end > PAGE_SIZE) or (crc != crc16(data, crc16(page[position:position + 1]))):
+                counters["bad records"] += 1
+                break  # the rest of the page can't be trusted
+            counters["records"] += 1
+            counters["bytes"] += length
+            yield data
+            position = end
+
+
+def extract(image, magic, output, as_records):
+    """Writes the records to output, returns the counters."""
+    counters = {"sectors": 0, "records": 0, "bytes": 0, "bad records": 0}
+    sectors = find_sectors(image, magic)
+    counters["sectors"] = len(sectors)
+    if sectors:
+        erase_counts = [erase_count for _, erase_count, _ in sectors]
+        counters["sequence"] = "%d - %d" % (sectors[0][0], sectors[-1][0])
+        counters["erase count"] = "%d - %d" % (min(erase_counts), max(erase_counts))
+        gaps = sectors[-1][0] - sectors[0][0] + 1 - len(sectors)
+        if gaps:
+            counters["missing sectors"] = gaps
+    for _, _, offset in sectors:
+        for data in read_records(image, offset, counters):
+            if as_records:
+                output.write(data.hex(" ").encode("ascii") + b"\n")
+            else:
+                output.write(data)
+    return counters
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image", help="flash image or dump, or - to read stdin")
+    parser.add_argument("--magic", default="FLOG", help="4 char magic of the log's sectors (default: FLOG, the logs)")
+    parser.add_argument("--records", action="store_true", help="print each record in hex on its own line instead")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+    if args.image == "-":
+        image_bytes = sys.stdin.buffer.read()
+    else:
+        with open(args.image, "rb") as f:
+            image_bytes = f.read()
+    out = open(args.output, "wb") if args.output else sys.stdout.buffer
+    stats = extract(image_bytes, magic_number(args.magic), out, args.records)
+    out.flush()
+    print(", ".join("%s: %s" % item for item in stats.items()), file=sys.stderr)
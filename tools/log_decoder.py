@@ -0,0 +1,202 @@
+"""
+Decodes binary logs (APP_LOG_FORMAT = LOG_FORMAT_BINARY, see lib/Logging/src/BinaryLog.h) back into the text logs:
+    {H:MM:SS.ms} LOG_LEVEL: message
+
+The records only hold the ID of their format string, so the format strings are found by searching the source for
+LOG(LOG_LEVEL::<level>, "<format>", ...) calls and hashing them the same way as logStringId(). The source must be the
+same as the firmware was built from. Anything in the capture that isn't a record (e.g. other prints) is passed through.
+
+Usage:
+    python tools/log_decoder.py <capture file, or - for stdin> [--src <dir> ...]
+
+e.g. decode a native run, or a Serial capture from the board (miniterm/pio device monitor can log to a file):
+    .pio/build/native/program | python tools/log_decoder.py -
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+RECORD_SYNC = 0xA5
+RECORD_HEADER_LENGTH = 11
+
+LEVELS = {1: "ERROR", 2: " WARN", 3: " INFO", 4: "DEBUG"}  # padded like the text logs
+ARG_WORD, ARG_DWORD, ARG_STRING = 0, 1, 2
+
+SOURCE_EXTENSIONS = (".c", ".cpp", ".h", ".hpp", ".ino")
+LOG_CALL = re.compile(r'\bLOG\s*\(\s*LOG_LEVEL::\w+\s*,\s*((?:"(?:[^"\\\n]|\\.)*"\s*)+)')
+STRING_LITERAL = re.compile(r'"((?:[^"\\\n]|\\.)*)"')
+ESCAPE = re.compile(r'\\(x[0-9a-fA-F]+|[0-7]{1,3}|.)')
+SIMPLE_ESCAPES = {"n": 10, "t": 9, "r": 13, "0": 0, "a": 7, "b": 8, "f": 12, "v": 11, "\\": 92, "'": 39, '"': 34,
+                  "?": 63}
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcsp%])")
+
+
+def unescape(literal):
+    """Returns the bytes of the chars in a C string literal (without the quotes)."""
+    def replace(match):
+        escape = match.group(1)
+        if escape[0] == "x":
+            return chr(int(escape[1:], 16) & 0xFF)
+        if escape[0] in "01234567":
+            return chr(int(escape, 8) & 0xFF)
+        return chr(SIMPLE_ESCAPES.get(escape, ord(escape)))
+    return ESCAPE.sub(replace, literal).encode("latin-1")
+
+
+def string_id(format_bytes):
+    """Same as logStringId() in BinaryLog.h: the 32 bit FNV-1a hash."""
+    hash_value = 2166136261
+    for byte in format_bytes:
+        hash_value = ((hash_value ^ byte) * 16777619) & 0xFFFFFFFF
+    return hash_value
+
+
+def read_format_strings(source_dirs):
+    """Returns {ID: format string} for every LOG() call in the source."""
+    formats = {}
+    for source_dir in source_dirs:
+        for root, _, files in os.walk(source_dir):
+            for name in files:
+                if not name.endswith(SOURCE_EXTENSIONS):
+                    continue
+                with open(os.path.join(root, name), encoding="utf-8", errors="replace") as f:
+                    source = f.read()
+                for call in LOG_CALL.finditer(source):
+                    format_bytes = b"".join(unescape(s) for s in STRING_LITERAL.findall(call.group(1)))
+                    format_id = string_id(format_bytes)
+                    if formats.get(format_id, format_bytes) != format_bytes:
+                        print("warning: log format ID 0x%08x used by both %r and %r" %
+                              (format_id, formats[format_id], format_bytes), file=sys.stderr)
+                    formats[format_id] = format_bytes
+    return formats
+
+
+def read_args(data, n_args):
+    """Returns the list of (type, bytes) args of a record from its data after the header, or None if it's malformed."""
+    n_type_bytes = (n_args + 3) // 4
+    if len(data) < n_type_bytes:
+        return None
+    args = []
+    position = n_type_bytes
+    for i in range(n_args):
+        arg_type = (data[i // 4] >> (2 * (i % 4))) & 0x3
+        if arg_type == ARG_STRING:
+            if position >= len(data):
+                return None
+            length = 1 + data[position]
+            args.append((arg_type, data[position + 1:position + length]))
+        elif arg_type in (ARG_WORD, ARG_DWORD):
+            length = 4 if arg_type == ARG_WORD else 8
+            args.append((arg_type, data[position:position + length]))
+        else:
+            return None
+        position += length
+    return args if position == len(data) else None
+
+
+def arg_value(arg, conversion):
+    """Converts a raw arg to a python value to print with the given printf conversion."""
+    arg_type, raw = arg
+    if arg_type == ARG_STRING:
+        return raw.decode("latin-1") if conversion == "s" else 0
+    if conversion in "eEfFgGaA":
+        return struct.unpack("<f" if arg_type == ARG_WORD else "<d", raw)[0]
+    signed = conversion in "di"
+    if arg_type == ARG_WORD:
+        return struct.unpack("<i" if signed else "<I", raw)[0]
+    return struct.unpack("<q" if signed else "<Q", raw)[0]
+
+
+def format_message(format_bytes, args):
+    """printf for the decoded args."""
+    args = list(args)
+    output = []
+    position = 0
+    fmt = format_bytes.decode("latin-1")
+    for conversion in CONVERSION.finditer(fmt):
+        output.append(fmt[position:conversion.start()])
+        position = conversion.end()
+        flags, width, precision, _, specifier = conversion.groups()
+        if specifier == "%":
+            output.append("%")
+            continue
+        if width == "*":
+            width = str(arg_value(args.pop(0), "d")) if args else ""
+        if precision == "*":
+            precision = str(arg_value(args.pop(0), "d")) if args else ""
+        if not args:
+            output.append(conversion.group(0))  # missing arg, leave it as it is
+            continue
+        value = arg_value(args.pop(0), specifier)
+        if specifier == "p":
+            flags, specifier = flags + "#", "x"
+        elif specifier in "aA":
+            specifier = "e"
+        elif specifier == "c":
+            value = chr(value & 0xFF)
+        python_format = "%" + flags + (width or "") + ("" if precision is None else "." + precision) + specifier
+        output.append(python_format % value)
+    output.append(fmt[position:])
+    return "".join(output)
+
+
+def format_timestamp(timestamp):
+    """Same as formatTimestamp() in Logging.cpp."""
+    return "%lu:%02lu:%02lu.%03lu" % (timestamp // 3600000, (timestamp % 3600000) // 60000,
+                                      (timestamp % 60000) // 1000, timestamp % 1000)
+
+
+def decode(capture, formats, output):
+    """Writes the text logs for the records in the capture to output, passing through everything else."""
+    position = 0
+    text_start = 0
+    while position < len(capture):
+        record = decode_record(capture, position, formats)
+        if record is None:
+            position += 1
+            continue
+        line, length = record
+        output.write(capture[text_start:position].decode("latin-1"))
+        output.write(line + "\n")
+        position += length
+        text_start = position
+    output.write(capture[text_start:].decode("latin-1"))
+
+
+def decode_record(capture, position, formats):
+    """Returns (text log, record length) if there's a valid record at position, else None."""
+    if (capture[position] != RECORD_SYNC) or (position + RECORD_HEADER_LENGTH > len(capture)):
+        return None
+    length = capture[position + 1]
+    level = capture[position + 2] & 0x0F
+    n_args = capture[position + 2] >> 4
+    format_id, timestamp = struct.unpack_from("<II", capture, position + 3)
+    if (length < RECORD_HEADER_LENGTH) or (position + length > len(capture)) or (level not in LEVELS):
+        return None
+    args = read_args(capture[position + RECORD_HEADER_LENGTH:position + length], n_args)
+    if args is None:
+        return None
+    if format_id in formats:
+        message = format_message(formats[format_id], args)
+    else:
+        message = "<unknown log format ID 0x%08x, args: %s>" % (format_id, " ".join(raw.hex() for _, raw in args))
+    return "{%s} %s: %s" % (format_timestamp(timestamp), LEVELS[level], message), length
+
+
+if __name__ == "__main__":
+    repo_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    default_src = [os.path.join(repo_dir, d) for d in ("lib", "src", "examples", "benchmarks")]
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", help="captured binary logs, or - to read stdin")
+    parser.add_argument("--src", nargs="+", default=default_src, help="source directories to search for LOG() calls "
+                        "(default: lib src examples benchmarks)")
+    args = parser.parse_args()
+    if args.capture == "-":
+        capture_bytes = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, "rb") as f:
+            capture_bytes = f.read()
+    decode(capture_bytes, read_format_strings(args.src), sys.stdout)
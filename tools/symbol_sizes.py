@@ -0,0 +1,91 @@
+"""
+Prints the flash (code size) and RAM (stack usage) cost of functions in a built program.
+
+Flash comes from the symbol sizes reported by nm. Stack comes from the .su files gcc writes when built with
+-fstack-usage (see the *_bench environments in platformio.ini). Functions that have been inlined into their callers
+don't have a symbol of their own, so their cost is included in the caller.
+
+Used as a PlatformIO post build script:
+    extra_scripts = post:tools/symbol_sizes.py
+    custom_symbol_sizes_filter = <regex of demangled function names>
+
+Or standalone:
+    python tools/symbol_sizes.py <program/firmware.elf> [build dir] [--nm <nm>] [--filter <regex>]
+"""
+
+import argparse
+import glob
+import os
+import re
+import subprocess
+
+DEFAULT_FILTER = (r"sensorPortSchema::(encode|decode)Data|(encode|decode)DataWithSchema|(Encode|Decode)DataWithSchema"
+                  r"|(encode|decode)FixedWidth|fieldCodec<.*>::(encode|decode)|portSchema::(encode|decode)")
+
+
+def read_symbol_sizes(nm, program, name_filter):
+    """Returns {demangled function name: size in bytes} for the functions matching name_filter."""
+    output = subprocess.run([nm, "-S", "-C", "--size-sort", program], capture_output=True, text=True, check=True)
+    sizes = {}
+    for line in output.stdout.splitlines():
+        parts = line.split(maxsplit=3)
+        if (len(parts) == 4) and (parts[2] in "tTwW") and re.search(name_filter, parts[3]):
+            sizes[parts[3]] = int(parts[1], 16)
+    return sizes
+
+
+def read_stack_usage(build_dir, name_filter):
+    """Returns {function name: stack bytes} from the .su files in build_dir for functions matching name_filter."""
+    usage = {}
+    for su_file in glob.glob(os.path.join(build_dir, "**", "*.su"), recursive=True):
+        with open(su_file) as f:
+            for line in f:
+                # <file>:<line>:<col>:<function>\t<bytes>\t<static|dynamic|bounded>
+                location, _, rest = line.rstrip("\n").partition("\t")
+                function = location.split(":", 3)[-1]
+                if re.search(name_filter, function):
+                    usage[function] = int(rest.split("\t")[0])
+    return usage
+
+
+def normalise(name):
+    """Reduces a function name to "scope::name(arg types)" so nm & .su names can be matched up."""
+    name = re.sub(r"^.*?([\w:]+\()", r"\1", name)  # drop any return type
+    name = re.sub(r"\s+", "", name)
+    for c_type, int_type in (("unsignedchar", "uint8_t"), ("unsignedshort", "uint16_t"), ("unsignedint", "uint32_t"),
+                             ("unsignedlong", "uint32_t")):
+        name = name.replace(c_type, int_type)
+    return re.sub(r"(\w+)const\*", r"const\1*", name)  # nm: "T const*", gcc: "const T*"
+
+
+def print_costs(nm, program, build_dir, name_filter=DEFAULT_FILTER):
+    sizes = read_symbol_sizes(nm, program, name_filter)
+    stack = {normalise(name): size for name, size in read_stack_usage(build_dir, name_filter).items()}
+
+    print("\nFlash & stack cost of functions matching '%s' in %s" % (name_filter, program))
+    print("%-100s %10s %10s" % ("function", "flash (B)", "stack (B)"))
+    for name, size in sorted(sizes.items()):
+        stack_bytes = stack.get(normalise(name))
+        print("%-100s %10d %10s" % (name, size, "-" if stack_bytes is None else stack_bytes))
+    if not sizes:
+        print("(no matching functions - they may have all been inlined)")
+
+
+def post_build_action(source, target, env):
+    nm = re.sub(r"g(cc|\+\+)$", "nm", env.subst("$CC"))
+    name_filter = env.GetProjectOption("custom_symbol_sizes_filter", DEFAULT_FILTER)
+    print_costs(nm, target[0].get_abspath(), env.subst("$BUILD_DIR"), name_filter)
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    env.AddPostAction("$PROGPATH", post_build_action)  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+        parser.add_argument("program", help="built program or firmware.elf")
+        parser.add_argument("build_dir", nargs="?", help="directory to search for .su files (default: program's)")
+        parser.add_argument("--nm", default="nm", help="nm to use e.g. arm-none-eabi-nm (default: nm)")
+        parser.add_argument("--filter", default=DEFAULT_FILTER, help="regex of function names to include")
+        args = parser.parse_args()
+        print_costs(args.nm, args.program, args.build_dir or os.path.dirname(args.program), args.filter)